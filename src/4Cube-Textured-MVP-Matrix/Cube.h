@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+// unit cube as a plain triangle list (no index buffer), 6 faces * 2 triangles
+const std::vector<Vertex3D_UV> cubeVertices = {
+// Front face - два треугольника
+{{{-1.0f, -1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Bottom left
+{{{ 1.0f, -1.0f,  1.0f}}, {{1.0f, 1.0f}}}, // Bottom right
+{{{ 1.0f,  1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Top right
+
+{{{-1.0f, -1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Bottom left
+{{{ 1.0f,  1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Top right
+{{{-1.0f,  1.0f,  1.0f}}, {{0.0f, 0.0f}}}, // Top left
+
+// Back face - два треугольника (reverse texture coordinates)
+{{{ 1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f}}}, // Bottom right
+{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Bottom left
+{{{-1.0f,  1.0f, -1.0f}}, {{0.0f, 0.0f}}}, // Top left
+
+{{{ 1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f}}}, // Bottom right
+{{{-1.0f,  1.0f, -1.0f}}, {{0.0f, 0.0f}}}, // Top left
+{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Top right
+
+// Left face - два треугольника
+{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Bottom front
+{{{-1.0f, -1.0f,  1.0f}}, {{1.0f, 1.0f}}}, // Bottom back
+{{{-1.0f,  1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Top back
+
+{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Bottom front
+{{{-1.0f,  1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Top back
+{{{-1.0f,  1.0f, -1.0f}}, {{0.0f, 0.0f}}}, // Top front
+
+// Right face - два треугольника
+{{{ 1.0f, -1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Bottom front
+{{{ 1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f}}}, // Bottom back
+{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Top back
+
+{{{ 1.0f, -1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Bottom front
+{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Top back
+{{{ 1.0f,  1.0f,  1.0f}}, {{0.0f, 0.0f}}}, // Top front
+
+// Top face - два треугольника
+{{{-1.0f,  1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Front left
+{{{ 1.0f,  1.0f,  1.0f}}, {{1.0f, 1.0f}}}, // Front right
+{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Back right
+
+{{{-1.0f,  1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Front left
+{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Back right
+{{{-1.0f,  1.0f, -1.0f}}, {{0.0f, 0.0f}}}, // Back left
+
+// Bottom face - два треугольника
+{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Front left
+{{{ 1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f}}}, // Front right
+{{{ 1.0f, -1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Back right
+
+{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Front left
+{{{ 1.0f, -1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Back right
+{{{-1.0f, -1.0f,  1.0f}}, {{0.0f, 0.0f}}}  // Back left
+};
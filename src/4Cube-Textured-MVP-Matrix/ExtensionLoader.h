@@ -44,6 +44,9 @@ void unloadExternalMemoryWin32Commands( VkDevice device );
 void loadDedicatedAllocationCommands( VkDevice device );
 void unloadDedicatedAllocationCommands( VkDevice device );
 
+void loadDrawIndirectCountCommands( VkDevice device );
+void unloadDrawIndirectCountCommands( VkDevice device );
+
 ////////////////////////////////////////////////////////
 
 std::unordered_map< VkInstance, std::vector<const char*> > instanceExtensionsMap;
@@ -98,6 +101,7 @@ void loadDeviceExtensionsCommands( const VkDevice device, const std::vector<cons
 		if( strcmp( e, VK_KHR_EXTERNAL_MEMORY_WIN32_EXTENSION_NAME ) == 0 ) loadExternalMemoryWin32Commands( device );
 #endif
 		if( strcmp( e, VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME ) == 0 ) loadDedicatedAllocationCommands( device );
+		if( strcmp( e, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME ) == 0 ) loadDrawIndirectCountCommands( device );
 		// ...
 	}
 }
@@ -111,6 +115,7 @@ void unloadDeviceExtensionsCommands( const VkDevice device ){
 		if( strcmp( e, VK_KHR_EXTERNAL_MEMORY_WIN32_EXTENSION_NAME ) == 0 ) unloadExternalMemoryWin32Commands( device );
 #endif
 		if( strcmp( e, VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME ) == 0 ) unloadDedicatedAllocationCommands( device );
+		if( strcmp( e, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME ) == 0 ) unloadDrawIndirectCountCommands( device );
 		// ...
 	}
 
@@ -435,4 +440,60 @@ void unloadDedicatedAllocationCommands( VkDevice ){
 	// no commands
 }
 
+// VK_KHR_draw_indirect_count
+///////////////////////////////////////////
+
+// vkCmd* commands only get a VkCommandBuffer, so they can't be looked up by VkDevice.
+// Every dispatchable handle starts with the loader's dispatch table pointer, which a device shares with its command buffers -- key by that.
+typedef void* DispatchKey;
+DispatchKey getDispatchKey( const void* dispatchableHandle ){
+	return *reinterpret_cast<DispatchKey const*>( dispatchableHandle );
+}
+
+std::unordered_map< DispatchKey, PFN_vkCmdDrawIndirectCountKHR > CmdDrawIndirectCountKHRDispatchTable;
+std::unordered_map< DispatchKey, PFN_vkCmdDrawIndexedIndirectCountKHR > CmdDrawIndexedIndirectCountKHRDispatchTable;
+
+void loadDrawIndirectCountCommands( VkDevice device ){
+	PFN_vkVoidFunction temp_fp;
+
+	temp_fp = vkGetDeviceProcAddr( device, "vkCmdDrawIndirectCountKHR" );
+	if( !temp_fp ) throw "Failed to load vkCmdDrawIndirectCountKHR"; // check shouldn't be necessary (based on spec)
+	CmdDrawIndirectCountKHRDispatchTable[getDispatchKey( device )] = reinterpret_cast<PFN_vkCmdDrawIndirectCountKHR>( temp_fp );
+
+	temp_fp = vkGetDeviceProcAddr( device, "vkCmdDrawIndexedIndirectCountKHR" );
+	if( !temp_fp ) throw "Failed to load vkCmdDrawIndexedIndirectCountKHR"; // check shouldn't be necessary (based on spec)
+	CmdDrawIndexedIndirectCountKHRDispatchTable[getDispatchKey( device )] = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>( temp_fp );
+}
+
+void unloadDrawIndirectCountCommands( VkDevice device ){
+	CmdDrawIndirectCountKHRDispatchTable.erase( getDispatchKey( device ) );
+	CmdDrawIndexedIndirectCountKHRDispatchTable.erase( getDispatchKey( device ) );
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndirectCountKHR(
+	VkCommandBuffer commandBuffer,
+	VkBuffer buffer,
+	VkDeviceSize offset,
+	VkBuffer countBuffer,
+	VkDeviceSize countBufferOffset,
+	uint32_t maxDrawCount,
+	uint32_t stride
+){
+	auto dispatched_cmd = CmdDrawIndirectCountKHRDispatchTable.at( getDispatchKey( commandBuffer ) );
+	return dispatched_cmd( commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride );
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndexedIndirectCountKHR(
+	VkCommandBuffer commandBuffer,
+	VkBuffer buffer,
+	VkDeviceSize offset,
+	VkBuffer countBuffer,
+	VkDeviceSize countBufferOffset,
+	uint32_t maxDrawCount,
+	uint32_t stride
+){
+	auto dispatched_cmd = CmdDrawIndexedIndirectCountKHRDispatchTable.at( getDispatchKey( commandBuffer ) );
+	return dispatched_cmd( commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride );
+}
+
 #endif //EXTENSION_LOADER_H
\ No newline at end of file
@@ -0,0 +1,401 @@
+#pragma once
+
+// CPU frustum culling over a wide bounding-volume hierarchy -- for when GPU culling (cullObjects.comp) is not available.
+// Every BVH node stores the boxes of its children as SoA lanes, so one SSE (4 wide) or AVX (8 wide) instruction tests
+// all children of a node against a frustum plane. The instruction set is whatever GLM detected (glm/simd/platform.h).
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+#	include <immintrin.h>
+constexpr uint32_t bvhWidth = 8;
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+#	include <emmintrin.h>
+constexpr uint32_t bvhWidth = 4;
+#else
+constexpr uint32_t bvhWidth = 4; // scalar fallback
+#endif
+
+struct Aabb{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// xyz = plane normal pointing into the frustum, w = distance; not normalized -- only the sign of the distance is used
+struct Frustum{
+	std::array<glm::vec4, 6> planes;
+};
+
+// Gribb-Hartmann extraction; Vulkan clip space (0 <= z <= w)
+Frustum extractFrustum( const glm::mat4& viewProjection ){
+	const glm::mat4 m = glm::transpose( viewProjection ); // m[i] = row i
+
+	return Frustum{{{
+		m[3] + m[0], // left
+		m[3] - m[0], // right
+		m[3] + m[1], // bottom
+		m[3] - m[1], // top
+		m[2],        // near
+		m[3] - m[2]  // far
+	}}};
+}
+
+// scalar reference test; conservative -- boxes near frustum corners may be reported visible
+bool isVisible( const Aabb& box, const Frustum& frustum ){
+	for( const auto& p : frustum.planes ){
+		const glm::vec3 farthest(  p.x >= 0.0f ? box.max.x : box.min.x, p.y >= 0.0f ? box.max.y : box.min.y, p.z >= 0.0f ? box.max.z : box.min.z  );
+		if( (p.x * farthest.x + p.y * farthest.y) + (p.z * farthest.z + p.w) < 0.0f ) return false; // same operation order as testChildren()
+	}
+
+	return true;
+}
+
+
+// BVH
+///////////////////////////////////////////
+
+struct alignas(32) BvhNode{
+	// child boxes, one lane per child
+	float minX[bvhWidth], minY[bvhWidth], minZ[bvhWidth];
+	float maxX[bvhWidth], maxY[bvhWidth], maxZ[bvhWidth];
+
+	uint32_t child[bvhWidth]; // node index; unused when leafChildren
+	uint32_t firstLeaf[bvhWidth]; // range of Bvh::leafObjects below the child
+	uint32_t leafCount[bvhWidth];
+	uint32_t childCount;
+	bool leafChildren; // children are single objects (Bvh::leafObjects[firstLeaf])
+};
+
+struct Bvh{
+	std::vector<BvhNode> nodes; // bottom level first, root last
+	std::vector<uint32_t> leafObjects; // object indices in spatial order; every node covers a contiguous range
+	uint32_t root;
+};
+
+// spreads the lower 10 bits so that two zero bits follow each of them
+uint32_t expandBits( uint32_t v ){
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+// p in [0, 1]^3
+uint32_t mortonCode( const glm::vec3 p ){
+	const glm::vec3 q = glm::clamp( p * 1024.0f, glm::vec3( 0.0f ), glm::vec3( 1023.0f ) );
+	return expandBits( static_cast<uint32_t>( q.x ) ) << 2 | expandBits( static_cast<uint32_t>( q.y ) ) << 1 | expandBits( static_cast<uint32_t>( q.z ) );
+}
+
+void setChildBounds( BvhNode& node, const uint32_t lane, const Aabb& box ){
+	node.minX[lane] = box.min.x; node.minY[lane] = box.min.y; node.minZ[lane] = box.min.z;
+	node.maxX[lane] = box.max.x; node.maxY[lane] = box.max.y; node.maxZ[lane] = box.max.z;
+}
+
+Aabb getNodeBounds( const BvhNode& node ){
+	Aabb box{ glm::vec3( std::numeric_limits<float>::max() ), glm::vec3( std::numeric_limits<float>::lowest() ) };
+	for( uint32_t i = 0; i < node.childCount; ++i ){
+		box.min = glm::min(  box.min, glm::vec3( node.minX[i], node.minY[i], node.minZ[i] )  );
+		box.max = glm::max(  box.max, glm::vec3( node.maxX[i], node.maxY[i], node.maxZ[i] )  );
+	}
+
+	return box;
+}
+
+// Linear BVH: objects sorted along a Morton curve, then grouped bvhWidth at a time bottom-up.
+// Not SAH quality, but O(n log n) and quick enough to rebuild every frame for moving objects.
+Bvh buildBvh( const std::vector<Aabb>& objectBounds ){
+	Bvh bvh;
+	bvh.root = 0;
+	if( objectBounds.empty() ) return bvh;
+
+	const uint32_t objectCount = static_cast<uint32_t>( objectBounds.size() );
+
+	Aabb centroidBounds{ glm::vec3( std::numeric_limits<float>::max() ), glm::vec3( std::numeric_limits<float>::lowest() ) };
+	for( const auto& box : objectBounds ){
+		const glm::vec3 centroid = 0.5f * (box.min + box.max);
+		centroidBounds.min = glm::min( centroidBounds.min, centroid );
+		centroidBounds.max = glm::max( centroidBounds.max, centroid );
+	}
+	const glm::vec3 extent = glm::max(  centroidBounds.max - centroidBounds.min, glm::vec3( std::numeric_limits<float>::min() )  );
+
+	std::vector<uint64_t> keys( objectCount ); // Morton code << 32 | object index
+	for( uint32_t i = 0; i < objectCount; ++i ){
+		const glm::vec3 centroid = 0.5f * (objectBounds[i].min + objectBounds[i].max);
+		keys[i] = uint64_t( mortonCode( (centroid - centroidBounds.min) / extent ) ) << 32 | i;
+	}
+	std::sort( keys.begin(), keys.end() );
+
+	bvh.leafObjects.resize( objectCount );
+	for( uint32_t i = 0; i < objectCount; ++i ) bvh.leafObjects[i] = static_cast<uint32_t>( keys[i] );
+
+	uint32_t levelSize = 0;
+	for( uint32_t first = 0; first < objectCount; first += bvhWidth, ++levelSize ){
+		BvhNode node{};
+		node.leafChildren = true;
+		node.childCount = std::min( bvhWidth, objectCount - first );
+		for( uint32_t lane = 0; lane < node.childCount; ++lane ){
+			setChildBounds( node, lane, objectBounds[bvh.leafObjects[first + lane]] );
+			node.firstLeaf[lane] = first + lane;
+			node.leafCount[lane] = 1;
+		}
+		bvh.nodes.push_back( node );
+	}
+
+	uint32_t levelBegin = 0;
+	while( levelSize > 1 ){
+		const uint32_t nextLevelBegin = static_cast<uint32_t>( bvh.nodes.size() );
+		uint32_t nextLevelSize = 0;
+		for( uint32_t first = 0; first < levelSize; first += bvhWidth, ++nextLevelSize ){
+			BvhNode node{};
+			node.leafChildren = false;
+			node.childCount = std::min( bvhWidth, levelSize - first );
+			for( uint32_t lane = 0; lane < node.childCount; ++lane ){
+				const uint32_t childIndex = levelBegin + first + lane;
+				const BvhNode& child = bvh.nodes[childIndex];
+
+				setChildBounds( node, lane, getNodeBounds( child ) );
+				node.child[lane] = childIndex;
+				node.firstLeaf[lane] = child.firstLeaf[0];
+				node.leafCount[lane] = child.firstLeaf[child.childCount - 1] + child.leafCount[child.childCount - 1] - child.firstLeaf[0];
+			}
+			bvh.nodes.push_back( node );
+		}
+
+		levelBegin = nextLevelBegin;
+		levelSize = nextLevelSize;
+	}
+
+	bvh.root = static_cast<uint32_t>( bvh.nodes.size() ) - 1;
+	return bvh;
+}
+
+// per lane bit masks: outside = culled, straddling = crosses a plane; the rest is fully inside
+void testChildren( const BvhNode& node, const Frustum& frustum, uint32_t& outside, uint32_t& straddling ){
+	outside = 0;
+	straddling = 0;
+
+	for( const auto& p : frustum.planes ){
+		// plane is the same for all lanes, so which box corner is farthest/nearest along it is a per-plane choice, not a per-lane blend
+		const float* farX = p.x >= 0.0f ? node.maxX : node.minX;
+		const float* farY = p.y >= 0.0f ? node.maxY : node.minY;
+		const float* farZ = p.z >= 0.0f ? node.maxZ : node.minZ;
+		const float* nearX = p.x >= 0.0f ? node.minX : node.maxX;
+		const float* nearY = p.y >= 0.0f ? node.minY : node.maxY;
+		const float* nearZ = p.z >= 0.0f ? node.minZ : node.maxZ;
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+		const __m256 nx = _mm256_set1_ps( p.x ), ny = _mm256_set1_ps( p.y ), nz = _mm256_set1_ps( p.z ), d = _mm256_set1_ps( p.w );
+		const __m256 zero = _mm256_setzero_ps();
+
+		const __m256 farDistance = _mm256_add_ps(  _mm256_add_ps( _mm256_mul_ps( nx, _mm256_loadu_ps( farX ) ), _mm256_mul_ps( ny, _mm256_loadu_ps( farY ) ) ), _mm256_add_ps( _mm256_mul_ps( nz, _mm256_loadu_ps( farZ ) ), d )  );
+		const __m256 nearDistance = _mm256_add_ps(  _mm256_add_ps( _mm256_mul_ps( nx, _mm256_loadu_ps( nearX ) ), _mm256_mul_ps( ny, _mm256_loadu_ps( nearY ) ) ), _mm256_add_ps( _mm256_mul_ps( nz, _mm256_loadu_ps( nearZ ) ), d )  );
+
+		outside |= static_cast<uint32_t>(  _mm256_movemask_ps( _mm256_cmp_ps( farDistance, zero, _CMP_LT_OQ ) )  );
+		straddling |= static_cast<uint32_t>(  _mm256_movemask_ps( _mm256_cmp_ps( nearDistance, zero, _CMP_LT_OQ ) )  );
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+		const __m128 nx = _mm_set1_ps( p.x ), ny = _mm_set1_ps( p.y ), nz = _mm_set1_ps( p.z ), d = _mm_set1_ps( p.w );
+		const __m128 zero = _mm_setzero_ps();
+
+		const __m128 farDistance = _mm_add_ps(  _mm_add_ps( _mm_mul_ps( nx, _mm_loadu_ps( farX ) ), _mm_mul_ps( ny, _mm_loadu_ps( farY ) ) ), _mm_add_ps( _mm_mul_ps( nz, _mm_loadu_ps( farZ ) ), d )  );
+		const __m128 nearDistance = _mm_add_ps(  _mm_add_ps( _mm_mul_ps( nx, _mm_loadu_ps( nearX ) ), _mm_mul_ps( ny, _mm_loadu_ps( nearY ) ) ), _mm_add_ps( _mm_mul_ps( nz, _mm_loadu_ps( nearZ ) ), d )  );
+
+		outside |= static_cast<uint32_t>(  _mm_movemask_ps( _mm_cmplt_ps( farDistance, zero ) )  );
+		straddling |= static_cast<uint32_t>(  _mm_movemask_ps( _mm_cmplt_ps( nearDistance, zero ) )  );
+#else
+		for( uint32_t lane = 0; lane < bvhWidth; ++lane ){
+			if( (p.x * farX[lane] + p.y * farY[lane]) + (p.z * farZ[lane] + p.w) < 0.0f ) outside |= 1u << lane;
+			if( (p.x * nearX[lane] + p.y * nearY[lane]) + (p.z * nearZ[lane] + p.w) < 0.0f ) straddling |= 1u << lane;
+		}
+#endif
+	}
+
+	const uint32_t usedLanes = (1u << node.childCount) - 1;
+	outside &= usedLanes;
+	straddling &= usedLanes & ~outside;
+}
+
+
+// Workers
+///////////////////////////////////////////
+
+// persistent threads, so a per-frame cull does not pay for thread creation
+class CullingWorkers{
+public:
+	explicit CullingWorkers( unsigned threadCount = std::max( 1u, std::thread::hardware_concurrency() ) )
+	: workerVisible( threadCount )
+	{
+		for( unsigned i = 1; i < threadCount; ++i ) threads.emplace_back( &CullingWorkers::workerLoop, this, i ); // worker 0 is the calling thread
+	}
+
+	~CullingWorkers(){
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			quit = true;
+		}
+		jobReady.notify_all();
+
+		for( auto& t : threads ) t.join();
+	}
+
+	CullingWorkers( const CullingWorkers& ) = delete;
+	CullingWorkers& operator=( const CullingWorkers& ) = delete;
+
+	unsigned size() const{ return static_cast<unsigned>( workerVisible.size() ); }
+
+	// runs job( workerIndex ) on every worker and returns once all of them finished
+	void run( const std::function<void(unsigned)>& newJob ){
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			job = &newJob;
+			busyWorkers = static_cast<unsigned>( threads.size() );
+			++generation;
+		}
+		jobReady.notify_all();
+
+		newJob( 0 );
+
+		std::unique_lock<std::mutex> lock( mutex );
+		jobDone.wait(  lock, [this]{ return busyWorkers == 0; }  );
+		job = nullptr;
+	}
+
+	std::vector< std::vector<uint32_t> > workerVisible; // per-worker output of cullBvh()
+
+private:
+	void workerLoop( const unsigned workerIndex ){
+		uint64_t seenGeneration = 0;
+		while( true ){
+			const std::function<void(unsigned)>* currentJob;
+			{
+				std::unique_lock<std::mutex> lock( mutex );
+				jobReady.wait(  lock, [&]{ return quit || generation != seenGeneration; }  );
+				if( quit ) return;
+
+				seenGeneration = generation;
+				currentJob = job;
+			}
+
+			(*currentJob)( workerIndex );
+
+			std::lock_guard<std::mutex> lock( mutex );
+			if( --busyWorkers == 0 ) jobDone.notify_one();
+		}
+	}
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable jobReady;
+	std::condition_variable jobDone;
+	const std::function<void(unsigned)>* job = nullptr;
+	uint64_t generation = 0;
+	unsigned busyWorkers = 0;
+	bool quit = false;
+};
+
+
+// Culling
+///////////////////////////////////////////
+
+struct CullTask{
+	uint32_t node; // traverse this node, or...
+	uint32_t firstLeaf, leafCount; // ...when leafCount != 0, accept this fully visible leaf range
+};
+
+// Collects everything below the task, appending visible object indices to visible
+void cullTask( const Bvh& bvh, const Frustum& frustum, const CullTask task, std::vector<uint32_t>& visible ){
+	const auto acceptRange = [&]( const uint32_t firstLeaf, const uint32_t leafCount ){
+		visible.insert( visible.end(), bvh.leafObjects.begin() + firstLeaf, bvh.leafObjects.begin() + firstLeaf + leafCount );
+	};
+
+	if( task.leafCount ){
+		acceptRange( task.firstLeaf, task.leafCount );
+		return;
+	}
+
+	uint32_t stack[128]; // (bvhWidth - 1) * depth + 1 at most; depth is ~log_bvhWidth( object count )
+	uint32_t stackSize = 0;
+	stack[stackSize++] = task.node;
+
+	while( stackSize ){
+		const BvhNode& node = bvh.nodes[stack[--stackSize]];
+
+		uint32_t outside, straddling;
+		testChildren( node, frustum, outside, straddling );
+
+		for( uint32_t lane = 0; lane < node.childCount; ++lane ){
+			const uint32_t bit = 1u << lane;
+			if( outside & bit ) continue;
+
+			if( node.leafChildren || !(straddling & bit) ) acceptRange( node.firstLeaf[lane], node.leafCount[lane] );
+			else stack[stackSize++] = node.child[lane];
+		}
+	}
+}
+
+// Fills visibleObjects with the indices of objects whose box is (conservatively) in the frustum. Order is unspecified.
+void cullBvh( const Bvh& bvh, const Frustum& frustum, CullingWorkers& workers, std::vector<uint32_t>& visibleObjects ){
+	visibleObjects.clear();
+	if( bvh.nodes.empty() ) return;
+
+	// serially open the top of the tree until there are enough independent subtrees to keep the workers busy
+	std::vector<CullTask> tasks = { { bvh.root, 0, 0 } };
+	const size_t targetTaskCount = size_t( workers.size() ) * 16;
+
+	for( bool expanded = workers.size() > 1; expanded && tasks.size() < targetTaskCount; ){
+		expanded = false;
+
+		std::vector<CullTask> nextTasks;
+		for( const auto& task : tasks ){
+			if( task.leafCount || bvh.nodes[task.node].leafChildren ){
+				nextTasks.push_back( task );
+				continue;
+			}
+
+			const BvhNode& node = bvh.nodes[task.node];
+			uint32_t outside, straddling;
+			testChildren( node, frustum, outside, straddling );
+
+			for( uint32_t lane = 0; lane < node.childCount; ++lane ){
+				const uint32_t bit = 1u << lane;
+				if( outside & bit ) continue;
+
+				if( straddling & bit ) nextTasks.push_back( { node.child[lane], 0, 0 } );
+				else nextTasks.push_back( { 0, node.firstLeaf[lane], node.leafCount[lane] } );
+			}
+			expanded = true;
+		}
+
+		tasks.swap( nextTasks );
+	}
+
+	std::atomic<size_t> nextTask( 0 );
+	std::vector<size_t> outputOffsets( workers.size() + 1, 0 );
+
+	workers.run(  [&]( const unsigned worker ){
+		auto& visible = workers.workerVisible[worker];
+		visible.clear();
+
+		for( size_t t = nextTask++; t < tasks.size(); t = nextTask++ ) cullTask( bvh, frustum, tasks[t], visible );
+	}  );
+
+	for( unsigned worker = 0; worker < workers.size(); ++worker ) outputOffsets[worker + 1] = outputOffsets[worker] + workers.workerVisible[worker].size();
+	visibleObjects.resize( outputOffsets.back() );
+
+	// compact the per-worker lists in parallel too; at 1M objects the copy is not free
+	workers.run(  [&]( const unsigned worker ){
+		const auto& visible = workers.workerVisible[worker];
+		std::copy( visible.begin(), visible.end(), visibleObjects.begin() + outputOffsets[worker] );
+	}  );
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+// Native decoder for uncompressed BMP and TGA files -- the formats this repo ships its textures in.
+// Decodes in one pass straight into the destination (e.g. mapped staging memory): flips bottom-up rows while
+// expanding BGR to RGBA or swizzling BGRA to RGBA, with SSSE3 (4 pixels) or AVX2 (8 pixels) shuffles where GLM detected them.
+// Anything else (palettes, RLE, 16 bit) is reported as unsupported so the caller can fall back to SDL.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+#if GLM_ARCH & (GLM_ARCH_AVX2_BIT | GLM_ARCH_SSSE3_BIT)
+#	include <immintrin.h>
+#endif
+
+enum class ImageFileFormat{ Bmp, Tga };
+
+struct ImageHeader{
+	ImageFileFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytesPerPixel; // 3 = BGR, 4 = BGRA
+	bool hasAlpha; // false: the 4th byte is padding and decodes as opaque
+	bool topDown; // rows stored top row first
+	size_t pixelOffset; // of the first stored row
+	size_t rowPitch; // stored row size including padding
+};
+
+uint32_t readLittleEndian( const uint8_t* bytes, const uint32_t size ){
+	uint32_t value = 0;
+	for( uint32_t i = 0; i < size; ++i ) value |= uint32_t( bytes[i] ) << (8 * i);
+	return value;
+}
+
+bool readBmpHeader( const uint8_t* file, const size_t size, ImageHeader& header ){
+	const size_t fileHeaderSize = 14;
+	if( size < fileHeaderSize + 40 || file[0] != 'B' || file[1] != 'M' ) return false;
+
+	const uint8_t* info = file + fileHeaderSize;
+	const uint32_t infoSize = readLittleEndian( info, 4 );
+	if( infoSize < 40 ) return false; // OS/2 core headers
+
+	const int32_t width = static_cast<int32_t>(  readLittleEndian( info + 4, 4 )  );
+	const int32_t height = static_cast<int32_t>(  readLittleEndian( info + 8, 4 )  );
+	const uint32_t bitsPerPixel = readLittleEndian( info + 14, 2 );
+	const uint32_t compression = readLittleEndian( info + 16, 4 );
+	const uint32_t biRgb = 0, biBitfields = 3;
+
+	if( width <= 0 || height == 0 || height == INT32_MIN ) return false;
+	if( bitsPerPixel != 24 && bitsPerPixel != 32 ) return false;
+
+	header.hasAlpha = bitsPerPixel == 32; // BI_RGB too: readImageHeader() drops it again if every alpha byte is zero
+	if( compression == biBitfields ){
+		// masks follow a 40 byte header, or are part of the V4/V5 header
+		if( bitsPerPixel != 32 || size < fileHeaderSize + 40 + 16 ) return false;
+		const uint32_t redMask = readLittleEndian( info + 40, 4 );
+		const uint32_t greenMask = readLittleEndian( info + 44, 4 );
+		const uint32_t blueMask = readLittleEndian( info + 48, 4 );
+		const uint32_t alphaMask = infoSize >= 56 ? readLittleEndian( info + 52, 4 ) : 0;
+		if( redMask != 0x00FF0000 || greenMask != 0x0000FF00 || blueMask != 0x000000FF ) return false;
+		if( alphaMask != 0 && alphaMask != 0xFF000000 ) return false;
+		header.hasAlpha = alphaMask != 0;
+	}
+	else if( compression != biRgb ) return false;
+
+	header.format = ImageFileFormat::Bmp;
+	header.width = static_cast<uint32_t>( width );
+	header.height = static_cast<uint32_t>( height < 0 ? -height : height );
+	header.bytesPerPixel = bitsPerPixel / 8;
+	header.topDown = height < 0;
+	header.pixelOffset = readLittleEndian( file + 10, 4 );
+	header.rowPitch = (size_t( header.width ) * header.bytesPerPixel + 3) & ~size_t( 3 ); // rows are 4 byte aligned
+
+	return true;
+}
+
+bool readTgaHeader( const uint8_t* file, const size_t size, ImageHeader& header ){
+	const size_t tgaHeaderSize = 18;
+	if( size < tgaHeaderSize ) return false;
+
+	const uint32_t idLength = file[0];
+	const uint32_t colorMapType = file[1];
+	const uint32_t imageType = file[2];
+	const uint32_t width = readLittleEndian( file + 12, 2 );
+	const uint32_t height = readLittleEndian( file + 14, 2 );
+	const uint32_t bitsPerPixel = file[16];
+	const uint32_t descriptor = file[17];
+	const uint32_t uncompressedTrueColor = 2;
+
+	if( colorMapType != 0 || imageType != uncompressedTrueColor ) return false;
+	if( bitsPerPixel != 24 && bitsPerPixel != 32 ) return false;
+	if( width == 0 || height == 0 ) return false;
+	if( descriptor & 0x10 ) return false; // right-to-left pixel order
+
+	header.format = ImageFileFormat::Tga;
+	header.width = width;
+	header.height = height;
+	header.bytesPerPixel = bitsPerPixel / 8;
+	header.hasAlpha = bitsPerPixel == 32 && (descriptor & 0x0F) == 8;
+	header.topDown = (descriptor & 0x20) != 0;
+	header.pixelOffset = tgaHeaderSize + idLength;
+	header.rowPitch = size_t( width ) * header.bytesPerPixel; // no row padding
+
+	return true;
+}
+
+// false when the file is not something decodeImage() handles; TGA has no signature, so BMP is tried first
+bool readImageHeader( const uint8_t* file, const size_t size, ImageHeader& header ){
+	if( !readBmpHeader( file, size, header ) && !readTgaHeader( file, size, header ) ) return false;
+
+	const uint32_t maxDimension = 1 << 16; // far beyond any maxImageDimension2D; keeps the size math below from overflowing
+	if( header.width > maxDimension || header.height > maxDimension ) return false;
+
+	const size_t lastRowEnd = header.pixelOffset + header.rowPitch * (header.height - 1) + size_t( header.width ) * header.bytesPerPixel;
+	if( lastRowEnd > size ) return false; // truncated files are rejected here, so decoding never reads out of bounds
+
+	// many writers leave the 4th byte of 32 bit BMPs zero; like SDL, treat an all-zero alpha channel as opaque
+	// (stops at the first visible pixel, so real alpha costs next to nothing)
+	if( header.format == ImageFileFormat::Bmp && header.hasAlpha ){
+		bool alphaZero = true;
+		for( uint32_t y = 0; y < header.height && alphaZero; ++y ){
+			const uint8_t* row = file + header.pixelOffset + y * header.rowPitch;
+			for( uint32_t x = 0; x < header.width && alphaZero; ++x ) alphaZero = row[4 * x + 3] == 0;
+		}
+		header.hasAlpha = !alphaZero;
+	}
+
+	return true;
+}
+
+void expandBgrRow( const uint8_t* source, uint8_t* destination, const uint32_t width ){
+	uint32_t x = 0;
+
+#if GLM_ARCH & (GLM_ARCH_AVX2_BIT | GLM_ARCH_SSSE3_BIT)
+	// 4 BGR pixels (12 of the 16 loaded bytes) -> 4 RGBA pixels; -1 zeroes the alpha byte, which the OR then sets
+	const __m128i bgrToRgba = _mm_setr_epi8( 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1 );
+	const __m128i opaque = _mm_set1_epi32( int32_t( 0xFF000000 ) );
+
+#	if GLM_ARCH & GLM_ARCH_AVX2_BIT
+	const __m256i bgrToRgbaWide = _mm256_broadcastsi128_si256( bgrToRgba );
+	const __m256i opaqueWide = _mm256_broadcastsi128_si256( opaque );
+	for( ; x + 10 <= width; x += 8 ){ // second load reads bytes 12..27 of the 24 used, so keep 10 pixels in range
+		const uint8_t* pixels = source + 3 * x;
+		const __m256i bgr = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(  _mm_loadu_si128( reinterpret_cast<const __m128i*>( pixels ) )  ),
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>( pixels + 12 ) ),
+			1
+		);
+		const __m256i rgba = _mm256_or_si256( _mm256_shuffle_epi8( bgr, bgrToRgbaWide ), opaqueWide );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( destination + 4 * x ), rgba );
+	}
+#	endif
+
+	for( ; x + 6 <= width; x += 4 ){ // the 16 byte load covers 5.33 pixels
+		const __m128i bgr = _mm_loadu_si128( reinterpret_cast<const __m128i*>( source + 3 * x ) );
+		_mm_storeu_si128(  reinterpret_cast<__m128i*>( destination + 4 * x ), _mm_or_si128( _mm_shuffle_epi8( bgr, bgrToRgba ), opaque )  );
+	}
+#endif
+
+	for( ; x < width; ++x ){
+		destination[4 * x + 0] = source[3 * x + 2];
+		destination[4 * x + 1] = source[3 * x + 1];
+		destination[4 * x + 2] = source[3 * x + 0];
+		destination[4 * x + 3] = 0xFF;
+	}
+}
+
+void swizzleBgraRow( const uint8_t* source, uint8_t* destination, const uint32_t width, const bool hasAlpha ){
+	uint32_t x = 0;
+
+#if GLM_ARCH & (GLM_ARCH_AVX2_BIT | GLM_ARCH_SSSE3_BIT)
+	const __m128i bgraToRgba = _mm_setr_epi8( 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 );
+	const __m128i alphaFill = _mm_set1_epi32(  hasAlpha ? 0 : int32_t( 0xFF000000 )  );
+
+#	if GLM_ARCH & GLM_ARCH_AVX2_BIT
+	const __m256i bgraToRgbaWide = _mm256_broadcastsi128_si256( bgraToRgba );
+	const __m256i alphaFillWide = _mm256_broadcastsi128_si256( alphaFill );
+	for( ; x + 8 <= width; x += 8 ){
+		const __m256i bgra = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( source + 4 * x ) );
+		_mm256_storeu_si256(  reinterpret_cast<__m256i*>( destination + 4 * x ), _mm256_or_si256( _mm256_shuffle_epi8( bgra, bgraToRgbaWide ), alphaFillWide )  );
+	}
+#	endif
+
+	for( ; x + 4 <= width; x += 4 ){
+		const __m128i bgra = _mm_loadu_si128( reinterpret_cast<const __m128i*>( source + 4 * x ) );
+		_mm_storeu_si128(  reinterpret_cast<__m128i*>( destination + 4 * x ), _mm_or_si128( _mm_shuffle_epi8( bgra, bgraToRgba ), alphaFill )  );
+	}
+#endif
+
+	for( ; x < width; ++x ){
+		destination[4 * x + 0] = source[4 * x + 2];
+		destination[4 * x + 1] = source[4 * x + 1];
+		destination[4 * x + 2] = source[4 * x + 0];
+		destination[4 * x + 3] = hasAlpha ? source[4 * x + 3] : 0xFF;
+	}
+}
+
+// writes width * height tightly packed RGBA8 pixels, top row first (as SDL surfaces are)
+void decodeImage( const uint8_t* file, const ImageHeader& header, uint8_t* rgba ){
+	const size_t destinationPitch = size_t( header.width ) * 4;
+
+	for( uint32_t y = 0; y < header.height; ++y ){
+		const uint32_t storedRow = header.topDown ? y : header.height - 1 - y;
+		const uint8_t* source = file + header.pixelOffset + storedRow * header.rowPitch;
+		uint8_t* destination = rgba + y * destinationPitch;
+
+		if( header.bytesPerPixel == 3 ) expandBgrRow( source, destination, header.width );
+		else swizzleBgraRow( source, destination, header.width, header.hasAlpha );
+	}
+}
@@ -0,0 +1,403 @@
+#pragma once
+
+// KTX2 container reading: header, level index and per-format block sizes, so block-compressed payloads
+// (BC1-BC7, ETC2, ASTC) can be uploaded level by level exactly as stored in the file.
+// For devices without a format's support, the BC1-BC5 family can be decoded to RGBA8 on the CPU instead.
+// Supercompressed files (Basis Universal, zstd) are rejected -- that needs a transcoder this repo does not ship.
+// Writing covers what textureCooker.cpp produces: BC1 / BC3 levels plus key/value metadata.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+const uint8_t ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct Ktx2Level{
+	uint64_t byteOffset; // from the start of the file
+	uint64_t byteLength;
+};
+
+struct Ktx2Header{
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount; // >= 1
+	std::vector<Ktx2Level> levels; // [0] = full size
+};
+
+struct BlockFormatInfo{
+	uint32_t blockWidth;
+	uint32_t blockHeight;
+	uint32_t bytesPerBlock;
+};
+
+// 0 bytesPerBlock = not a format this loader knows
+BlockFormatInfo getBlockFormatInfo( const VkFormat format ){
+	switch( format ){
+		case VK_FORMAT_R8G8B8A8_UNORM: case VK_FORMAT_R8G8B8A8_SRGB:
+			return { 1, 1, 4 };
+
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK: case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK: case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK: case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+			return { 4, 4, 8 };
+
+		case VK_FORMAT_BC2_UNORM_BLOCK: case VK_FORMAT_BC2_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK: case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK: case VK_FORMAT_BC7_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK: case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+			return { 4, 4, 16 };
+
+		// ASTC: always 16 bytes, only the block footprint changes
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK: case VK_FORMAT_ASTC_4x4_SRGB_BLOCK: return { 4, 4, 16 };
+		case VK_FORMAT_ASTC_5x4_UNORM_BLOCK: case VK_FORMAT_ASTC_5x4_SRGB_BLOCK: return { 5, 4, 16 };
+		case VK_FORMAT_ASTC_5x5_UNORM_BLOCK: case VK_FORMAT_ASTC_5x5_SRGB_BLOCK: return { 5, 5, 16 };
+		case VK_FORMAT_ASTC_6x5_UNORM_BLOCK: case VK_FORMAT_ASTC_6x5_SRGB_BLOCK: return { 6, 5, 16 };
+		case VK_FORMAT_ASTC_6x6_UNORM_BLOCK: case VK_FORMAT_ASTC_6x6_SRGB_BLOCK: return { 6, 6, 16 };
+		case VK_FORMAT_ASTC_8x5_UNORM_BLOCK: case VK_FORMAT_ASTC_8x5_SRGB_BLOCK: return { 8, 5, 16 };
+		case VK_FORMAT_ASTC_8x6_UNORM_BLOCK: case VK_FORMAT_ASTC_8x6_SRGB_BLOCK: return { 8, 6, 16 };
+		case VK_FORMAT_ASTC_8x8_UNORM_BLOCK: case VK_FORMAT_ASTC_8x8_SRGB_BLOCK: return { 8, 8, 16 };
+		case VK_FORMAT_ASTC_10x5_UNORM_BLOCK: case VK_FORMAT_ASTC_10x5_SRGB_BLOCK: return { 10, 5, 16 };
+		case VK_FORMAT_ASTC_10x6_UNORM_BLOCK: case VK_FORMAT_ASTC_10x6_SRGB_BLOCK: return { 10, 6, 16 };
+		case VK_FORMAT_ASTC_10x8_UNORM_BLOCK: case VK_FORMAT_ASTC_10x8_SRGB_BLOCK: return { 10, 8, 16 };
+		case VK_FORMAT_ASTC_10x10_UNORM_BLOCK: case VK_FORMAT_ASTC_10x10_SRGB_BLOCK: return { 10, 10, 16 };
+		case VK_FORMAT_ASTC_12x10_UNORM_BLOCK: case VK_FORMAT_ASTC_12x10_SRGB_BLOCK: return { 12, 10, 16 };
+		case VK_FORMAT_ASTC_12x12_UNORM_BLOCK: case VK_FORMAT_ASTC_12x12_SRGB_BLOCK: return { 12, 12, 16 };
+
+		default:
+			return { 0, 0, 0 };
+	}
+}
+
+// bytes of a tightly packed level of a width x height texture
+uint64_t getLevelByteLength( const BlockFormatInfo& block, const uint32_t width, const uint32_t height, const uint32_t level ){
+	const uint32_t levelWidth = std::max( width >> level, 1u );
+	const uint32_t levelHeight = std::max( height >> level, 1u );
+	return uint64_t( (levelWidth + block.blockWidth - 1) / block.blockWidth ) * ((levelHeight + block.blockHeight - 1) / block.blockHeight) * block.bytesPerBlock;
+}
+
+uint32_t readLittleEndian32( const uint8_t* bytes ){
+	return uint32_t( bytes[0] ) | (uint32_t( bytes[1] ) << 8) | (uint32_t( bytes[2] ) << 16) | (uint32_t( bytes[3] ) << 24);
+}
+
+uint64_t readLittleEndian64( const uint8_t* bytes ){
+	return uint64_t(  readLittleEndian32( bytes )  ) | (uint64_t(  readLittleEndian32( bytes + 4 )  ) << 32);
+}
+
+// false when the file is not KTX2 at all; throws for KTX2 files this loader cannot use
+bool readKtx2Header( const uint8_t* file, const size_t size, Ktx2Header& header ){
+	const size_t headerSize = 80; // identifier + 9 uint32 + index (4 x uint32, 2 x uint64)
+	const size_t levelIndexEntrySize = 24;
+
+	if( size < headerSize || std::memcmp( file, ktx2Identifier, sizeof( ktx2Identifier ) ) != 0 ) return false;
+
+	const uint32_t vkFormat = readLittleEndian32( file + 12 );
+	const uint32_t pixelWidth = readLittleEndian32( file + 20 );
+	const uint32_t pixelHeight = readLittleEndian32( file + 24 );
+	const uint32_t pixelDepth = readLittleEndian32( file + 28 );
+	const uint32_t layerCount = readLittleEndian32( file + 32 );
+	const uint32_t faceCount = readLittleEndian32( file + 36 );
+	const uint32_t levelCount = readLittleEndian32( file + 40 );
+	const uint32_t supercompressionScheme = readLittleEndian32( file + 44 );
+
+	if( supercompressionScheme != 0 ) throw "KTX2: supercompressed payloads (Basis Universal, zstd) are not supported!";
+	if( vkFormat == VK_FORMAT_UNDEFINED ) throw "KTX2: VK_FORMAT_UNDEFINED payload (Basis Universal) is not supported!";
+	if( pixelWidth == 0 || pixelHeight == 0 || pixelDepth > 1 || layerCount > 1 || faceCount != 1 ) throw "KTX2: only plain 2D textures are supported!";
+
+	header.format = static_cast<VkFormat>( vkFormat );
+	const BlockFormatInfo block = getBlockFormatInfo( header.format );
+	if( block.bytesPerBlock == 0 ) throw "KTX2: unsupported vkFormat!";
+
+	header.width = pixelWidth;
+	header.height = pixelHeight;
+	header.levelCount = std::max( levelCount, 1u ); // 0 asks the loader to generate mips -- not possible for compressed data
+
+	uint32_t fullMipChain = 1; // down to 1x1, as getMipLevelCount() in main.cpp
+	while( fullMipChain < 32 && (std::max( pixelWidth, pixelHeight ) >> fullMipChain) > 0 ) ++fullMipChain;
+	if( header.levelCount > fullMipChain ) throw "KTX2: more levels than the full mip chain!";
+	if( size < headerSize + levelIndexEntrySize * header.levelCount ) throw "KTX2: truncated level index!";
+
+	header.levels.resize( header.levelCount );
+	for( uint32_t level = 0; level < header.levelCount; ++level ){
+		const uint8_t* entry = file + headerSize + levelIndexEntrySize * level;
+		header.levels[level] = { readLittleEndian64( entry ), readLittleEndian64( entry + 8 ) };
+
+		const Ktx2Level& l = header.levels[level];
+		if( l.byteLength != getLevelByteLength( block, pixelWidth, pixelHeight, level ) ) throw "KTX2: level size does not match its dimensions!";
+		if( l.byteOffset > size || l.byteLength > size - l.byteOffset ) throw "KTX2: level data out of file bounds!";
+	}
+
+	return true;
+}
+
+// value of key in the key/value data; false when the file has no such entry (or is not a valid KTX2 file)
+bool readKtx2Value( const uint8_t* file, const size_t size, const std::string& key, std::string& value ){
+	Ktx2Header header;
+	try{ if( !readKtx2Header( file, size, header ) ) return false; }
+	catch( const char* ){ return false; }
+
+	const uint64_t kvdOffset = readLittleEndian32( file + 56 );
+	const uint64_t kvdLength = readLittleEndian32( file + 60 );
+	if( kvdOffset > size || kvdLength > size - kvdOffset ) return false;
+
+	for( uint64_t entry = kvdOffset; entry + 4 <= kvdOffset + kvdLength; ){
+		const uint32_t entryLength = readLittleEndian32( file + entry );
+		if( entryLength > kvdOffset + kvdLength - entry - 4 ) return false;
+
+		// key NUL value (NUL), then padding to 4 bytes
+		const char* pair = reinterpret_cast<const char*>( file + entry + 4 );
+		const size_t keyLength = strnlen( pair, entryLength );
+		if( keyLength < entryLength && key == std::string( pair, keyLength ) ){
+			value.assign( pair + keyLength + 1, strnlen( pair + keyLength + 1, entryLength - keyLength - 1 ) );
+			return true;
+		}
+
+		entry += 4 + ((entryLength + 3) & ~3u);
+	}
+
+	return false;
+}
+
+void writeLittleEndian( std::vector<uint8_t>& file, const size_t offset, const uint64_t value, const uint32_t size ){
+	for( uint32_t i = 0; i < size; ++i ) file[offset + i] = uint8_t( value >> (8 * i) );
+}
+
+// Khronos Basic Data Format Descriptor of the block-compressed formats writeKtx2() knows
+std::vector<uint32_t> getDataFormatDescriptor( const VkFormat format ){
+	const uint32_t bc1Model = 128, bc3Model = 130; // KHR_DF_MODEL_BC1A, KHR_DF_MODEL_BC3
+	const uint32_t bt709Primaries = 1, linearTransfer = 1, srgbTransfer = 2;
+	const uint32_t colorChannel = 0, alphaChannel = 15, linearQualifier = 0x10; // KHR_DF_SAMPLE_DATATYPE_LINEAR: alpha of sRGB formats is linear
+
+	bool bc3, srgb;
+	switch( format ){
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK: bc3 = false; srgb = false; break;
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK: bc3 = false; srgb = true; break;
+		case VK_FORMAT_BC3_UNORM_BLOCK: bc3 = true; srgb = false; break;
+		case VK_FORMAT_BC3_SRGB_BLOCK: bc3 = true; srgb = true; break;
+		default: throw "KTX2: no data format descriptor for this format!";
+	}
+
+	const uint32_t sampleCount = bc3 ? 2 : 1;
+	const uint32_t blockSize = 24 + 16 * sampleCount;
+	std::vector<uint32_t> descriptor = {
+		4 + blockSize, // dfdTotalSize
+		0, // vendorId KHRONOS, descriptorType BASICFORMAT
+		2 | (blockSize << 16), // versionNumber 1.3
+		(bc3 ? bc3Model : bc1Model) | (bt709Primaries << 8) | ((srgb ? srgbTransfer : linearTransfer) << 16),
+		3 | (3 << 8), // texelBlockDimension 4x4 (stored minus one)
+		bc3 ? 16u : 8u, // bytesPlane0
+		0
+	};
+
+	const auto addSample = [&]( const uint32_t bitOffset, const uint32_t channelType ){
+		descriptor.insert(  descriptor.end(), { bitOffset | (63 << 16) | (channelType << 24), 0u, 0u, 0xFFFFFFFFu }  ); // 64 bits, full range
+	};
+	if( bc3 ){
+		addSample(  0, alphaChannel | (srgb ? linearQualifier : 0)  );
+		addSample( 64, colorChannel );
+	}
+	else addSample( 0, colorChannel );
+
+	return descriptor;
+}
+
+// levels[0] = full size; stored smallest level first as the specification recommends, each aligned to the block size
+std::vector<uint8_t> writeKtx2( const VkFormat format, const uint32_t width, const uint32_t height, const std::vector<std::vector<uint8_t>>& levels, const std::vector<std::pair<std::string, std::string>>& keyValues ){
+	const size_t headerSize = 80, levelIndexEntrySize = 24;
+	const uint32_t levelCount = static_cast<uint32_t>( levels.size() );
+	const std::vector<uint32_t> descriptor = getDataFormatDescriptor( format );
+
+	std::vector<uint8_t> keyValueData;
+	auto sortedKeyValues = keyValues; // entries have to be sorted by key
+	std::sort( sortedKeyValues.begin(), sortedKeyValues.end() );
+	for( const auto& keyValue : sortedKeyValues ){
+		const uint32_t entryLength = static_cast<uint32_t>( keyValue.first.size() + 1 + keyValue.second.size() + 1 );
+		const size_t entry = keyValueData.size();
+		keyValueData.resize(  entry + 4 + ((entryLength + 3) & ~3u), 0  );
+		writeLittleEndian( keyValueData, entry, entryLength, 4 );
+		std::memcpy( &keyValueData[entry + 4], keyValue.first.c_str(), keyValue.first.size() + 1 );
+		std::memcpy( &keyValueData[entry + 4 + keyValue.first.size() + 1], keyValue.second.c_str(), keyValue.second.size() + 1 );
+	}
+
+	const size_t dfdOffset = headerSize + levelIndexEntrySize * levelCount;
+	const size_t kvdOffset = dfdOffset + 4 * descriptor.size();
+	const size_t alignment = getBlockFormatInfo( format ).bytesPerBlock; // lcm( block size, 4 ) for 8 and 16 byte blocks
+
+	std::vector<size_t> levelOffsets( levelCount );
+	size_t fileSize = kvdOffset + keyValueData.size();
+	for( uint32_t level = levelCount; level-- > 0; ){
+		fileSize = (fileSize + alignment - 1) / alignment * alignment;
+		levelOffsets[level] = fileSize;
+		fileSize += levels[level].size();
+	}
+
+	std::vector<uint8_t> file( fileSize, 0 );
+	std::memcpy( file.data(), ktx2Identifier, sizeof( ktx2Identifier ) );
+	writeLittleEndian( file, 12, format, 4 );
+	writeLittleEndian( file, 16, 1, 4 ); // typeSize: 1 for block-compressed formats
+	writeLittleEndian( file, 20, width, 4 );
+	writeLittleEndian( file, 24, height, 4 );
+	writeLittleEndian( file, 36, 1, 4 ); // faceCount; pixelDepth, layerCount and supercompressionScheme stay 0
+	writeLittleEndian( file, 40, levelCount, 4 );
+	writeLittleEndian( file, 48, dfdOffset, 4 );
+	writeLittleEndian( file, 52, 4 * descriptor.size(), 4 );
+	writeLittleEndian( file, 56, keyValueData.empty() ? 0 : kvdOffset, 4 );
+	writeLittleEndian( file, 60, keyValueData.size(), 4 );
+
+	for( uint32_t level = 0; level < levelCount; ++level ){
+		const size_t entry = headerSize + levelIndexEntrySize * level;
+		writeLittleEndian( file, entry, levelOffsets[level], 8 );
+		writeLittleEndian( file, entry + 8, levels[level].size(), 8 );
+		writeLittleEndian( file, entry + 16, levels[level].size(), 8 ); // uncompressedByteLength
+		std::memcpy( &file[levelOffsets[level]], levels[level].data(), levels[level].size() );
+	}
+	for( size_t i = 0; i < descriptor.size(); ++i ) writeLittleEndian( file, dfdOffset + 4 * i, descriptor[i], 4 );
+	if( !keyValueData.empty() ) std::memcpy( &file[kvdOffset], keyValueData.data(), keyValueData.size() );
+
+	return file;
+}
+
+// CPU fallback -- BC1 to BC5 only; BC6H/BC7, ETC2 and ASTC have to be supported by the device
+bool isCpuDecodable( const VkFormat format ){
+	switch( format ){
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK: case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC2_UNORM_BLOCK: case VK_FORMAT_BC2_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK: case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// the RGBA8 format the CPU decode of format writes; keeps sRGB-ness, BC4/BC5 land in R / RG
+VkFormat getCpuDecodedFormat( const VkFormat format ){
+	switch( format ){
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK: case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK: case VK_FORMAT_BC3_SRGB_BLOCK:
+			return VK_FORMAT_R8G8B8A8_SRGB;
+		default:
+			return VK_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+// 4x4 RGBA8 texels, row-major
+typedef uint8_t DecodedBlock[16][4];
+
+// bc1: color0 <= color1 switches to three colors + black (transparent if bc1Alpha); BC2/BC3 always use four colors
+void decodeColorBlock( const uint8_t* block, const bool bc1, const bool bc1Alpha, DecodedBlock& texels ){
+	const uint32_t color0 = block[0] | (block[1] << 8);
+	const uint32_t color1 = block[2] | (block[3] << 8);
+
+	const auto expand565 = []( const uint32_t c, uint8_t* rgb ){
+		const uint32_t r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+		rgb[0] = uint8_t( (r << 3) | (r >> 2) );
+		rgb[1] = uint8_t( (g << 2) | (g >> 4) );
+		rgb[2] = uint8_t( (b << 3) | (b >> 2) );
+	};
+
+	uint8_t palette[4][4];
+	expand565( color0, palette[0] );
+	expand565( color1, palette[1] );
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 0xFF;
+
+	if( color0 > color1 || !bc1 ){
+		for( uint32_t c = 0; c < 3; ++c ){
+			palette[2][c] = uint8_t( (2 * palette[0][c] + palette[1][c]) / 3 );
+			palette[3][c] = uint8_t( (palette[0][c] + 2 * palette[1][c]) / 3 );
+		}
+	}
+	else{
+		for( uint32_t c = 0; c < 3; ++c ){
+			palette[2][c] = uint8_t( (palette[0][c] + palette[1][c]) / 2 );
+			palette[3][c] = 0;
+		}
+		if( bc1Alpha ) palette[3][3] = 0;
+	}
+
+	const uint32_t indices = readLittleEndian32( block + 4 );
+	for( uint32_t i = 0; i < 16; ++i ) std::memcpy( texels[i], palette[(indices >> (2 * i)) & 3], 4 );
+}
+
+// BC4 block, also the alpha half of BC3 and each channel of BC5
+void decodeChannelBlock( const uint8_t* block, DecodedBlock& texels, const uint32_t channel ){
+	const uint32_t value0 = block[0];
+	const uint32_t value1 = block[1];
+
+	uint8_t palette[8] = { uint8_t( value0 ), uint8_t( value1 ) };
+	if( value0 > value1 ){
+		for( uint32_t i = 1; i < 7; ++i ) palette[i + 1] = uint8_t(  ((7 - i) * value0 + i * value1) / 7  );
+	}
+	else{
+		for( uint32_t i = 1; i < 5; ++i ) palette[i + 1] = uint8_t(  ((5 - i) * value0 + i * value1) / 5  );
+		palette[6] = 0;
+		palette[7] = 0xFF;
+	}
+
+	uint64_t indices = 0;
+	for( uint32_t i = 0; i < 6; ++i ) indices |= uint64_t( block[2 + i] ) << (8 * i);
+	for( uint32_t i = 0; i < 16; ++i ) texels[i][channel] = palette[(indices >> (3 * i)) & 7];
+}
+
+void decodeBlock( const VkFormat format, const uint8_t* block, DecodedBlock& texels ){
+	switch( format ){
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK: case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			decodeColorBlock( block, true, false, texels );
+			break;
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			decodeColorBlock( block, true, true, texels );
+			break;
+		case VK_FORMAT_BC2_UNORM_BLOCK: case VK_FORMAT_BC2_SRGB_BLOCK:
+			decodeColorBlock( block + 8, false, false, texels );
+			for( uint32_t i = 0; i < 16; ++i ){
+				const uint32_t alpha = (block[i / 2] >> (4 * (i % 2))) & 0xF;
+				texels[i][3] = uint8_t( alpha * 17 );
+			}
+			break;
+		case VK_FORMAT_BC3_UNORM_BLOCK: case VK_FORMAT_BC3_SRGB_BLOCK:
+			decodeColorBlock( block + 8, false, false, texels );
+			decodeChannelBlock( block, texels, 3 );
+			break;
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+			for( uint32_t i = 0; i < 16; ++i ){ texels[i][1] = texels[i][2] = 0; texels[i][3] = 0xFF; }
+			decodeChannelBlock( block, texels, 0 );
+			break;
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+			for( uint32_t i = 0; i < 16; ++i ){ texels[i][2] = 0; texels[i][3] = 0xFF; }
+			decodeChannelBlock( block, texels, 0 );
+			decodeChannelBlock( block + 8, texels, 1 );
+			break;
+		default:
+			throw "decodeBlock: format is not CPU decodable!";
+	}
+}
+
+// one level to tightly packed width * height RGBA8; blocks hanging over the edge are clipped
+void decodeLevel( const VkFormat format, const uint8_t* blocks, const uint32_t width, const uint32_t height, uint8_t* rgba ){
+	const uint32_t bytesPerBlock = getBlockFormatInfo( format ).bytesPerBlock;
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+
+	DecodedBlock texels;
+	for( uint32_t by = 0; by < blocksHigh; ++by ){
+		for( uint32_t bx = 0; bx < blocksWide; ++bx ){
+			decodeBlock( format, blocks + size_t( by * blocksWide + bx ) * bytesPerBlock, texels );
+
+			const uint32_t columns = std::min( 4u, width - 4 * bx );
+			const uint32_t rows = std::min( 4u, height - 4 * by );
+			for( uint32_t y = 0; y < rows; ++y ){
+				std::memcpy( rgba + (size_t( 4 * by + y ) * width + 4 * bx) * 4, texels[4 * y], 4 * columns );
+			}
+		}
+	}
+}
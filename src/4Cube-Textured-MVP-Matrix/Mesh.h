@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+
+// indexed triangle list, as consumed by vkCmdDrawIndexed* and the GPU-driven path
+struct IndexedMesh{
+	std::vector<Vertex3D_UV> vertices;
+	std::vector<uint32_t> indices;
+};
+
+// merges bitwise identical vertices of a plain triangle list
+IndexedMesh indexMesh( const std::vector<Vertex3D_UV>& triangleList ){
+	IndexedMesh mesh;
+	mesh.indices.reserve( triangleList.size() );
+
+	std::unordered_map<std::string, uint32_t> uniqueVertices;
+	for( const auto& v : triangleList ){
+		const std::string key( reinterpret_cast<const char*>( &v ), sizeof( v ) );
+		const auto inserted = uniqueVertices.emplace( key, static_cast<uint32_t>( mesh.vertices.size() ) );
+		if( inserted.second ) mesh.vertices.push_back( v );
+
+		mesh.indices.push_back( inserted.first->second );
+	}
+
+	return mesh;
+}
+
+glm::vec3 toVec3( const Vertex3D& v ){
+	return glm::vec3( v.position[0], v.position[1], v.position[2] );
+}
+
+// xyz = center, w = radius; centered on the AABB, which is tight enough for the boxy meshes here
+glm::vec4 computeBoundingSphere( const std::vector<Vertex3D_UV>& vertices ){
+	if( vertices.empty() ) return glm::vec4( 0.0f );
+
+	glm::vec3 minCorner = toVec3( vertices[0].position );
+	glm::vec3 maxCorner = minCorner;
+	for( const auto& v : vertices ){
+		minCorner = glm::min( minCorner, toVec3( v.position ) );
+		maxCorner = glm::max( maxCorner, toVec3( v.position ) );
+	}
+
+	const glm::vec3 center = 0.5f * (minCorner + maxCorner);
+	float radius = 0.0f;
+	for( const auto& v : vertices ) radius = std::max(  radius, glm::length( toVec3( v.position ) - center )  );
+
+	return glm::vec4( center, radius );
+}
+
+// splits every triangle into subdivisions^2 smaller ones, interpolating position and uv; shape stays the same
+IndexedMesh tessellateMesh( const IndexedMesh& mesh, const uint32_t subdivisions ){
+	if( subdivisions <= 1 ) return mesh;
+
+	const uint32_t n = subdivisions;
+	IndexedMesh result;
+
+	for( size_t t = 0; t + 2 < mesh.indices.size(); t += 3 ){
+		const Vertex3D_UV& a = mesh.vertices[mesh.indices[t + 0]];
+		const Vertex3D_UV& b = mesh.vertices[mesh.indices[t + 1]];
+		const Vertex3D_UV& c = mesh.vertices[mesh.indices[t + 2]];
+
+		// barycentric grid: row i has n - i + 1 vertices
+		const uint32_t base = static_cast<uint32_t>( result.vertices.size() );
+		const auto gridIndex = [&]( const uint32_t i, const uint32_t j ){ return base + i * (n + 1) - i * (i - 1) / 2 + j; };
+
+		for( uint32_t i = 0; i <= n; ++i ){
+			for( uint32_t j = 0; j <= n - i; ++j ){
+				const float u = float( j ) / n, v = float( i ) / n, w = 1.0f - u - v;
+
+				Vertex3D_UV vertex;
+				for( int k = 0; k < 3; ++k ) vertex.position.position[k] = w * a.position.position[k] + u * b.position.position[k] + v * c.position.position[k];
+				for( int k = 0; k < 2; ++k ) vertex.uv.uv[k] = w * a.uv.uv[k] + u * b.uv.uv[k] + v * c.uv.uv[k];
+				result.vertices.push_back( vertex );
+			}
+		}
+
+		// same winding as the source triangle
+		for( uint32_t i = 0; i < n; ++i ){
+			for( uint32_t j = 0; j < n - i; ++j ){
+				result.indices.insert(  result.indices.end(), { gridIndex( i, j ), gridIndex( i, j + 1 ), gridIndex( i + 1, j ) }  );
+				if( j + 1 < n - i ) result.indices.insert(  result.indices.end(), { gridIndex( i, j + 1 ), gridIndex( i + 1, j + 1 ), gridIndex( i + 1, j ) }  );
+			}
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+// Quadric error metric simplification (Garland & Heckbert) by half-edge collapses, and LOD chains built with it.
+// Collapses move a vertex onto one of its neighbours, so no new vertices (and no uv interpolation) are needed
+// and every LOD can index the base mesh's vertex buffer. Border and uv seam vertices stay locked.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Mesh.h"
+
+// symmetric 4x4 matrix of summed plane equations, weighted by triangle area
+struct Quadric{
+	std::array<double, 10> q; // aa ab ac ad bb bc bd cc cd dd
+	double weight;
+};
+
+Quadric makeQuadric( const glm::dvec3 n, const double d, const double weight ){
+	return Quadric{ {{
+		weight * n.x * n.x, weight * n.x * n.y, weight * n.x * n.z, weight * n.x * d,
+		weight * n.y * n.y, weight * n.y * n.z, weight * n.y * d,
+		weight * n.z * n.z, weight * n.z * d,
+		weight * d * d
+	}}, weight };
+}
+
+void addQuadric( Quadric& to, const Quadric& from ){
+	for( size_t i = 0; i < to.q.size(); ++i ) to.q[i] += from.q[i];
+	to.weight += from.weight;
+}
+
+// mean squared distance of p to the planes summed in the quadric
+double evaluateQuadric( const Quadric& quadric, const glm::dvec3 p ){
+	const auto& q = quadric.q;
+	const double e =
+		  q[0] * p.x * p.x + 2 * q[1] * p.x * p.y + 2 * q[2] * p.x * p.z + 2 * q[3] * p.x
+		+ q[4] * p.y * p.y + 2 * q[5] * p.y * p.z + 2 * q[6] * p.y
+		+ q[7] * p.z * p.z + 2 * q[8] * p.z
+		+ q[9];
+
+	return quadric.weight > 0.0 ? std::max( e, 0.0 ) / quadric.weight : 0.0;
+}
+
+// merges vertices with the same position and uv (up to float noise, e.g. from tessellateMesh()) so they share topology
+std::vector<uint32_t> getWeldRemap( const std::vector<Vertex3D_UV>& vertices ){
+	const float quantization = 1.0e5f;
+
+	std::vector<uint32_t> remap( vertices.size() );
+	std::unordered_map<std::string, uint32_t> representatives;
+	for( uint32_t v = 0; v < vertices.size(); ++v ){
+		int32_t key[5];
+		for( int k = 0; k < 3; ++k ) key[k] = static_cast<int32_t>( std::lround( vertices[v].position.position[k] * quantization ) );
+		for( int k = 0; k < 2; ++k ) key[3 + k] = static_cast<int32_t>( std::lround( vertices[v].uv.uv[k] * quantization ) );
+
+		remap[v] = representatives.emplace( std::string( reinterpret_cast<const char*>( key ), sizeof( key ) ), v ).first->second;
+	}
+
+	return remap;
+}
+
+// Returns indices of the simplified mesh (into mesh.vertices) with at most targetTriangleCount triangles, or as close as the
+// locked borders allow. error receives the largest collapse error as a distance in mesh units.
+std::vector<uint32_t> simplifyMesh( const IndexedMesh& mesh, const uint32_t targetTriangleCount, float* error = nullptr ){
+	const uint32_t vertexCount = static_cast<uint32_t>( mesh.vertices.size() );
+	const std::vector<uint32_t> remap = getWeldRemap( mesh.vertices );
+
+	const auto position = [&]( const uint32_t v ){ return glm::dvec3( toVec3( mesh.vertices[v].position ) ); };
+
+	std::vector< std::array<uint32_t, 3> > triangles;
+	for( size_t i = 0; i + 2 < mesh.indices.size(); i += 3 ){
+		const std::array<uint32_t, 3> t = {{ remap[mesh.indices[i]], remap[mesh.indices[i + 1]], remap[mesh.indices[i + 2]] }};
+		if( t[0] != t[1] && t[1] != t[2] && t[0] != t[2] ) triangles.push_back( t );
+	}
+	uint32_t liveTriangleCount = static_cast<uint32_t>( triangles.size() );
+
+	std::vector<bool> triangleRemoved( triangles.size(), false );
+	std::vector< std::vector<uint32_t> > vertexTriangles( vertexCount );
+	for( uint32_t t = 0; t < triangles.size(); ++t ) for( const uint32_t v : triangles[t] ) vertexTriangles[v].push_back( t );
+
+	// edges used by one triangle are borders (incl. uv seams, which welding keeps apart), more than two is non-manifold -- don't touch either
+	std::vector<bool> locked( vertexCount, false );
+	{
+		std::unordered_map<uint64_t, uint32_t> edgeUse;
+		for( const auto& t : triangles ){
+			for( int k = 0; k < 3; ++k ){
+				const uint32_t a = std::min( t[k], t[(k + 1) % 3] ), b = std::max( t[k], t[(k + 1) % 3] );
+				++edgeUse[uint64_t( a ) << 32 | b];
+			}
+		}
+		for( const auto& e : edgeUse ){
+			if( e.second != 2 ){
+				locked[e.first >> 32] = true;
+				locked[e.first & 0xFFFFFFFF] = true;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics( vertexCount, Quadric{ {}, 0.0 } );
+	for( const auto& t : triangles ){
+		const glm::dvec3 p0 = position( t[0] ), p1 = position( t[1] ), p2 = position( t[2] );
+		const glm::dvec3 cross = glm::cross( p1 - p0, p2 - p0 );
+		const double area = 0.5 * glm::length( cross );
+		if( area <= 0.0 ) continue;
+
+		const glm::dvec3 n = cross / (2.0 * area);
+		const Quadric quadric = makeQuadric( n, -glm::dot( n, p0 ), area );
+		for( const uint32_t v : t ) addQuadric( quadrics[v], quadric );
+	}
+
+	std::vector<bool> collapsed( vertexCount, false );
+	std::vector<uint32_t> version( vertexCount, 0 );
+
+	struct Collapse{
+		double cost;
+		uint32_t from, to;
+		uint32_t fromVersion, toVersion;
+		bool operator>( const Collapse& other ) const{ return cost > other.cost; }
+	};
+	std::priority_queue< Collapse, std::vector<Collapse>, std::greater<Collapse> > heap;
+
+	const auto liveTriangles = [&]( const uint32_t v ) -> std::vector<uint32_t>& {
+		auto& list = vertexTriangles[v];
+		list.erase(  std::remove_if( list.begin(), list.end(), [&]( uint32_t t ){ return triangleRemoved[t]; } ), list.end()  );
+		return list;
+	};
+
+	const auto neighbours = [&]( const uint32_t v ){
+		std::vector<uint32_t> result;
+		for( const uint32_t t : liveTriangles( v ) ) for( const uint32_t w : triangles[t] ) if( w != v ) result.push_back( w );
+		std::sort( result.begin(), result.end() );
+		result.erase( std::unique( result.begin(), result.end() ), result.end() );
+		return result;
+	};
+
+	const auto pushCollapse = [&]( const uint32_t from, const uint32_t to ){
+		if( locked[from] ) return;
+
+		Quadric combined = quadrics[from];
+		addQuadric( combined, quadrics[to] );
+		heap.push( { evaluateQuadric( combined, position( to ) ), from, to, version[from], version[to] } );
+	};
+
+	for( uint32_t v = 0; v < vertexCount; ++v ){
+		if( remap[v] != v ) continue;
+		for( const uint32_t w : neighbours( v ) ) pushCollapse( v, w );
+	}
+
+	const auto isCollapseValid = [&]( const uint32_t from, const uint32_t to ){
+		// link condition: the only shared neighbours are the apexes of the two triangles on the edge, otherwise the collapse pinches the surface
+		const std::vector<uint32_t> fromNeighbours = neighbours( from ), toNeighbours = neighbours( to );
+		std::vector<uint32_t> shared;
+		std::set_intersection( fromNeighbours.begin(), fromNeighbours.end(), toNeighbours.begin(), toNeighbours.end(), std::back_inserter( shared ) );
+
+		uint32_t edgeTriangles = 0;
+		for( const uint32_t t : liveTriangles( from ) ){
+			const auto& tri = triangles[t];
+			if( tri[0] == to || tri[1] == to || tri[2] == to ) ++edgeTriangles;
+		}
+		if( edgeTriangles == 0 || shared.size() != edgeTriangles ) return false;
+
+		// no triangle may flip or degenerate
+		for( const uint32_t t : liveTriangles( from ) ){
+			const auto& tri = triangles[t];
+			if( tri[0] == to || tri[1] == to || tri[2] == to ) continue;
+
+			glm::dvec3 p[3], moved[3];
+			for( int k = 0; k < 3; ++k ){
+				p[k] = position( tri[k] );
+				moved[k] = tri[k] == from ? position( to ) : p[k];
+			}
+
+			const glm::dvec3 before = glm::cross( p[1] - p[0], p[2] - p[0] );
+			const glm::dvec3 after = glm::cross( moved[1] - moved[0], moved[2] - moved[0] );
+			if( glm::dot( before, after ) <= 0.25 * glm::length( before ) * glm::length( after ) ) return false; // > ~75 degrees rotation counts as a flip
+		}
+
+		return true;
+	};
+
+	double maxCost = 0.0;
+	while( liveTriangleCount > targetTriangleCount && !heap.empty() ){
+		const Collapse c = heap.top();
+		heap.pop();
+
+		if( collapsed[c.from] || collapsed[c.to] ) continue;
+		if( c.fromVersion != version[c.from] || c.toVersion != version[c.to] ) continue; // stale
+		if( !isCollapseValid( c.from, c.to ) ) continue; // re-queued when the neighbourhood changes
+
+		for( const uint32_t t : liveTriangles( c.from ) ){
+			auto& tri = triangles[t];
+			if( tri[0] == c.to || tri[1] == c.to || tri[2] == c.to ){
+				triangleRemoved[t] = true;
+				--liveTriangleCount;
+				continue;
+			}
+
+			for( auto& v : tri ) if( v == c.from ) v = c.to;
+			vertexTriangles[c.to].push_back( t );
+		}
+		vertexTriangles[c.from].clear();
+		collapsed[c.from] = true;
+		addQuadric( quadrics[c.to], quadrics[c.from] );
+		maxCost = std::max( maxCost, c.cost );
+
+		// everything around the merged vertex has new costs and validity
+		const std::vector<uint32_t> changed = neighbours( c.to );
+		++version[c.to];
+		for( const uint32_t v : changed ) ++version[v];
+
+		for( const uint32_t w : changed ) pushCollapse( c.to, w );
+		for( const uint32_t v : changed ) for( const uint32_t w : neighbours( v ) ) pushCollapse( v, w );
+	}
+
+	if( error ) *error = static_cast<float>( std::sqrt( maxCost ) );
+
+	std::vector<uint32_t> indices;
+	indices.reserve( 3 * liveTriangleCount );
+	for( uint32_t t = 0; t < triangles.size(); ++t ){
+		if( !triangleRemoved[t] ) indices.insert( indices.end(), triangles[t].begin(), triangles[t].end() );
+	}
+
+	return indices;
+}
+
+
+// LOD chain
+///////////////////////////////////////////
+
+struct MeshLod{
+	uint32_t firstIndex; // into LodMesh::indices
+	uint32_t indexCount;
+	float error; // largest deviation from the base mesh, mesh units
+};
+
+// base mesh and all of its LODs in one vertex + index buffer; lods[0] is the base mesh
+struct LodMesh{
+	std::vector<Vertex3D_UV> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;
+};
+
+// each level simplifies the previous one; levels that cannot get meaningfully smaller are dropped
+LodMesh buildLodChain( const IndexedMesh& mesh, const std::vector<float>& triangleRatios = { 0.5f, 0.25f, 0.1f } ){
+	LodMesh result;
+	result.vertices = mesh.vertices;
+	result.indices = mesh.indices;
+	result.lods.push_back( { 0, static_cast<uint32_t>( mesh.indices.size() ), 0.0f } );
+
+	const uint32_t baseTriangleCount = static_cast<uint32_t>( mesh.indices.size() / 3 );
+	IndexedMesh previous = mesh;
+	float accumulatedError = 0.0f;
+
+	for( const float ratio : triangleRatios ){
+		float error;
+		std::vector<uint32_t> indices = simplifyMesh(  previous, static_cast<uint32_t>( baseTriangleCount * ratio ), &error  );
+		if( indices.size() * 10 > previous.indices.size() * 9 ) break; // less than 10 % saved
+
+		accumulatedError += error; // collapses on top of collapses: errors add up at worst
+		result.lods.push_back( { static_cast<uint32_t>( result.indices.size() ), static_cast<uint32_t>( indices.size() ), accumulatedError } );
+		result.indices.insert( result.indices.end(), indices.begin(), indices.end() );
+
+		previous.indices = std::move( indices );
+	}
+
+	return result;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+// Offline meshlet (cluster) builder. Meshlets are drawn as plain index ranges through indexed indirect draws,
+// so culling them (cullMeshlets.comp) needs a compute pass only -- no mesh shader hardware.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Mesh.h"
+
+constexpr uint32_t maxMeshletVertices = 64;
+constexpr uint32_t maxMeshletTriangles = 124;
+
+// std430 layout matching cullMeshlets.comp
+struct Meshlet{
+	glm::vec4 boundingSphere; // xyz = center, w = radius; mesh space
+	glm::vec4 normalCone; // xyz = axis, w = cutoff; back facing from eye when dot( center - eye, axis ) >= cutoff * |center - eye| + radius
+	uint32_t firstIndex; // into MeshletMesh::indices
+	uint32_t indexCount;
+	uint32_t vertexCount; // unique vertices referenced, <= maxMeshletVertices
+	uint32_t padding;
+};
+
+struct MeshletMesh{
+	std::vector<Vertex3D_UV> vertices; // same as the source mesh
+	std::vector<uint32_t> indices; // source indices reordered so that every meshlet is a contiguous range
+	std::vector<Meshlet> meshlets;
+	uint32_t triangleCount;
+};
+
+glm::vec3 getTriangleNormal( const IndexedMesh& mesh, const uint32_t triangle ){
+	const glm::vec3 a = toVec3( mesh.vertices[mesh.indices[3 * triangle + 0]].position );
+	const glm::vec3 b = toVec3( mesh.vertices[mesh.indices[3 * triangle + 1]].position );
+	const glm::vec3 c = toVec3( mesh.vertices[mesh.indices[3 * triangle + 2]].position );
+
+	const glm::vec3 n = glm::cross( b - a, c - a ); // counter-clockwise is front, as in Cube.h
+	const float length = glm::length( n );
+	return length > 0.0f ? n / length : glm::vec3( 0.0f );
+}
+
+Meshlet computeMeshletBounds( const IndexedMesh& mesh, const std::vector<uint32_t>& triangles, const std::vector<uint32_t>& meshletVertices ){
+	Meshlet meshlet{};
+
+	glm::vec3 minCorner = toVec3( mesh.vertices[meshletVertices[0]].position );
+	glm::vec3 maxCorner = minCorner;
+	for( const uint32_t v : meshletVertices ){
+		minCorner = glm::min( minCorner, toVec3( mesh.vertices[v].position ) );
+		maxCorner = glm::max( maxCorner, toVec3( mesh.vertices[v].position ) );
+	}
+	const glm::vec3 center = 0.5f * (minCorner + maxCorner);
+	float radius = 0.0f;
+	for( const uint32_t v : meshletVertices ) radius = std::max(  radius, glm::length( toVec3( mesh.vertices[v].position ) - center )  );
+	meshlet.boundingSphere = glm::vec4( center, radius );
+
+	glm::vec3 normalSum( 0.0f );
+	for( const uint32_t t : triangles ) normalSum += getTriangleNormal( mesh, t );
+
+	// cutoff 1 can never pass the back-facing test -- used when normals spread too much for the cone to be useful
+	meshlet.normalCone = glm::vec4( 0.0f, 0.0f, 1.0f, 1.0f );
+	if( glm::length( normalSum ) > 0.0f ){
+		const glm::vec3 axis = glm::normalize( normalSum );
+
+		float minDot = 1.0f;
+		for( const uint32_t t : triangles ){
+			const glm::vec3 n = getTriangleNormal( mesh, t );
+			if( n != glm::vec3( 0.0f ) ) minDot = std::min( minDot, glm::dot( n, axis ) );
+		}
+
+		if( minDot > 0.1f ) meshlet.normalCone = glm::vec4(  axis, std::sqrt( 1.0f - minDot * minDot )  ); // sine of the cone half-angle
+	}
+
+	return meshlet;
+}
+
+// Greedy: grow each meshlet from a seed triangle, always taking the adjacent triangle that adds the fewest new vertices.
+MeshletMesh buildMeshlets( const IndexedMesh& mesh ){
+	const uint32_t vertexCount = static_cast<uint32_t>( mesh.vertices.size() );
+	const uint32_t triangleCount = static_cast<uint32_t>( mesh.indices.size() / 3 );
+
+	MeshletMesh result;
+	result.vertices = mesh.vertices;
+	result.triangleCount = triangleCount;
+	result.indices.reserve( 3 * triangleCount );
+
+	// vertex -> triangles adjacency, CSR
+	std::vector<uint32_t> adjacencyOffsets( vertexCount + 1, 0 );
+	for( const uint32_t i : mesh.indices ) ++adjacencyOffsets[i + 1];
+	for( uint32_t v = 0; v < vertexCount; ++v ) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	std::vector<uint32_t> adjacency( mesh.indices.size() );
+	{
+		std::vector<uint32_t> fill( adjacencyOffsets.begin(), adjacencyOffsets.end() - 1 );
+		for( uint32_t i = 0; i < mesh.indices.size(); ++i ) adjacency[fill[mesh.indices[i]]++] = i / 3;
+	}
+
+	std::vector<bool> triangleUsed( triangleCount, false );
+	std::vector<int32_t> localVertex( vertexCount, -1 ); // >= 0 while the vertex is part of the current meshlet
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint32_t> meshletTriangles;
+	std::vector<uint32_t> candidates;
+	uint32_t nextSeed = 0;
+
+	const auto newVertexCount = [&]( const uint32_t t ){
+		uint32_t count = 0;
+		for( uint32_t k = 0; k < 3; ++k ) count += localVertex[mesh.indices[3 * t + k]] < 0;
+		return count;
+	};
+
+	const auto finishMeshlet = [&]{
+		if( meshletTriangles.empty() ) return;
+
+		Meshlet meshlet = computeMeshletBounds( mesh, meshletTriangles, meshletVertices );
+		meshlet.firstIndex = static_cast<uint32_t>( result.indices.size() );
+		meshlet.indexCount = 3 * static_cast<uint32_t>( meshletTriangles.size() );
+		meshlet.vertexCount = static_cast<uint32_t>( meshletVertices.size() );
+		result.meshlets.push_back( meshlet );
+
+		for( const uint32_t t : meshletTriangles ){
+			result.indices.insert( result.indices.end(), mesh.indices.begin() + 3 * t, mesh.indices.begin() + 3 * t + 3 );
+		}
+
+		for( const uint32_t v : meshletVertices ) localVertex[v] = -1;
+		meshletVertices.clear();
+		meshletTriangles.clear();
+		candidates.clear();
+	};
+
+	while( true ){
+		// pick the adjacent triangle adding the fewest vertices; fall back to the next unused one in index order
+		uint32_t best = UINT32_MAX;
+		uint32_t bestNewVertices = UINT32_MAX;
+		for( size_t i = 0; i < candidates.size(); ){
+			if( triangleUsed[candidates[i]] ){
+				candidates[i] = candidates.back();
+				candidates.pop_back();
+				continue;
+			}
+
+			const uint32_t newVertices = newVertexCount( candidates[i] );
+			if( newVertices < bestNewVertices || (newVertices == bestNewVertices && candidates[i] < best) ){
+				best = candidates[i];
+				bestNewVertices = newVertices;
+			}
+			++i;
+		}
+
+		if( best == UINT32_MAX ){
+			while( nextSeed < triangleCount && triangleUsed[nextSeed] ) ++nextSeed;
+			if( nextSeed == triangleCount ) break;
+
+			best = nextSeed;
+			bestNewVertices = newVertexCount( best );
+		}
+
+		if( meshletVertices.size() + bestNewVertices > maxMeshletVertices || meshletTriangles.size() == maxMeshletTriangles ){
+			finishMeshlet();
+			continue; // re-evaluate: the best candidate depended on the finished meshlet's vertices
+		}
+
+		triangleUsed[best] = true;
+		meshletTriangles.push_back( best );
+		for( uint32_t k = 0; k < 3; ++k ){
+			const uint32_t v = mesh.indices[3 * best + k];
+			if( localVertex[v] >= 0 ) continue;
+
+			localVertex[v] = static_cast<int32_t>( meshletVertices.size() );
+			meshletVertices.push_back( v );
+			candidates.insert( candidates.end(), adjacency.begin() + adjacencyOffsets[v], adjacency.begin() + adjacencyOffsets[v + 1] );
+		}
+	}
+	finishMeshlet();
+
+	return result;
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+// CPU side of the resource cache (ResourceCache in main.cpp): content keys, decoded texture files and the on-disk index.
+// A key is the XXH64 of the file bytes seeded with a hash of the import settings -- two paths with the same bytes
+// share one GPU resource, and a texture decoded once is read back from the cache directory instead of decoded again.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Ktx2.h"
+#include "TextureStreaming.h"
+
+// XXH64 (Collet, xxHash); the same values as the reference implementation on little endian hosts
+constexpr uint64_t xxPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t xxPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t xxPrime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t xxPrime4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t xxPrime5 = 0x27D4EB2F165667C5ull;
+
+uint64_t rotateLeft( const uint64_t value, const int bits ){
+	return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t xxRound( uint64_t accumulator, const uint64_t input ){
+	accumulator += input * xxPrime2;
+	return rotateLeft( accumulator, 31 ) * xxPrime1;
+}
+
+uint64_t xxMergeRound( const uint64_t accumulator, const uint64_t value ){
+	return (accumulator ^ xxRound( 0, value )) * xxPrime1 + xxPrime4;
+}
+
+uint64_t xxHash64( const void* data, const size_t size, const uint64_t seed = 0 ){
+	const uint8_t* bytes = static_cast<const uint8_t*>( data );
+	const uint8_t* const end = bytes + size;
+	const auto read64 = []( const uint8_t* p ){ uint64_t v; std::memcpy( &v, p, 8 ); return v; };
+	const auto read32 = []( const uint8_t* p ){ uint32_t v; std::memcpy( &v, p, 4 ); return v; };
+
+	uint64_t hash;
+	if( size >= 32 ){
+		uint64_t v1 = seed + xxPrime1 + xxPrime2;
+		uint64_t v2 = seed + xxPrime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - xxPrime1;
+		for( ; end - bytes >= 32; bytes += 32 ){
+			v1 = xxRound( v1, read64( bytes ) );
+			v2 = xxRound( v2, read64( bytes + 8 ) );
+			v3 = xxRound( v3, read64( bytes + 16 ) );
+			v4 = xxRound( v4, read64( bytes + 24 ) );
+		}
+
+		hash = rotateLeft( v1, 1 ) + rotateLeft( v2, 7 ) + rotateLeft( v3, 12 ) + rotateLeft( v4, 18 );
+		hash = xxMergeRound( hash, v1 );
+		hash = xxMergeRound( hash, v2 );
+		hash = xxMergeRound( hash, v3 );
+		hash = xxMergeRound( hash, v4 );
+	}
+	else hash = seed + xxPrime5;
+
+	hash += size;
+	for( ; end - bytes >= 8; bytes += 8 ) hash = rotateLeft( hash ^ xxRound( 0, read64( bytes ) ), 27 ) * xxPrime1 + xxPrime4;
+	if( end - bytes >= 4 ){
+		hash = rotateLeft( hash ^ (read32( bytes ) * xxPrime1), 23 ) * xxPrime2 + xxPrime3;
+		bytes += 4;
+	}
+	for( ; bytes < end; ++bytes ) hash = rotateLeft( hash ^ (*bytes * xxPrime5), 11 ) * xxPrime1;
+
+	hash ^= hash >> 33;
+	hash *= xxPrime2;
+	hash ^= hash >> 29;
+	hash *= xxPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+// settings: everything besides the bytes that changes the result (mipmapped, target format, ...) -- with a version to bump
+uint64_t getContentKey( const uint8_t* bytes, const size_t size, const std::string& settings ){
+	return xxHash64( bytes, size, xxHash64( settings.data(), settings.size() ) );
+}
+
+std::string getContentKeyText( const uint64_t key ){
+	char text[17];
+	std::snprintf( text, sizeof( text ), "%016llx", static_cast<unsigned long long>( key ) );
+	return text;
+}
+
+// one line of the index: a decoded texture in the cache directory
+struct CachedTextureInfo{
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint64_t bytes; // of all levels
+};
+typedef std::unordered_map<uint64_t, CachedTextureInfo> ResourceIndex;
+
+// lines of "key format width height levels bytes"; a missing index is an empty one, unreadable lines are skipped
+ResourceIndex readResourceIndex( const std::string& path ){
+	ResourceIndex index;
+	std::ifstream file( path );
+	std::string line;
+	while( std::getline( file, line ) ){
+		unsigned long long key, bytes;
+		unsigned format, width, height, levelCount;
+		if( std::sscanf( line.c_str(), "%llx %u %u %u %u %llu", &key, &format, &width, &height, &levelCount, &bytes ) != 6 ) continue;
+		index[key] = { static_cast<VkFormat>( format ), width, height, levelCount, bytes };
+	}
+
+	return index;
+}
+
+// appended, so a crash loses at most the line being written
+void appendResourceIndex( const std::string& path, const uint64_t key, const CachedTextureInfo& info ){
+	std::ofstream file( path, std::ios::app );
+	file << getContentKeyText( key ) << " " << info.format << " " << info.width << " " << info.height << " " << info.levelCount << " " << info.bytes << "\n";
+	if( !file ) throw "cannot append to the resource cache index!";
+}
+
+CachedTextureInfo getCachedTextureInfo( const DecodedTexture& texture ){
+	CachedTextureInfo info{ texture.format, texture.width, texture.height, static_cast<uint32_t>( texture.levels.size() ), 0 };
+	for( const auto& level : texture.levels ) info.bytes += level.size();
+	return info;
+}
+
+// "RCT1", then format, width, height and level count (u32), the level sizes (u64) and the levels -- little endian,
+// for this cache only; cooked textures meant to be shipped are KTX2 (textureCooker.cpp)
+constexpr uint32_t cachedTextureMagic = 0x31544352; // "RCT1"
+
+std::vector<uint8_t> serializeDecodedTexture( const DecodedTexture& texture ){
+	const CachedTextureInfo info = getCachedTextureInfo( texture );
+	const size_t headerSize = 20 + 8 * texture.levels.size();
+
+	std::vector<uint8_t> file( headerSize );
+	writeLittleEndian( file, 0, cachedTextureMagic, 4 );
+	writeLittleEndian( file, 4, texture.format, 4 );
+	writeLittleEndian( file, 8, texture.width, 4 );
+	writeLittleEndian( file, 12, texture.height, 4 );
+	writeLittleEndian( file, 16, info.levelCount, 4 );
+	file.reserve( headerSize + info.bytes );
+	for( size_t level = 0; level < texture.levels.size(); ++level ){
+		writeLittleEndian( file, 20 + 8 * level, texture.levels[level].size(), 8 );
+		file.insert( file.end(), texture.levels[level].begin(), texture.levels[level].end() );
+	}
+
+	return file;
+}
+
+// false if the file is not one serializeDecodedTexture() wrote, was cut short, or its level sizes do not match the format and size
+bool deserializeDecodedTexture( const uint8_t* file, const size_t size, DecodedTexture& texture ){
+	if( size < 20 || readLittleEndian32( file ) != cachedTextureMagic ) return false;
+
+	const uint32_t levelCount = readLittleEndian32( file + 16 );
+	if( levelCount == 0 || levelCount > 32 || size < 20 + 8 * size_t( levelCount ) ) return false;
+
+	texture = { static_cast<VkFormat>( readLittleEndian32( file + 4 ) ), readLittleEndian32( file + 8 ), readLittleEndian32( file + 12 ), {} };
+	const BlockFormatInfo block = getBlockFormatInfo( texture.format );
+	if( block.bytesPerBlock == 0 || texture.width == 0 || texture.height == 0 ) return false;
+
+	size_t offset = 20 + 8 * size_t( levelCount );
+	for( uint32_t level = 0; level < levelCount; ++level ){
+		const uint64_t levelSize = readLittleEndian64( file + 20 + 8 * level );
+		if( levelSize != getLevelByteLength( block, texture.width, texture.height, level ) ) return false; // would be uploaded as a level of that size
+		if( levelSize > size - offset ) return false;
+
+		texture.levels.emplace_back( file + offset, file + offset + levelSize );
+		offset += levelSize;
+	}
+
+	return true;
+}
+
+// empty if the file cannot be read
+std::vector<uint8_t> readResourceFile( const std::string& path ){
+	std::ifstream file( path, std::ios::binary | std::ios::ate );
+	if( !file ) return {};
+
+	std::vector<uint8_t> bytes( static_cast<size_t>( file.tellg() ) );
+	file.seekg( 0 );
+	file.read( reinterpret_cast<char*>( bytes.data() ), bytes.size() );
+	return file ? bytes : std::vector<uint8_t>();
+}
+
+bool readCachedTexture( const std::string& path, DecodedTexture& texture ){
+	const std::vector<uint8_t> bytes = readResourceFile( path );
+	return deserializeDecodedTexture( bytes.data(), bytes.size(), texture );
+}
+
+void writeCachedTexture( const std::string& path, const DecodedTexture& texture ){
+	const std::vector<uint8_t> bytes = serializeDecodedTexture( texture );
+	std::ofstream file( path, std::ios::binary | std::ios::trunc );
+	file.write( reinterpret_cast<const char*>( bytes.data() ), bytes.size() );
+	if( !file ) throw "cannot write a decoded texture to the resource cache!";
+}
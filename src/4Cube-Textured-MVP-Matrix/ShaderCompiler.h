@@ -0,0 +1,234 @@
+#pragma once
+
+// Runtime GLSL -> SPIR-V (RUNTIME_SHADER_COMPILER in main.cpp): shaderc compiles .vert/.frag/.comp sources on demand, the
+// SPIR-V is kept in a cache directory under a key of everything that changes it -- the source and the files it includes,
+// the defines and the compiler -- and ShaderWatcher (inotify) tells which files changed, for hot reload.
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <shaderc/shaderc.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "ResourceCache.h"
+
+// the shaderc release, as a string literal -- its API only exposes the SPIR-V version it produces
+// build.sh passes -DSHADERC_VERSION="\"$(pkg-config --modversion shaderc)\""; without it, clear the cache by hand after upgrading shaderc
+#ifndef SHADERC_VERSION
+	#define SHADERC_VERSION "unknown"
+#endif
+
+struct ShaderSource{
+	std::string path; // the stage follows the extension, as with glslc
+	std::vector<std::string> defines; // "NAME" or "NAME=VALUE", as glslc -D
+};
+
+std::string normalizeShaderPath( const std::string& path ){
+	return std::filesystem::path( path ).lexically_normal().generic_string();
+}
+
+// #include "file" is relative to the including file; <file> is not supported
+std::string resolveShaderInclude( const std::string& includingPath, const std::string& includedName ){
+	return normalizeShaderPath(  ( std::filesystem::path( includingPath ).parent_path() / includedName ).string()  );
+}
+
+// the source and everything it includes, each once; a commented out or #if'ed out #include still counts (a harmless extra reload)
+void collectShaderDependencies( const std::string& path, std::vector<std::string>& dependencies ){
+	for( const std::string& known : dependencies ) if( known == path ) return;
+	dependencies.push_back( path );
+
+	std::ifstream file( path );
+	std::string line;
+	while( std::getline( file, line ) ){
+		const size_t directive = line.find_first_not_of( " \t" );
+		if( directive == std::string::npos || line.compare( directive, 8, "#include" ) != 0 ) continue;
+
+		const size_t open = line.find( '"', directive + 8 );
+		const size_t close = open == std::string::npos ? open : line.find( '"', open + 1 );
+		if( close != std::string::npos ) collectShaderDependencies( resolveShaderInclude( path, line.substr( open + 1, close - open - 1 ) ), dependencies );
+	}
+}
+
+std::vector<std::string> getShaderDependencies( const ShaderSource& shader ){
+	std::vector<std::string> dependencies;
+	collectShaderDependencies( normalizeShaderPath( shader.path ), dependencies );
+	return dependencies;
+}
+
+shaderc_shader_kind getShaderKind( const std::string& path ){
+	const std::string extension = std::filesystem::path( path ).extension().string();
+	if( extension == ".vert" ) return shaderc_vertex_shader;
+	if( extension == ".frag" ) return shaderc_fragment_shader;
+	if( extension == ".comp" ) return shaderc_compute_shader;
+	throw "unknown shader stage -- .vert, .frag or .comp only!";
+}
+
+struct ShaderCompiler{
+	shaderc_compiler_t compiler;
+	std::string cacheDirectory;
+	std::string version; // shaderc release and the SPIR-V version it produces
+};
+
+ShaderCompiler initShaderCompiler( const std::string& cacheDirectory ){
+	ShaderCompiler compiler{ shaderc_compiler_initialize(), cacheDirectory, "" };
+	if( !compiler.compiler ) throw "cannot initialize shaderc!";
+
+	unsigned version, revision;
+	shaderc_get_spv_version( &version, &revision );
+	compiler.version = std::string( "shaderc " SHADERC_VERSION " SPIR-V " ) + std::to_string( version ) + "." + std::to_string( revision );
+
+	std::filesystem::create_directories( cacheDirectory );
+	return compiler;
+}
+
+void killShaderCompiler( ShaderCompiler& compiler ){
+	shaderc_compiler_release( compiler.compiler );
+}
+
+// bump shaderCacheVersion when the compile options below change
+constexpr const char* shaderCacheVersion = "shader1";
+
+uint64_t getShaderKey( const ShaderCompiler& compiler, const ShaderSource& shader, const std::vector<std::string>& dependencies ){
+	std::string settings = std::string( shaderCacheVersion ) + " " + compiler.version;
+	for( const std::string& define : shader.defines ) settings += "\n-D" + define;
+
+	uint64_t key = xxHash64( settings.data(), settings.size() );
+	for( const std::string& dependency : dependencies ){
+		const std::vector<uint8_t> bytes = readResourceFile( dependency );
+		key = getContentKey( bytes.data(), bytes.size(), dependency + "\n" + getContentKeyText( key ) );
+	}
+
+	return key;
+}
+
+// what shaderc needs back from an include callback, and the strings it points to
+struct ShaderInclude{
+	shaderc_include_result result;
+	std::string name;
+	std::string content;
+};
+
+shaderc_include_result* resolveShaderIncludeCallback( void*, const char* requested, int /*type*/, const char* requesting, size_t /*depth*/ ){
+	ShaderInclude* include = new ShaderInclude{};
+	include->name = resolveShaderInclude( requesting, requested );
+	std::ifstream file( include->name, std::ios::binary );
+	if( file ) include->content.assign( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
+	else{
+		// an empty name tells shaderc the include failed, the content is the message
+		include->name.clear();
+		include->content = std::string( "cannot open " ) + requested;
+	}
+
+	include->result = { include->name.data(), include->name.size(), include->content.data(), include->content.size(), nullptr };
+	return &include->result;
+}
+
+void releaseShaderIncludeCallback( void*, shaderc_include_result* result ){
+	delete reinterpret_cast<ShaderInclude*>( result ); // result is the first member
+}
+
+std::vector<char> compileShaderSource( const ShaderCompiler& compiler, const ShaderSource& shader, const std::string& path ){
+	std::ifstream file( path, std::ios::binary );
+	if( !file ) throw "cannot open " + path;
+	const std::string source{ std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() };
+
+	shaderc_compile_options_t options = shaderc_compile_options_initialize();
+	for( const std::string& define : shader.defines ){
+		const size_t equals = define.find( '=' );
+		const std::string name = define.substr( 0, equals );
+		const std::string value = equals == std::string::npos ? "" : define.substr( equals + 1 );
+		shaderc_compile_options_add_macro_definition( options, name.data(), name.size(), value.data(), value.size() );
+	}
+	shaderc_compile_options_set_include_callbacks( options, resolveShaderIncludeCallback, releaseShaderIncludeCallback, nullptr );
+	shaderc_compile_options_set_optimization_level( options, shaderc_optimization_level_performance );
+
+	shaderc_compilation_result_t result = shaderc_compile_into_spv( compiler.compiler, source.data(), source.size(), getShaderKind( path ), path.c_str(), "main", options );
+	shaderc_compile_options_release( options );
+
+	const bool success = shaderc_result_get_compilation_status( result ) == shaderc_compilation_status_success;
+	const std::string messages = shaderc_result_get_error_message( result );
+	const char* bytes = shaderc_result_get_bytes( result );
+	const std::vector<char> spirv = success ? std::vector<char>( bytes, bytes + shaderc_result_get_length( result ) ) : std::vector<char>();
+	shaderc_result_release( result );
+
+	if( !success ) throw "cannot compile " + path + ":\n" + messages;
+	return spirv;
+}
+
+// SPIR-V of the shader, read from the cache directory when nothing it depends on changed; throws a string on compile errors
+// dependencies: set to what the shader depends on now, for ShaderWatcher's changes
+std::vector<char> compileShader( const ShaderCompiler& compiler, const ShaderSource& shader, std::vector<std::string>& dependencies, bool& cached ){
+	dependencies = getShaderDependencies( shader );
+	const std::string cachePath = compiler.cacheDirectory + "/" + getContentKeyText( getShaderKey( compiler, shader, dependencies ) ) + ".spv";
+
+	const std::vector<uint8_t> cachedSpirv = readResourceFile( cachePath );
+	cached = !cachedSpirv.empty() && cachedSpirv.size() % 4 == 0;
+	if( cached ) return std::vector<char>( cachedSpirv.begin(), cachedSpirv.end() );
+
+	const std::vector<char> spirv = compileShaderSource( compiler, shader, dependencies[0] );
+
+	// temporary file and rename: another process reading the cache never sees half of one
+	{
+		std::ofstream file( cachePath + ".tmp", std::ios::binary | std::ios::trunc );
+		file.write( spirv.data(), spirv.size() );
+		if( !file ) throw "cannot write to the shader cache!";
+	}
+	std::filesystem::rename( cachePath + ".tmp", cachePath );
+
+	return spirv;
+}
+
+// files written in one directory (not its subdirectories); without inotify nothing ever changes
+struct ShaderWatcher{
+	int fd;
+	std::string directory;
+};
+
+ShaderWatcher initShaderWatcher( const std::string& directory ){
+	ShaderWatcher watcher{ -1, directory };
+#ifdef __linux__
+	watcher.fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	// IN_MOVED_TO too: many editors save to a temporary file and rename it over the original
+	if( watcher.fd >= 0 && inotify_add_watch( watcher.fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO ) < 0 ){
+		close( watcher.fd );
+		watcher.fd = -1;
+	}
+#endif
+	return watcher;
+}
+
+void killShaderWatcher( ShaderWatcher& watcher ){
+#ifdef __linux__
+	if( watcher.fd >= 0 ) close( watcher.fd );
+#endif
+	watcher.fd = -1;
+}
+
+// paths (as normalizeShaderPath() makes them) of the files written since the last call; never blocks
+std::set<std::string> getChangedShaderFiles( ShaderWatcher& watcher ){
+	std::set<std::string> changed;
+#ifdef __linux__
+	if( watcher.fd < 0 ) return changed;
+
+	alignas( inotify_event ) char buffer[4096];
+	ssize_t size;
+	while( (size = read( watcher.fd, buffer, sizeof( buffer ) )) > 0 ){
+		for( ssize_t offset = 0; offset < size; ){
+			const inotify_event* event = reinterpret_cast<const inotify_event*>( buffer + offset );
+			if( event->len ) changed.insert(  normalizeShaderPath( watcher.directory + "/" + event->name )  );
+			offset += sizeof( inotify_event ) + event->len;
+		}
+	}
+#endif
+	return changed;
+}
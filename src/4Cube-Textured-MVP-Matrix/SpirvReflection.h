@@ -0,0 +1,349 @@
+#pragma once
+
+// SPIR-V reflection: the descriptor bindings, push constant ranges and vertex inputs a compiled module declares, read from its
+// decorations and types -- so descriptor set layouts, pipeline layouts, pools and vertex attributes follow the shaders instead
+// of a hand-written table that has to be kept in sync with them. Only what this app's shaders use; throws on anything else.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct ReflectedBinding{
+	uint32_t set;
+	uint32_t binding;
+	VkDescriptorType type;
+	uint32_t count; // 0: runtime array (bindless), the layout decides the count
+	VkShaderStageFlags stages;
+};
+
+struct ReflectedVertexInput{
+	uint32_t location;
+	VkFormat format;
+	uint32_t size; // bytes
+};
+
+struct ShaderReflection{
+	VkShaderStageFlags stages;
+	std::vector<ReflectedBinding> bindings; // sorted by set, then binding
+	std::vector<VkPushConstantRange> pushConstantRanges; // one per stage using push constants
+	std::vector<ReflectedVertexInput> vertexInputs; // vertex shaders only, sorted by location
+};
+
+// the few opcodes, decorations and storage classes needed (SPIR-V specification, 3.x)
+namespace spirv{
+	constexpr uint32_t magic = 0x07230203;
+
+	enum Op : uint32_t{
+		OpEntryPoint = 15,
+		OpTypeInt = 21, OpTypeFloat = 22, OpTypeVector = 23, OpTypeMatrix = 24, OpTypeImage = 25, OpTypeSampler = 26,
+		OpTypeSampledImage = 27, OpTypeArray = 28, OpTypeRuntimeArray = 29, OpTypeStruct = 30, OpTypePointer = 32,
+		OpConstant = 43,
+		OpVariable = 59,
+		OpDecorate = 71, OpMemberDecorate = 72
+	};
+
+	enum Decoration : uint32_t{
+		Block = 2, BufferBlock = 3, ArrayStride = 6, MatrixStride = 7, BuiltIn = 11, Location = 30, Binding = 33, DescriptorSet = 34, Offset = 35
+	};
+
+	enum StorageClass : uint32_t{
+		UniformConstant = 0, Input = 1, Uniform = 2, PushConstant = 9, StorageBuffer = 12
+	};
+
+	enum Dim : uint32_t{ DimBuffer = 5, DimSubpassData = 6 };
+}
+
+// what reflectSpirv() keeps of an id while walking the module
+struct SpirvId{
+	uint32_t opcode = 0;
+	std::vector<uint32_t> operands; // of the instruction defining it, the result id left out
+	uint32_t storageClass = 0; // variables
+	uint32_t typeId = 0; // variables and constants
+	bool hasLocation = false, hasBinding = false, hasSet = false, builtIn = false, block = false, bufferBlock = false;
+	uint32_t location = 0, binding = 0, set = 0, arrayStride = 0;
+	std::unordered_map<uint32_t, uint32_t> memberOffsets, memberMatrixStrides;
+};
+
+// bytes of a type in a push constant block (explicit layout: offsets and strides are decorations)
+uint32_t getSpirvTypeSize( const std::vector<SpirvId>& ids, const uint32_t typeId ){
+	const SpirvId& type = ids.at( typeId );
+	switch( type.opcode ){
+		case spirv::OpTypeInt:
+		case spirv::OpTypeFloat: return type.operands[0] / 8;
+		case spirv::OpTypeVector: return type.operands[1] * getSpirvTypeSize( ids, type.operands[0] );
+		case spirv::OpTypeMatrix: return type.operands[1] * getSpirvTypeSize( ids, type.operands[0] ); // struct members use their MatrixStride instead
+		case spirv::OpTypeArray: return ids.at( type.operands[1] ).operands.at( 0 ) * type.arrayStride;
+		case spirv::OpTypeStruct:{
+			uint32_t size = 0;
+			for( uint32_t member = 0; member < type.operands.size(); ++member ){
+				const SpirvId& memberType = ids.at( type.operands[member] );
+				const auto matrixStride = type.memberMatrixStrides.find( member );
+				const uint32_t memberSize = memberType.opcode == spirv::OpTypeMatrix && matrixStride != type.memberMatrixStrides.end()
+					? memberType.operands[1] * matrixStride->second
+					: getSpirvTypeSize( ids, type.operands[member] );
+				const auto offset = type.memberOffsets.find( member );
+				size = std::max( size, (offset == type.memberOffsets.end() ? 0 : offset->second) + memberSize );
+			}
+			return size;
+		}
+		default: throw "SPIR-V reflection: unsupported type in a push constant block!";
+	}
+}
+
+VkShaderStageFlagBits getSpirvStage( const uint32_t executionModel ){
+	switch( executionModel ){
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: throw "SPIR-V reflection: unsupported execution model!";
+	}
+}
+
+VkDescriptorType getSpirvDescriptorType( const SpirvId& variable, const SpirvId& type ){
+	switch( type.opcode ){
+		case spirv::OpTypeSampler: return VK_DESCRIPTOR_TYPE_SAMPLER;
+		case spirv::OpTypeSampledImage: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		case spirv::OpTypeImage:{
+			const uint32_t dim = type.operands[1];
+			const uint32_t sampled = type.operands[5]; // 1: sampled, 2: storage
+			if( dim == spirv::DimSubpassData ) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			if( dim == spirv::DimBuffer ) return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+		case spirv::OpTypeStruct:
+			// before SPIR-V 1.3 storage buffers are Uniform blocks decorated BufferBlock
+			if( variable.storageClass == spirv::StorageBuffer || type.bufferBlock ) return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			if( type.block ) return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			break;
+	}
+	throw "SPIR-V reflection: unsupported descriptor type!";
+}
+
+VkFormat getSpirvVertexFormat( const std::vector<SpirvId>& ids, const SpirvId& type, uint32_t& size ){
+	const bool vector = type.opcode == spirv::OpTypeVector;
+	const SpirvId& component = vector ? ids.at( type.operands[0] ) : type;
+	const uint32_t count = vector ? type.operands[1] : 1;
+	if( (component.opcode != spirv::OpTypeFloat && component.opcode != spirv::OpTypeInt) || component.operands[0] != 32 ){
+		throw "SPIR-V reflection: vertex inputs have to be 32 bit scalars or vectors!";
+	}
+	size = 4 * count;
+
+	const VkFormat floats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+	const VkFormat ints[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+	const VkFormat uints[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+	if( component.opcode == spirv::OpTypeFloat ) return floats[count - 1];
+	return component.operands[1] ? ints[count - 1] : uints[count - 1]; // signedness
+}
+
+// words of one module with one entry point, as glslc writes them
+ShaderReflection reflectSpirv( const uint32_t* words, const size_t wordCount ){
+	if( wordCount < 5 || words[0] != spirv::magic ) throw "SPIR-V reflection: not a SPIR-V module!";
+
+	const uint32_t bound = words[3];
+	std::vector<SpirvId> ids( bound );
+	std::vector<uint32_t> variables;
+	const auto id = [&]( const uint32_t i ) -> SpirvId& {
+		if( i >= bound ) throw "SPIR-V reflection: id out of bounds!";
+		return ids[i];
+	};
+
+	ShaderReflection reflection{};
+	for( size_t offset = 5; offset < wordCount; ){
+		const uint32_t opcode = words[offset] & 0xFFFF;
+		const uint32_t length = words[offset] >> 16;
+		if( length == 0 || offset + length > wordCount ) throw "SPIR-V reflection: truncated module!";
+		const uint32_t* operands = words + offset + 1;
+		const uint32_t operandCount = length - 1;
+
+		switch( opcode ){
+			case spirv::OpEntryPoint:
+				if( reflection.stages ) throw "SPIR-V reflection: more than one entry point!";
+				reflection.stages = getSpirvStage( operands[0] );
+				break;
+
+			case spirv::OpDecorate:{
+				SpirvId& target = id( operands[0] );
+				switch( operands[1] ){
+					case spirv::Block: target.block = true; break;
+					case spirv::BufferBlock: target.bufferBlock = true; break;
+					case spirv::ArrayStride: target.arrayStride = operands[2]; break;
+					case spirv::BuiltIn: target.builtIn = true; break;
+					case spirv::Location: target.hasLocation = true; target.location = operands[2]; break;
+					case spirv::Binding: target.hasBinding = true; target.binding = operands[2]; break;
+					case spirv::DescriptorSet: target.hasSet = true; target.set = operands[2]; break;
+				}
+				break;
+			}
+
+			case spirv::OpMemberDecorate:{
+				SpirvId& target = id( operands[0] );
+				if( operands[2] == spirv::Offset ) target.memberOffsets[operands[1]] = operands[3];
+				else if( operands[2] == spirv::MatrixStride ) target.memberMatrixStrides[operands[1]] = operands[3];
+				else if( operands[2] == spirv::BuiltIn ) target.builtIn = true; // gl_PerVertex
+				break;
+			}
+
+			case spirv::OpTypeInt: case spirv::OpTypeFloat: case spirv::OpTypeVector: case spirv::OpTypeMatrix:
+			case spirv::OpTypeImage: case spirv::OpTypeSampler: case spirv::OpTypeSampledImage: case spirv::OpTypeArray:
+			case spirv::OpTypeRuntimeArray: case spirv::OpTypeStruct: case spirv::OpTypePointer:{
+				SpirvId& type = id( operands[0] );
+				type.opcode = opcode;
+				type.operands.assign( operands + 1, operands + operandCount );
+				break;
+			}
+
+			case spirv::OpConstant:{
+				SpirvId& constant = id( operands[1] );
+				constant.opcode = opcode;
+				constant.typeId = operands[0];
+				constant.operands.assign( operands + 2, operands + operandCount ); // the low word is enough for array lengths
+				break;
+			}
+
+			case spirv::OpVariable:{
+				SpirvId& variable = id( operands[1] );
+				variable.opcode = opcode;
+				variable.typeId = operands[0];
+				variable.storageClass = operands[2];
+				variables.push_back( operands[1] );
+				break;
+			}
+		}
+
+		offset += length;
+	}
+	if( !reflection.stages ) throw "SPIR-V reflection: no entry point!";
+
+	for( const uint32_t variableId : variables ){
+		const SpirvId& variable = ids[variableId];
+		const SpirvId& pointer = id( variable.typeId );
+		if( pointer.opcode != spirv::OpTypePointer ) throw "SPIR-V reflection: variable of a non-pointer type!";
+		const uint32_t typeId = pointer.operands[1];
+
+		switch( variable.storageClass ){
+			case spirv::UniformConstant:
+			case spirv::Uniform:
+			case spirv::StorageBuffer:{
+				if( !variable.hasBinding ) continue; // nothing to bind
+				const SpirvId* type = &id( typeId );
+				uint32_t count = 1;
+				if( type->opcode == spirv::OpTypeArray ){
+					count = id( type->operands[1] ).operands.at( 0 );
+					type = &id( type->operands[0] );
+				}
+				else if( type->opcode == spirv::OpTypeRuntimeArray ){
+					count = 0;
+					type = &id( type->operands[0] );
+				}
+
+				reflection.bindings.push_back( { variable.set, variable.binding, getSpirvDescriptorType( variable, *type ), count, reflection.stages } );
+				break;
+			}
+
+			case spirv::PushConstant:{
+				const SpirvId& block = id( typeId );
+				uint32_t first = UINT32_MAX;
+				for( const auto& memberOffset : block.memberOffsets ) first = std::min( first, memberOffset.second );
+				if( first == UINT32_MAX ) first = 0;
+				reflection.pushConstantRanges.push_back( { reflection.stages, first, getSpirvTypeSize( ids, typeId ) - first } );
+				break;
+			}
+
+			case spirv::Input:{
+				if( reflection.stages != VK_SHADER_STAGE_VERTEX_BIT || variable.builtIn || id( typeId ).builtIn ) continue;
+				if( !variable.hasLocation ) throw "SPIR-V reflection: vertex input without a location!";
+
+				ReflectedVertexInput input{ variable.location, VK_FORMAT_UNDEFINED, 0 };
+				input.format = getSpirvVertexFormat( ids, id( typeId ), input.size );
+				reflection.vertexInputs.push_back( input );
+				break;
+			}
+		}
+	}
+
+	std::sort( reflection.bindings.begin(), reflection.bindings.end(), []( const ReflectedBinding& a, const ReflectedBinding& b ){
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	} );
+	std::sort( reflection.vertexInputs.begin(), reflection.vertexInputs.end(), []( const ReflectedVertexInput& a, const ReflectedVertexInput& b ){
+		return a.location < b.location;
+	} );
+	return reflection;
+}
+
+ShaderReflection reflectSpirv( const std::vector<char>& code ){
+	std::vector<uint32_t> words( code.size() / 4 );
+	std::memcpy( words.data(), code.data(), words.size() * 4 );
+	return reflectSpirv( words.data(), words.size() );
+}
+
+// the stages of a pipeline together: bindings used by several stages get all of them; throws if the stages disagree on a type
+ShaderReflection mergeShaderReflections( const std::vector<ShaderReflection>& stages ){
+	ShaderReflection merged{};
+	for( const ShaderReflection& stage : stages ){
+		merged.stages |= stage.stages;
+		merged.pushConstantRanges.insert( merged.pushConstantRanges.end(), stage.pushConstantRanges.begin(), stage.pushConstantRanges.end() );
+		if( stage.stages == VK_SHADER_STAGE_VERTEX_BIT ) merged.vertexInputs = stage.vertexInputs;
+
+		for( const ReflectedBinding& binding : stage.bindings ){
+			const auto known = std::find_if( merged.bindings.begin(), merged.bindings.end(), [&]( const ReflectedBinding& b ){
+				return b.set == binding.set && b.binding == binding.binding;
+			} );
+			if( known == merged.bindings.end() ) merged.bindings.push_back( binding );
+			else if( known->type != binding.type || known->count != binding.count ) throw "SPIR-V reflection: stages declare one binding differently!";
+			else known->stages |= binding.stages;
+		}
+	}
+
+	std::sort( merged.bindings.begin(), merged.bindings.end(), []( const ReflectedBinding& a, const ReflectedBinding& b ){
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	} );
+	return merged;
+}
+
+// highest set number + 1; sets in between without bindings get empty layouts
+uint32_t getReflectedSetCount( const ShaderReflection& reflection ){
+	return reflection.bindings.empty() ? 0 : reflection.bindings.back().set + 1;
+}
+
+// runtime arrays get runtimeArrayCount descriptors
+std::vector<VkDescriptorSetLayoutBinding> getDescriptorSetLayoutBindings( const ShaderReflection& reflection, const uint32_t set, const uint32_t runtimeArrayCount = 1 ){
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	for( const ReflectedBinding& binding : reflection.bindings ){
+		if( binding.set != set ) continue;
+		bindings.push_back( { binding.binding, binding.type, binding.count ? binding.count : runtimeArrayCount, binding.stages, nullptr } );
+	}
+
+	return bindings;
+}
+
+// enough for setCount sets of each layout
+std::vector<VkDescriptorPoolSize> getDescriptorPoolSizes( const ShaderReflection& reflection, const uint32_t setCount, const uint32_t runtimeArrayCount = 1 ){
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for( const ReflectedBinding& binding : reflection.bindings ){
+		const uint32_t count = (binding.count ? binding.count : runtimeArrayCount) * setCount;
+		const auto known = std::find_if( poolSizes.begin(), poolSizes.end(), [&]( const VkDescriptorPoolSize& size ){ return size.type == binding.type; } );
+		if( known == poolSizes.end() ) poolSizes.push_back( { binding.type, count } );
+		else known->descriptorCount += count;
+	}
+
+	return poolSizes;
+}
+
+// the vertex inputs interleaved in one binding in location order, tightly packed -- as Vertex3D_UV lays them out; returns the stride
+uint32_t getVertexInputAttributes( const ShaderReflection& reflection, const uint32_t binding, std::vector<VkVertexInputAttributeDescription>& attributes ){
+	uint32_t offset = 0;
+	attributes.clear();
+	for( const ReflectedVertexInput& input : reflection.vertexInputs ){
+		attributes.push_back( { input.location, binding, input.format, offset } );
+		offset += input.size;
+	}
+
+	return offset;
+}
@@ -0,0 +1,315 @@
+#pragma once
+
+// Offline texture cooking: mip chain filtered in linear space (Kaiser windowed sinc or box), then BC1 (opaque) or BC3 (alpha)
+// block compression -- the output of textureCooker.cpp, uploaded by createKtx2TextureImage() without any conversion.
+// Encoder: per block principal axis endpoints, refined once by least squares; good quality, no exhaustive search.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Ktx2.h"
+
+enum class MipFilter{ Box, Kaiser };
+
+struct LinearImage{
+	uint32_t width;
+	uint32_t height;
+	std::vector<glm::vec4> texels; // linear RGB, straight alpha
+};
+
+// runs body( i ) for i in [0, count) on threadCount threads (the calling one included)
+template< class F >
+void parallelFor( const uint32_t count, const unsigned threadCount, F body ){
+	std::atomic<uint32_t> next( 0 );
+	const auto work = [&]{
+		for( uint32_t i = next++; i < count; i = next++ ) body( i );
+	};
+
+	std::vector<std::thread> threads;
+	for( unsigned t = 1; t < std::min( threadCount, count ); ++t ) threads.emplace_back( work );
+	work();
+	for( auto& t : threads ) t.join();
+}
+
+float srgbToLinear( const float c ){
+	return c <= 0.04045f ? c / 12.92f : std::pow( (c + 0.055f) / 1.055f, 2.4f );
+}
+
+float linearToSrgb( const float c ){
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow( c, 1.0f / 2.4f ) - 0.055f;
+}
+
+LinearImage toLinearImage( const uint8_t* rgba, const uint32_t width, const uint32_t height ){
+	float srgbTable[256];
+	for( uint32_t i = 0; i < 256; ++i ) srgbTable[i] = srgbToLinear( i / 255.0f );
+
+	LinearImage image{ width, height, std::vector<glm::vec4>( size_t( width ) * height ) };
+	for( size_t i = 0; i < image.texels.size(); ++i ){
+		const uint8_t* p = rgba + 4 * i;
+		image.texels[i] = glm::vec4( srgbTable[p[0]], srgbTable[p[1]], srgbTable[p[2]], p[3] / 255.0f );
+	}
+
+	return image;
+}
+
+void toSrgbPixels( const LinearImage& image, uint8_t* rgba ){
+	const auto quantize = []( const float c ){ return uint8_t(  std::lround( glm::clamp( c, 0.0f, 1.0f ) * 255.0f )  ); };
+
+	for( size_t i = 0; i < image.texels.size(); ++i ){
+		const glm::vec4 t = image.texels[i];
+		uint8_t* p = rgba + 4 * i;
+		p[0] = quantize( linearToSrgb( t.r ) );
+		p[1] = quantize( linearToSrgb( t.g ) );
+		p[2] = quantize( linearToSrgb( t.b ) );
+		p[3] = quantize( t.a );
+	}
+}
+
+// zeroth order modified Bessel function of the first kind, for the Kaiser window
+float besselI0( const float x ){
+	float sum = 1.0f, term = 1.0f;
+	for( uint32_t k = 1; k < 32 && term > 1e-8f * sum; ++k ){
+		term *= (x / (2.0f * k)) * (x / (2.0f * k));
+		sum += term;
+	}
+	return sum;
+}
+
+// x in destination texels from the destination texel center
+float evaluateMipFilter( const MipFilter filter, const float x ){
+	if( filter == MipFilter::Box ) return std::abs( x ) <= 0.5f ? 1.0f : 0.0f;
+
+	const float width = 3.0f, alpha = 4.0f;
+	if( std::abs( x ) >= width ) return 0.0f;
+
+	const float pi = 3.14159265f;
+	const float sinc = x == 0.0f ? 1.0f : std::sin( pi * x ) / (pi * x);
+	const float t = x / width;
+	return sinc * besselI0(  alpha * std::sqrt( 1.0f - t * t )  ) / besselI0( alpha );
+}
+
+struct FilterTap{
+	uint32_t source;
+	float weight;
+};
+
+// normalized taps for every destination texel along one axis; edges clamp
+std::vector<std::vector<FilterTap>> buildFilterTaps( const MipFilter filter, const uint32_t sourceSize, const uint32_t destinationSize ){
+	const float scale = float( sourceSize ) / destinationSize;
+	const float radius = filter == MipFilter::Box ? 0.5f : 3.0f; // destination texels
+
+	std::vector<std::vector<FilterTap>> taps( destinationSize );
+	for( uint32_t d = 0; d < destinationSize; ++d ){
+		const float center = (d + 0.5f) * scale; // in source texels
+		const int32_t first = int32_t(  std::floor( center - radius * scale )  );
+		const int32_t last = int32_t(  std::ceil( center + radius * scale )  );
+
+		float sum = 0.0f;
+		for( int32_t s = first; s <= last; ++s ){
+			const float weight = evaluateMipFilter(  filter, (s + 0.5f - center) / scale  );
+			if( weight == 0.0f ) continue;
+
+			taps[d].push_back(  { uint32_t(  glm::clamp( s, 0, int32_t( sourceSize ) - 1 )  ), weight }  );
+			sum += weight;
+		}
+
+		for( auto& tap : taps[d] ) tap.weight /= sum;
+	}
+
+	return taps;
+}
+
+// next mip level, max( size / 2, 1 ) like the KTX2 level sizes; separable, rows in parallel
+LinearImage downsample( const LinearImage& source, const MipFilter filter, const unsigned threadCount ){
+	const uint32_t width = std::max( source.width / 2, 1u );
+	const uint32_t height = std::max( source.height / 2, 1u );
+	const auto horizontalTaps = buildFilterTaps( filter, source.width, width );
+	const auto verticalTaps = buildFilterTaps( filter, source.height, height );
+
+	std::vector<glm::vec4> horizontal( size_t( width ) * source.height );
+	parallelFor( source.height, threadCount, [&]( const uint32_t y ){
+		for( uint32_t x = 0; x < width; ++x ){
+			glm::vec4 sum( 0.0f );
+			for( const FilterTap& tap : horizontalTaps[x] ) sum += tap.weight * source.texels[size_t( y ) * source.width + tap.source];
+			horizontal[size_t( y ) * width + x] = sum;
+		}
+	} );
+
+	LinearImage result{ width, height, std::vector<glm::vec4>( size_t( width ) * height ) };
+	parallelFor( height, threadCount, [&]( const uint32_t y ){
+		for( uint32_t x = 0; x < width; ++x ){
+			glm::vec4 sum( 0.0f );
+			for( const FilterTap& tap : verticalTaps[y] ) sum += tap.weight * horizontal[size_t( tap.source ) * width + x];
+			result.texels[size_t( y ) * width + x] = glm::clamp( sum, 0.0f, 1.0f ); // Kaiser lobes can ring past [0, 1]
+		}
+	} );
+
+	return result;
+}
+
+uint32_t packRgb565( const glm::vec3 c ){
+	const glm::vec3 q = glm::round(  glm::clamp( c, 0.0f, 255.0f ) * glm::vec3( 31.0f, 63.0f, 31.0f ) / 255.0f  );
+	return (uint32_t( q.r ) << 11) | (uint32_t( q.g ) << 5) | uint32_t( q.b );
+}
+
+glm::vec3 unpackRgb565( const uint32_t c ){
+	const uint32_t r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+	return glm::vec3( (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) );
+}
+
+// four color mode only (color0 > color1), as the texels are opaque or BC3 carries the alpha
+void encodeColorBlock( const uint8_t texels[16][4], uint8_t* block ){
+	glm::vec3 colors[16];
+	glm::vec3 mean( 0.0f );
+	for( uint32_t i = 0; i < 16; ++i ){
+		colors[i] = glm::vec3( texels[i][0], texels[i][1], texels[i][2] );
+		mean += colors[i] / 16.0f;
+	}
+
+	// principal axis of the colors: power iteration on the covariance
+	glm::mat3 covariance( 0.0f );
+	for( const glm::vec3& c : colors ) covariance += glm::outerProduct( c - mean, c - mean );
+	glm::vec3 axis( 1.0f, 1.0f, 1.0f );
+	for( uint32_t i = 0; i < 8; ++i ){
+		const glm::vec3 next = covariance * axis;
+		const float length = glm::length( next );
+		if( length < 1e-6f ) break;
+		axis = next / length;
+	}
+
+	float minProjection = 0.0f, maxProjection = 0.0f;
+	for( const glm::vec3& c : colors ){
+		minProjection = std::min(  minProjection, glm::dot( c - mean, axis )  );
+		maxProjection = std::max(  maxProjection, glm::dot( c - mean, axis )  );
+	}
+	const float inset = (maxProjection - minProjection) / 16.0f; // pull the endpoints in a bit, the extremes are rarely hit exactly
+	glm::vec3 endpoints[2] = { mean + (maxProjection - inset) * axis, mean + (minProjection + inset) * axis };
+
+	uint32_t indices[16];
+	uint32_t color0 = 0, color1 = 0;
+	for( uint32_t pass = 0; pass < 2; ++pass ){
+		color0 = packRgb565( endpoints[0] );
+		color1 = packRgb565( endpoints[1] );
+		if( color0 < color1 ) std::swap( color0, color1 );
+
+		const glm::vec3 c0 = unpackRgb565( color0 ), c1 = unpackRgb565( color1 );
+		const glm::vec3 palette[4] = { c0, c1, glm::floor( (2.0f * c0 + c1) / 3.0f ), glm::floor( (c0 + 2.0f * c1) / 3.0f ) };
+		for( uint32_t i = 0; i < 16; ++i ){
+			float bestDistance = INFINITY;
+			for( uint32_t p = 0; p < 4; ++p ){
+				const glm::vec3 d = colors[i] - palette[p];
+				if( glm::dot( d, d ) < bestDistance ){ bestDistance = glm::dot( d, d ); indices[i] = p; }
+			}
+		}
+		if( pass == 1 || color0 == color1 ) break;
+
+		// least squares endpoints for the chosen indices: color = (1 - w) * e0 + w * e1
+		const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		glm::vec3 ax( 0.0f ), bx( 0.0f );
+		for( uint32_t i = 0; i < 16; ++i ){
+			const float w = weights[indices[i]];
+			aa += (1.0f - w) * (1.0f - w); ab += (1.0f - w) * w; bb += w * w;
+			ax += (1.0f - w) * colors[i]; bx += w * colors[i];
+		}
+		const float determinant = aa * bb - ab * ab;
+		if( std::abs( determinant ) < 1e-6f ) break;
+		endpoints[0] = (ax * bb - bx * ab) / determinant;
+		endpoints[1] = (bx * aa - ax * ab) / determinant;
+	}
+
+	if( color0 == color1 ) std::fill( indices, indices + 16, 0u );
+
+	block[0] = uint8_t( color0 ); block[1] = uint8_t( color0 >> 8 );
+	block[2] = uint8_t( color1 ); block[3] = uint8_t( color1 >> 8 );
+	uint32_t packed = 0;
+	for( uint32_t i = 0; i < 16; ++i ) packed |= indices[i] << (2 * i);
+	for( uint32_t i = 0; i < 4; ++i ) block[4 + i] = uint8_t( packed >> (8 * i) );
+}
+
+// BC4 layout, eight value mode (value0 > value1) over the block's range
+void encodeChannelBlock( const uint8_t texels[16][4], const uint32_t channel, uint8_t* block ){
+	uint32_t minValue = 255, maxValue = 0;
+	for( uint32_t i = 0; i < 16; ++i ){
+		minValue = std::min<uint32_t>( minValue, texels[i][channel] );
+		maxValue = std::max<uint32_t>( maxValue, texels[i][channel] );
+	}
+
+	block[0] = uint8_t( maxValue );
+	block[1] = uint8_t( minValue );
+	uint64_t packed = 0;
+	if( maxValue > minValue ){
+		uint32_t palette[8] = { maxValue, minValue };
+		for( uint32_t i = 1; i < 7; ++i ) palette[i + 1] = ((7 - i) * maxValue + i * minValue) / 7;
+
+		for( uint32_t i = 0; i < 16; ++i ){
+			uint32_t bestIndex = 0, bestDistance = UINT32_MAX;
+			for( uint32_t p = 0; p < 8; ++p ){
+				const uint32_t distance = uint32_t(  std::abs( int32_t( texels[i][channel] ) - int32_t( palette[p] ) )  );
+				if( distance < bestDistance ){ bestDistance = distance; bestIndex = p; }
+			}
+			packed |= uint64_t( bestIndex ) << (3 * i);
+		}
+	}
+	for( uint32_t i = 0; i < 6; ++i ) block[2 + i] = uint8_t( packed >> (8 * i) );
+}
+
+// BC1 (8 byte blocks) or BC3 (16 byte blocks, alpha first) for one RGBA8 level; block rows in parallel
+std::vector<uint8_t> encodeLevel( const uint8_t* rgba, const uint32_t width, const uint32_t height, const bool withAlpha, const unsigned threadCount ){
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+	const uint32_t bytesPerBlock = withAlpha ? 16 : 8;
+
+	std::vector<uint8_t> blocks( size_t( blocksWide ) * blocksHigh * bytesPerBlock );
+	parallelFor( blocksHigh, threadCount, [&]( const uint32_t by ){
+		uint8_t texels[16][4];
+		for( uint32_t bx = 0; bx < blocksWide; ++bx ){
+			// edge blocks repeat the last row / column -- the decoder clips them anyway
+			for( uint32_t i = 0; i < 16; ++i ){
+				const uint32_t x = std::min( 4 * bx + i % 4, width - 1 );
+				const uint32_t y = std::min( 4 * by + i / 4, height - 1 );
+				std::memcpy( texels[i], rgba + (size_t( y ) * width + x) * 4, 4 );
+			}
+
+			uint8_t* block = blocks.data() + (size_t( by ) * blocksWide + bx) * bytesPerBlock;
+			if( withAlpha ){
+				encodeChannelBlock( texels, 3, block );
+				encodeColorBlock( texels, block + 8 );
+			}
+			else encodeColorBlock( texels, block );
+		}
+	} );
+
+	return blocks;
+}
+
+// the whole cook of one RGBA8 sRGB image: level 0 straight from the pixels, the rest filtered from the linear previous level;
+// BC3 if any texel is not opaque, BC1 otherwise
+std::vector<uint8_t> cookKtx2( const uint8_t* rgba, const uint32_t width, const uint32_t height, const MipFilter filter, const unsigned threadCount, const std::vector<std::pair<std::string, std::string>>& keyValues = {} ){
+	bool withAlpha = false;
+	for( size_t i = 3; i < size_t( width ) * height * 4 && !withAlpha; i += 4 ) withAlpha = rgba[i] != 0xFF;
+	const VkFormat format = withAlpha ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK; // sRGB, like the R8G8B8A8_SRGB textures
+
+	std::vector<std::vector<uint8_t>> levels;
+	levels.push_back(  encodeLevel( rgba, width, height, withAlpha, threadCount )  );
+
+	LinearImage level = toLinearImage( rgba, width, height );
+	std::vector<uint8_t> levelPixels;
+	while( level.width > 1 || level.height > 1 ){
+		level = downsample( level, filter, threadCount );
+		levelPixels.resize( size_t( level.width ) * level.height * 4 );
+		toSrgbPixels( level, levelPixels.data() );
+		levels.push_back(  encodeLevel( levelPixels.data(), level.width, level.height, withAlpha, threadCount )  );
+	}
+
+	return writeKtx2( format, width, height, levels, keyValues );
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+// Packs many small textures into a few equally sized pages -- the layers of one 2D array texture -- so objects using them
+// share one descriptor set and one draw on devices without VK_EXT_descriptor_indexing (see bindlessTextures for those with it).
+// MaxRects with the best short side fit heuristic (Jylanki, "A Thousand Ways to Pack the Bin"), no rotation.
+// Mip-safe: every texture gets an edge-replicated gutter and its padded rect is aligned to the footprint of a texel of the
+// last mip level, so box-filtered levels never mix two textures and bilinear taps at the edges stay inside the gutter.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "TextureCooker.h"
+
+struct AtlasRect{
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct AtlasEntry{
+	uint32_t layer;
+	AtlasRect rect; // the texture itself in level 0 texels, gutter not included
+};
+
+struct TextureAtlas{
+	uint32_t pageWidth;
+	uint32_t pageHeight;
+	uint32_t mipLevels; // the layers are mip-safe down to this many levels
+	uint32_t layerCount;
+	std::vector<AtlasEntry> entries; // in the order of the packed sizes
+	uint64_t textureTexels; // level 0 texels of the textures, for the efficiency
+};
+
+// one page under construction; freeRects are maximal and may overlap
+struct MaxRectsPage{
+	std::vector<AtlasRect> freeRects;
+};
+
+// level 0 texels covered by one texel of the last mip level; padded rects start and end on multiples of it
+uint32_t getAtlasAlignment( const uint32_t mipLevels ){
+	return 1u << (mipLevels - 1);
+}
+
+uint32_t alignUp( const uint32_t value, const uint32_t alignment ){
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool contains( const AtlasRect& outer, const AtlasRect& inner ){
+	return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+}
+
+bool overlaps( const AtlasRect& a, const AtlasRect& b ){
+	return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// best short side fit: the free rect leaving the smallest leftover on its shorter side, ties by the longer one; false if none fits
+bool findMaxRectsPosition( const MaxRectsPage& page, const uint32_t width, const uint32_t height, AtlasRect& position, uint64_t& score ){
+	bool found = false;
+	for( const AtlasRect& free : page.freeRects ){
+		if( free.width < width || free.height < height ) continue;
+
+		const uint32_t leftoverX = free.width - width;
+		const uint32_t leftoverY = free.height - height;
+		const uint64_t candidateScore = (uint64_t( std::min( leftoverX, leftoverY ) ) << 32) | std::max( leftoverX, leftoverY );
+		if( !found || candidateScore < score ){
+			found = true;
+			score = candidateScore;
+			position = { free.x, free.y, width, height };
+		}
+	}
+
+	return found;
+}
+
+// splits every free rect the placed one overlaps into the up to four maximal rects around it, then drops the contained ones
+// (a new rect lies inside an old one, so it can't contain any untouched rect -- only the new ones can be redundant)
+void placeMaxRect( MaxRectsPage& page, const AtlasRect& placed ){
+	std::vector<AtlasRect> kept;
+	std::vector<AtlasRect> created;
+	kept.reserve( page.freeRects.size() );
+
+	for( const AtlasRect& free : page.freeRects ){
+		if( !overlaps( free, placed ) ){
+			kept.push_back( free );
+			continue;
+		}
+
+		if( placed.x > free.x ) created.push_back( { free.x, free.y, placed.x - free.x, free.height } );
+		if( placed.x + placed.width < free.x + free.width ) created.push_back( { placed.x + placed.width, free.y, free.x + free.width - (placed.x + placed.width), free.height } );
+		if( placed.y > free.y ) created.push_back( { free.x, free.y, free.width, placed.y - free.y } );
+		if( placed.y + placed.height < free.y + free.height ) created.push_back( { free.x, placed.y + placed.height, free.width, free.y + free.height - (placed.y + placed.height) } );
+	}
+
+	page.freeRects = kept;
+	for( size_t i = 0; i < created.size(); ++i ){
+		bool redundant = std::any_of( kept.begin(), kept.end(), [&]( const AtlasRect& k ){ return contains( k, created[i] ); } );
+		for( size_t j = 0; j < created.size() && !redundant; ++j ){
+			if( i == j || !contains( created[j], created[i] ) ) continue;
+			redundant = !contains( created[i], created[j] ) || j < i; // of two equal rects keep the first
+		}
+		if( !redundant ) page.freeRects.push_back( created[i] );
+	}
+}
+
+// sizes are texture extents (x = width, y = height) in texels; pageWidth and pageHeight must be multiples of getAtlasAlignment( mipLevels )
+// throws if a padded texture is larger than a page
+TextureAtlas packTextures( const std::vector<glm::uvec2>& sizes, const uint32_t pageWidth, const uint32_t pageHeight, const uint32_t mipLevels ){
+	const uint32_t alignment = getAtlasAlignment( mipLevels );
+	const uint32_t gutter = alignment; // 1 texel at the last level, so bilinear filtering never reaches a neighbour
+
+	TextureAtlas atlas{ pageWidth, pageHeight, mipLevels, 0, std::vector<AtlasEntry>( sizes.size() ), 0 };
+	std::vector<MaxRectsPage> pages;
+
+	// largest side first packs tighter than input order
+	std::vector<uint32_t> order( sizes.size() );
+	std::iota( order.begin(), order.end(), 0u );
+	std::stable_sort( order.begin(), order.end(), [&]( const uint32_t a, const uint32_t b ){
+		return std::max( sizes[a].x, sizes[a].y ) > std::max( sizes[b].x, sizes[b].y );
+	} );
+
+	for( const uint32_t i : order ){
+		const uint32_t paddedWidth = alignUp( sizes[i].x + 2 * gutter, alignment );
+		const uint32_t paddedHeight = alignUp( sizes[i].y + 2 * gutter, alignment );
+		if( paddedWidth > pageWidth || paddedHeight > pageHeight ) throw "texture (with its gutter) is larger than an atlas page!";
+
+		uint32_t bestLayer = static_cast<uint32_t>( pages.size() );
+		AtlasRect bestPosition{};
+		uint64_t bestScore = UINT64_MAX;
+		for( uint32_t layer = 0; layer < pages.size(); ++layer ){
+			AtlasRect position;
+			uint64_t score;
+			if( findMaxRectsPosition( pages[layer], paddedWidth, paddedHeight, position, score ) && score < bestScore ){
+				bestLayer = layer;
+				bestPosition = position;
+				bestScore = score;
+			}
+		}
+
+		if( bestLayer == pages.size() ){
+			pages.push_back( MaxRectsPage{ { { 0, 0, pageWidth, pageHeight } } } );
+			bestPosition = { 0, 0, paddedWidth, paddedHeight };
+		}
+
+		placeMaxRect( pages[bestLayer], bestPosition );
+		atlas.entries[i] = { bestLayer, { bestPosition.x + gutter, bestPosition.y + gutter, sizes[i].x, sizes[i].y } };
+		atlas.textureTexels += uint64_t( sizes[i].x ) * sizes[i].y;
+	}
+
+	atlas.layerCount = static_cast<uint32_t>( pages.size() );
+	return atlas;
+}
+
+// texels of the textures per texel of all layers (level 0); the rest is gutter, alignment and space left free
+double getPackingEfficiency( const TextureAtlas& atlas ){
+	const uint64_t layerTexels = uint64_t( atlas.pageWidth ) * atlas.pageHeight * atlas.layerCount;
+	return layerTexels ? double( atlas.textureTexels ) / layerTexels : 0.0;
+}
+
+// xy = scale, zw = offset taking a texture's [0, 1] uv to layer uv; uv outside [0, 1] (repeat) does not survive atlasing
+glm::vec4 getAtlasUvTransform( const TextureAtlas& atlas, const AtlasEntry& entry ){
+	return glm::vec4(
+		float( entry.rect.width ) / atlas.pageWidth,
+		float( entry.rect.height ) / atlas.pageHeight,
+		float( entry.rect.x ) / atlas.pageWidth,
+		float( entry.rect.y ) / atlas.pageHeight
+	);
+}
+
+// for meshes not shared between textures: bake the transform into the vertices
+void remapUvs( std::vector<Vertex3D_UV>& vertices, const glm::vec4 uvTransform ){
+	for( Vertex3D_UV& vertex : vertices ){
+		vertex.uv.uv[0] = vertex.uv.uv[0] * uvTransform.x + uvTransform.z;
+		vertex.uv.uv[1] = vertex.uv.uv[1] * uvTransform.y + uvTransform.w;
+	}
+}
+
+// all mip levels of one layer, RGBA8 sRGB, [0] = level 0; images[i] holds entries[i]'s tightly packed RGBA8 texels
+// gutters (up to the aligned end of the padded rect) repeat the edge texels; space no texture covers stays transparent black
+std::vector<std::vector<uint8_t>> buildAtlasLayer( const TextureAtlas& atlas, const uint32_t layer, const std::vector<const uint8_t*>& images ){
+	const uint32_t alignment = getAtlasAlignment( atlas.mipLevels );
+	const uint32_t gutter = alignment;
+
+	std::vector<std::vector<uint8_t>> levels( 1, std::vector<uint8_t>( size_t( atlas.pageWidth ) * atlas.pageHeight * 4, 0 ) );
+	uint8_t* page = levels[0].data();
+
+	for( size_t i = 0; i < atlas.entries.size(); ++i ){
+		const AtlasEntry& entry = atlas.entries[i];
+		if( entry.layer != layer ) continue;
+
+		const AtlasRect& r = entry.rect;
+		const uint32_t paddedRight = alignUp( r.x + r.width + gutter, alignment );
+		const uint32_t paddedBottom = alignUp( r.y + r.height + gutter, alignment );
+		for( uint32_t y = r.y - gutter; y < paddedBottom; ++y ){
+			const uint32_t sourceY = std::min( std::max( y, r.y ), r.y + r.height - 1 ) - r.y;
+			const uint8_t* sourceRow = images[i] + size_t( sourceY ) * r.width * 4;
+			uint8_t* row = page + size_t( y ) * atlas.pageWidth * 4;
+
+			for( uint32_t x = r.x - gutter; x < r.x; ++x ) std::memcpy( row + 4 * x, sourceRow, 4 );
+			std::memcpy( row + 4 * r.x, sourceRow, size_t( r.width ) * 4 );
+			for( uint32_t x = r.x + r.width; x < paddedRight; ++x ) std::memcpy( row + 4 * x, sourceRow + 4 * (r.width - 1), 4 );
+		}
+	}
+
+	// box: the 2x2 footprints line up with the aligned padded rects, a wider filter would reach into the neighbours
+	LinearImage level = toLinearImage( page, atlas.pageWidth, atlas.pageHeight );
+	for( uint32_t i = 1; i < atlas.mipLevels; ++i ){
+		level = downsample( level, MipFilter::Box, std::thread::hardware_concurrency() );
+		levels.emplace_back( size_t( level.width ) * level.height * 4 );
+		toSrgbPixels( level, levels.back().data() );
+	}
+
+	return levels;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+// CPU side of texture streaming: reading, decoding and mip filtering run on worker threads, so the render thread
+// only copies finished levels into staging memory. The GPU side (uploads, placeholder, view swaps) is TextureStreamer in main.cpp.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "ImageDecoder.h"
+#include "Ktx2.h"
+#include "TextureCooker.h"
+
+// levels ready to be copied into the image as they are
+struct DecodedTexture{
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	std::vector<std::vector<uint8_t>> levels; // [0] = full size
+};
+
+// isSampleable: whether the device samples a KTX2 payload format as stored, else BC1-BC5 get decoded to RGBA8 here
+// BMP/TGA get their mip chain box filtered here (mipmapped), since the GPU path of createTextureImage() would stall the queue
+DecodedTexture decodeTextureFile( const std::vector<uint8_t>& file, const bool mipmapped, const std::function<bool(VkFormat)>& isSampleable ){
+	DecodedTexture texture;
+
+	Ktx2Header ktx2Header;
+	if( readKtx2Header( file.data(), file.size(), ktx2Header ) ){
+		const bool native = isSampleable( ktx2Header.format );
+		if( !native && !isCpuDecodable( ktx2Header.format ) ) throw "KTX2: the device cannot sample the texture format and there is no CPU fallback for it!";
+
+		texture = { native ? ktx2Header.format : getCpuDecodedFormat( ktx2Header.format ), ktx2Header.width, ktx2Header.height, {} };
+		for( uint32_t level = 0; level < ktx2Header.levelCount; ++level ){
+			const uint8_t* source = file.data() + ktx2Header.levels[level].byteOffset;
+			const uint32_t levelWidth = std::max( ktx2Header.width >> level, 1u );
+			const uint32_t levelHeight = std::max( ktx2Header.height >> level, 1u );
+
+			if( native ) texture.levels.emplace_back( source, source + ktx2Header.levels[level].byteLength );
+			else{
+				texture.levels.emplace_back( size_t( levelWidth ) * levelHeight * 4 );
+				decodeLevel( ktx2Header.format, source, levelWidth, levelHeight, texture.levels.back().data() );
+			}
+		}
+
+		return texture;
+	}
+
+	ImageHeader header;
+	if( !readImageHeader( file.data(), file.size(), header ) ) throw "unsupported texture file -- KTX2, or uncompressed 24/32 bit BMP or TGA only!";
+
+	texture = { VK_FORMAT_R8G8B8A8_SRGB, header.width, header.height, {} };
+	texture.levels.emplace_back( size_t( header.width ) * header.height * 4 );
+	decodeImage( file.data(), header, texture.levels[0].data() );
+
+	if( mipmapped ){
+		LinearImage level = toLinearImage( texture.levels[0].data(), header.width, header.height );
+		while( level.width > 1 || level.height > 1 ){
+			level = downsample( level, MipFilter::Box, 1 ); // already on a worker
+			texture.levels.emplace_back( size_t( level.width ) * level.height * 4 );
+			toSrgbPixels( level, texture.levels.back().data() );
+		}
+	}
+
+	return texture;
+}
+
+// persistent threads working through a FIFO of jobs; the destructor waits for the ones already started
+class StreamingWorkers{
+public:
+	explicit StreamingWorkers( unsigned threadCount = std::max( 2u, std::thread::hardware_concurrency() ) - 1 ) // leave a core to the render thread
+	{
+		for( unsigned i = 0; i < threadCount; ++i ) threads.emplace_back( &StreamingWorkers::workerLoop, this );
+	}
+
+	~StreamingWorkers(){
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			quit = true;
+			jobs.clear();
+		}
+		jobReady.notify_all();
+
+		for( auto& t : threads ) t.join();
+	}
+
+	StreamingWorkers( const StreamingWorkers& ) = delete;
+	StreamingWorkers& operator=( const StreamingWorkers& ) = delete;
+
+	void enqueue( std::function<void()> job ){
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			jobs.push_back( std::move( job ) );
+		}
+		jobReady.notify_one();
+	}
+
+private:
+	void workerLoop(){
+		while( true ){
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock( mutex );
+				jobReady.wait(  lock, [this]{ return quit || !jobs.empty(); }  );
+				if( quit ) return;
+
+				job = std::move( jobs.front() );
+				jobs.pop_front();
+			}
+
+			job();
+		}
+	}
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable jobReady;
+	std::deque<std::function<void()>> jobs;
+	bool quit = false;
+};
+
+// what a worker hands back to the render thread
+struct DecodeResult{
+	uint32_t texture; // the caller's id
+	std::shared_ptr<DecodedTexture> decoded; // nullptr when decoding failed
+	std::string error;
+};
+
+// decode requests in, finished textures out; never blocks the caller
+class TextureDecoder{
+public:
+	explicit TextureDecoder( std::function<bool(VkFormat)> isSampleable )
+	: isSampleable( std::move( isSampleable ) )
+	{}
+
+	void request( const uint32_t texture, const std::string& path, const bool mipmapped ){
+		workers.enqueue( [=]{
+			DecodeResult result{ texture, nullptr, "" };
+			try{
+				std::ifstream file( path, std::ios::binary );
+				if( !file ) throw "cannot open the texture file!";
+				const std::vector<uint8_t> bytes{ std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() };
+
+				result.decoded = std::make_shared<DecodedTexture>(  decodeTextureFile( bytes, mipmapped, isSampleable )  );
+			}
+			catch( const char* e ){ result.error = e; }
+			catch( const std::exception& e ){ result.error = e.what(); }
+
+			std::lock_guard<std::mutex> lock( mutex );
+			results.push_back( std::move( result ) );
+		} );
+	}
+
+	std::vector<DecodeResult> takeResults(){
+		std::lock_guard<std::mutex> lock( mutex );
+		std::vector<DecodeResult> taken;
+		taken.swap( results );
+		return taken;
+	}
+
+private:
+	const std::function<bool(VkFormat)> isSampleable;
+	std::mutex mutex;
+	std::vector<DecodeResult> results;
+	StreamingWorkers workers; // last: joined before the members the jobs use go away
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+// CPU side of virtual texturing: a square texture far bigger than memory, cut into pages per mip level, of which only the
+// pages the last frame asked for (the feedback pass, see virtualTexture.frag) live in a fixed pool of physical page slots.
+// Here: page ids, the feedback analysis, the LRU page cache and the indirection table the shaders look the slots up in.
+// The GPU side (physical pages or sparse residency, uploads, the feedback target) is VirtualTexture in main.cpp.
+
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// mip << 24 | y << 12 | x, the same packing virtualTexture.frag writes into the feedback target
+constexpr uint32_t invalidPageId = 0xFFFFFFFF; // feedback texels nothing was drawn to, free slots
+
+uint32_t packPageId( const uint32_t mip, const uint32_t x, const uint32_t y ){
+	return mip << 24 | y << 12 | x;
+}
+
+uint32_t getPageMip( const uint32_t page ){ return page >> 24; }
+uint32_t getPageX( const uint32_t page ){ return page & 0xFFF; }
+uint32_t getPageY( const uint32_t page ){ return (page >> 12) & 0xFFF; }
+
+struct VirtualTextureLayout{
+	uint32_t size; // texels per side of level 0
+	uint32_t pageSize; // texels per side of a page, without the border
+	uint32_t pageBorder; // texels repeated from the neighbour pages around a physical page, for bilinear filtering
+	uint32_t pages; // per side of level 0
+	uint32_t mipLevels; // down to the level that is one page
+};
+
+// size and pageSize must be powers of two with size >= pageSize, at most 4096 pages per side
+VirtualTextureLayout makeVirtualTextureLayout( const uint32_t size, const uint32_t pageSize, const uint32_t pageBorder ){
+	const auto isPowerOfTwo = []( const uint32_t v ){ return v && !(v & (v - 1)); };
+	if( !isPowerOfTwo( size ) || !isPowerOfTwo( pageSize ) || size < pageSize ) throw "virtual texture: size and page size must be powers of two, size >= page size!";
+	if( size / pageSize > 4096 ) throw "virtual texture: more than 4096 pages per side do not fit the page id!";
+
+	VirtualTextureLayout layout{ size, pageSize, pageBorder, size / pageSize, 1 };
+	while( (layout.pages >> (layout.mipLevels - 1)) > 1 ) ++layout.mipLevels;
+	return layout;
+}
+
+uint32_t getPagesPerSide( const VirtualTextureLayout& layout, const uint32_t mip ){
+	return std::max( layout.pages >> mip, 1u );
+}
+
+// the one page of the coarsest level; always resident, so every lookup has something to fall back to
+uint32_t getRootPage( const VirtualTextureLayout& layout ){
+	return packPageId( layout.mipLevels - 1, 0, 0 );
+}
+
+struct PageRequest{
+	uint32_t page;
+	uint32_t texels; // feedback texels asking for it (or for a finer page it covers)
+};
+
+// dedups the feedback and adds the parents of every page asked for; coarsest level first, then the most asked for --
+// the order pages should be loaded in, so a page never waits for a finer one and the fallback chain fills in top-down
+std::vector<PageRequest> analyzeFeedback( const uint32_t* feedback, const size_t texelCount, const VirtualTextureLayout& layout ){
+	std::unordered_map<uint32_t, uint32_t> counts;
+	for( size_t i = 0; i < texelCount; ++i ){
+		const uint32_t page = feedback[i];
+		if( page == invalidPageId ) continue;
+
+		const uint32_t mip = getPageMip( page );
+		if( mip >= layout.mipLevels || getPageX( page ) >= getPagesPerSide( layout, mip ) || getPageY( page ) >= getPagesPerSide( layout, mip ) ) continue;
+		++counts[page];
+	}
+
+	// finest level first, so a parent also sums up the children added by the levels below
+	std::vector<std::vector<uint32_t>> levelPages( layout.mipLevels );
+	for( const auto& count : counts ) levelPages[getPageMip( count.first )].push_back( count.first );
+	for( uint32_t mip = 0; mip + 1 < layout.mipLevels; ++mip ){
+		for( const uint32_t page : levelPages[mip] ){
+			const uint32_t texels = counts[page];
+			const auto parent = counts.insert( { packPageId( mip + 1, getPageX( page ) / 2, getPageY( page ) / 2 ), 0 } );
+			parent.first->second += texels;
+			if( parent.second ) levelPages[mip + 1].push_back( parent.first->first );
+		}
+	}
+
+	std::vector<PageRequest> requests;
+	requests.reserve( counts.size() );
+	for( const auto& count : counts ) requests.push_back( { count.first, count.second } );
+	std::sort( requests.begin(), requests.end(), []( const PageRequest& a, const PageRequest& b ){
+		if( getPageMip( a.page ) != getPageMip( b.page ) ) return getPageMip( a.page ) > getPageMip( b.page );
+		if( a.texels != b.texels ) return a.texels > b.texels;
+		return a.page < b.page;
+	} );
+	return requests;
+}
+
+// which page sits in which physical slot; slot 0 holds the root page and is never evicted
+struct PageCache{
+	uint32_t slotsPerRow; // of the physical page texture
+	std::vector<uint32_t> slotPages; // invalidPageId = free
+	std::vector<uint64_t> slotLastUsed; // frame
+	std::list<uint32_t> lru; // evictable slots, most recently used first
+	std::vector<std::list<uint32_t>::iterator> lruPositions; // per slot
+	std::unordered_map<uint32_t, uint32_t> pageSlots;
+};
+
+struct PageLoad{
+	uint32_t page;
+	uint32_t slot;
+	uint32_t evictedPage; // invalidPageId if the slot was free
+};
+
+PageCache initPageCache( const VirtualTextureLayout& layout, const uint32_t slotsPerRow, const uint32_t slotRows ){
+	const uint32_t slotCount = slotsPerRow * slotRows;
+	if( slotCount < 2 ) throw "virtual texture: the page cache needs a slot for the root page and at least one more!";
+
+	PageCache cache{ slotsPerRow, std::vector<uint32_t>( slotCount, invalidPageId ), std::vector<uint64_t>( slotCount, 0 ), {}, std::vector<std::list<uint32_t>::iterator>( slotCount ), {} };
+	for( uint32_t slot = 1; slot < slotCount; ++slot ) cache.lruPositions[slot] = cache.lru.insert( cache.lru.end(), slot );
+
+	cache.slotPages[0] = getRootPage( layout );
+	cache.pageSlots[cache.slotPages[0]] = 0;
+	return cache;
+}
+
+// marks the resident requests used, then assigns slots to the missing ones in request order, at most maxLoads of them;
+// evicts the least recently used pages, but never one used this frame -- a working set bigger than the cache just loads less
+std::vector<PageLoad> updatePageCache( PageCache& cache, const std::vector<PageRequest>& requests, const uint64_t frame, const uint32_t maxLoads ){
+	for( const PageRequest& request : requests ){
+		const auto resident = cache.pageSlots.find( request.page );
+		if( resident == cache.pageSlots.end() ) continue;
+
+		const uint32_t slot = resident->second;
+		cache.slotLastUsed[slot] = frame;
+		if( slot != 0 ) cache.lru.splice( cache.lru.begin(), cache.lru, cache.lruPositions[slot] );
+	}
+
+	std::vector<PageLoad> loads;
+	for( const PageRequest& request : requests ){
+		if( loads.size() >= maxLoads ) break;
+		if( cache.pageSlots.count( request.page ) ) continue;
+
+		const uint32_t slot = cache.lru.back();
+		const uint32_t evicted = cache.slotPages[slot];
+		if( evicted != invalidPageId && cache.slotLastUsed[slot] == frame ) break; // everything left is in use
+
+		if( evicted != invalidPageId ) cache.pageSlots.erase( evicted );
+		cache.slotPages[slot] = request.page;
+		cache.slotLastUsed[slot] = frame;
+		cache.pageSlots[request.page] = slot;
+		cache.lru.splice( cache.lru.begin(), cache.lru, cache.lruPositions[slot] );
+
+		loads.push_back( { request.page, slot, evicted } );
+	}
+
+	return loads;
+}
+
+uint32_t getResidentPageCount( const PageCache& cache ){
+	return static_cast<uint32_t>( cache.pageSlots.size() );
+}
+
+// per level (pages per side squared), RGBA8_UINT: slot x, slot y, level of the resident page, 255
+// a page that is not resident takes over its parent's entry, so a lookup always lands on the finest resident ancestor
+// rebuilt whole -- about 1.3 * pages^2 texels, cheap next to the uploads it goes with
+std::vector<std::vector<uint8_t>> buildIndirection( const VirtualTextureLayout& layout, const PageCache& cache ){
+	if( cache.slotsPerRow > 256 || cache.slotPages.size() / cache.slotsPerRow > 256 ) throw "virtual texture: slot coordinates do not fit the RGBA8 indirection!";
+
+	std::vector<std::vector<uint32_t>> residentSlots( layout.mipLevels );
+	for( const auto& resident : cache.pageSlots ) residentSlots[getPageMip( resident.first )].push_back( resident.second );
+
+	std::vector<std::vector<uint8_t>> levels( layout.mipLevels );
+	for( uint32_t mip = layout.mipLevels; mip-- > 0; ){
+		const uint32_t pages = getPagesPerSide( layout, mip );
+		levels[mip].resize( size_t( pages ) * pages * 4 );
+
+		if( mip + 1 < layout.mipLevels ){ // only the root has no parent, and it is always resident
+			const uint32_t parentPages = getPagesPerSide( layout, mip + 1 );
+			for( uint32_t y = 0; y < pages; ++y ){
+				for( uint32_t x = 0; x < pages; ++x ){
+					const uint8_t* parent = &levels[mip + 1][(size_t( y / 2 ) * parentPages + x / 2) * 4];
+					std::copy( parent, parent + 4, &levels[mip][(size_t( y ) * pages + x) * 4] );
+				}
+			}
+		}
+
+		for( const uint32_t slot : residentSlots[mip] ){
+			const uint32_t page = cache.slotPages[slot];
+			uint8_t* entry = &levels[mip][(size_t( getPageY( page ) ) * pages + getPageX( page )) * 4];
+			entry[0] = uint8_t( slot % cache.slotsPerRow );
+			entry[1] = uint8_t( slot / cache.slotsPerRow );
+			entry[2] = uint8_t( mip );
+			entry[3] = 255;
+		}
+	}
+
+	return levels;
+}
+
+// stand-in content until pages come from a tiled file: fields of random crops with a coarser grid of roads, so every
+// level and page looks different; writes the page and its border, (pageSize + 2 * border)^2 RGBA8 sRGB texels
+void generateProceduralPage( const VirtualTextureLayout& layout, const uint32_t page, const uint32_t border, uint8_t* texels ){
+	static const uint8_t palette[][3] = { {96, 128, 56}, {128, 150, 64}, {170, 160, 90}, {110, 90, 60}, {70, 110, 50}, {150, 140, 110} };
+	const auto hash = []( uint32_t x, uint32_t y ){
+		uint32_t h = x * 0x8DA6B343u ^ y * 0xD8163841u;
+		h ^= h >> 13; h *= 0x5BD1E995u; h ^= h >> 15;
+		return h;
+	};
+
+	const uint32_t mip = getPageMip( page );
+	const uint32_t levelSize = std::max( layout.size >> mip, 1u );
+	const uint32_t side = layout.pageSize + 2 * border;
+	const int64_t left = int64_t( getPageX( page ) ) * layout.pageSize - border;
+	const int64_t top = int64_t( getPageY( page ) ) * layout.pageSize - border;
+
+	for( uint32_t row = 0; row < side; ++row ){
+		const uint32_t y = uint32_t( std::min<int64_t>( std::max<int64_t>( top + row, 0 ), levelSize - 1 ) );
+		for( uint32_t column = 0; column < side; ++column ){
+			const uint32_t x = uint32_t( std::min<int64_t>( std::max<int64_t>( left + column, 0 ), levelSize - 1 ) );
+
+			// in level 0 texels, at the center of this level's texel
+			const uint64_t u = (uint64_t( x ) << mip) + (1u << mip >> 1);
+			const uint64_t v = (uint64_t( y ) << mip) + (1u << mip >> 1);
+
+			const uint8_t* color = palette[hash( uint32_t( u >> 9 ), uint32_t( v >> 9 ) ) % 6];
+			const bool road = (u & 4095) < 24 || (v & 4095) < 24;
+			const uint32_t shade = 200 + hash( uint32_t( u >> 2 ), uint32_t( v >> 2 ) ) % 56;
+
+			uint8_t* texel = texels + (size_t( row ) * side + column) * 4;
+			for( int c = 0; c < 3; ++c ) texel[c] = road ? uint8_t( 60 ) : uint8_t( color[c] * shade / 255 );
+			texel[3] = 255;
+		}
+	}
+}
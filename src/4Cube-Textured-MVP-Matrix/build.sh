@@ -1,18 +1,99 @@
 clear
 rm cube.app
+rm cubeRuntimeShaders.app
 rm vertexShader.spv
+rm vertexShaderPushConstants.spv
+rm vertexShaderPerDrawUniform.spv
 rm fragmentShader.spv 
+rm fragmentShaderBindless.spv
+rm fragmentShaderTextureArray.spv
+rm virtualTexture.spv
+rm virtualTextureSparse.spv
+rm virtualTextureFeedback.spv
+rm cullObjects.spv
+rm cullMeshlets.spv
+rm generateMipmap.spv
+rm convertImage.spv
 glslc vertexShader.vert -o vertexShader.spv 
 if [ $? -eq 0 ]; then
     echo "Vertex shader compile success"
 else
     exit 1
 fi
+glslc vertexShader.vert -DPER_DRAW_PUSH_CONSTANTS -o vertexShaderPushConstants.spv
+if [ $? -eq 0 ]; then
+    echo "Push constant vertex shader compile success"
+else
+    exit 1
+fi
+glslc vertexShader.vert -DPER_DRAW_UNIFORM -o vertexShaderPerDrawUniform.spv
+if [ $? -eq 0 ]; then
+    echo "Per-draw uniform vertex shader compile success"
+else
+    exit 1
+fi
 glslc fragmentShader.frag -o fragmentShader.spv 
 if [ $? -eq 0 ]; then
     echo "Fragment shader compile success"
 else
     exit 1
 fi
-clang++ main.cpp -g -lvulkan -lSDL2 -o cube.app
+glslc fragmentShader.frag -DBINDLESS_TEXTURES -o fragmentShaderBindless.spv
+if [ $? -eq 0 ]; then
+    echo "Bindless fragment shader compile success"
+else
+    exit 1
+fi
+glslc fragmentShader.frag -DTEXTURE_ARRAY -o fragmentShaderTextureArray.spv
+if [ $? -eq 0 ]; then
+    echo "Texture array fragment shader compile success"
+else
+    exit 1
+fi
+glslc virtualTexture.frag -o virtualTexture.spv
+if [ $? -eq 0 ]; then
+    echo "Virtual texture fragment shader compile success"
+else
+    exit 1
+fi
+glslc virtualTexture.frag -DSPARSE_RESIDENCY -o virtualTextureSparse.spv
+if [ $? -eq 0 ]; then
+    echo "Sparse virtual texture fragment shader compile success"
+else
+    exit 1
+fi
+glslc virtualTexture.frag -DFEEDBACK -o virtualTextureFeedback.spv
+if [ $? -eq 0 ]; then
+    echo "Virtual texture feedback shader compile success"
+else
+    exit 1
+fi
+glslc cullObjects.comp -o cullObjects.spv
+if [ $? -eq 0 ]; then
+    echo "Culling compute shader compile success"
+else
+    exit 1
+fi
+glslc cullMeshlets.comp -o cullMeshlets.spv
+if [ $? -eq 0 ]; then
+    echo "Meshlet culling compute shader compile success"
+else
+    exit 1
+fi
+glslc generateMipmap.comp -o generateMipmap.spv
+if [ $? -eq 0 ]; then
+    echo "Mipmap compute shader compile success"
+else
+    exit 1
+fi
+glslc convertImage.comp -o convertImage.spv
+if [ $? -eq 0 ]; then
+    echo "Image conversion compute shader compile success"
+else
+    exit 1
+fi
+clang++ textureCooker.cpp -O2 -pthread -o textureCooker.app || exit 1
+./textureCooker.app vulkan.texture.bmp || exit 1
+clang++ main.cpp -g -pthread -DRUNTIME_SHADER_COMPILER=1 -DSHADERC_VERSION="\"$(pkg-config --modversion shaderc)\"" -lvulkan -lSDL2 -lshaderc_shared -o cubeRuntimeShaders.app || exit 1
+clang++ main.cpp -g -pthread -lvulkan -lSDL2 -o cube.app
 ./cube.app
\ No newline at end of file
@@ -0,0 +1,96 @@
+// Standalone CPU benchmark of FrustumCulling.h -- no Vulkan needed.
+// 100K to 1M random boxes, camera turning in place; compares a brute-force scalar loop with the SIMD BVH on one and on all threads.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "FrustumCulling.h"
+
+std::vector<Aabb> generateBoxes( const uint32_t count, const float sceneExtent ){
+	std::mt19937 random( 42 );
+	std::uniform_real_distribution<float> position( -sceneExtent, sceneExtent );
+	std::uniform_real_distribution<float> halfSize( 0.25f, 1.0f );
+
+	std::vector<Aabb> boxes( count );
+	for( auto& box : boxes ){
+		const glm::vec3 center( position( random ), position( random ), position( random ) );
+		const glm::vec3 extent( halfSize( random ) );
+		box = { center - extent, center + extent };
+	}
+
+	return boxes;
+}
+
+Frustum getCameraFrustum( const uint32_t frame, const float sceneExtent ){
+	const float yaw = glm::radians( 360.0f ) * frame / 64.0f;
+	const glm::mat4 view = glm::lookAt(  glm::vec3( 0.0f ), glm::vec3( glm::sin( yaw ), 0.0f, glm::cos( yaw ) ), glm::vec3( 0.0f, 1.0f, 0.0f )  );
+
+	glm::mat4 proj = glm::perspective( glm::radians( 45.0f ), 16.0f / 9.0f, 0.1f, sceneExtent );
+	proj[1][1] *= -1; // Invert Y coordinate for Vulkan
+
+	return extractFrustum( proj * view );
+}
+
+void cullBruteForce( const std::vector<Aabb>& boxes, const Frustum& frustum, std::vector<uint32_t>& visible ){
+	visible.clear();
+	for( uint32_t i = 0; i < boxes.size(); ++i ) if( isVisible( boxes[i], frustum ) ) visible.push_back( i );
+}
+
+template< class F >
+double measureMilliseconds( const uint32_t frames, F cullFrame ){
+	const auto start = std::chrono::high_resolution_clock::now();
+	for( uint32_t frame = 0; frame < frames; ++frame ) cullFrame( frame );
+	return std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count() / frames;
+}
+
+int main(){
+	const std::vector<uint32_t> objectCounts = { 100000, 250000, 500000, 1000000 };
+	const float sceneExtent = 200.0f;
+	const uint32_t measuredFrames = 32;
+
+	CullingWorkers singleWorker( 1 );
+	CullingWorkers allWorkers;
+
+	std::cout << "BVH width " << bvhWidth << ", " << allWorkers.size() << " threads" << std::endl;
+	std::cout << "objects\tvisible\tbuild ms\tbrute force ms/frame\tBVH 1 thread ms/frame\tBVH " << allWorkers.size() << " threads ms/frame" << std::endl;
+
+	for( const uint32_t count : objectCounts ){
+		const std::vector<Aabb> boxes = generateBoxes( count, sceneExtent );
+
+		const auto buildStart = std::chrono::high_resolution_clock::now();
+		const Bvh bvh = buildBvh( boxes );
+		const double buildMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - buildStart ).count();
+
+		// the BVH only accepts whole subtrees that are inside all planes, so it must agree with the per-box test exactly
+		std::vector<uint32_t> expected, visible;
+		size_t visibleTotal = 0;
+		for( uint32_t frame = 0; frame < measuredFrames; ++frame ){
+			const Frustum frustum = getCameraFrustum( frame, sceneExtent );
+			cullBruteForce( boxes, frustum, expected );
+			cullBvh( bvh, frustum, allWorkers, visible );
+			std::sort( visible.begin(), visible.end() );
+
+			if( visible != expected ){
+				std::cerr << "ERROR: BVH culling result differs from brute force (" << count << " objects, frame " << frame << ")" << std::endl;
+				return EXIT_FAILURE;
+			}
+			visibleTotal += visible.size();
+		}
+
+		const double bruteForce = measureMilliseconds(  measuredFrames, [&]( uint32_t frame ){ cullBruteForce( boxes, getCameraFrustum( frame, sceneExtent ), visible ); }  );
+		const double bvhSingle = measureMilliseconds(  measuredFrames, [&]( uint32_t frame ){ cullBvh( bvh, getCameraFrustum( frame, sceneExtent ), singleWorker, visible ); }  );
+		const double bvhParallel = measureMilliseconds(  measuredFrames, [&]( uint32_t frame ){ cullBvh( bvh, getCameraFrustum( frame, sceneExtent ), allWorkers, visible ); }  );
+
+		std::cout << count << "\t" << visibleTotal / measuredFrames << "\t" << buildMilliseconds << "\t" << bruteForce << "\t" << bvhSingle << "\t" << bvhParallel << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
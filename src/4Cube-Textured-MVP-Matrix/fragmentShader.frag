@@ -1,11 +1,45 @@
 #version 450
+// build.sh compiles this three times: as is, with -DBINDLESS_TEXTURES for the bindlessTextures table,
+// and with -DTEXTURE_ARRAY for textures packed into the layers of one array (TexturePacker.h) -- those change the
+// descriptors; features that do not are specialization constants below, chosen per pipeline
+
+#ifdef BINDLESS_TEXTURES
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
 
 layout (location = 0) smooth in vec2 uv;
+layout (location = 1) flat in uint textureIndex;
 
+#ifdef BINDLESS_TEXTURES
+// BindlessTextureTable; instances of one draw may index different textures, hence nonuniformEXT
+layout(set = 1, binding = 0) uniform sampler textureSampler;
+layout(set = 1, binding = 1) uniform texture2D textures[];
+#elif defined(TEXTURE_ARRAY)
+// textureIndex is the layer
+layout(set = 0, binding = 1) uniform sampler2DArray textureSampler;
+#else
 layout(set = 0, binding = 1) uniform sampler2D textureSampler;
+#endif
+
+// = ShaderVariant in main.cpp
+layout(constant_id = 1) const bool texturing = true; // off: the uv as the color
+layout(constant_id = 2) const bool alphaTest = false;
+layout(constant_id = 3) const float alphaCutoff = 0.5;
 
 layout (location = 0) out vec4 outColor;
 
 void main(){
-	 outColor = texture(textureSampler, uv);
+	vec4 color = vec4(uv, 0.0, 1.0);
+	if (texturing) {
+#ifdef BINDLESS_TEXTURES
+		color = texture(sampler2D(textures[nonuniformEXT(textureIndex)], textureSampler), uv);
+#elif defined(TEXTURE_ARRAY)
+		color = texture(textureSampler, vec3(uv, textureIndex));
+#else
+		color = texture(textureSampler, uv);
+#endif
+	}
+
+	if (alphaTest && color.a < alphaCutoff) discard;
+	outColor = color;
 }
\ No newline at end of file
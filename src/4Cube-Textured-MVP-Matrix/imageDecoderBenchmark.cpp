@@ -0,0 +1,106 @@
+// Standalone CPU benchmark of ImageDecoder.h against the SDL path createTextureImage() used before:
+// SDL_LoadBMP -> SDL_ConvertSurfaceFormat( RGBA32 ) -> memcpy into the staging memory. Needs SDL2 only, no Vulkan.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "ImageDecoder.h"
+
+// bottom-up BGR(A) BMP with random pixels; 24 bit rows get padded to 4 bytes
+std::vector<uint8_t> generateBmp( const uint32_t width, const uint32_t height, const uint32_t bitsPerPixel ){
+	const uint32_t rowPitch = (width * bitsPerPixel / 8 + 3) & ~3u;
+	const uint32_t pixelOffset = 14 + 40;
+
+	std::vector<uint8_t> file( pixelOffset + size_t( rowPitch ) * height, 0 );
+	const auto write = [&]( const size_t offset, const uint32_t value, const uint32_t size ){
+		for( uint32_t i = 0; i < size; ++i ) file[offset + i] = uint8_t( value >> (8 * i) );
+	};
+	file[0] = 'B'; file[1] = 'M';
+	write( 2, uint32_t( file.size() ), 4 );
+	write( 10, pixelOffset, 4 );
+	write( 14, 40, 4 ); // BITMAPINFOHEADER
+	write( 18, width, 4 );
+	write( 22, height, 4 );
+	write( 26, 1, 2 ); // planes
+	write( 28, bitsPerPixel, 2 );
+
+	std::mt19937 random( 42 );
+	for( uint32_t y = 0; y < height; ++y ){
+		for( uint32_t x = 0; x < width * bitsPerPixel / 8; ++x ) file[pixelOffset + size_t( y ) * rowPitch + x] = uint8_t( random() );
+	}
+
+	return file;
+}
+
+void decodeWithSdl( const std::vector<uint8_t>& file, uint8_t* staging ){
+	SDL_Surface* surface = SDL_LoadBMP_RW( SDL_RWFromConstMem( file.data(), int( file.size() ) ), 1 );
+	if( !surface ) throw "SDL_LoadBMP_RW failed!";
+
+	SDL_Surface* rgbaSurface = SDL_ConvertSurfaceFormat( surface, SDL_PIXELFORMAT_RGBA32, 0 );
+	if( !rgbaSurface ) throw "SDL_ConvertSurfaceFormat failed!";
+
+	std::memcpy( staging, rgbaSurface->pixels, size_t( rgbaSurface->w ) * rgbaSurface->h * 4 ); // RGBA32 pitch is always w * 4
+
+	SDL_FreeSurface( rgbaSurface );
+	SDL_FreeSurface( surface );
+}
+
+void decodeNative( const std::vector<uint8_t>& file, uint8_t* staging ){
+	ImageHeader header;
+	if( !readImageHeader( file.data(), file.size(), header ) ) throw "readImageHeader rejected the file!";
+
+	decodeImage( file.data(), header, staging );
+}
+
+template< class F >
+double measureMilliseconds( const uint32_t runs, F decode ){
+	const auto start = std::chrono::high_resolution_clock::now();
+	for( uint32_t run = 0; run < runs; ++run ) decode();
+	return std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count() / runs;
+}
+
+int main() try{
+	const std::vector<uint32_t> sizes = { 1024, 2048, 4096, 4093 /*odd: padded rows and scalar tails*/ };
+	const uint32_t measuredRuns = 10;
+
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+	std::cout << "swizzle: AVX2" << std::endl;
+#elif GLM_ARCH & GLM_ARCH_SSSE3_BIT
+	std::cout << "swizzle: SSSE3" << std::endl;
+#else
+	std::cout << "swizzle: scalar" << std::endl;
+#endif
+	std::cout << "size\tbpp\tSDL ms\tnative ms\tspeedup" << std::endl;
+
+	for( const uint32_t size : sizes ){
+		for( const uint32_t bitsPerPixel : { 24u, 32u } ){
+			const std::vector<uint8_t> file = generateBmp( size, size, bitsPerPixel );
+			std::vector<uint8_t> expected( size_t( size ) * size * 4 ), staging( expected.size() ); // stands in for the mapped staging buffer
+
+			decodeWithSdl( file, expected.data() );
+			decodeNative( file, staging.data() );
+			if( staging != expected ){
+				std::cerr << "ERROR: native decode differs from SDL (" << size << "x" << size << ", " << bitsPerPixel << " bpp)" << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			const double sdl = measureMilliseconds(  measuredRuns, [&]{ decodeWithSdl( file, staging.data() ); }  );
+			const double native = measureMilliseconds(  measuredRuns, [&]{ decodeNative( file, staging.data() ); }  );
+
+			std::cout << size << "\t" << bitsPerPixel << "\t" << sdl << "\t" << native << "\t" << sdl / native << std::endl;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+catch( const char* e ){
+	std::cerr << "ERROR: " << e << std::endl;
+	return EXIT_FAILURE;
+}
@@ -1,15 +1,27 @@
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <exception>
+#include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -18,6 +30,17 @@
 #include "ErrorHandling.h"
 #include "ExtensionLoader.h"
 #include "Vertex.h"
+#include "Cube.h"
+#include "Mesh.h"
+#include "Meshlet.h"
+#include "MeshSimplifier.h"
+#include "ImageDecoder.h"
+#include "Ktx2.h"
+#include "TextureStreaming.h"
+#include "TexturePacker.h"
+#include "VirtualTexture.h"
+#include "ResourceCache.h"
+#include "SpirvReflection.h"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
@@ -37,12 +60,42 @@ using std::string;
 using std::to_string;
 using std::vector;
 
-#define VULKAN_VALIDATION 1
+#ifndef VULKAN_VALIDATION
+	#define VULKAN_VALIDATION 1
+#endif
+
+// compile the app's shaders at startup and hot-reload them when their files change (ShaderCompiler.h), instead of loading
+// the .spv build.sh compiled; needs shaderc, build.sh also builds cubeRuntimeShaders.app this way
+#ifndef RUNTIME_SHADER_COMPILER
+	#define RUNTIME_SHADER_COMPILER 0
+#endif
+
+#if RUNTIME_SHADER_COMPILER
+	#include "ShaderCompiler.h"
+#endif
 
 struct UniformBufferObject {
     glm::mat4 mvp;
 };
 
+// per-object data read by the vertex shader (model, texture) and cullObjects.comp (bounds); std430 layout
+struct ObjectData{
+	glm::mat4 model;
+	glm::vec4 boundingSphere; // xyz = center, w = radius; in the space ubo.mvp transforms from
+	glm::vec4 uvTransform; // xy = scale, zw = offset of the mesh uv; places the object's texture in an atlas (TexturePacker.h)
+	uint32_t textureIndex; // into the bindless texture table or the texture array; unused with a single texture
+	uint32_t padding[3]; // std430 rounds the struct up to the alignment of mat4
+};
+
+// everything one draw needs, for draws that carry their own transform (vertexShader.vert with PER_DRAW_PUSH_CONSTANTS or
+// PER_DRAW_UNIFORM) -- as push constants, a draw that only moved needs no descriptor or buffer writes at all
+struct PerDrawData{
+	glm::mat4 mvp;
+	glm::vec4 uvTransform; // as ObjectData::uvTransform
+	uint32_t textureIndex; // the material
+};
+static_assert( sizeof( PerDrawData ) <= 128, "PerDrawData must fit into the 128 bytes of push constants every device has" );
+
 const char *appName = "Hello Vulkan Triangle";
 
 // layers and debug
@@ -66,6 +119,65 @@ const char *appName = "Hello Vulkan Triangle";
 
 constexpr bool fpsCounter = true;
 
+// number of cubes drawn by the single instanced draw call; transforms are laid out in a grid by generateInstanceTransforms()
+constexpr uint32_t instanceCount = 1;
+
+// frustum-cull the instances in a compute shader and draw the survivors with indirect draws, instead of one plain instanced draw
+constexpr bool gpuDrivenRendering = false;
+
+// with gpuDrivenRendering: cull per meshlet (cluster) instead of per object; the cube gets tessellated so there is something to split
+constexpr bool meshletCulling = false;
+
+// pick a LOD (generated at load time by MeshSimplifier.h) per object and frame from its projected size; CPU-side, so not with gpuDrivenRendering
+constexpr bool lodSelection = false;
+constexpr float lodMaxErrorPixels = 1.0f; // coarsest LOD whose simplification error stays below this many pixels
+constexpr float lodHysteresis = 0.25f; // going coarser needs the error to be this fraction below the limit, against popping back and forth
+static_assert( !(gpuDrivenRendering && lodSelection), "lodSelection writes its own indirect draws; it does not combine with gpuDrivenRendering" );
+
+// BMP/TGA, or KTX2 with block-compressed levels uploaded as stored; build.sh cooks the KTX2 with textureCooker.app
+constexpr const char* texturePath = "vulkan.texture.ktx2";
+
+// textures get a full mip chain generated at load time; sampled with anisotropic filtering up to this where the device supports it (1 = off)
+constexpr bool textureMipmaps = true;
+constexpr float textureMaxAnisotropy = 16.0f;
+
+// textures live in one big update-after-bind array (VK_EXT_descriptor_indexing) indexed by ObjectData::textureIndex,
+// so objects with different textures can share one instanced or indirect draw; otherwise there is one texture per descriptor set
+constexpr bool bindlessTextures = false;
+constexpr uint32_t bindlessTextureCapacity = 4096; // clamped to what the device supports
+
+// load textures in the background: a placeholder at first, then levels from coarsest to finest, at most this many bytes uploaded per frame
+constexpr bool textureStreaming = true;
+constexpr VkDeviceSize textureStreamingBudget = 32 << 20;
+
+// virtual texturing (--benchmark-virtual-texture): a texture far bigger than memory, of which only the pages the last frame
+// sampled are resident; sparse residency where the device has it, else an indirection into a texture of page slots (lavapipe)
+constexpr uint32_t virtualTextureSize = 65536; // texels per side of level 0; clamped to the device limits with sparse residency
+constexpr uint32_t virtualTexturePageSize = 128; // the standard sparse block of RGBA8; virtualTexture.frag has a copy of these three
+constexpr uint32_t virtualTexturePageBorder = 4;
+constexpr uint32_t virtualTextureFeedbackScale = 8; // the feedback pass renders at 1/8 of the size
+constexpr uint32_t virtualTexturePageSlots = 16; // per side of the physical page texture (or of the sparse page memory)
+constexpr uint32_t virtualTextureUploadsPerFrame = 32;
+
+// textures loaded without streaming go through a cache keyed by their content (ResourceCache.h): files with the same bytes
+// share one image, unreferenced ones stay resident up to the budget, and decoded textures are kept on disk for the next run
+constexpr const char* resourceCacheDirectory = "resourceCache";
+constexpr VkDeviceSize resourceCacheBudget = 256 << 20;
+
+// compiled pipelines are kept here between runs (a VkPipelineCache); deleting it only costs startup time
+constexpr const char* pipelineCachePath = "pipelineCache.bin";
+
+// with RUNTIME_SHADER_COMPILER: the compiled SPIR-V, and the directory watched for changed shaders
+constexpr const char* shaderCacheDirectory = "shaderCache";
+constexpr const char* shaderSourceDirectory = ".";
+
+// descriptor pools of the DescriptorAllocators are this many sets big; more sets just take more pools
+constexpr uint32_t staticDescriptorSetsPerPool = 16;
+constexpr uint32_t frameDescriptorSetsPerPool = 1024;
+
+// meshlet and LOD demos tessellate the cube, so there is something to split and simplify
+constexpr uint32_t denseCubeTessellation = 16; // every cube triangle becomes 16^2 triangles
+
 // window and swapchain
 constexpr uint32_t initialWindowWidth = 800;
 constexpr uint32_t initialWindowHeight = 800;
@@ -83,31 +195,58 @@ VkDescriptorSet createDescriptorSet(
 	VkBuffer uniformBuffer,
 	VkImageView textureImageView,
 	VkSampler textureSampler, 
+	VkBuffer objectBuffer,
 	VkDescriptorSetLayout descriptorSetLayout, 
 	VkDescriptorPool descriptorPool, 
 	VkDevice device
 );
-std::tuple<VkImage, VkDeviceMemory> createTextureImage(const char *imagePath, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue);
-VkImageView createTextureImageView(VkDevice device, VkImage textureImage);
-VkSampler createTextureSampler(VkDevice device);
+struct Texture{
+	VkImage image;
+	VkDeviceMemory memory;
+	VkFormat format; // R8G8B8A8_SRGB for images, the payload format (or its CPU decoded stand-in) for KTX2
+	uint32_t mipLevels;
+};
+// BMP/TGA (mipmapped: full chain generated on the GPU) or KTX2 (levels and format as stored, mipmapped is ignored)
+Texture createTextureImage(const char *imagePath, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue, bool mipmapped = true);
+Texture createKtx2TextureImage(const uint8_t* file, const Ktx2Header& header, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue);
+uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+// all levels have to be in TRANSFER_DST_OPTIMAL with level 0 filled; leaves all of them in SHADER_READ_ONLY_OPTIMAL
+void generateMipmaps(VkQueue graphicsQueue, VkCommandPool commandPool, VkDevice device, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+// same contract, for formats without VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT blits; uses generateMipmap.comp
+void generateMipmapsCompute(VkQueue graphicsQueue, VkCommandPool commandPool, VkDevice device, VkPhysicalDevice physicalDevice, VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels);
+VkImageView createTextureImageView(VkDevice device, const Texture& texture);
+// layers[layer][level] are tightly packed texels, every layer with the same levels (as buildAtlasLayer() returns them); ends in SHADER_READ_ONLY_OPTIMAL
+Texture createTextureArrayImage(VkFormat format, uint32_t width, uint32_t height, const vector<vector<vector<uint8_t>>>& layers, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue);
+// VK_IMAGE_VIEW_TYPE_2D_ARRAY over all levels and layers, for sampler2DArray
+VkImageView createTextureArrayImageView(VkDevice device, const Texture& texture, uint32_t layerCount);
+// maxAnisotropy <= 1 disables anisotropic filtering; anything above needs the samplerAnisotropy feature enabled
+VkSampler createTextureSampler(VkDevice device, float maxAnisotropy);
 VkDescriptorSetLayout createDescriptorSetLayout(VkDevice device);
-VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels = 1);
 VkCommandBuffer beginSingleTimeCommands(VkCommandPool commandPool, VkDevice device);
-void createImage(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+void createImage(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, uint32_t arrayLayers = 1);
 bool isLayerSupported( const char* layer, const vector<VkLayerProperties>& supportedLayers );
 bool isExtensionSupported( const char* extension, const vector<VkExtensionProperties>& supportedExtensions );
 // treat layers as optional; app can always run without em -- i.e. return those supported
 vector<const char*> checkInstanceLayerSupport( const vector<const char*>& requestedLayers, const vector<VkLayerProperties>& supportedLayers );
 vector<VkExtensionProperties> getSupportedInstanceExtensions( const vector<const char*>& providingLayers );
 bool checkExtensionSupport( const vector<const char*>& extensions, const vector<VkExtensionProperties>& supportedExtensions );
+vector<VkExtensionProperties> getSupportedDeviceExtensions( VkPhysicalDevice physDevice, const vector<const char*>& providingLayers );
 
-void updateUniformBuffer(VkDeviceMemory uniformBufferMemory, VkDevice device);
+// what ubo.mvp is made of; returned for CPU-side work like LOD selection
+struct FrameTransforms{
+	glm::mat4 model; // whole scene rotation
+	glm::mat4 view;
+	glm::mat4 proj;
+};
+FrameTransforms updateUniformBuffer(VkDeviceMemory uniformBufferMemory, VkDevice device);
 VkInstance initInstance( const vector<const char*>& layers = {}, const vector<const char*>& extensions = {} );
 void killInstance( VkInstance instance );
 
 VkPhysicalDevice getPhysicalDevice( VkInstance instance, VkSurfaceKHR surface = VK_NULL_HANDLE /*seek presentation support if !NULL*/ ); // destroyed with instance
 VkPhysicalDeviceProperties getPhysicalDeviceProperties( VkPhysicalDevice physicalDevice );
 VkPhysicalDeviceMemoryProperties getPhysicalDeviceMemoryProperties( VkPhysicalDevice physicalDevice );
+VkPhysicalDeviceFeatures getPhysicalDeviceFeatures( VkPhysicalDevice physicalDevice );
 
 std::pair<uint32_t, uint32_t> getQueueFamilies( VkPhysicalDevice physDevice, VkSurfaceKHR surface );
 vector<VkQueueFamilyProperties> getQueueFamilyProperties( VkPhysicalDevice device );
@@ -118,7 +257,9 @@ VkDevice initDevice(
 	uint32_t graphicsQueueFamily,
 	uint32_t presentQueueFamily,
 	const vector<const char*>& layers = {},
-	const vector<const char*>& extensions = {}
+	const vector<const char*>& extensions = {},
+	uint32_t transferQueueFamily = VK_QUEUE_FAMILY_IGNORED, // one more queue, unless it is one of the above
+	const void* extensionFeatures = nullptr // chain of VkPhysicalDevice*Features structs, for features beyond VkPhysicalDeviceFeatures
 );
 void killDevice( VkDevice device );
 
@@ -179,7 +320,8 @@ void killSwapchainImageViews( VkDevice device, vector<VkImageView>& imageViews )
 VkRenderPass initRenderPass(
 	VkDevice device,
 	VkPhysicalDevice physicalDevice,
-	VkSurfaceFormatKHR surfaceFormat
+	VkSurfaceFormatKHR surfaceFormat,
+	VkImageLayout colorFinalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR // offscreen targets keep COLOR_ATTACHMENT_OPTIMAL
 );
 void killRenderPass( VkDevice device, VkRenderPass renderPass );
 
@@ -197,10 +339,68 @@ void killShaderModule( VkDevice device, VkShaderModule shaderModule );
 
 VkPipelineLayout initPipelineLayout(
 	VkDevice device,
-	VkDescriptorSetLayout descriptorSetLayout
+	VkDescriptorSetLayout descriptorSetLayout,
+	const vector<VkPushConstantRange>& pushConstantRanges = {}
+);
+VkPipelineLayout initPipelineLayout(
+	VkDevice device,
+	const vector<VkDescriptorSetLayout>& descriptorSetLayouts, // [i] = set i
+	const vector<VkPushConstantRange>& pushConstantRanges = {}
 );
 void killPipelineLayout( VkDevice device, VkPipelineLayout pipelineLayout );
 
+// what the driver compiled, kept across runs: loaded at startup, shared by all pipeline creation, saved at shutdown
+// an empty cache if the file is missing or was written by another device or driver version (the reason gets logged)
+VkPipelineCache initPipelineCache( VkDevice device, const VkPhysicalDeviceProperties& properties, const string& path );
+// writes a temporary file and renames it over path, so a crash never leaves a torn cache behind
+void savePipelineCache( VkDevice device, VkPipelineCache pipelineCache, const string& path );
+void killPipelineCache( VkDevice device, VkPipelineCache pipelineCache );
+
+// what a render pass has to match for a pipeline created with another one to be usable in it (render pass compatibility)
+struct RenderPassCompatibility{
+	VkFormat colorFormat;
+	VkFormat depthFormat;
+	VkSampleCountFlagBits samples;
+	uint32_t subpass;
+};
+// features of vertexShader.vert and fragmentShader.frag chosen per pipeline as specialization constants: one SPIR-V module
+// instead of a permutation for each, and the driver still drops the branches a pipeline does not take.
+// The members in constant_id order, 4 bytes each; shaders without a constant ignore it.
+struct ShaderVariant{
+	VkBool32 instancing; // per-object data from the object buffer; off: one object, placed by ubo.mvp alone
+	VkBool32 texturing; // off: the uv as the color, the texture is not read
+	VkBool32 alphaTest; // discards fragments with alpha below alphaCutoff
+	float alphaCutoff;
+};
+constexpr ShaderVariant defaultShaderVariant{ VK_TRUE, VK_TRUE, VK_FALSE, 0.5f };
+
+// everything a graphics pipeline of this app is made of; vertices are always Vertex3D_UV
+struct GraphicsPipelineState{
+	VkShaderModule vertexShader;
+	VkShaderModule fragmentShader;
+	uint32_t vertexBufferBinding;
+	VkPrimitiveTopology topology;
+	VkPolygonMode polygonMode;
+	VkCullModeFlags cullMode;
+	VkBool32 depthTest;
+	VkBool32 depthWrite;
+	VkCompareOp depthCompareOp;
+	VkBool32 blend; // straight alpha: src alpha, one minus src alpha
+	ShaderVariant variant;
+	vector<VkVertexInputAttributeDescription> vertexAttributes; // empty: position and uv of Vertex3D_UV at locations 0 and 1
+	VkPipelineLayout pipelineLayout;
+	VkRenderPass renderPass; // created with this one; usable in any render pass matching compatibility
+	RenderPassCompatibility compatibility; // only the pipeline registry looks at it
+};
+// the state initPipeline() always used: filled triangle lists, no culling, depth tested and written, no blending, defaultShaderVariant
+GraphicsPipelineState getDefaultPipelineState(
+	VkPipelineLayout pipelineLayout,
+	VkRenderPass renderPass,
+	VkShaderModule vertexShader,
+	VkShaderModule fragmentShader,
+	uint32_t vertexBufferBinding
+);
+
 VkPipeline initPipeline(
 	VkDevice device,
 	VkPhysicalDeviceLimits limits,
@@ -209,15 +409,105 @@ VkPipeline initPipeline(
 	VkShaderModule vertexShader,
 	VkShaderModule fragmentShader,
 	const uint32_t vertexBufferBinding,
-	uint32_t width, uint32_t height
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE
 );
+VkPipeline initPipeline( VkDevice device, const VkPhysicalDeviceLimits& limits, const GraphicsPipelineState& state, VkPipelineCache pipelineCache = VK_NULL_HANDLE );
 void killPipeline( VkDevice device, VkPipeline pipeline );
 
+VkPipeline initComputePipeline( VkDevice device, VkPipelineLayout pipelineLayout, VkShaderModule computeShader, VkPipelineCache pipelineCache = VK_NULL_HANDLE );
+
 std::tuple<VkBuffer, VkDeviceMemory> createUniformBuffer(VkDevice device, VkPhysicalDevice physicalDevice);
 
 VkDescriptorPool createDescriptorPool(VkDevice device);
+void writeDescriptorSet( VkDevice device, VkDescriptorSet descriptorSet, VkBuffer uniformBuffer, VkImageView textureImageView, VkSampler textureSampler, VkBuffer objectBuffer );
+VkDescriptorPool createDescriptorPool( VkDevice device, const vector<VkDescriptorPoolSize>& poolSizes, uint32_t maxSets );
+
+template<typename Handle>
+uint64_t getHandleValue( const Handle handle ){
+	uint64_t value = 0; // non-dispatchable handles are pointers on 64 bit, uint64_t on 32 bit platforms
+	std::memcpy( &value, &handle, sizeof( handle ) );
+	return value;
+}
+
+// layouts made from SPIR-V reflection (SpirvReflection.h), one per distinct set of bindings; all killed together
+struct DescriptorLayoutCache{
+	std::unordered_map<uint64_t, VkDescriptorSetLayout> setLayouts;
+	std::unordered_map<uint64_t, VkPipelineLayout> pipelineLayouts;
+};
+VkDescriptorSetLayout getDescriptorSetLayout( VkDevice device, DescriptorLayoutCache& cache, const vector<VkDescriptorSetLayoutBinding>& bindings );
+// sets 0 to getReflectedSetCount() - 1 and the push constant ranges of the (merged) stages
+VkPipelineLayout getReflectedPipelineLayout( VkDevice device, DescriptorLayoutCache& cache, const ShaderReflection& reflection );
+void killDescriptorLayoutCache( VkDevice device, DescriptorLayoutCache& cache );
+
+// descriptor sets out of a list of pools: when the current pool runs out (or fragments) the next one is taken, or created,
+// so nothing has to know up front how many sets there will be. Per frame in flight: reset wholesale once the frame's fence
+// signaled. Long-lived: never reset, for static sets.
+struct DescriptorAllocator{
+	VkDevice device;
+	vector<VkDescriptorPoolSize> setSizes; // descriptors of each type one set needs at most; a pool gets setsPerPool times that
+	uint32_t setsPerPool;
+	vector<VkDescriptorPool> usedPools; // the last one is the current one
+	vector<VkDescriptorPool> freePools; // reset, taken before a new one is created
+	uint32_t currentPoolSets; // allocated out of usedPools.back()
+	uint32_t allocatedSets; // since the last reset
+};
+DescriptorAllocator initDescriptorAllocator( VkDevice device, const vector<VkDescriptorPoolSize>& setSizes, uint32_t setsPerPool );
+void killDescriptorAllocator( DescriptorAllocator& allocator );
+VkDescriptorSet allocateDescriptorSet( DescriptorAllocator& allocator, VkDescriptorSetLayout descriptorSetLayout );
+// frees every set allocated from it at once (vkResetDescriptorPool); returns how many that were
+uint32_t resetDescriptorAllocator( DescriptorAllocator& allocator );
+uint32_t getDescriptorPoolCount( const DescriptorAllocator& allocator );
+
+// what one binding of a set points at: the buffer fields for buffer descriptors, the image fields for the others
+struct DescriptorBinding{
+	uint32_t binding;
+	VkDescriptorType type;
+	VkBuffer buffer;
+	VkDeviceSize offset;
+	VkDeviceSize range;
+	VkImageView imageView;
+	VkSampler sampler;
+	VkImageLayout imageLayout;
+};
+struct CachedDescriptorSet{
+	VkDescriptorSetLayout layout;
+	vector<DescriptorBinding> bindings;
+	VkDescriptorSet descriptorSet;
+};
+// written descriptor sets by layout and contents: asking for a set with the same contents again returns the set written the
+// first time, so sets that do not change are never written again. The sets live until the cache is killed; the ones of
+// invalidated entries get rewritten for later misses of their layout.
+struct DescriptorSetCache{
+	DescriptorAllocator allocator; // long-lived, never reset
+	std::unordered_map<uint64_t, CachedDescriptorSet> entries;
+	std::unordered_map<uint64_t, vector<VkDescriptorSet>> retiredSets; // by layout handle
+	uint32_t hits;
+	uint32_t misses; // = vkUpdateDescriptorSets calls
+};
+DescriptorSetCache initDescriptorSetCache( VkDevice device, const vector<VkDescriptorPoolSize>& setSizes, uint32_t setsPerPool );
+void killDescriptorSetCache( DescriptorSetCache& cache );
+VkDescriptorSet getCachedDescriptorSet( DescriptorSetCache& cache, VkDescriptorSetLayout layout, const vector<DescriptorBinding>& bindings );
+// drops the entries pointing at a buffer, image view or sampler (its getHandleValue()) about to be destroyed; returns how many
+// the sets must not be in use by pending command buffers any more -- as the resource itself
+uint32_t invalidateDescriptorSets( DescriptorSetCache& cache, uint64_t resource );
+// createDescriptorSet(), out of an allocator instead of a pool of exactly the right size
+VkDescriptorSet createDescriptorSet(
+	VkBuffer uniformBuffer,
+	VkImageView textureImageView,
+	VkSampler textureSampler,
+	VkBuffer objectBuffer,
+	VkDescriptorSetLayout descriptorSetLayout,
+	DescriptorAllocator& allocator
+);
+// rewrites the combined image sampler of a createDescriptorSet() set; the set must not be in use by pending command buffers
+void updateTextureDescriptor( VkDevice device, VkDescriptorSet descriptorSet, VkImageView textureImageView, VkSampler textureSampler );
 void setVertexData( VkDevice device, VkDeviceMemory memory, vector<Vertex3D_UV> vertices );
 
+vector<glm::mat4> generateInstanceTransforms( uint32_t count, float gridExtent = 1.0f /*half size of the grid*/ );
+vector<ObjectData> generateObjects( const vector<glm::mat4>& transforms, glm::vec4 localBoundingSphere, uint32_t textureIndex = 0 );
+VkBuffer initObjectBuffer( VkDevice device, uint32_t maxObjectCount );
+void setObjectData( VkDevice device, VkDeviceMemory memory, const vector<ObjectData>& objects );
+
 VkSemaphore initSemaphore( VkDevice device );
 vector<VkSemaphore> initSemaphores( VkDevice device, size_t count );
 void killSemaphore( VkDevice device, VkSemaphore semaphore );
@@ -241,11 +531,18 @@ void recordBeginRenderPass(
 	uint32_t width, uint32_t height
 );
 void recordEndRenderPass( VkCommandBuffer commandBuffer );
+// the dynamic viewport and scissor of the pipelines from initPipeline(); recordBeginRenderPass() sets them to the render area
+void recordSetViewport( VkCommandBuffer commandBuffer, uint32_t width, uint32_t height );
 
 void recordBindPipeline( VkCommandBuffer commandBuffer, VkPipeline pipeline );
 void recordBindVertexBuffer( VkCommandBuffer commandBuffer, const uint32_t vertexBufferBinding, VkBuffer vertexBuffer );
 
-void recordDraw( VkCommandBuffer commandBuffer, uint32_t vertexCount );
+void recordBindIndexBuffer( VkCommandBuffer commandBuffer, VkBuffer indexBuffer );
+
+void recordDraw( VkCommandBuffer commandBuffer, uint32_t vertexCount, uint32_t instanceCount = 1 );
+void recordDrawIndexed( VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t instanceCount = 1 );
+// for pipelines with vertexShaderPushConstants.spv; the layout's push constant range is the reflected one
+void recordPushDrawData( VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const PerDrawData& drawData );
 
 void submitToQueue( VkQueue queue, VkCommandBuffer commandBuffer, VkSemaphore imageReadyS, VkSemaphore renderDoneS, VkFence fence = VK_NULL_HANDLE );
 void present( VkQueue queue, VkSwapchainKHR swapchain, uint32_t swapchainImageIndex, VkSemaphore renderDoneS );
@@ -253,6 +550,541 @@ void present( VkQueue queue, VkSwapchainKHR swapchain, uint32_t swapchainImageIn
 // cleanup dangerous semaphore with signal pending from vkAcquireNextImageKHR
 void cleanupUnsafeSemaphore( VkQueue queue, VkSemaphore semaphore );
 
+// GPU-driven rendering: cullObjects.comp turns the object buffer into indirect draws, so CPU work per frame does not depend on object count
+// With meshlets, cullMeshlets.comp does the same per object * meshlet, adding a back-facing cone test.
+struct GpuCulling{
+	bool drawIndirectCount; // VK_KHR_draw_indirect_count enabled; otherwise every object gets a (possibly empty) draw
+	bool multiDrawIndirect; // otherwise recorded as one vkCmdDrawIndexedIndirect per object
+	uint32_t maxObjectCount;
+	uint32_t meshletCount; // per object; 0 = whole-object culling
+
+	VkBuffer meshletBuffer; // Meshlet[meshletCount]
+	VkDeviceMemory meshletBufferMemory;
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+	VkShaderModule shader;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+
+	VkBuffer drawCommandBuffer; // VkDrawIndexedIndirectCommand[maxObjectCount * max( meshletCount, 1 )]
+	VkDeviceMemory drawCommandBufferMemory;
+	VkBuffer drawCountBuffer; // CullingStats
+	VkDeviceMemory drawCountBufferMemory;
+};
+// layout of drawCountBuffer
+struct CullingStats{
+	uint32_t drawCount; // visible objects or meshlets
+	uint32_t triangleCount; // triangles in them
+};
+// enables what the GPU-driven path needs; returns whether VK_KHR_draw_indirect_count got requested
+// features.multiDrawIndirect is left at what the device supports, which is what initGpuCulling wants to know
+bool requestGpuDrivenSupport( VkPhysicalDevice physicalDevice, const vector<const char*>& layers, VkPhysicalDeviceFeatures& features, vector<const char*>& deviceExtensions );
+GpuCulling initGpuCulling(
+	VkDevice device,
+	const VkPhysicalDeviceLimits& limits,
+	const VkPhysicalDeviceMemoryProperties& memoryProperties,
+	VkBuffer uniformBuffer,
+	VkBuffer objectBuffer,
+	uint32_t maxObjectCount,
+	bool drawIndirectCount,
+	bool multiDrawIndirect,
+	const vector<Meshlet>& meshlets = {}, // non-empty switches to per-meshlet culling; the index buffer must be MeshletMesh::indices
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE
+);
+void killGpuCulling( VkDevice device, GpuCulling& culling );
+// outside of render pass; indexCount is ignored for meshlet culling
+void recordCullObjects( VkCommandBuffer commandBuffer, const GpuCulling& culling, uint32_t objectCount, uint32_t indexCount );
+// inside of render pass, with the graphics pipeline, vertex + index buffer and descriptor set bound
+void recordDrawCulledObjects( VkCommandBuffer commandBuffer, const GpuCulling& culling, uint32_t objectCount );
+// host-side readback of the last cull result; the submission must have finished
+CullingStats getCullingStats( VkDevice device, const GpuCulling& culling );
+
+// LOD selection: the CPU rewrites one indirect draw per object each frame, so the prerecorded command buffers stay valid.
+// One region of draws per prerecorded command buffer: a region is only rewritten once the submission reading it finished.
+struct LodDraws{
+	VkBuffer buffer; // VkDrawIndexedIndirectCommand[regionCount][objectCount]
+	VkDeviceMemory memory;
+	VkDrawIndexedIndirectCommand* mapped; // persistently mapped, host coherent
+	uint32_t objectCount;
+	uint32_t regionCount;
+	vector<uint32_t> currentLods; // per object, for the hysteresis
+	bool multiDrawIndirect; // otherwise recorded as one vkCmdDrawIndexedIndirect per object
+};
+// enables what LodDraws needs; throws if indirect draws can't carry the object index
+bool requestLodDrawSupport( VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures& features );
+LodDraws initLodDraws( VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t objectCount, bool multiDrawIndirect, uint32_t regionCount = 1 );
+void killLodDraws( VkDevice device, LodDraws& draws );
+// screen pixels covered by one world unit at the given point (isotropic approximation)
+float getPixelsPerUnit( const FrameTransforms& transforms, glm::vec3 worldPosition, float viewportHeight );
+uint32_t selectLod( const vector<MeshLod>& lods, float pixelsPerMeshUnit, uint32_t currentLod );
+// returns the number of triangles the draws will submit; no pending submission may read the region
+uint64_t updateLodDraws( LodDraws& draws, uint32_t region, const vector<MeshLod>& lods, const vector<ObjectData>& objects, float meshRadius, const FrameTransforms& transforms, float viewportHeight );
+// inside of render pass, with the graphics pipeline, vertex + index buffer and descriptor set bound
+void recordDrawLods( VkCommandBuffer commandBuffer, const LodDraws& draws, uint32_t region, uint32_t objectCount );
+
+// Texture streaming: workers decode (TextureStreaming.h), uploads go through a transfer-only queue where the device has one,
+// coarsest levels first. Textures sample a 1x1 placeholder until their first levels are resident and then a view over
+// more and more levels -- so the first frame does not wait for any texture.
+struct StreamedTexture{
+	Texture texture; // image is VK_NULL_HANDLE until the texture is decoded
+	VkImageView view; // VK_NULL_HANDLE until the first upload finished
+	uint32_t residentLevel; // finest level uploaded, the view's baseMipLevel; texture.mipLevels while none is
+	bool uploading; // one upload per texture at a time keeps the levels in order
+	std::shared_ptr<DecodedTexture> decoded; // released once level 0 is resident
+};
+struct TextureUpload{
+	uint32_t texture;
+	uint32_t firstLevel; // uploads [firstLevel, residentLevel)
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	VkCommandBuffer transferCommandBuffer;
+	VkCommandBuffer acquireCommandBuffer; // queue family ownership acquire on the graphics queue; VK_NULL_HANDLE without a transfer family
+	VkSemaphore transferDone; // likewise
+	VkFence done; // signaled = the levels are resident; polled, never waited for
+};
+struct TextureStreamer{
+	VkPhysicalDevice physicalDevice;
+	uint32_t graphicsQueueFamily;
+	uint32_t transferQueueFamily; // == graphicsQueueFamily without a transfer-only family
+	VkQueue graphicsQueue;
+	VkQueue transferQueue;
+	VkCommandPool graphicsCommandPool;
+	VkCommandPool transferCommandPool;
+
+	Texture placeholder;
+	VkImageView placeholderView;
+
+	vector<StreamedTexture> textures;
+	vector<TextureUpload> uploads; // in flight
+	vector<VkImageView> retiredViews; // replaced by finer ones; killRetiredTextureViews() once no frame uses them
+	std::unique_ptr<TextureDecoder> decoder;
+};
+// a transfer-only queue family (copy engine), or graphicsQueueFamily if the device has none
+uint32_t getTransferQueueFamily( VkPhysicalDevice physDevice, uint32_t graphicsQueueFamily );
+TextureStreamer initTextureStreamer( VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsQueueFamily, VkQueue graphicsQueue, uint32_t transferQueueFamily, VkQueue transferQueue );
+// waits for the decodes and uploads in flight
+void killTextureStreamer( VkDevice device, TextureStreamer& streamer );
+// decoding starts right away; returns the id for getStreamedTextureView()
+uint32_t requestStreamedTexture( TextureStreamer& streamer, const string& path, bool mipmapped );
+// the placeholder until the texture's first levels are resident
+VkImageView getStreamedTextureView( const TextureStreamer& streamer, uint32_t texture );
+// once per frame: picks up decoded textures and finished uploads, starts new uploads of up to uploadBudget bytes;
+// returns whether a view changed -- descriptors using it need a rewrite, then killRetiredTextureViews()
+bool updateTextureStreamer( VkDevice device, TextureStreamer& streamer, VkDeviceSize uploadBudget );
+void killRetiredTextureViews( VkDevice device, TextureStreamer& streamer );
+
+// Bindless textures: one descriptor set holding every texture (set 1 of the graphics pipeline layout), shaders pick theirs by
+// ObjectData::textureIndex -- so a texture change needs neither another descriptor set nor another bind, and draws
+// with different textures merge into one. Update-after-bind: writing a slot leaves the recorded command buffers valid.
+struct BindlessTextureTable{
+	VkDescriptorSetLayout descriptorSetLayout; // binding 0 = immutable sampler, binding 1 = texture2D[capacity], partially bound
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+	uint32_t capacity;
+	uint32_t count; // slots handed out
+};
+// enables VK_EXT_descriptor_indexing with the features the table needs (chain indexingFeatures into initDevice()); throws if unsupported
+// needs VK_KHR_get_physical_device_properties2 enabled on the instance
+void requestBindlessSupport( VkPhysicalDevice physicalDevice, const vector<const char*>& layers, VkPhysicalDeviceDescriptorIndexingFeaturesEXT& indexingFeatures, vector<const char*>& deviceExtensions );
+// capacity gets clamped to the update-after-bind limits; all textures are sampled with sampler
+BindlessTextureTable initBindlessTextureTable( VkDevice device, VkPhysicalDevice physicalDevice, VkSampler sampler, uint32_t capacity );
+void killBindlessTextureTable( VkDevice device, BindlessTextureTable& table );
+// returns the textureIndex for the view; slots not yet handed out may be written while frames are in flight
+uint32_t addBindlessTexture( VkDevice device, BindlessTextureTable& table, VkImageView view );
+// the slot must not be in use by pending command buffers; recorded ones stay valid
+void setBindlessTexture( VkDevice device, const BindlessTextureTable& table, uint32_t textureIndex, VkImageView view );
+
+// Virtual texturing: the feedback pass writes the page every pixel wants, the next updateVirtualTexture() reads it back,
+// loads the missing pages into the LRU page cache (VirtualTexture.h) and rewrites the indirection virtualTexture.frag looks them up in.
+// Pages live in the slots of one physical texture, or -- with sparse residency -- in memory bound to the virtual image itself.
+typedef std::function<void( const VirtualTextureLayout& layout, uint32_t page, uint32_t border, uint8_t* texels )> VirtualPageSource;
+struct VirtualTexture{
+	VirtualTextureLayout layout;
+	PageCache cache;
+	VirtualPageSource pageSource;
+	bool sparse;
+	VkQueue queue; // binds sparse memory; the graphics queue
+
+	Texture pages; // the physical page slots, or the sparse virtual image (memory = VK_NULL_HANDLE)
+	VkImageView pagesView;
+	VkSampler pagesSampler;
+	VkDeviceMemory sparsePageMemory; // slot i at i * sparsePageBytes
+	VkDeviceSize sparsePageBytes;
+	VkSemaphore sparseUnbound; // evicted pages are unbound before their memory is bound again
+	VkFence sparseBound;
+
+	Texture indirection; // RGBA8_UINT, a level per page level, a texel per page
+	VkImageView indirectionView;
+	VkSampler indirectionSampler;
+
+	VkBuffer stagingBuffer; // persistently mapped: virtualTextureUploadsPerFrame pages, then the indirection levels
+	VkDeviceMemory stagingBufferMemory;
+	uint8_t* staging;
+	vector<PageLoad> pendingLoads; // staged by updateVirtualTexture(), copied by recordVirtualTextureUploads()
+	uint64_t frame;
+
+	uint32_t feedbackWidth, feedbackHeight;
+	VkImage feedbackImage; // R32_UINT page ids (VirtualTexture.h)
+	VkDeviceMemory feedbackImageMemory;
+	VkImageView feedbackImageView;
+	VkImage feedbackDepthImage;
+	VkDeviceMemory feedbackDepthImageMemory;
+	VkImageView feedbackDepthImageView;
+	VkRenderPass feedbackRenderPass;
+	vector<VkFramebuffer> feedbackFramebuffers; // exactly one
+	VkBuffer feedbackBuffer; // host visible copy of feedbackImage
+	VkDeviceMemory feedbackBufferMemory;
+	const uint32_t* feedback;
+};
+struct VirtualTextureStats{
+	uint32_t requestedPages; // including the parents of the pages in the feedback
+	uint32_t loadedPages;
+	uint32_t residentPages;
+	double analysisMilliseconds; // feedback analysis and cache update
+	double loadMilliseconds; // page generation, indirection rebuild, sparse binds
+};
+// whether the queue family can bind and the device sample sparse resident 2D images of format in pages of pageSize^2 texels;
+// enables the features if so
+bool requestSparseResidencySupport( VkPhysicalDevice physicalDevice, uint32_t queueFamily, VkFormat format, uint32_t pageSize, VkPhysicalDeviceFeatures& features );
+// size: texels per side (power of two); the feedback target is the viewport divided by virtualTextureFeedbackScale
+VirtualTexture initVirtualTexture( VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, VkCommandPool commandPool, bool sparse, uint32_t size, VirtualPageSource pageSource, uint32_t viewportWidth, uint32_t viewportHeight );
+void killVirtualTexture( VkDevice device, VirtualTexture& virtualTexture );
+// binding 0 = uniform buffer, 1 = the pages, 2 = object buffer, 3 = the indirection -- the bindings of vertexShader.vert and virtualTexture.frag
+VkDescriptorSetLayout createVirtualTextureDescriptorSetLayout( VkDevice device );
+VkDescriptorSet createVirtualTextureDescriptorSet( VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, VkBuffer uniformBuffer, VkBuffer objectBuffer, const VirtualTexture& virtualTexture );
+// once per frame before recording, with the previous frame finished (its feedback is read, the staging memory and evicted pages reused)
+VirtualTextureStats updateVirtualTexture( VkDevice device, VirtualTexture& virtualTexture );
+// the staged pages and indirection; outside of a render pass, before the passes sampling the texture
+void recordVirtualTextureUploads( VkCommandBuffer commandBuffer, const VirtualTexture& virtualTexture );
+// the feedback pass: draw with pipelines made for feedbackRenderPass and virtualTextureFeedback.spv in between
+void recordBeginVirtualTextureFeedback( VkCommandBuffer commandBuffer, const VirtualTexture& virtualTexture );
+// ends the pass and copies the feedback to where updateVirtualTexture() reads it
+void recordEndVirtualTextureFeedback( VkCommandBuffer commandBuffer, const VirtualTexture& virtualTexture );
+
+// Resource cache: textures and buffers keyed by a hash of their content and import settings (ResourceCache.h), shared and
+// reference counted. Released resources stay resident until the budget is exceeded, then go least recently released first.
+// Decoded textures are written to the cache directory and listed in its index, so loading one again skips the decoding.
+struct CachedResource{
+	uint64_t key;
+	Texture texture; // image is VK_NULL_HANDLE for buffers
+	VkImageView view;
+	VkBuffer buffer;
+	VkDeviceMemory bufferMemory;
+	VkDeviceSize bytes; // counted against the budget
+	uint32_t references;
+	std::list<uint64_t>::iterator unusedPosition; // in ResourceCache::unused while references == 0
+};
+struct ResourceCacheStats{
+	uint32_t hits; // already resident
+	uint32_t diskHits; // decoded texture read back from the cache directory
+	uint32_t misses; // decoded (textures) or uploaded (buffers)
+	uint32_t evictions;
+};
+struct ResourceCache{
+	VkPhysicalDevice physicalDevice;
+	VkCommandPool commandPool; // uploads
+	VkQueue queue;
+	std::function<bool(VkFormat)> isSampleable;
+	string directory;
+	ResourceIndex index; // decoded textures in directory
+	VkDeviceSize budget;
+	VkDeviceSize residentBytes;
+	std::unordered_map<uint64_t, CachedResource> resources; // references to them stay valid until they are evicted
+	std::list<uint64_t> unused; // unreferenced keys, most recently released first
+	ResourceCacheStats stats;
+};
+// creates directory if need be and reads its index
+ResourceCache initResourceCache( VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const string& directory, VkDeviceSize budget );
+// kills every resource, referenced or not; none may be in use by the device
+void killResourceCache( VkDevice device, ResourceCache& cache );
+// BMP/TGA (mipmapped: mip chain filtered on the CPU) or KTX2; each acquire needs a releaseCachedResource() of the key
+const CachedResource& acquireCachedTexture( VkDevice device, ResourceCache& cache, const string& path, bool mipmapped );
+// host visible (device local where possible) buffer with a copy of data; resident only, not kept on disk
+const CachedResource& acquireCachedBuffer( VkDevice device, ResourceCache& cache, const void* data, VkDeviceSize size, VkBufferUsageFlags usage );
+// may evict right away when over budget -- release only once no pending command buffer uses the resource
+void releaseCachedResource( VkDevice device, ResourceCache& cache, uint64_t key );
+
+// Staging ring: one persistently mapped buffer uploads are written into back to back, wrapping around; the space is reused
+// once the submission reading it finished, so no upload needs a staging buffer of its own.
+struct StagingRing{
+	VkBuffer buffer; // TRANSFER_SRC and STORAGE_BUFFER, so compute shaders can read uploads in place
+	VkDeviceMemory memory;
+	uint8_t* mapped;
+	VkDeviceSize size;
+	VkDeviceSize head; // bytes ever allocated, offset = head % size
+	VkDeviceSize tail; // bytes ever handed back
+	std::deque<std::pair<VkFence, VkDeviceSize>> inFlight; // fence of a submission, head at its retireStaging()
+	vector<VkFence> freeFences;
+};
+StagingRing initStagingRing( VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size );
+// waits for the submissions in flight
+void killStagingRing( VkDevice device, StagingRing& ring );
+// offset of size bytes to write to; waits for the submissions still reading them, throws if they cannot fit at all
+VkDeviceSize allocateStaging( VkDevice device, StagingRing& ring, VkDeviceSize size, VkDeviceSize alignment = 16 );
+// the fence to submit the work reading everything allocated since the last call with; the ring owns and resets it
+VkFence retireStaging( VkDevice device, StagingRing& ring );
+
+// Image conversion: format conversion, resampling and mip generation in compute (convertImage.comp), for a batch of images
+// in one command buffer -- a dispatch per image and level, a barrier per level. Sources are read straight from the staging
+// ring; results are copied into images or into the readback buffer.
+enum class PixelFormat : uint32_t{ Bgr8, Rgba8, Rgba16f }; // = convertImage.comp
+enum class ResampleFilter : uint32_t{ Bilinear, Lanczos3 };
+struct ImageConversion{
+	VkDeviceSize sourceOffset; // in the staging ring, tightly packed rows
+	PixelFormat sourceFormat;
+	bool sourceSrgb; // 8 bit formats only, half is linear
+	uint32_t sourceWidth, sourceHeight;
+	PixelFormat destinationFormat; // Rgba8 or Rgba16f
+	bool destinationSrgb; // likewise
+	uint32_t width, height;
+	ResampleFilter filter; // for level 0 and, between the levels, for the mip chain
+	uint32_t mipLevels;
+	VkImage image; // R8G8B8A8 (UNORM or SRGB) or R16G16B16A16_SFLOAT with TRANSFER_DST usage; ends up in SHADER_READ_ONLY_OPTIMAL
+	               // VK_NULL_HANDLE: read back instead
+	VkDeviceSize readbackOffset; // set by recordImageConversions(): the levels, one after another at 16 byte alignment
+};
+struct ImageConverter{
+	VkDescriptorSetLayout descriptorSetLayout; // 0 = source, 1 = destination buffer
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet fromStaging; // staging ring -> output, for level 0
+	VkDescriptorSet fromOutput; // output -> output, for the mip levels
+	VkShaderModule shader;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+	VkBuffer output; // every level of a batch
+	VkDeviceMemory outputMemory;
+	VkBuffer readbackBuffer;
+	VkDeviceMemory readbackMemory;
+	const uint8_t* readback; // persistently mapped
+	VkDeviceSize capacity; // of output and readback
+};
+// capacity: bytes of all levels of a batch, clamped to maxStorageBufferRange; the ring must not be bigger than that either
+ImageConverter initImageConverter( VkDevice device, VkPhysicalDevice physicalDevice, const StagingRing& ring, VkDeviceSize capacity );
+void killImageConverter( VkDevice device, ImageConverter& converter );
+// throws if the batch does not fit into the capacity; the readback is valid once the submission finished
+void recordImageConversions( VkCommandBuffer commandBuffer, const ImageConverter& converter, vector<ImageConversion>& conversions );
+
+#if RUNTIME_SHADER_COMPILER
+// Shader hot reload: pipelines whose shaders (or the files those include) changed on disk are compiled and created again on
+// a background thread; the render loop only swaps the finished ones in, so a reload never stalls it for a compilation.
+struct ReloadablePipeline{
+	vector<ShaderSource> shaders;
+	std::function<VkPipeline( const vector<VkShaderModule>& )> create; // gets a module per shader, in order; runs on the reload thread
+	VkPipeline* pipeline; // replaced by applyReloadedPipelines()
+	std::set<string> dependencies; // of all the shaders, as of their last successful compilation
+};
+// what the reload thread hands back; pipeline is VK_NULL_HANDLE if it failed
+struct ReloadedPipeline{
+	size_t index; // into ShaderReloader::pipelines
+	VkPipeline pipeline;
+	std::set<string> dependencies;
+	string error;
+	double milliseconds;
+};
+struct ShaderReloadResults{
+	std::mutex mutex;
+	vector<ReloadedPipeline> pipelines;
+};
+struct ShaderReloader{
+	const ShaderCompiler* compiler;
+	ShaderWatcher watcher;
+	vector<ReloadablePipeline> pipelines;
+	std::shared_ptr<ShaderReloadResults> results;
+	std::unique_ptr<StreamingWorkers> worker; // one thread: the reloads of a pipeline finish in the order they were requested
+};
+ShaderReloader initShaderReloader( const ShaderCompiler& compiler, const string& directory );
+// waits for the reload running, if any
+void killShaderReloader( VkDevice device, ShaderReloader& reloader );
+// pipeline: created already, from the shaders as they are now
+void addReloadablePipeline( ShaderReloader& reloader, const vector<ShaderSource>& shaders, std::function<VkPipeline( const vector<VkShaderModule>& )> create, VkPipeline* pipeline );
+// starts reloads for changed files; true if reloaded pipelines wait for applyReloadedPipelines()
+bool updateShaderReloader( VkDevice device, ShaderReloader& reloader );
+// replaces (and kills) the pipelines -- only once no pending command buffer uses them; compile errors get logged, the old pipeline stays
+void applyReloadedPipelines( VkDevice device, ShaderReloader& reloader );
+#endif
+
+// Pipeline libraries (VK_EXT_graphics_pipeline_library): a pipeline in four parts -- vertex input, pre-rasterization shaders,
+// fragment shader and fragment output -- each created once for the part of GraphicsPipelineState it depends on and shared by
+// all pipelines with that part. Linking parts is quick enough for first use; the LINK_TIME_OPTIMIZATION link, as fast to draw
+// with as initPipeline()'s, is for the background.
+constexpr size_t pipelineLibraryPartCount = 4;
+struct PipelineLibraries{
+	VkDevice device;
+	VkPhysicalDeviceLimits limits;
+	VkPipelineCache pipelineCache;
+	std::unordered_map<uint64_t, VkPipeline> parts; // by part and the state it depends on
+};
+// enables VK_EXT_graphics_pipeline_library (chain libraryFeatures into initDevice()); false if unsupported -- use initPipeline() then
+// needs VK_KHR_get_physical_device_properties2 enabled on the instance
+bool requestPipelineLibrarySupport( VkPhysicalDevice physicalDevice, const vector<const char*>& layers, VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT& libraryFeatures, vector<const char*>& deviceExtensions );
+PipelineLibraries initPipelineLibraries( VkDevice device, const VkPhysicalDeviceLimits& limits, VkPipelineCache pipelineCache );
+// pipelines linked from the parts may outlive them, but none may be created from them any more
+void killPipelineLibraries( PipelineLibraries& libraries );
+// parts: VkGraphicsPipelineLibraryFlagBitsEXT; a library of just those parts of state, ready to be linked
+VkPipeline initPipelineLibrary( VkDevice device, const VkPhysicalDeviceLimits& limits, const GraphicsPipelineState& state, VkGraphicsPipelineLibraryFlagsEXT parts, VkPipelineCache pipelineCache = VK_NULL_HANDLE );
+// the four parts of state, the ones not made for an earlier state created now
+std::array<VkPipeline, pipelineLibraryPartCount> getPipelineLibraries( PipelineLibraries& libraries, const GraphicsPipelineState& state );
+// optimized: with VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT -- takes about as long as initPipeline(); without it just links
+VkPipeline linkPipelineLibraries( VkDevice device, const std::array<VkPipeline, pipelineLibraryPartCount>& parts, VkPipelineLayout pipelineLayout, bool optimized, VkPipelineCache pipelineCache = VK_NULL_HANDLE );
+
+// Pipeline registry: graphics pipelines by a hash of their whole state, so equal requests share one pipeline. New ones are
+// created on worker threads; until one is ready the caller draws with a fallback pipeline, or skips the draw.
+// With pipeline libraries a new pipeline is linked from its parts right away instead, and replaced once the workers made the optimized link.
+struct RegisteredPipeline{
+	VkPipeline pipeline; // VK_NULL_HANDLE while being created, or if the creation failed
+	bool pending;
+};
+// what the workers hand back
+struct CreatedPipeline{
+	uint64_t key;
+	VkPipeline pipeline;
+	string error;
+};
+struct PipelineRegistryResults{
+	std::mutex mutex;
+	std::condition_variable pipelineCreated;
+	vector<CreatedPipeline> pipelines;
+};
+struct PipelineRegistry{
+	VkDevice device;
+	VkPhysicalDeviceLimits limits;
+	VkPipelineCache pipelineCache;
+	std::unordered_map<uint64_t, RegisteredPipeline> pipelines;
+	std::shared_ptr<PipelineRegistryResults> results;
+	std::unique_ptr<StreamingWorkers> workers;
+	std::unique_ptr<PipelineLibraries> libraries; // null: monolithic initPipeline() on the workers
+	vector<VkPipeline> retiredPipelines; // linked ones the optimized link replaced
+	uint32_t requests; // all requestPipeline() calls, deduplicated ones included
+};
+// pipelineLibraries: only where requestPipelineLibrarySupport() returned true
+PipelineRegistry initPipelineRegistry( VkDevice device, const VkPhysicalDeviceLimits& limits, VkPipelineCache pipelineCache, bool pipelineLibraries = false, unsigned threadCount = std::max( 2u, std::thread::hardware_concurrency() ) - 1 );
+// waits for the creations already started; kills every pipeline of the registry
+void killPipelineRegistry( PipelineRegistry& registry );
+// once no pending command buffer uses the pipelines updatePipelineRegistry() replaced
+void killRetiredPipelines( PipelineRegistry& registry );
+// hashes the shader modules by handle and the render pass by its compatibility, not by handle
+uint64_t getPipelineStateKey( const GraphicsPipelineState& state );
+// the key to get the pipeline with; creation starts in the background unless the state is known already
+// with libraries, the parts of state not made yet are created before this returns (throws if they cannot be)
+uint64_t requestPipeline( PipelineRegistry& registry, const GraphicsPipelineState& state );
+// takes over the pipelines created since the last call (failures get logged); returns how many
+uint32_t updatePipelineRegistry( PipelineRegistry& registry );
+// VK_NULL_HANDLE if not ready (yet) -- skip the draw then
+VkPipeline getPipeline( const PipelineRegistry& registry, uint64_t key );
+// the fallback while not ready: a compatible pipeline (same layout and render pass) that is good enough for a few frames
+VkPipeline getPipelineOr( const PipelineRegistry& registry, uint64_t key, uint64_t fallbackKey );
+// blocks until created -- for the pipelines nothing can be drawn without, like the fallback itself; throws if the creation failed
+VkPipeline waitForPipeline( PipelineRegistry& registry, uint64_t key );
+
+// headless (no window, no swapchain) context for benchmarks
+struct HeadlessContext{
+	VkInstance instance;
+#if VULKAN_VALIDATION
+	DebugObjectVariant debugHandle;
+#endif
+	VkPhysicalDevice physicalDevice;
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
+	VkPhysicalDeviceFeatures enabledFeatures;
+	vector<const char*> enabledDeviceExtensions;
+	uint32_t graphicsQueueFamily;
+	uint32_t transferQueueFamily; // == graphicsQueueFamily without a transfer-only family
+	VkDevice device;
+	VkQueue graphicsQueue;
+	VkQueue transferQueue;
+	VkCommandPool commandPool;
+};
+// lets a benchmark pick device features and extensions once the physical device is known
+typedef std::function<void( VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures& features, vector<const char*>& deviceExtensions )> DeviceRequirements;
+// extensionFeatures: chained into initDevice(); read once deviceRequirements ran, so it can point it at the feature structs it filled in
+HeadlessContext initHeadless( const DeviceRequirements& deviceRequirements = nullptr, const void* const& extensionFeatures = nullptr );
+void killHeadless( HeadlessContext& context );
+uint32_t getGraphicsQueueFamily( VkPhysicalDevice physDevice );
+
+// color + depth render target standing in for the swapchain image
+struct OffscreenTarget{
+	uint32_t width, height;
+	VkImage colorImage;
+	VkDeviceMemory colorImageMemory;
+	VkImageView colorImageView;
+	VkImage depthImage;
+	VkDeviceMemory depthImageMemory;
+	VkImageView depthImageView;
+	VkRenderPass renderPass;
+	vector<VkFramebuffer> framebuffers; // exactly one, vector to fit initFramebuffers()
+};
+OffscreenTarget initOffscreenTarget( const HeadlessContext& context, uint32_t width, uint32_t height );
+void killOffscreenTarget( VkDevice device, OffscreenTarget& target );
+
+VkQueryPool initTimestampQueryPool( VkDevice device, uint32_t queryCount );
+void killQueryPool( VkDevice device, VkQueryPool queryPool );
+// returns milliseconds between timestamps [firstQuery] and [firstQuery + 1]
+double getTimestampDelta( VkDevice device, VkQueryPool queryPool, uint32_t firstQuery, float timestampPeriod );
+
+void submitAndWait( VkDevice device, VkQueue queue, VkCommandBuffer commandBuffer, VkFence fence );
+
+// what the benchmarks draw with unless they measure it: a target, one mesh, an object buffer (filled by the benchmark),
+// vulkan.texture.bmp, the UBO, the descriptor set and layout of createDescriptorSetLayout(), vertexShader + fragmentShader,
+// and a command buffer, fence and timestamp query pool to submit and time frames with
+struct HeadlessScene{
+	OffscreenTarget target;
+
+	uint32_t indexCount;
+	glm::vec4 boundingSphere;
+	VkBuffer vertexBuffer;
+	VkDeviceMemory vertexBufferMemory;
+	VkBuffer indexBuffer;
+	VkDeviceMemory indexBufferMemory;
+	VkBuffer objectBuffer;
+	VkDeviceMemory objectBufferMemory;
+
+	Texture texture;
+	VkImageView textureImageView;
+	VkSampler textureSampler;
+	VkBuffer uniformBuffer;
+	VkDeviceMemory uniformBufferMemory;
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+	VkPipelineLayout pipelineLayout;
+	VkShaderModule vertexShader;
+	VkShaderModule fragmentShader;
+
+	VkCommandBuffer commandBuffer; // out of context.commandPool
+	VkFence fence;
+	bool gpuTimestamps; // the graphics queue has them; queryPool is there either way
+	VkQueryPool queryPool; // 2 timestamps
+	std::array<VkClearValue, 2> clearValues;
+};
+// objectCount: the size of the object buffer, for the largest run
+HeadlessScene initHeadlessScene( const HeadlessContext& context, const IndexedMesh& mesh, uint32_t objectCount );
+void killHeadlessScene( VkDevice device, HeadlessScene& scene );
+
+// the states benchmarkPipelineRegistry() and benchmarkPipelineLibrary() draw: every combination of culling, blending, depth
+// handling and shader variant on top of defaultState -- all from the same two modules
+constexpr uint32_t benchmarkPipelineStateCount = 3 * 2 * 3 * 2 * 3;
+vector<GraphicsPipelineState> getBenchmarkPipelineStates( const GraphicsPipelineState& defaultState );
+
+int benchmarkInstancing();
+int benchmarkGpuDriven();
+int benchmarkMeshlets();
+int benchmarkLod();
+int benchmarkTextureFiltering();
+int benchmarkTextureStreaming();
+int benchmarkTextureAtlas();
+int benchmarkVirtualTexture();
+int benchmarkResourceCache();
+int benchmarkImageConversion();
+int benchmarkPipelineCache();
+int benchmarkResize();
+int benchmarkPipelineRegistry();
+int benchmarkPerDrawData();
+int benchmarkDescriptorAllocator();
+int benchmarkPipelineLibrary();
+
 
 // main()!
 //////////////////////////////////////////////////////////////////////////////////
@@ -319,66 +1151,22 @@ VkFormat findDepthFormat(VkPhysicalDevice physicalDevice) {
 	);
 };
 
-int start() try{
+int start(){
 	const uint32_t vertexBufferBinding = 0;
 
-	const std::vector<Vertex3D_UV> cube = {
-
-// Front face - два треугольника
-{{{-1.0f, -1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Bottom left
-{{{ 1.0f, -1.0f,  1.0f}}, {{1.0f, 1.0f}}}, // Bottom right
-{{{ 1.0f,  1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Top right
-
-{{{-1.0f, -1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Bottom left
-{{{ 1.0f,  1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Top right
-{{{-1.0f,  1.0f,  1.0f}}, {{0.0f, 0.0f}}}, // Top left
-
-// Back face - два треугольника (reverse texture coordinates)
-{{{ 1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f}}}, // Bottom right
-{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Bottom left
-{{{-1.0f,  1.0f, -1.0f}}, {{0.0f, 0.0f}}}, // Top left
-
-{{{ 1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f}}}, // Bottom right
-{{{-1.0f,  1.0f, -1.0f}}, {{0.0f, 0.0f}}}, // Top left
-{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Top right
-
-// Left face - два треугольника
-{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Bottom front
-{{{-1.0f, -1.0f,  1.0f}}, {{1.0f, 1.0f}}}, // Bottom back
-{{{-1.0f,  1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Top back
-
-{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Bottom front
-{{{-1.0f,  1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Top back
-{{{-1.0f,  1.0f, -1.0f}}, {{0.0f, 0.0f}}}, // Top front
-
-// Right face - два треугольника
-{{{ 1.0f, -1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Bottom front
-{{{ 1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f}}}, // Bottom back
-{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Top back
-
-{{{ 1.0f, -1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Bottom front
-{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Top back
-{{{ 1.0f,  1.0f,  1.0f}}, {{0.0f, 0.0f}}}, // Top front
-
-// Top face - два треугольника
-{{{-1.0f,  1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Front left
-{{{ 1.0f,  1.0f,  1.0f}}, {{1.0f, 1.0f}}}, // Front right
-{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Back right
-
-{{{-1.0f,  1.0f,  1.0f}}, {{0.0f, 1.0f}}}, // Front left
-{{{ 1.0f,  1.0f, -1.0f}}, {{1.0f, 0.0f}}}, // Back right
-{{{-1.0f,  1.0f, -1.0f}}, {{0.0f, 0.0f}}}, // Back left
-
-// Bottom face - два треугольника
-{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Front left
-{{{ 1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f}}}, // Front right
-{{{ 1.0f, -1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Back right
-
-{{{-1.0f, -1.0f, -1.0f}}, {{0.0f, 1.0f}}}, // Front left
-{{{ 1.0f, -1.0f,  1.0f}}, {{1.0f, 0.0f}}}, // Back right
-{{{-1.0f, -1.0f,  1.0f}}, {{0.0f, 0.0f}}}  // Back left
-
-	};
+	IndexedMesh cube = indexMesh( ::cubeVertices );
+	MeshletMesh cubeMeshlets{};
+	if( ::meshletCulling ){
+		cube = tessellateMesh( cube, ::denseCubeTessellation );
+		cubeMeshlets = buildMeshlets( cube );
+		cube.indices = cubeMeshlets.indices; // same triangles, meshlet order
+	}
+	LodMesh cubeLods{};
+	if( ::lodSelection ){
+		cube = tessellateMesh( cube, ::denseCubeTessellation );
+		cubeLods = buildLodChain( cube );
+		cube.indices = cubeLods.indices; // all levels, back to back
+	}
 
 	const auto supportedLayers = enumerate<VkInstance, VkLayerProperties>();
 	vector<const char*> requestedLayers;
@@ -447,6 +1235,7 @@ int start() try{
         throw std::runtime_error("failed to get SDL Vulkan extensions");
     }
 #endif
+	if( ::bindlessTextures ) requestedInstanceExtensions.push_back( VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME ); // to query the descriptor indexing features
 
 	//checkExtensionSupport(requestedInstanceExtensions, supportedInstanceExtensions);
 
@@ -493,13 +1282,33 @@ int start() try{
 	uint32_t graphicsQueueFamily, presentQueueFamily;
 	std::tie( graphicsQueueFamily, presentQueueFamily ) = getQueueFamilies( physicalDevice, surface );
 
-	const VkPhysicalDeviceFeatures features = {}; // don't need any special feature for this demo
-	const vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	VkPhysicalDeviceFeatures features = {}; // the plain instanced path doesn't need any special feature
+	vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+
+	const bool samplerAnisotropy = ::textureMaxAnisotropy > 1.0f && getPhysicalDeviceFeatures( physicalDevice ).samplerAnisotropy; // optional, just sharper
+	features.samplerAnisotropy = samplerAnisotropy;
+
+	const bool drawIndirectCount = ::gpuDrivenRendering && requestGpuDrivenSupport( physicalDevice, requestedLayers, features, deviceExtensions );
+	const bool multiDrawIndirect = ::lodSelection && requestLodDrawSupport( physicalDevice, features );
 
-	const VkDevice device = initDevice( physicalDevice, features, graphicsQueueFamily, presentQueueFamily, requestedLayers, deviceExtensions );
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+	if( ::bindlessTextures ) requestBindlessSupport( physicalDevice, requestedLayers, indexingFeatures, deviceExtensions );
+
+	const uint32_t transferQueueFamily = ::textureStreaming ? getTransferQueueFamily( physicalDevice, graphicsQueueFamily ) : graphicsQueueFamily;
+
+	const VkDevice device = initDevice( physicalDevice, features, graphicsQueueFamily, presentQueueFamily, requestedLayers, deviceExtensions, transferQueueFamily, ::bindlessTextures ? &indexingFeatures : nullptr );
 	const VkQueue graphicsQueue = getQueue( device, graphicsQueueFamily, 0 );
 	const VkQueue presentQueue = getQueue( device, presentQueueFamily, 0 );
-
+	const VkQueue transferQueue = getQueue( device, transferQueueFamily, 0 );
+
+	// warm: an earlier run left compiled pipelines behind
+	const VkPipelineCache pipelineCache = initPipelineCache( device, physicalDeviceProperties, ::pipelineCachePath );
+	bool pipelineCacheWarm;
+	{
+		size_t cacheSize;
+		VkResult errorCode = vkGetPipelineCacheData( device, pipelineCache, &cacheSize, nullptr ); RESULT_HANDLER( errorCode, "vkGetPipelineCacheData" );
+		pipelineCacheWarm = cacheSize > 4 * sizeof( uint32_t ) + VK_UUID_SIZE; // more than the header
+	}
 
 	VkSurfaceFormatKHR surfaceFormat = getSurfaceFormat( physicalDevice, surface );
 	VkRenderPass renderPass = initRenderPass(
@@ -508,49 +1317,143 @@ int start() try{
 		surfaceFormat
 	);
 
+#if RUNTIME_SHADER_COMPILER
+	ShaderCompiler shaderCompiler = initShaderCompiler( ::shaderCacheDirectory );
+	const ShaderSource vertexShaderSource{ "vertexShader.vert", {} };
+	const ShaderSource fragmentShaderSource{ "fragmentShader.frag", ::bindlessTextures ? vector<string>{ "BINDLESS_TEXTURES" } : vector<string>{} };
+	vector<char> vertexShaderCode, fragShaderCode;
+	{
+		vector<string> dependencies;
+		bool vertexShaderCached, fragmentShaderCached;
+		vertexShaderCode = compileShader( shaderCompiler, vertexShaderSource, dependencies, vertexShaderCached );
+		fragShaderCode = compileShader( shaderCompiler, fragmentShaderSource, dependencies, fragmentShaderCached );
+		logger << "shaders " << (vertexShaderCached && fragmentShaderCached ? "read from the shader cache" : "compiled") << std::endl;
+	}
+#else
     auto vertexShaderCode = readFile("vertexShader.spv");
-    auto fragShaderCode = readFile("fragmentShader.spv");
+    auto fragShaderCode = readFile( ::bindlessTextures ? "fragmentShaderBindless.spv" : "fragmentShader.spv" );
+#endif
 
 	VkCommandPool commandPool = initCommandPool( device, graphicsQueueFamily );
 
-    auto descriptorSetLayout = createDescriptorSetLayout(device);
-    auto descriptorPool = createDescriptorPool(device);
-	auto createTextureResult = createTextureImage(
-		"vulkan.texture.bmp",
-		device,
-		physicalDevice,
-		commandPool,
-		graphicsQueue
-	);
-	VkImage textureImage = std::get<0>(createTextureResult);
-	VkDeviceMemory textureImageMemory = std::get<1>(createTextureResult);
-	auto textureImageView = createTextureImageView(
-		device,
-		textureImage
-	);
+	// set 0 and the vertex input follow the shaders; bindless keeps the hand-written set 0 (createDescriptorSetLayout()), its
+	// shader no longer reads binding 1 but the set is written the same way -- and set 1 needs flags SPIR-V cannot express
+	const ShaderReflection shaderReflection = mergeShaderReflections( { reflectSpirv( vertexShaderCode ), reflectSpirv( fragShaderCode ) } );
+	DescriptorLayoutCache descriptorLayoutCache;
+	const VkDescriptorSetLayout descriptorSetLayout = ::bindlessTextures
+		? createDescriptorSetLayout( device )
+		: getDescriptorSetLayout( device, descriptorLayoutCache, getDescriptorSetLayoutBindings( shaderReflection, 0 ) );
+	// long-lived sets; grows by a pool of staticDescriptorSetsPerPool sets whenever one is full
+	const vector<VkDescriptorPoolSize> descriptorSetSizes = ::bindlessTextures
+		? vector<VkDescriptorPoolSize>{ { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 }, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 } }
+		: getDescriptorPoolSizes( shaderReflection, 1 );
+	DescriptorAllocator staticDescriptors = initDescriptorAllocator( device, descriptorSetSizes, ::staticDescriptorSetsPerPool );
+	// streamed: the placeholder now, the real texture over the next frames; otherwise loaded right here, through the resource cache
+	TextureStreamer textureStreamer{};
+	uint32_t streamedTexture = 0;
+	ResourceCache resourceCache{};
+	VkImageView textureImageView;
+	if( ::textureStreaming ){
+		textureStreamer = initTextureStreamer( device, physicalDevice, graphicsQueueFamily, graphicsQueue, transferQueueFamily, transferQueue );
+		streamedTexture = requestStreamedTexture( textureStreamer, ::texturePath, ::textureMipmaps );
+		textureImageView = getStreamedTextureView( textureStreamer, streamedTexture );
+	}
+	else{
+		resourceCache = initResourceCache( physicalDevice, commandPool, graphicsQueue, ::resourceCacheDirectory, ::resourceCacheBudget );
+		textureImageView = acquireCachedTexture( device, resourceCache, ::texturePath, ::textureMipmaps ).view;
+	}
 	auto textureSampler = createTextureSampler(
-		device
+		device,
+		samplerAnisotropy ? std::min( ::textureMaxAnisotropy, physicalDeviceProperties.limits.maxSamplerAnisotropy ) : 1.0f
 	);
 
+	// bindless: the objects carry the texture's slot in the table; set 0 keeps its combined image sampler, which the shader then ignores
+	BindlessTextureTable bindlessTextureTable{};
+	uint32_t textureIndex = 0;
+	if( ::bindlessTextures ){
+		bindlessTextureTable = initBindlessTextureTable( device, physicalDevice, textureSampler, ::bindlessTextureCapacity );
+		textureIndex = addBindlessTexture( device, bindlessTextureTable, textureImageView );
+	}
+
 	auto createUniformBufferResult = createUniformBuffer(device, physicalDevice);
 	VkBuffer uniformBuffer = std::get<0>(createUniformBufferResult);
 	VkDeviceMemory uniformBufferMemory = std::get<1>(createUniformBufferResult);
 
+	VkBuffer objectBuffer = initObjectBuffer( device, ::instanceCount );
+	VkDeviceMemory objectBufferMemory = initMemory<ResourceType::Buffer>(
+		device,
+		physicalDeviceMemoryProperties,
+		objectBuffer,
+		{
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		}
+	);
+	const glm::vec4 cubeBoundingSphere = computeBoundingSphere( cube.vertices );
+	const vector<ObjectData> objects = generateObjects( generateInstanceTransforms( ::instanceCount ), cubeBoundingSphere, textureIndex );
+	setObjectData( device, objectBufferMemory, objects );
+
     auto descriptorSet = createDescriptorSet(
 		uniformBuffer,
 		textureImageView,
 		textureSampler,
+		objectBuffer,
 		descriptorSetLayout,
-		descriptorPool,
-		device
+		staticDescriptors
 	);
 
+	GpuCulling gpuCulling{};
+	if( ::gpuDrivenRendering ){
+		gpuCulling = initGpuCulling(
+			device,
+			physicalDeviceProperties.limits,
+			physicalDeviceMemoryProperties,
+			uniformBuffer,
+			objectBuffer,
+			::instanceCount,
+			drawIndirectCount,
+			features.multiDrawIndirect == VK_TRUE,
+			::meshletCulling ? cubeMeshlets.meshlets : vector<Meshlet>{},
+			pipelineCache
+		);
+	}
+
+	LodDraws lodDraws{}; // a region per swapchain image, made with the swapchain
+	FrameTransforms frameTransforms{}; // of the frame render() submits, for its LOD selection
+
     VkShaderModule vertexShader = createShaderModule(device, vertexShaderCode);
     VkShaderModule fragmentShader = createShaderModule(device,fragShaderCode);    
 
-	VkPipelineLayout pipelineLayout = initPipelineLayout(device, descriptorSetLayout);
+	VkPipelineLayout pipelineLayout = ::bindlessTextures
+		? initPipelineLayout( device, vector<VkDescriptorSetLayout>{ descriptorSetLayout, bindlessTextureTable.descriptorSetLayout } )
+		: getReflectedPipelineLayout( device, descriptorLayoutCache, shaderReflection );
+
+	GraphicsPipelineState pipelineState = getDefaultPipelineState( pipelineLayout, renderPass, vertexShader, fragmentShader, vertexBufferBinding );
+	if( getVertexInputAttributes( shaderReflection, vertexBufferBinding, pipelineState.vertexAttributes ) > sizeof( Vertex3D_UV ) ){
+		throw "vertex shader inputs do not fit into Vertex3D_UV!";
+	}
+
+	// once: viewport and scissor are dynamic, so the pipeline survives swapchain recreation
+	VkPipeline pipeline;
+	{
+		const auto pipelineStart = std::chrono::high_resolution_clock::now();
+		pipeline = initPipeline( device, physicalDeviceProperties.limits, pipelineState, pipelineCache );
+		const double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - pipelineStart ).count();
+		logger << "graphics pipeline created in " << milliseconds << " ms, " << (pipelineCacheWarm ? "warm" : "cold") << " pipeline cache" << std::endl;
+	}
 
-	VkBuffer vertexBuffer = initBuffer( device, sizeof(decltype(cube)::value_type ) * cube.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT );
+#if RUNTIME_SHADER_COMPILER
+	ShaderReloader shaderReloader = initShaderReloader( shaderCompiler, ::shaderSourceDirectory );
+	// the layouts stay: a reload that changes bindings or vertex inputs needs a restart
+	addReloadablePipeline( shaderReloader, { vertexShaderSource, fragmentShaderSource }, [=]( const vector<VkShaderModule>& modules ){
+		GraphicsPipelineState reloadedState = pipelineState;
+		reloadedState.vertexShader = modules[0];
+		reloadedState.fragmentShader = modules[1];
+		return initPipeline( device, physicalDeviceProperties.limits, reloadedState, pipelineCache );
+	}, &pipeline );
+#endif
+
+	VkBuffer vertexBuffer = initBuffer( device, sizeof( Vertex3D_UV ) * cube.vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT );
 	const std::vector<VkMemoryPropertyFlags> memoryTypePriority{
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // preferably wanna device-side memory that can be updated from host without hassle
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT // guaranteed to allways be supported
@@ -561,7 +1464,16 @@ int start() try{
 		vertexBuffer,
 		memoryTypePriority
 	);
-	setVertexData( device, vertexBufferMemory, cube ); // Writes throug memory map. Synchronization is implicit for any subsequent vkQueueSubmit batches.
+	setVertexData( device, vertexBufferMemory, cube.vertices ); // Writes throug memory map. Synchronization is implicit for any subsequent vkQueueSubmit batches.
+
+	VkBuffer indexBuffer = initBuffer( device, sizeof( uint32_t ) * cube.indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT );
+	VkDeviceMemory indexBufferMemory = initMemory<ResourceType::Buffer>(
+		device,
+		physicalDeviceMemoryProperties,
+		indexBuffer,
+		memoryTypePriority
+	);
+	setMemoryData(  device, indexBufferMemory, const_cast<uint32_t*>( cube.indices.data() ), sizeof( uint32_t ) * cube.indices.size()  );
 
 	// might need synchronization if init is more advanced than this
 	//VkResult errorCode = vkDeviceWaitIdle( device ); RESULT_HANDLER( errorCode, "vkDeviceWaitIdle" );
@@ -571,8 +1483,12 @@ int start() try{
 	VkSwapchainKHR swapchain = VK_NULL_HANDLE; // has to be NULL -- signifies that there's no swapchain
 	vector<VkImageView> swapchainImageViews;
 	vector<VkFramebuffer> framebuffers;
+	VkImage depthImage = VK_NULL_HANDLE;
+	VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
+	VkImageView depthImageView = VK_NULL_HANDLE;
+
+	VkExtent2D swapchainExtent = {};
 
-	VkPipeline pipeline = VK_NULL_HANDLE; // has to be NULL for the case the app ends before even first swapchain
 	vector<VkCommandBuffer> commandBuffers;
 
 	vector<VkSemaphore> imageReadySs;
@@ -584,11 +1500,58 @@ int start() try{
 	const uint32_t maxInflightSubmissions = 2; // more than 2 probably does not make much sense
 	uint32_t submissionNr = 0; // index of the current submission modulo maxInflightSubmission
 	vector<VkFence> submissionFences;
-
+	vector<VkFence> imageFences; // per swapchain image: the submission fence of the last frame that used it, VK_NULL_HANDLE if none
+
+
+	// one command buffer per swapchain image; recorded once per swapchain, or again when the texture descriptor changes
+	const std::function<void(void)> recordCommandBuffers = [&](){
+		std::array<VkClearValue, 2> clearValues{};
+		clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+		clearValues[1].depthStencil = {1.0f, 0};
+
+		for( size_t i = 0; i < commandBuffers.size(); ++i ){
+			beginCommandBuffer( commandBuffers[i] );
+				if( ::gpuDrivenRendering ) recordCullObjects( commandBuffers[i], gpuCulling, ::instanceCount, static_cast<uint32_t>( cube.indices.size() ) );
+
+				recordBeginRenderPass(
+					commandBuffers[i],
+					renderPass,
+					framebuffers[i],
+					clearValues.data(),
+					swapchainExtent.width,
+					swapchainExtent.height
+				);
+
+				recordBindPipeline(commandBuffers[i], pipeline );
+				recordBindVertexBuffer(commandBuffers[i], vertexBufferBinding, vertexBuffer );
+				recordBindIndexBuffer( commandBuffers[i], indexBuffer );
+				updateUniformBuffer(uniformBufferMemory, device);
+
+				vkCmdBindDescriptorSets(
+					commandBuffers[i], 
+					VK_PIPELINE_BIND_POINT_GRAPHICS, 
+					pipelineLayout, 
+					0, 
+					1, 
+					&descriptorSet, 
+					0, 
+					nullptr
+				);
+				if( ::bindlessTextures ) vkCmdBindDescriptorSets( commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &bindlessTextureTable.descriptorSet, 0, nullptr );
+
+				if( ::gpuDrivenRendering ) recordDrawCulledObjects( commandBuffers[i], gpuCulling, ::instanceCount );
+				else if( ::lodSelection ) recordDrawLods( commandBuffers[i], lodDraws, static_cast<uint32_t>( i ), ::instanceCount );
+				else recordDrawIndexed( commandBuffers[i], static_cast<uint32_t>( cube.indices.size() ), ::instanceCount );
+
+				recordEndRenderPass( commandBuffers[i] );
+			endCommandBuffer(commandBuffers[i]);
+		}
+	};
 
 	const std::function<bool(void)> recreateSwapchain = [&](){
 		// swapchain recreation -- will be done before the first frame too;
 		TODO( "This may be triggered from many sources (e.g. WM_SIZE event, and VK_ERROR_OUT_OF_DATE_KHR too). Should prevent duplicate swapchain recreation." )
+		const auto recreationStart = std::chrono::high_resolution_clock::now();
 
 		const VkSwapchainKHR oldSwapchain = swapchain;
 		swapchain = VK_NULL_HANDLE;
@@ -626,8 +1589,10 @@ int start() try{
 			// only reset + later reuse already allocated and create new only if needed
 			{VkResult errorCode = vkResetCommandPool( device, commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
 
-			killPipeline( device, pipeline );
 			killFramebuffers( device, framebuffers );
+			killImageView( device, depthImageView );
+			killImage( device, depthImage );
+			killMemory( device, depthImageMemory );
 			killSwapchainImageViews( device, swapchainImageViews );
 
 			// kill oldSwapchain later, after it is potentially used by vkCreateSwapchainKHR
@@ -649,14 +1614,12 @@ int start() try{
 
 			VkFormat depthFormat = findDepthFormat(physicalDevice);
 
-			VkImage depthImage;
-			VkDeviceMemory depthImageMemory;
-
 			createImage(
 				device,
 				physicalDevice,
-				screenWidth,
-				screenHeight,
+				surfaceSize.width,
+				surfaceSize.height,
+				1, // mip levels
 				depthFormat,
 				VK_IMAGE_TILING_OPTIMAL,
 				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
@@ -665,7 +1628,7 @@ int start() try{
 				depthImageMemory
 			);
 
-			VkImageView depthImageView = createImageView(
+			depthImageView = createImageView(
 				device,
 				depthImage,
 				depthFormat,
@@ -687,53 +1650,15 @@ int start() try{
 				surfaceSize.height
 			);
 
-			pipeline = initPipeline(
-				device,
-				physicalDeviceProperties.limits,
-				pipelineLayout,
-				renderPass,
-				vertexShader,
-				fragmentShader,
-				vertexBufferBinding,
-				surfaceSize.width, surfaceSize.height
-			);
-
-			std::array<VkClearValue, 2> clearValues{};
-			clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
-			clearValues[1].depthStencil = {1.0f, 0};
+			swapchainExtent = surfaceSize;
+			// the device is idle here -- waited for above, or nothing was submitted yet
+			if( ::lodSelection && lodDraws.regionCount != swapchainImages.size() ){
+				if( lodDraws.regionCount ) killLodDraws( device, lodDraws );
+				lodDraws = initLodDraws( device, physicalDeviceMemoryProperties, ::instanceCount, multiDrawIndirect, static_cast<uint32_t>( swapchainImages.size() ) );
+			}
 
 			acquireCommandBuffers(device, commandPool, static_cast<uint32_t>( swapchainImages.size() ), commandBuffers  );
-			for( size_t i = 0; i < swapchainImages.size(); ++i ){
-				beginCommandBuffer( commandBuffers[i] );
-					recordBeginRenderPass(
-						commandBuffers[i],
-						renderPass,
-						framebuffers[i],
-						clearValues.data(),
-						surfaceSize.width,
-						surfaceSize.height
-					);
-
-					recordBindPipeline(commandBuffers[i], pipeline );
-					recordBindVertexBuffer(commandBuffers[i], vertexBufferBinding, vertexBuffer );
-					updateUniformBuffer(uniformBufferMemory, device);
-
-					vkCmdBindDescriptorSets(
-						commandBuffers[i], 
-						VK_PIPELINE_BIND_POINT_GRAPHICS, 
-						pipelineLayout, 
-						0, 
-						1, 
-						&descriptorSet, 
-						0, 
-						nullptr
-					);
-
-					recordDraw(commandBuffers[i], static_cast<uint32_t>(cube.size()));
-
-					recordEndRenderPass( commandBuffers[i] );
-				endCommandBuffer(commandBuffers[i]);
-			}
+			recordCommandBuffers();
 
 			imageReadySs = initSemaphores( device, maxInflightSubmissions );
 			// per https://github.com/KhronosGroup/Vulkan-Docs/issues/1150 need upto swapchain-image count
@@ -741,6 +1666,7 @@ int start() try{
 
 			submissionFences = initFences( device, maxInflightSubmissions, VK_FENCE_CREATE_SIGNALED_BIT ); // signaled fence means previous execution finished, so we start rendering presignaled
 			submissionNr = 0;
+			imageFences.assign( swapchainImages.size(), VK_NULL_HANDLE );
 		}
 
 		if( oldSwapchain ){
@@ -749,6 +1675,9 @@ int start() try{
 			// per current spec, we can't really be sure these are not used :/ at least kill them after the swapchain
 			// https://github.com/KhronosGroup/Vulkan-Docs/issues/152
 			killSemaphores( device, oldImageReadySs );
+
+			const double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - recreationStart ).count();
+			logger << "swapchain recreated in " << milliseconds << " ms" << std::endl;
 		}
 
 		return swapchain != VK_NULL_HANDLE;
@@ -772,6 +1701,15 @@ int start() try{
 			uint32_t nextSwapchainImageIndex = getNextImageIndex( device, swapchain, imageReadySs[submissionNr] );
 			unsafeSemaphore = false;
 
+			// the image's command buffer (and its LOD draws) may still be in use by an older submission than the one waited for above
+			const VkFence imageFence = imageFences[nextSwapchainImageIndex];
+			if( imageFence && imageFence != submissionFences[submissionNr] ){
+				VkResult errorCode = vkWaitForFences( device, 1, &imageFence, VK_TRUE, UINT64_MAX ); RESULT_HANDLER( errorCode, "vkWaitForFences" );
+			}
+			imageFences[nextSwapchainImageIndex] = submissionFences[submissionNr];
+
+			if( ::lodSelection ) updateLodDraws( lodDraws, nextSwapchainImageIndex, cubeLods.lods, objects, cubeBoundingSphere.w, frameTransforms, static_cast<float>( screenHeight ) );
+
 			submitToQueue( graphicsQueue, commandBuffers[nextSwapchainImageIndex], imageReadySs[submissionNr], renderDoneSs[nextSwapchainImageIndex], submissionFences[submissionNr] );
 			present( presentQueue, swapchain, nextSwapchainImageIndex, renderDoneSs[nextSwapchainImageIndex] );
 
@@ -800,7 +1738,35 @@ int start() try{
         (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE) == false
     ) {
         SDL_PollEvent(&event);
-		updateUniformBuffer(uniformBufferMemory, device);
+
+		if( ::textureStreaming && updateTextureStreamer( device, textureStreamer, ::textureStreamingBudget ) ){
+			// the prerecorded command buffers use descriptorSet -- it may only change once they are done, and they have to be recorded again after
+			// (bindless: the slot may only change once they are done too, but update-after-bind leaves them valid)
+			{VkResult errorCode = vkQueueWaitIdle( graphicsQueue ); RESULT_HANDLER( errorCode, "vkQueueWaitIdle" );}
+			if( ::bindlessTextures ) setBindlessTexture( device, bindlessTextureTable, textureIndex, getStreamedTextureView( textureStreamer, streamedTexture ) );
+			else updateTextureDescriptor( device, descriptorSet, getStreamedTextureView( textureStreamer, streamedTexture ), textureSampler );
+			killRetiredTextureViews( device, textureStreamer );
+
+			if( !::bindlessTextures && swapchain ){
+				{VkResult errorCode = vkResetCommandPool( device, commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+				recordCommandBuffers();
+			}
+		}
+
+#if RUNTIME_SHADER_COMPILER
+		if( updateShaderReloader( device, shaderReloader ) ){
+			// as with a streamed texture: the prerecorded command buffers use the old pipeline until they are done
+			{VkResult errorCode = vkQueueWaitIdle( graphicsQueue ); RESULT_HANDLER( errorCode, "vkQueueWaitIdle" );}
+			applyReloadedPipelines( device, shaderReloader );
+
+			if( swapchain ){
+				{VkResult errorCode = vkResetCommandPool( device, commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+				recordCommandBuffers();
+			}
+		}
+#endif
+
+		frameTransforms = updateUniformBuffer(uniformBufferMemory, device);
         render();
     }
 
@@ -817,9 +1783,10 @@ int start() try{
 
 	// command buffers killed with pool
 
-	killPipeline( device, pipeline );
-
 	killFramebuffers( device, framebuffers );
+	killImageView( device, depthImageView );
+	killImage( device, depthImage );
+	killMemory( device, depthImageMemory );
 
 	killSwapchainImageViews( device, swapchainImageViews );
 	killSwapchain( device, swapchain );
@@ -834,15 +1801,41 @@ int start() try{
 
 	killCommandPool( device,  commandPool );
 
+	if( ::gpuDrivenRendering ) killGpuCulling( device, gpuCulling );
+	if( ::lodSelection && lodDraws.regionCount ) killLodDraws( device, lodDraws );
+	if( ::bindlessTextures ) killBindlessTextureTable( device, bindlessTextureTable );
+
+	if( ::textureStreaming ) killTextureStreamer( device, textureStreamer );
+	else killResourceCache( device, resourceCache );
+
+	killBuffer( device, indexBuffer );
+	killMemory( device, indexBufferMemory );
 	killBuffer( device, vertexBuffer );
 	killMemory( device, vertexBufferMemory );
 
-	killPipelineLayout( device, pipelineLayout );
+	killBuffer( device, objectBuffer );
+	killMemory( device, objectBufferMemory );
+
+#if RUNTIME_SHADER_COMPILER
+	killShaderReloader( device, shaderReloader );
+	killShaderCompiler( shaderCompiler );
+#endif
+
+	killPipeline( device, pipeline );
+	if( ::bindlessTextures ){
+		killPipelineLayout( device, pipelineLayout );
+		vkDestroyDescriptorSetLayout( device, descriptorSetLayout, nullptr );
+	}
+	killDescriptorLayoutCache( device, descriptorLayoutCache );
+	killDescriptorAllocator( staticDescriptors );
 	killShaderModule( device, fragmentShader );
 	killShaderModule( device, vertexShader );
 
 	killRenderPass( device, renderPass );
 
+	savePipelineCache( device, pipelineCache, ::pipelineCachePath );
+	killPipelineCache( device, pipelineCache );
+
 	killDevice( device );
 
 	killSurface( instance, surface );
@@ -855,6 +1848,11 @@ int start() try{
 
 	return exitStatus;
 }
+
+// runs an entry point (the windowed app or one of the benchmarks) and reports whatever it throws
+int runGuarded( const std::function<int(void)>& entryPoint ) try{
+	return entryPoint();
+}
 catch( VulkanResultException vkE ){
 	logger << "ERROR: Terminated due to an uncaught VkResult exception: "
 	       << vkE.file << ":" << vkE.line << ":" << vkE.func << "() " << vkE.source << "() returned " << to_string( vkE.result )
@@ -881,11 +1879,34 @@ catch( ... ){
 
 #if defined(_WIN32) && !defined(_CONSOLE)
 int WINAPI WinMain( HINSTANCE, HINSTANCE, LPSTR, int ){
-	return helloTriangle();
+	return runGuarded( start );
 }
 #else
-int main(){
-	return start();
+int main( int argc, char* argv[] ){
+	const string mode = argc > 1 ? argv[1] : "";
+
+	if( mode == "--benchmark-instancing" ) return runGuarded( benchmarkInstancing );
+	else if( mode == "--benchmark-gpu-driven" ) return runGuarded( benchmarkGpuDriven );
+	else if( mode == "--benchmark-meshlets" ) return runGuarded( benchmarkMeshlets );
+	else if( mode == "--benchmark-lod" ) return runGuarded( benchmarkLod );
+	else if( mode == "--benchmark-texture-filtering" ) return runGuarded( benchmarkTextureFiltering );
+	else if( mode == "--benchmark-texture-streaming" ) return runGuarded( benchmarkTextureStreaming );
+	else if( mode == "--benchmark-texture-atlas" ) return runGuarded( benchmarkTextureAtlas );
+	else if( mode == "--benchmark-virtual-texture" ) return runGuarded( benchmarkVirtualTexture );
+	else if( mode == "--benchmark-resource-cache" ) return runGuarded( benchmarkResourceCache );
+	else if( mode == "--benchmark-image-conversion" ) return runGuarded( benchmarkImageConversion );
+	else if( mode == "--benchmark-pipeline-cache" ) return runGuarded( benchmarkPipelineCache );
+	else if( mode == "--benchmark-resize" ) return runGuarded( benchmarkResize );
+	else if( mode == "--benchmark-pipeline-registry" ) return runGuarded( benchmarkPipelineRegistry );
+	else if( mode == "--benchmark-per-draw-data" ) return runGuarded( benchmarkPerDrawData );
+	else if( mode == "--benchmark-descriptor-allocator" ) return runGuarded( benchmarkDescriptorAllocator );
+	else if( mode == "--benchmark-pipeline-library" ) return runGuarded( benchmarkPipelineLibrary );
+	else if( !mode.empty() ){
+		logger << "Usage: " << argv[0] << " [--benchmark-instancing | --benchmark-gpu-driven | --benchmark-meshlets | --benchmark-lod | --benchmark-texture-filtering | --benchmark-texture-streaming | --benchmark-texture-atlas | --benchmark-virtual-texture | --benchmark-resource-cache | --benchmark-image-conversion | --benchmark-pipeline-cache | --benchmark-resize | --benchmark-pipeline-registry | --benchmark-per-draw-data | --benchmark-descriptor-allocator | --benchmark-pipeline-library]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return runGuarded( start );
 }
 #endif
 
@@ -907,7 +1928,14 @@ VkDescriptorSetLayout createDescriptorSetLayout(VkDevice device) {
     samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     samplerLayoutBinding.pImmutableSamplers = nullptr; // Optional
 
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+    VkDescriptorSetLayoutBinding objectLayoutBinding{};
+    objectLayoutBinding.binding = 2;
+    objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    objectLayoutBinding.descriptorCount = 1;
+    objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    objectLayoutBinding.pImmutableSamplers = nullptr; // Optional
+
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings = {uboLayoutBinding, samplerLayoutBinding, objectLayoutBinding};
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -922,11 +1950,13 @@ VkDescriptorSetLayout createDescriptorSetLayout(VkDevice device) {
 }
 
 VkDescriptorPool createDescriptorPool(VkDevice device) {
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     poolSizes[0].descriptorCount = 1;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     poolSizes[1].descriptorCount = 1;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = 1;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -941,10 +1971,73 @@ VkDescriptorPool createDescriptorPool(VkDevice device) {
 	return descriptorPool;
 }
 
+VkDescriptorPool createDescriptorPool( VkDevice device, const vector<VkDescriptorPoolSize>& poolSizes, uint32_t maxSets ){
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = maxSets;
+	poolInfo.poolSizeCount = static_cast<uint32_t>( poolSizes.size() );
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool descriptorPool;
+	{VkResult errorCode = vkCreateDescriptorPool( device, &poolInfo, nullptr, &descriptorPool ); RESULT_HANDLER( errorCode, "vkCreateDescriptorPool" );}
+	return descriptorPool;
+}
+
+VkDescriptorSetLayout getDescriptorSetLayout( VkDevice device, DescriptorLayoutCache& cache, const vector<VkDescriptorSetLayoutBinding>& bindings ){
+	vector<uint64_t> values;
+	for( const VkDescriptorSetLayoutBinding& binding : bindings ){
+		values.insert( values.end(), { binding.binding, uint64_t( binding.descriptorType ), binding.descriptorCount, binding.stageFlags } );
+	}
+	const uint64_t key = xxHash64( values.data(), values.size() * sizeof( uint64_t ) );
+
+	const auto known = cache.setLayouts.find( key );
+	if( known != cache.setLayouts.end() ) return known->second;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>( bindings.size() );
+	layoutInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	{VkResult errorCode = vkCreateDescriptorSetLayout( device, &layoutInfo, nullptr, &descriptorSetLayout ); RESULT_HANDLER( errorCode, "vkCreateDescriptorSetLayout" );}
+	cache.setLayouts[key] = descriptorSetLayout;
+	return descriptorSetLayout;
+}
+
+VkPipelineLayout getReflectedPipelineLayout( VkDevice device, DescriptorLayoutCache& cache, const ShaderReflection& reflection ){
+	vector<VkDescriptorSetLayout> setLayouts;
+	for( uint32_t set = 0; set < getReflectedSetCount( reflection ); ++set ){
+		setLayouts.push_back(  getDescriptorSetLayout( device, cache, getDescriptorSetLayoutBindings( reflection, set ) )  );
+	}
+
+	// the set layouts are cached, so their handles stand for their bindings
+	vector<uint64_t> values;
+	for( VkDescriptorSetLayout setLayout : setLayouts ) values.push_back( getHandleValue( setLayout ) );
+	for( const VkPushConstantRange& range : reflection.pushConstantRanges ){
+		values.insert( values.end(), { range.stageFlags, range.offset, range.size } );
+	}
+	const uint64_t key = xxHash64( values.data(), values.size() * sizeof( uint64_t ) );
+
+	const auto known = cache.pipelineLayouts.find( key );
+	if( known != cache.pipelineLayouts.end() ) return known->second;
+
+	const VkPipelineLayout pipelineLayout = initPipelineLayout( device, setLayouts, reflection.pushConstantRanges );
+	cache.pipelineLayouts[key] = pipelineLayout;
+	return pipelineLayout;
+}
+
+void killDescriptorLayoutCache( VkDevice device, DescriptorLayoutCache& cache ){
+	for( const auto& pipelineLayout : cache.pipelineLayouts ) killPipelineLayout( device, pipelineLayout.second );
+	for( const auto& setLayout : cache.setLayouts ) vkDestroyDescriptorSetLayout( device, setLayout.second, nullptr );
+	cache.pipelineLayouts.clear();
+	cache.setLayouts.clear();
+}
+
 VkDescriptorSet createDescriptorSet(
     VkBuffer uniformBuffer,
     VkImageView textureImageView,
     VkSampler textureSampler,
+    VkBuffer objectBuffer,
     VkDescriptorSetLayout descriptorSetLayout,
     VkDescriptorPool descriptorPool,
     VkDevice device
@@ -962,17 +2055,41 @@ VkDescriptorSet createDescriptorSet(
         throw std::runtime_error("failed to allocate descriptor set!");
     }
 
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = uniformBuffer;
-    bufferInfo.offset = 0;
-    bufferInfo.range = sizeof(UniformBufferObject);
+	writeDescriptorSet( device, descriptorSet, uniformBuffer, textureImageView, textureSampler, objectBuffer );
+    return descriptorSet;
+}
+
+VkDescriptorSet createDescriptorSet(
+	VkBuffer uniformBuffer,
+	VkImageView textureImageView,
+	VkSampler textureSampler,
+	VkBuffer objectBuffer,
+	VkDescriptorSetLayout descriptorSetLayout,
+	DescriptorAllocator& allocator
+){
+	const VkDescriptorSet descriptorSet = allocateDescriptorSet( allocator, descriptorSetLayout );
+	writeDescriptorSet( allocator.device, descriptorSet, uniformBuffer, textureImageView, textureSampler, objectBuffer );
+	return descriptorSet;
+}
+
+// the bindings of createDescriptorSetLayout()
+void writeDescriptorSet( VkDevice device, VkDescriptorSet descriptorSet, VkBuffer uniformBuffer, VkImageView textureImageView, VkSampler textureSampler, VkBuffer objectBuffer ){
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = uniformBuffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(UniformBufferObject);
 
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     imageInfo.imageView = textureImageView;
     imageInfo.sampler = textureSampler;
 
-    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    VkDescriptorBufferInfo objectBufferInfo{};
+    objectBufferInfo.buffer = objectBuffer;
+    objectBufferInfo.offset = 0;
+    objectBufferInfo.range = VK_WHOLE_SIZE;
+
+    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrites[0].dstSet = descriptorSet;
     descriptorWrites[0].dstBinding = 0;
@@ -989,9 +2106,30 @@ VkDescriptorSet createDescriptorSet(
     descriptorWrites[1].descriptorCount = 1;
     descriptorWrites[1].pImageInfo = &imageInfo;
 
+    descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[2].dstSet = descriptorSet;
+    descriptorWrites[2].dstBinding = 2;
+    descriptorWrites[2].dstArrayElement = 0;
+    descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[2].descriptorCount = 1;
+    descriptorWrites[2].pBufferInfo = &objectBufferInfo;
+
     vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
 
-    return descriptorSet;
+void updateTextureDescriptor( VkDevice device, VkDescriptorSet descriptorSet, VkImageView textureImageView, VkSampler textureSampler ){
+	const VkDescriptorImageInfo imageInfo{ textureSampler, textureImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSet;
+	descriptorWrite.dstBinding = 1;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets( device, 1, &descriptorWrite, 0, nullptr );
 }
 
 void endSingleTimeCommands(VkQueue graphicsQueue, VkCommandPool commandPool, VkDevice device, VkCommandBuffer commandBuffer) {
@@ -1096,7 +2234,7 @@ void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize
     vkBindBufferMemory(device, buffer, bufferMemory, 0);
 }
 
-void updateUniformBuffer(VkDeviceMemory uniformBufferMemory, VkDevice device) {
+FrameTransforms updateUniformBuffer(VkDeviceMemory uniformBufferMemory, VkDevice device) {
     static auto startTime = std::chrono::high_resolution_clock::now();
 
     auto currentTime = std::chrono::high_resolution_clock::now();
@@ -1118,6 +2256,8 @@ void updateUniformBuffer(VkDeviceMemory uniformBufferMemory, VkDevice device) {
     vkMapMemory(device, uniformBufferMemory, 0, sizeof(ubo), 0, &data);
     memcpy(data, &ubo, sizeof(ubo));
     vkUnmapMemory(device, uniformBufferMemory);
+
+	return { model, view, proj };
 }
 
 std::tuple<VkBuffer, VkDeviceMemory> createUniformBuffer(VkDevice device, VkPhysicalDevice physicalDevice) {
@@ -1134,7 +2274,7 @@ std::tuple<VkBuffer, VkDeviceMemory> createUniformBuffer(VkDevice device, VkPhys
 	return std::make_tuple(uniformBuffer, uniformBufferMemory);
 }
 
-void transitionImageLayout(VkQueue graphicsQueue, VkCommandPool commandPool, VkDevice device, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
+void transitionImageLayout(VkQueue graphicsQueue, VkCommandPool commandPool, VkDevice device, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands(commandPool, device);
 
     VkImageMemoryBarrier barrier{};
@@ -1146,7 +2286,7 @@ void transitionImageLayout(VkQueue graphicsQueue, VkCommandPool commandPool, VkD
     barrier.image = image;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -1181,20 +2321,35 @@ void transitionImageLayout(VkQueue graphicsQueue, VkCommandPool commandPool, VkD
     endSingleTimeCommands(graphicsQueue, commandPool, device, commandBuffer);
 }
 
-std::tuple<VkImage, VkDeviceMemory> createTextureImage(const char *imagePath, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue) {
-    SDL_Surface* surface = SDL_LoadBMP(imagePath);
-    if (!surface) {
-        throw std::runtime_error("failed to load texture image!");
-    }
+Texture createTextureImage(const char *imagePath, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue, bool mipmapped) {
+	const std::vector<char> file = readFile( imagePath );
+	const uint8_t* fileBytes = reinterpret_cast<const uint8_t*>( file.data() );
 
-    // Конвертация пикселей из BGR в RGBA
-    SDL_Surface* rgbaSurface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
-    if (!rgbaSurface) {
-        SDL_FreeSurface(surface);
-        throw std::runtime_error("failed to convert surface to RGBA format!");
-    }
+	Ktx2Header ktx2Header;
+	if( readKtx2Header( fileBytes, file.size(), ktx2Header ) ) return createKtx2TextureImage( fileBytes, ktx2Header, device, physicalDevice, commandPool, graphicsQueue );
+
+	// uncompressed BMP/TGA decode in one pass straight into the staging memory; SDL handles whatever else it can load
+	ImageHeader header;
+	const bool nativeDecode = readImageHeader( fileBytes, file.size(), header );
+
+	SDL_Surface* rgbaSurface = nullptr;
+	if( !nativeDecode ){
+		SDL_Surface* surface = SDL_LoadBMP_RW( SDL_RWFromConstMem( file.data(), static_cast<int>( file.size() ) ), 1 );
+		if (!surface) {
+			throw std::runtime_error("failed to load texture image!");
+		}
+
+		// Конвертация пикселей из BGR в RGBA
+		rgbaSurface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+		SDL_FreeSurface(surface);
+		if (!rgbaSurface) {
+			throw std::runtime_error("failed to convert surface to RGBA format!");
+		}
+	}
 
-    VkDeviceSize imageSize = rgbaSurface->w * rgbaSurface->h * 4;  // 4 bytes per pixel (RGBA)
+	const uint32_t width = nativeDecode ? header.width : static_cast<uint32_t>( rgbaSurface->w );
+	const uint32_t height = nativeDecode ? header.height : static_cast<uint32_t>( rgbaSurface->h );
+    VkDeviceSize imageSize = VkDeviceSize( width ) * height * 4;  // 4 bytes per pixel (RGBA)
 
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
@@ -1202,20 +2357,33 @@ std::tuple<VkImage, VkDeviceMemory> createTextureImage(const char *imagePath, Vk
 
     void* data;
     vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, rgbaSurface->pixels, static_cast<size_t>(imageSize));
+	if( nativeDecode ) decodeImage( fileBytes, header, static_cast<uint8_t*>( data ) );
+	else memcpy(data, rgbaSurface->pixels, static_cast<size_t>(imageSize));
     vkUnmapMemory(device, stagingBufferMemory);
 
+	if( rgbaSurface ) SDL_FreeSurface(rgbaSurface);
+
+	const VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+	const uint32_t mipLevels = mipmapped ? getMipLevelCount(width, height) : 1;
+
+	// blits need linear filtering support for the format; the compute fallback only samples the image
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+	const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	const bool blitMipmaps = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
 	VkImage textureImage;
 	VkDeviceMemory textureImageMemory;
 
     createImage(
 		device, 
 		physicalDevice, 
-		rgbaSurface->w, 
-		rgbaSurface->h, 
-		VK_FORMAT_R8G8B8A8_SRGB, 
+		width, 
+		height, 
+		mipLevels,
+		format, 
 		VK_IMAGE_TILING_OPTIMAL, 
-		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
 		textureImage, 
 		textureImageMemory
@@ -1226,9 +2394,10 @@ std::tuple<VkImage, VkDeviceMemory> createTextureImage(const char *imagePath, Vk
 		commandPool, 
 		device, 
 		textureImage, 
-		VK_FORMAT_R8G8B8A8_SRGB, 
+		format, 
 		VK_IMAGE_LAYOUT_UNDEFINED, 
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		mipLevels
 	);
     copyBufferToImage(
 		graphicsQueue,
@@ -1236,34 +2405,433 @@ std::tuple<VkImage, VkDeviceMemory> createTextureImage(const char *imagePath, Vk
 		device,
 		stagingBuffer, 
 		textureImage, 
-		static_cast<uint32_t>(rgbaSurface->w), 
-		static_cast<uint32_t>(rgbaSurface->h)
-	);
-    transitionImageLayout(
-		graphicsQueue, 
-		commandPool, 
-		device, 
-		textureImage, 
-		VK_FORMAT_R8G8B8A8_SRGB, 
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		width, 
+		height
 	);
 
+	if( mipLevels == 1 ){
+		transitionImageLayout(
+			graphicsQueue, 
+			commandPool, 
+			device, 
+			textureImage, 
+			format, 
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			mipLevels
+		);
+	}
+	else if( blitMipmaps ) generateMipmaps( graphicsQueue, commandPool, device, textureImage, width, height, mipLevels );
+	else generateMipmapsCompute( graphicsQueue, commandPool, device, physicalDevice, textureImage, format, width, height, mipLevels );
+
     vkDestroyBuffer(device, stagingBuffer, nullptr);
     vkFreeMemory(device, stagingBufferMemory, nullptr);
 
-    SDL_FreeSurface(rgbaSurface);
-    SDL_FreeSurface(surface);
+	return { textureImage, textureImageMemory, format, mipLevels };
+}
+
+Texture createKtx2TextureImage(const uint8_t* file, const Ktx2Header& header, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue) {
+	// upload the blocks as they are where the device can sample the format, otherwise decode them on the CPU if possible
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, header.format, &formatProperties);
+	const bool nativeFormat = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	if( !nativeFormat && !isCpuDecodable( header.format ) ) throw "KTX2: the device cannot sample the texture format and there is no CPU fallback for it!";
+
+	const VkFormat format = nativeFormat ? header.format : getCpuDecodedFormat( header.format );
+	const BlockFormatInfo block = getBlockFormatInfo( format );
+	const VkDeviceSize alignment = std::max( block.bytesPerBlock, 4u ); // bufferOffset: multiple of the block size and of 4
+
+	vector<VkBufferImageCopy> regions( header.levelCount );
+	VkDeviceSize stagingSize = 0;
+	for( uint32_t level = 0; level < header.levelCount; ++level ){
+		const uint32_t levelWidth = std::max( header.width >> level, 1u );
+		const uint32_t levelHeight = std::max( header.height >> level, 1u );
+
+		stagingSize = (stagingSize + alignment - 1) / alignment * alignment;
+		regions[level] = {};
+		regions[level].bufferOffset = stagingSize;
+		regions[level].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		regions[level].imageExtent = { levelWidth, levelHeight, 1 };
+
+		stagingSize += nativeFormat ? header.levels[level].byteLength : VkDeviceSize( levelWidth ) * levelHeight * 4;
+	}
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(device, physicalDevice, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+	void* data;
+	{VkResult errorCode = vkMapMemory( device, stagingBufferMemory, 0, stagingSize, 0, &data ); RESULT_HANDLER( errorCode, "vkMapMemory" );}
+	for( uint32_t level = 0; level < header.levelCount; ++level ){
+		uint8_t* destination = static_cast<uint8_t*>( data ) + regions[level].bufferOffset;
+		const uint8_t* source = file + header.levels[level].byteOffset;
+
+		if( nativeFormat ) std::memcpy( destination, source, static_cast<size_t>( header.levels[level].byteLength ) );
+		else decodeLevel( header.format, source, regions[level].imageExtent.width, regions[level].imageExtent.height, destination );
+	}
+	vkUnmapMemory( device, stagingBufferMemory );
+
+	Texture texture{ VK_NULL_HANDLE, VK_NULL_HANDLE, format, header.levelCount };
+	createImage(
+		device,
+		physicalDevice,
+		header.width,
+		header.height,
+		header.levelCount,
+		format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		texture.image,
+		texture.memory
+	);
+
+	transitionImageLayout( graphicsQueue, commandPool, device, texture.image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, header.levelCount );
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands( commandPool, device );
+	vkCmdCopyBufferToImage( commandBuffer, stagingBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>( regions.size() ), regions.data() );
+	endSingleTimeCommands( graphicsQueue, commandPool, device, commandBuffer );
+
+	transitionImageLayout( graphicsQueue, commandPool, device, texture.image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, header.levelCount );
+
+	killBuffer( device, stagingBuffer );
+	killMemory( device, stagingBufferMemory );
+
+	return texture;
+}
+
+uint32_t getMipLevelCount( const uint32_t width, const uint32_t height ){
+	uint32_t levels = 1;
+	while( (std::max( width, height ) >> levels) > 0 ) ++levels;
+	return levels;
+}
+
+void recordMipBarrier(
+	VkCommandBuffer commandBuffer,
+	VkImage image,
+	uint32_t mipLevel,
+	VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+	VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage
+){
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 1, 0, 1 };
+
+	vkCmdPipelineBarrier( commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier );
+}
+
+void generateMipmaps( VkQueue graphicsQueue, VkCommandPool commandPool, VkDevice device, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels ){
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands( commandPool, device );
+
+	// each level is blitted (linear filter) from the one before, which is then done and can go to the shaders
+	int32_t levelWidth = static_cast<int32_t>( width );
+	int32_t levelHeight = static_cast<int32_t>( height );
+	for( uint32_t level = 1; level < mipLevels; ++level ){
+		recordMipBarrier(
+			commandBuffer, image, level - 1,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+		);
+
+		const int32_t nextWidth = std::max( levelWidth / 2, 1 );
+		const int32_t nextHeight = std::max( levelHeight / 2, 1 );
+
+		VkImageBlit blit{};
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+		blit.srcOffsets[1] = { levelWidth, levelHeight, 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+		vkCmdBlitImage( commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR );
+
+		recordMipBarrier(
+			commandBuffer, image, level - 1,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+		);
+
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	recordMipBarrier(
+		commandBuffer, image, mipLevels - 1,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+	);
+
+	endSingleTimeCommands( graphicsQueue, commandPool, device, commandBuffer );
+}
+
+void generateMipmapsCompute( VkQueue graphicsQueue, VkCommandPool commandPool, VkDevice device, VkPhysicalDevice physicalDevice, VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels ){
+	const uint32_t levelCount = mipLevels - 1; // levels written by the shader
+	const uint32_t workgroupSize = 8; // generateMipmap.comp local size
+
+	// 0 = previous level, 1 = texel buffer -- must match generateMipmap.comp
+	const std::array<VkDescriptorSetLayoutBinding, 2> bindings{{
+		{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+		{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr }
+	}};
+	const VkDescriptorSetLayoutCreateInfo layoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags
+		static_cast<uint32_t>( bindings.size() ),
+		bindings.data()
+	};
+	VkDescriptorSetLayout descriptorSetLayout;
+	{VkResult errorCode = vkCreateDescriptorSetLayout( device, &layoutInfo, nullptr, &descriptorSetLayout ); RESULT_HANDLER( errorCode, "vkCreateDescriptorSetLayout" );}
+
+	const std::array<VkDescriptorPoolSize, 2> poolSizes{{
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, levelCount },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, levelCount }
+	}};
+	const VkDescriptorPoolCreateInfo poolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags
+		levelCount, // max sets
+		static_cast<uint32_t>( poolSizes.size() ),
+		poolSizes.data()
+	};
+	VkDescriptorPool descriptorPool;
+	{VkResult errorCode = vkCreateDescriptorPool( device, &poolInfo, nullptr, &descriptorPool ); RESULT_HANDLER( errorCode, "vkCreateDescriptorPool" );}
+
+	const vector<VkDescriptorSetLayout> setLayouts( levelCount, descriptorSetLayout );
+	const VkDescriptorSetAllocateInfo allocInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		nullptr, // pNext
+		descriptorPool,
+		levelCount, setLayouts.data()
+	};
+	vector<VkDescriptorSet> descriptorSets( levelCount );
+	{VkResult errorCode = vkAllocateDescriptorSets( device, &allocInfo, descriptorSets.data() ); RESULT_HANDLER( errorCode, "vkAllocateDescriptorSets" );}
+
+	// texelFetch ignores filtering, so nearest is fine for every format
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	VkSampler sampler;
+	{VkResult errorCode = vkCreateSampler( device, &samplerInfo, nullptr, &sampler ); RESULT_HANDLER( errorCode, "vkCreateSampler" );}
+
+	// one buffer big enough for level 1; every level is written to it and copied out before the next one
+	const uint32_t firstLevelWidth = std::max( width / 2, 1u );
+	const uint32_t firstLevelHeight = std::max( height / 2, 1u );
+	VkBuffer texelBuffer;
+	VkDeviceMemory texelBufferMemory;
+	createBuffer( device, physicalDevice, VkDeviceSize( firstLevelWidth ) * firstLevelHeight * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texelBuffer, texelBufferMemory );
+
+	vector<VkImageView> levelViews( levelCount );
+	for( uint32_t level = 0; level < levelCount; ++level ){
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		{VkResult errorCode = vkCreateImageView( device, &viewInfo, nullptr, &levelViews[level] ); RESULT_HANDLER( errorCode, "vkCreateImageView" );}
+
+		const VkDescriptorImageInfo imageInfo{ sampler, levelViews[level], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		const VkDescriptorBufferInfo bufferInfo{ texelBuffer, 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, 2> writes{};
+		for( uint32_t i = 0; i < writes.size(); ++i ){
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = descriptorSets[level];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = bindings[i].descriptorType;
+		}
+		writes[0].pImageInfo = &imageInfo;
+		writes[1].pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets( device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+	}
+
+	const vector<VkPushConstantRange> pushConstantRanges = {
+		{ VK_SHADER_STAGE_COMPUTE_BIT, 0, 2 * sizeof( uint32_t ) } // MipParams
+	};
+	VkShaderModule shader = createShaderModule( device, readFile( "generateMipmap.spv" ) );
+	VkPipelineLayout pipelineLayout = initPipelineLayout( device, descriptorSetLayout, pushConstantRanges );
+	VkPipeline pipeline = initComputePipeline( device, pipelineLayout, shader );
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands( commandPool, device );
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline );
+
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	for( uint32_t level = 1; level < mipLevels; ++level ){
+		recordMipBarrier(
+			commandBuffer, image, level - 1,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+		);
+
+		levelWidth = std::max( levelWidth / 2, 1u );
+		levelHeight = std::max( levelHeight / 2, 1u );
+		const uint32_t destinationSize[2] = { levelWidth, levelHeight };
+
+		vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[level - 1], 0, nullptr );
+		vkCmdPushConstants( commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( destinationSize ), destinationSize );
+		vkCmdDispatch( commandBuffer, (levelWidth + workgroupSize - 1) / workgroupSize, (levelHeight + workgroupSize - 1) / workgroupSize, 1 );
+
+		const VkBufferMemoryBarrier texelsWritten{
+			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, nullptr,
+			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			texelBuffer, 0, VK_WHOLE_SIZE
+		};
+		vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &texelsWritten, 0, nullptr );
+
+		VkBufferImageCopy region{};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		region.imageExtent = { levelWidth, levelHeight, 1 };
+		vkCmdCopyBufferToImage( commandBuffer, texelBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
+
+		// the next dispatch overwrites the buffer the copy reads
+		const VkBufferMemoryBarrier texelsCopied{
+			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, nullptr,
+			VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			texelBuffer, 0, VK_WHOLE_SIZE
+		};
+		vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &texelsCopied, 0, nullptr );
+	}
+
+	recordMipBarrier(
+		commandBuffer, image, mipLevels - 1,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+	);
+
+	endSingleTimeCommands( graphicsQueue, commandPool, device, commandBuffer ); // waits for the queue, so everything below is free to go
 
-	return std::make_tuple(textureImage, textureImageMemory);
+	killPipeline( device, pipeline );
+	killPipelineLayout( device, pipelineLayout );
+	killShaderModule( device, shader );
+	for( VkImageView view : levelViews ) killImageView( device, view );
+	killBuffer( device, texelBuffer );
+	killMemory( device, texelBufferMemory );
+	vkDestroySampler( device, sampler, nullptr );
+	vkDestroyDescriptorPool( device, descriptorPool, nullptr );
+	vkDestroyDescriptorSetLayout( device, descriptorSetLayout, nullptr );
 }
 
-VkImageView createTextureImageView(VkDevice device, VkImage textureImage) {
-    auto textureImageView = createImageView(device, textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+VkImageView createTextureImageView(VkDevice device, const Texture& texture) {
+    auto textureImageView = createImageView(device, texture.image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
 	return textureImageView;
 }
 
-VkSampler createTextureSampler(VkDevice device) {
+Texture createTextureArrayImage(VkFormat format, uint32_t width, uint32_t height, const vector<vector<vector<uint8_t>>>& layers, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue) {
+	const uint32_t layerCount = static_cast<uint32_t>( layers.size() );
+	const uint32_t mipLevels = static_cast<uint32_t>( layers[0].size() );
+
+	// one region per layer and level, all from one staging buffer
+	vector<VkBufferImageCopy> regions;
+	VkDeviceSize stagingSize = 0;
+	for( uint32_t layer = 0; layer < layerCount; ++layer ){
+		for( uint32_t level = 0; level < mipLevels; ++level ){
+			VkBufferImageCopy region{};
+			region.bufferOffset = stagingSize;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1 };
+			region.imageExtent = { std::max( width >> level, 1u ), std::max( height >> level, 1u ), 1 };
+			regions.push_back( region );
+
+			stagingSize += (layers[layer][level].size() + 3) & ~size_t( 3 ); // bufferOffset: multiple of 4
+		}
+	}
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(device, physicalDevice, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+	void* data;
+	{VkResult errorCode = vkMapMemory( device, stagingBufferMemory, 0, stagingSize, 0, &data ); RESULT_HANDLER( errorCode, "vkMapMemory" );}
+	for( uint32_t layer = 0; layer < layerCount; ++layer ){
+		for( uint32_t level = 0; level < mipLevels; ++level ){
+			const vector<uint8_t>& texels = layers[layer][level];
+			std::memcpy( static_cast<uint8_t*>( data ) + regions[layer * mipLevels + level].bufferOffset, texels.data(), texels.size() );
+		}
+	}
+	vkUnmapMemory( device, stagingBufferMemory );
+
+	Texture texture{ VK_NULL_HANDLE, VK_NULL_HANDLE, format, mipLevels };
+	createImage(
+		device,
+		physicalDevice,
+		width,
+		height,
+		mipLevels,
+		format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		texture.image,
+		texture.memory,
+		layerCount
+	);
+
+	// transitionImageLayout() only knows one layer
+	const VkImageSubresourceRange allLayers{ VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, layerCount };
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = texture.image;
+	barrier.subresourceRange = allLayers;
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands( commandPool, device );
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier );
+
+	vkCmdCopyBufferToImage( commandBuffer, stagingBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>( regions.size() ), regions.data() );
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier );
+	endSingleTimeCommands( graphicsQueue, commandPool, device, commandBuffer );
+
+	killBuffer( device, stagingBuffer );
+	killMemory( device, stagingBufferMemory );
+
+	return texture;
+}
+
+VkImageView createTextureArrayImageView(VkDevice device, const Texture& texture, uint32_t layerCount) {
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = texture.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	viewInfo.format = texture.format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, 0, layerCount };
+
+	VkImageView imageView;
+	{VkResult errorCode = vkCreateImageView( device, &viewInfo, nullptr, &imageView ); RESULT_HANDLER( errorCode, "vkCreateImageView" );}
+	return imageView;
+}
+
+VkSampler createTextureSampler(VkDevice device, float maxAnisotropy) {
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -1271,9 +2839,8 @@ VkSampler createTextureSampler(VkDevice device) {
     samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    //samplerInfo.anisotropyEnable = VK_TRUE;
-	samplerInfo.anisotropyEnable = VK_FALSE;
-    samplerInfo.maxAnisotropy = 16;
+	samplerInfo.anisotropyEnable = maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = std::max(maxAnisotropy, 1.0f);
     samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
     samplerInfo.compareEnable = VK_FALSE;
@@ -1281,7 +2848,7 @@ VkSampler createTextureSampler(VkDevice device) {
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // whatever mip levels the view has
 
 	VkSampler textureSampler;
     if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
@@ -1290,15 +2857,15 @@ VkSampler createTextureSampler(VkDevice device) {
 	return textureSampler;
 }
 
-void createImage(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void createImage(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, uint32_t arrayLayers) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = arrayLayers;
     imageInfo.format = format;
     imageInfo.tiling = tiling;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -1325,7 +2892,7 @@ void createImage(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t widt
     vkBindImageMemory(device, image, imageMemory, 0);
 }
 
-VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = image;
@@ -1333,7 +2900,7 @@ VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkI
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = aspectFlags;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
@@ -1557,6 +3124,12 @@ VkPhysicalDeviceMemoryProperties getPhysicalDeviceMemoryProperties( VkPhysicalDe
 	return memoryInfo;
 }
 
+VkPhysicalDeviceFeatures getPhysicalDeviceFeatures( VkPhysicalDevice physicalDevice ){
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures( physicalDevice, &features );
+	return features;
+}
+
 vector<VkQueueFamilyProperties> getQueueFamilyProperties( VkPhysicalDevice device ){
 	uint32_t queueFamiliesCount;
 	vkGetPhysicalDeviceQueueFamilyProperties( device, &queueFamiliesCount, nullptr );
@@ -1615,7 +3188,9 @@ VkDevice initDevice(
 	const uint32_t graphicsQueueFamily,
 	const uint32_t presentQueueFamily,
 	const vector<const char*>& layers,
-	const vector<const char*>& extensions
+	const vector<const char*>& extensions,
+	const uint32_t transferQueueFamily,
+	const void* extensionFeatures
 ){
 	checkDeviceExtensionSupport( physDevice, extensions, layers );
 
@@ -1643,9 +3218,20 @@ VkDevice initDevice(
 		});
 	}
 
+	if( transferQueueFamily != VK_QUEUE_FAMILY_IGNORED && transferQueueFamily != graphicsQueueFamily && transferQueueFamily != presentQueueFamily ){
+		queues.push_back({
+			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			nullptr, // pNext
+			0, // flags
+			transferQueueFamily,
+			1, // queue count
+			priority
+		});
+	}
+
 	const VkDeviceCreateInfo deviceInfo{
 		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-		nullptr, // pNext
+		extensionFeatures, // pNext
 		0, // flags
 		static_cast<uint32_t>( queues.size() ),
 		queues.data(),
@@ -2049,7 +3635,8 @@ void killSwapchainImageViews( VkDevice device, vector<VkImageView>& imageViews )
 VkRenderPass initRenderPass(
 	VkDevice device,
 	VkPhysicalDevice physicalDevice,
-	VkSurfaceFormatKHR surfaceFormat
+	VkSurfaceFormatKHR surfaceFormat,
+	VkImageLayout colorFinalLayout
 ){
 	VkAttachmentDescription colorAttachment{
 		0, // flags
@@ -2060,7 +3647,7 @@ VkRenderPass initRenderPass(
 		VK_ATTACHMENT_LOAD_OP_DONT_CARE, // stencil
 		VK_ATTACHMENT_STORE_OP_DONT_CARE, // stencil
 		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+		colorFinalLayout
 	};
 
 	VkAttachmentReference colorReference{
@@ -2227,7 +3814,16 @@ void killShaderModule( VkDevice device, VkShaderModule shaderModule ){
 
 VkPipelineLayout initPipelineLayout(
 	VkDevice device,
-	VkDescriptorSetLayout descriptorSetLayout
+	VkDescriptorSetLayout descriptorSetLayout,
+	const vector<VkPushConstantRange>& pushConstantRanges
+){
+	return initPipelineLayout( device, vector<VkDescriptorSetLayout>{ descriptorSetLayout }, pushConstantRanges );
+}
+
+VkPipelineLayout initPipelineLayout(
+	VkDevice device,
+	const vector<VkDescriptorSetLayout>& descriptorSetLayouts,
+	const vector<VkPushConstantRange>& pushConstantRanges
 ){
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
 		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
@@ -2235,12 +3831,12 @@ VkPipelineLayout initPipelineLayout(
 		0, // flags - reserved for future use
 		0, // descriptorSetLayout count
 		nullptr,
-		0, // push constant range count
-		nullptr // push constant ranges
+		static_cast<uint32_t>( pushConstantRanges.size() ), // push constant range count
+		pushConstantRanges.data() // push constant ranges
 	};
 
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>( descriptorSetLayouts.size() );
+	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
 
 	VkPipelineLayout pipelineLayout;
 	VkResult errorCode = vkCreatePipelineLayout( device, &pipelineLayoutInfo, nullptr, &pipelineLayout ); 
@@ -2253,6 +3849,94 @@ void killPipelineLayout( VkDevice device, VkPipelineLayout pipelineLayout ){
 	vkDestroyPipelineLayout( device, pipelineLayout, nullptr );
 }
 
+// VK_PIPELINE_CACHE_HEADER_VERSION_ONE: header size, version, vendor ID, device ID (uint32 each), then the pipelineCacheUUID;
+// drivers reject data of other devices or versions anyway, this just says why the cache starts out empty
+bool isPipelineCacheCompatible( const vector<uint8_t>& data, const VkPhysicalDeviceProperties& properties, string& reason ){
+	const size_t headerSize = 4 * sizeof( uint32_t ) + VK_UUID_SIZE;
+	if( data.size() < headerSize ){
+		reason = "shorter than its header";
+		return false;
+	}
+
+	uint32_t header[4];
+	std::memcpy( header, data.data(), sizeof( header ) );
+	if( header[0] < headerSize || header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ) reason = "unknown header";
+	else if( header[2] != properties.vendorID ) reason = "written by another vendor's device";
+	else if( header[3] != properties.deviceID ) reason = "written by another device";
+	else if( std::memcmp( data.data() + 4 * sizeof( uint32_t ), properties.pipelineCacheUUID, VK_UUID_SIZE ) != 0 ) reason = "written by another driver version";
+	else return true;
+
+	return false;
+}
+
+VkPipelineCache initPipelineCache( const VkDevice device, const VkPhysicalDeviceProperties& properties, const string& path ){
+	vector<uint8_t> data = readResourceFile( path );
+	string reason;
+	if( data.empty() ) logger << "pipeline cache: " << path << " not found, starting empty" << std::endl;
+	else if( !isPipelineCacheCompatible( data, properties, reason ) ){
+		logger << "pipeline cache: " << path << " " << reason << ", starting empty" << std::endl;
+		data.clear();
+	}
+
+	const VkPipelineCacheCreateInfo cacheInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags
+		data.size(), data.data()
+	};
+
+	VkPipelineCache pipelineCache;
+	VkResult errorCode = vkCreatePipelineCache( device, &cacheInfo, nullptr, &pipelineCache ); RESULT_HANDLER( errorCode, "vkCreatePipelineCache" );
+	return pipelineCache;
+}
+
+void savePipelineCache( const VkDevice device, const VkPipelineCache pipelineCache, const string& path ){
+	size_t size;
+	{VkResult errorCode = vkGetPipelineCacheData( device, pipelineCache, &size, nullptr ); RESULT_HANDLER( errorCode, "vkGetPipelineCacheData" );}
+	vector<uint8_t> data( size );
+	{VkResult errorCode = vkGetPipelineCacheData( device, pipelineCache, &size, data.data() ); RESULT_HANDLER( errorCode, "vkGetPipelineCacheData" );}
+
+	const string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file( temporaryPath, std::ios::binary | std::ios::trunc );
+		file.write( reinterpret_cast<const char*>( data.data() ), static_cast<std::streamsize>( size ) );
+		file.close();
+		if( !file ) throw "cannot write the pipeline cache!";
+	}
+
+	std::error_code error;
+	std::filesystem::rename( temporaryPath, path, error );
+	if( error ) throw "cannot replace the pipeline cache file!";
+}
+
+void killPipelineCache( const VkDevice device, const VkPipelineCache pipelineCache ){
+	vkDestroyPipelineCache( device, pipelineCache, nullptr );
+}
+
+GraphicsPipelineState getDefaultPipelineState(
+	VkPipelineLayout pipelineLayout,
+	VkRenderPass renderPass,
+	VkShaderModule vertexShader,
+	VkShaderModule fragmentShader,
+	uint32_t vertexBufferBinding
+){
+	GraphicsPipelineState state{};
+	state.vertexShader = vertexShader;
+	state.fragmentShader = fragmentShader;
+	state.vertexBufferBinding = vertexBufferBinding;
+	state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	state.polygonMode = VK_POLYGON_MODE_FILL;
+	state.cullMode = VK_CULL_MODE_NONE;
+	state.depthTest = VK_TRUE;
+	state.depthWrite = VK_TRUE;
+	state.depthCompareOp = VK_COMPARE_OP_LESS;
+	state.blend = VK_FALSE;
+	state.variant = defaultShaderVariant;
+	state.pipelineLayout = pipelineLayout;
+	state.renderPass = renderPass;
+	return state;
+}
+
 VkPipeline initPipeline(
 	VkDevice device,
 	VkPhysicalDeviceLimits limits,
@@ -2261,29 +3945,55 @@ VkPipeline initPipeline(
 	VkShaderModule vertexShader,
 	VkShaderModule fragmentShader,
 	const uint32_t vertexBufferBinding,
-	uint32_t width, uint32_t height
+	VkPipelineCache pipelineCache
 ){
+	return initPipeline( device, limits, getDefaultPipelineState( pipelineLayout, renderPass, vertexShader, fragmentShader, vertexBufferBinding ), pipelineCache );
+}
+
+// libraryParts: 0 for a whole pipeline, else the VkGraphicsPipelineLibraryFlagBitsEXT of the library to create
+VkPipeline createGraphicsPipeline( const VkDevice device, const VkPhysicalDeviceLimits& limits, const GraphicsPipelineState& state, const VkPipelineCache pipelineCache, const VkGraphicsPipelineLibraryFlagsEXT libraryParts ){
+	const uint32_t vertexBufferBinding = state.vertexBufferBinding;
+
+	// both stages get all of ShaderVariant; entries for constants a stage does not declare are ignored
+	const std::array<VkSpecializationMapEntry, 4> specializationEntries{{
+		{ 0, offsetof( ShaderVariant, instancing ), sizeof( VkBool32 ) },
+		{ 1, offsetof( ShaderVariant, texturing ), sizeof( VkBool32 ) },
+		{ 2, offsetof( ShaderVariant, alphaTest ), sizeof( VkBool32 ) },
+		{ 3, offsetof( ShaderVariant, alphaCutoff ), sizeof( float ) }
+	}};
+	const VkSpecializationInfo specializationInfo{
+		static_cast<uint32_t>( specializationEntries.size() ),
+		specializationEntries.data(),
+		sizeof( ShaderVariant ),
+		&state.variant
+	};
+
 	VkPipelineShaderStageCreateInfo shaderStageStates[] = { 
 		{
 			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 			nullptr, // pNext
 			0, // flags - reserved for future use
 			VK_SHADER_STAGE_VERTEX_BIT,
-			vertexShader,
+			state.vertexShader,
 			u8"main",
-			nullptr // SpecializationInfo - constants pushed to shader on pipeline creation time
+			&specializationInfo // constants pushed to shader on pipeline creation time
 		}, 
 		{
 			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 			nullptr, // pNext
 			0, // flags - reserved for future use
 			VK_SHADER_STAGE_FRAGMENT_BIT,
-			fragmentShader,
+			state.fragmentShader,
 			u8"main",
-			nullptr // SpecializationInfo - constants pushed to shader on pipeline creation time
+			&specializationInfo // constants pushed to shader on pipeline creation time
 		}
 	};
 
+	// a library gets the stages of its parts only
+	vector<VkPipelineShaderStageCreateInfo> shaderStages;
+	if( !libraryParts || (libraryParts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT) ) shaderStages.push_back( shaderStageStates[0] );
+	if( !libraryParts || (libraryParts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) ) shaderStages.push_back( shaderStageStates[1] );
+
 	const uint32_t vertexBufferStride = sizeof( Vertex3D_UV );
 	if( vertexBufferBinding > limits.maxVertexInputBindings ){
 		throw string("Implementation does not allow enough input bindings. Needed: ")
@@ -2309,14 +4019,7 @@ VkPipeline initPipeline(
 	}
 
 	const uint32_t positionLocation = 0;
-	const uint32_t colorLocation = 1;
-
-	if( colorLocation >= limits.maxVertexInputAttributes ){
-		throw "Implementation does not allow enough input attributes.";
-	}
-	if(offsetof( Vertex3D_UV, uv) > limits.maxVertexInputAttributeOffset ){
-		throw "Implementation does not allow sufficient attribute offset.";
-	}
+	const uint32_t uvLocation = 1;
 
 	VkVertexInputAttributeDescription positionInputAttributeDescription{
 		positionLocation,
@@ -2325,17 +4028,26 @@ VkPipeline initPipeline(
 		offsetof(Vertex3D_UV, position)
 	};
 
-	VkVertexInputAttributeDescription colorInputAttributeDescription{
-		colorLocation,
+	VkVertexInputAttributeDescription uvInputAttributeDescription{
+		uvLocation,
 		vertexBufferBinding,
-		VK_FORMAT_R32G32B32_SFLOAT,
+		VK_FORMAT_R32G32_SFLOAT, // inUV is a vec2
 		offsetof(Vertex3D_UV, uv)
 	};
 
-	vector<VkVertexInputAttributeDescription> inputAttributeDescriptions = {
-		positionInputAttributeDescription,
-		colorInputAttributeDescription
-	};
+	// reflected ones come from getVertexInputAttributes(), checked against Vertex3D_UV by the caller
+	const vector<VkVertexInputAttributeDescription> inputAttributeDescriptions = state.vertexAttributes.empty()
+		? vector<VkVertexInputAttributeDescription>{ positionInputAttributeDescription, uvInputAttributeDescription }
+		: state.vertexAttributes;
+
+	for( const VkVertexInputAttributeDescription& attribute : inputAttributeDescriptions ){
+		if( attribute.location >= limits.maxVertexInputAttributes ){
+			throw "Implementation does not allow enough input attributes.";
+		}
+		if( attribute.offset > limits.maxVertexInputAttributeOffset ){
+			throw "Implementation does not allow sufficient attribute offset.";
+		}
+	}
 
 	VkPipelineVertexInputStateCreateInfo vertexInputState{
 		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
@@ -2351,32 +4063,28 @@ VkPipeline initPipeline(
 		VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
 		nullptr, // pNext
 		0, // flags - reserved for future use
-		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+		state.topology,
 		VK_FALSE // primitive restart
 	};
 
-	VkViewport viewport{
-		0.0f, // x
-		0.0f, // y
-		static_cast<float>( width ? width : 1 ),
-		static_cast<float>( height ? height : 1 ),
-		0.0f, // min depth
-		1.0f // max depth
-	};
-
-	VkRect2D scissor{
-		{0, 0}, // offset
-		{width, height}
-	};
-
+	// dynamic -- set by recordBeginRenderPass(), so the pipeline does not depend on the framebuffer size
 	VkPipelineViewportStateCreateInfo viewportState{
 		VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
 		nullptr, // pNext
 		0, // flags - reserved for future use
 		1, // Viewport count
-		&viewport,
+		nullptr, // viewports - dynamic
 		1, // scisor count,
-		&scissor
+		nullptr // scissors - dynamic
+	};
+
+	const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{
+		VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags - reserved for future use
+		2, // dynamic state count
+		dynamicStates
 	};
 
 	VkPipelineRasterizationStateCreateInfo rasterizationState{
@@ -2385,8 +4093,8 @@ VkPipeline initPipeline(
 		0, // flags - reserved for future use
 		VK_FALSE, // depth clamp
 		VK_FALSE, // rasterizer discard
-		VK_POLYGON_MODE_FILL,
-		VK_CULL_MODE_FRONT_BIT,
+		state.polygonMode,
+		state.cullMode,
 		VK_FRONT_FACE_CLOCKWISE,
 		VK_FALSE, // depth bias
 		0.0f, // bias constant factor
@@ -2394,9 +4102,6 @@ VkPipeline initPipeline(
 		0.0f, // bias slope factor
 		1.0f // line width
 	};
-	
-	rasterizationState.cullMode = VK_CULL_MODE_NONE;
-	rasterizationState.frontFace = VK_FRONT_FACE_CLOCKWISE;
 
 	VkPipelineMultisampleStateCreateInfo multisampleState{
 		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
@@ -2411,12 +4116,12 @@ VkPipeline initPipeline(
 	};
 
 	VkPipelineColorBlendAttachmentState blendAttachmentState{
-		VK_FALSE, // blending enabled?
-		VK_BLEND_FACTOR_ZERO, // src blend factor -ignored?
-		VK_BLEND_FACTOR_ZERO, // dst blend factor
+		state.blend, // blending enabled?
+		VK_BLEND_FACTOR_SRC_ALPHA, // src blend factor -ignored?
+		VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, // dst blend factor
 		VK_BLEND_OP_ADD, // blend op
-		VK_BLEND_FACTOR_ZERO, // src alpha blend factor
-		VK_BLEND_FACTOR_ZERO, // dst alpha blend factor
+		VK_BLEND_FACTOR_ONE, // src alpha blend factor
+		VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, // dst alpha blend factor
 		VK_BLEND_OP_ADD, // alpha blend op
 		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT // color write mask
 	};
@@ -2434,9 +4139,9 @@ VkPipeline initPipeline(
 
 	VkPipelineDepthStencilStateCreateInfo depthStencilState{};
 	depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencilState.depthTestEnable = VK_TRUE;
-	depthStencilState.depthWriteEnable = VK_TRUE;	
-	depthStencilState.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencilState.depthTestEnable = state.depthTest;
+	depthStencilState.depthWriteEnable = state.depthWrite;
+	depthStencilState.depthCompareOp = state.depthCompareOp;
 	depthStencilState.depthBoundsTestEnable = VK_FALSE;
 	// depthStencilState.minDepthBounds = 0.0f;
 	// depthStencilState.maxDepthBounds = 1.0f;
@@ -2444,12 +4149,16 @@ VkPipeline initPipeline(
 	// depthStencilState.front = {};
 	// depthStencilState.back = {};	
 
+	// the state of the other parts is ignored for libraries; retained, so the parts can be linked with link time optimization
+	const VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT, nullptr, libraryParts };
+	const VkPipelineCreateFlags libraryFlags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+
 	VkGraphicsPipelineCreateInfo pipelineInfo{
 		VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-		nullptr, // pNext
-		0, // flags - e.g. disable optimization
-		2, // shader stages count - vertex and fragment
-		shaderStageStates,
+		libraryParts ? &libraryInfo : nullptr, // pNext
+		libraryParts ? libraryFlags : 0, // flags - e.g. disable optimization
+		static_cast<uint32_t>( shaderStages.size() ), // shader stages count - vertex and fragment
+		shaderStages.data(),
 		&vertexInputState,
 		&inputAssemblyState,
 		nullptr, // tesselation
@@ -2458,10 +4167,10 @@ VkPipeline initPipeline(
 		&multisampleState,
 		&depthStencilState, // depth stencil
 		&colorBlendState,
-		nullptr, // dynamic state
-		pipelineLayout,
-		renderPass,
-		0, // subpass index in renderpass
+		&dynamicState,
+		state.pipelineLayout,
+		state.renderPass,
+		state.compatibility.subpass,
 		VK_NULL_HANDLE, // base pipeline
 		-1 // base pipeline index
 	};
@@ -2469,7 +4178,7 @@ VkPipeline initPipeline(
 	VkPipeline pipeline;
 	VkResult errorCode = vkCreateGraphicsPipelines(
 		device,
-		VK_NULL_HANDLE /* pipeline cache */,
+		pipelineCache,
 		1 /* info count */,
 		&pipelineInfo,
 		nullptr,
@@ -2478,10 +4187,38 @@ VkPipeline initPipeline(
 	return pipeline;
 }
 
+VkPipeline initPipeline( const VkDevice device, const VkPhysicalDeviceLimits& limits, const GraphicsPipelineState& state, const VkPipelineCache pipelineCache ){
+	return createGraphicsPipeline( device, limits, state, pipelineCache, 0 );
+}
+
 void killPipeline( VkDevice device, VkPipeline pipeline ){
 	vkDestroyPipeline( device, pipeline, nullptr );
 }
 
+VkPipeline initComputePipeline( VkDevice device, VkPipelineLayout pipelineLayout, VkShaderModule computeShader, VkPipelineCache pipelineCache ){
+	const VkComputePipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			nullptr, // pNext
+			0, // flags - reserved for future use
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			computeShader,
+			u8"main",
+			nullptr // SpecializationInfo
+		},
+		pipelineLayout,
+		VK_NULL_HANDLE, // base pipeline
+		-1 // base pipeline index
+	};
+
+	VkPipeline pipeline;
+	VkResult errorCode = vkCreateComputePipelines( device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline ); RESULT_HANDLER( errorCode, "vkCreateComputePipelines" );
+	return pipeline;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void setVertexData( VkDevice device, VkDeviceMemory memory, vector<Vertex3D_UV> vertices ){
@@ -2489,6 +4226,51 @@ void setVertexData( VkDevice device, VkDeviceMemory memory, vector<Vertex3D_UV>
 	setMemoryData(  device, memory, vertices.data(), sizeof( decltype(vertices)::value_type ) * vertices.size()  );
 }
 
+vector<glm::mat4> generateInstanceTransforms( const uint32_t count, const float gridExtent ){
+	if( count == 1 ) return { glm::mat4(1.f) }; // the single cube stays exactly as it was without instancing
+
+	// smallest cubic grid holding all instances, spanning [-gridExtent, gridExtent] (the single cube's box by default)
+	uint32_t side = 1;
+	while( side * side * side < count ) ++side;
+
+	const float cellSize = 2.0f * gridExtent / side;
+	const float cubeScale = 0.5f * cellSize * 0.7f; // leave a gap between neighbours
+
+	vector<glm::mat4> transforms;
+	transforms.reserve( count );
+	for( uint32_t i = 0; i < count; ++i ){
+		const glm::vec3 cell( i % side, (i / side) % side, i / (side * side) );
+		const glm::vec3 center = glm::vec3( -gridExtent ) + cellSize * (cell + 0.5f);
+
+		transforms.push_back(  glm::scale( glm::translate( glm::mat4(1.f), center ), glm::vec3( cubeScale ) )  );
+	}
+
+	return transforms;
+}
+
+vector<ObjectData> generateObjects( const vector<glm::mat4>& transforms, const glm::vec4 localBoundingSphere, const uint32_t textureIndex ){
+	vector<ObjectData> objects;
+	objects.reserve( transforms.size() );
+
+	for( const auto& model : transforms ){
+		// bounds are static, so transform them once here instead of per frame in the shader
+		const float maxScale = std::max({ glm::length( glm::vec3( model[0] ) ), glm::length( glm::vec3( model[1] ) ), glm::length( glm::vec3( model[2] ) ) });
+		const glm::vec3 center = glm::vec3(  model * glm::vec4( glm::vec3( localBoundingSphere ), 1.0f )  );
+
+		objects.push_back( { model, glm::vec4( center, localBoundingSphere.w * maxScale ), glm::vec4( 1.0f, 1.0f, 0.0f, 0.0f ), textureIndex, {} } );
+	}
+
+	return objects;
+}
+
+VkBuffer initObjectBuffer( VkDevice device, uint32_t maxObjectCount ){
+	return initBuffer( device, sizeof( ObjectData ) * maxObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT );
+}
+
+void setObjectData( VkDevice device, VkDeviceMemory memory, const vector<ObjectData>& objects ){
+	setMemoryData(  device, memory, const_cast<ObjectData*>( objects.data() ), sizeof( ObjectData ) * objects.size()  );
+}
+
 VkSemaphore initSemaphore( VkDevice device ){
 	const VkSemaphoreCreateInfo semaphoreInfo{
 		VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
@@ -2616,12 +4398,31 @@ void recordBeginRenderPass(
 	renderPassInfo.pClearValues = clearValue;	
 
 	vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+	recordSetViewport( commandBuffer, width, height );
 }
 
 void recordEndRenderPass( VkCommandBuffer commandBuffer ){
 	vkCmdEndRenderPass( commandBuffer );
 }
 
+void recordSetViewport( VkCommandBuffer commandBuffer, uint32_t width, uint32_t height ){
+	const VkViewport viewport{
+		0.0f, // x
+		0.0f, // y
+		static_cast<float>( width ? width : 1 ),
+		static_cast<float>( height ? height : 1 ),
+		0.0f, // min depth
+		1.0f // max depth
+	};
+	vkCmdSetViewport( commandBuffer, 0 /*first viewport*/, 1, &viewport );
+
+	const VkRect2D scissor{
+		{0, 0}, // offset
+		{width, height}
+	};
+	vkCmdSetScissor( commandBuffer, 0 /*first scissor*/, 1, &scissor );
+}
+
 void recordBindPipeline( VkCommandBuffer commandBuffer, VkPipeline pipeline ){
 	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
 }
@@ -2631,8 +4432,20 @@ void recordBindVertexBuffer( VkCommandBuffer commandBuffer, const uint32_t verte
 	vkCmdBindVertexBuffers( commandBuffer, vertexBufferBinding, 1 /*binding count*/, &vertexBuffer, offsets );
 }
 
-void recordDraw( VkCommandBuffer commandBuffer, const uint32_t vertexCount ){
-	vkCmdDraw( commandBuffer, vertexCount, 1 /*instance count*/, 0 /*first vertex*/, 0 /*first instance*/ );
+void recordBindIndexBuffer( VkCommandBuffer commandBuffer, VkBuffer indexBuffer ){
+	vkCmdBindIndexBuffer( commandBuffer, indexBuffer, 0 /*offset*/, VK_INDEX_TYPE_UINT32 );
+}
+
+void recordDraw( VkCommandBuffer commandBuffer, const uint32_t vertexCount, const uint32_t instanceCount ){
+	vkCmdDraw( commandBuffer, vertexCount, instanceCount, 0 /*first vertex*/, 0 /*first instance*/ );
+}
+
+void recordDrawIndexed( VkCommandBuffer commandBuffer, const uint32_t indexCount, const uint32_t instanceCount ){
+	vkCmdDrawIndexed( commandBuffer, indexCount, instanceCount, 0 /*first index*/, 0 /*vertex offset*/, 0 /*first instance*/ );
+}
+
+void recordPushDrawData( VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const PerDrawData& drawData ){
+	vkCmdPushConstants( commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0 /*offset*/, sizeof( PerDrawData ), &drawData );
 }
 
 void submitToQueue( VkQueue queue, VkCommandBuffer commandBuffer, VkSemaphore imageReadyS, VkSemaphore renderDoneS, VkFence fence ){
@@ -2678,3 +4491,4282 @@ void cleanupUnsafeSemaphore( VkQueue queue, VkSemaphore semaphore ){
 
 	const VkResult errorCode = vkQueueSubmit( queue, 1 /*submit count*/, &submit, VK_NULL_HANDLE ); RESULT_HANDLER( errorCode, "vkQueueSubmit" );
 }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GPU-driven rendering
+
+bool requestGpuDrivenSupport( VkPhysicalDevice physicalDevice, const vector<const char*>& layers, VkPhysicalDeviceFeatures& features, vector<const char*>& deviceExtensions ){
+	const VkPhysicalDeviceFeatures supported = getPhysicalDeviceFeatures( physicalDevice );
+	if( !supported.drawIndirectFirstInstance ) throw "GPU-driven rendering needs the drawIndirectFirstInstance feature!";
+
+	features.drawIndirectFirstInstance = VK_TRUE; // firstInstance carries the object index to the vertex shader
+	features.multiDrawIndirect = supported.multiDrawIndirect;
+
+	if( !supported.multiDrawIndirect ){
+		// vkCmdDrawIndexedIndirectCountKHR could only draw one command without it, so the count extension is of no use
+		logger << "WARNING: multiDrawIndirect not supported. Falling back to one vkCmdDrawIndexedIndirect per object." << std::endl;
+		return false;
+	}
+
+	if(  isExtensionSupported( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME, getSupportedDeviceExtensions( physicalDevice, layers ) )  ){
+		deviceExtensions.push_back( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+		return true;
+	}
+
+	logger << "WARNING: " VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME " not supported. Falling back to vkCmdDrawIndexedIndirect with zero-instance draws for culled objects." << std::endl;
+	return false;
+}
+
+GpuCulling initGpuCulling(
+	const VkDevice device,
+	const VkPhysicalDeviceLimits& limits,
+	const VkPhysicalDeviceMemoryProperties& memoryProperties,
+	const VkBuffer uniformBuffer,
+	const VkBuffer objectBuffer,
+	const uint32_t maxObjectCount,
+	const bool drawIndirectCount,
+	const bool multiDrawIndirect,
+	const vector<Meshlet>& meshlets,
+	const VkPipelineCache pipelineCache
+){
+	const uint64_t maxDrawCount = uint64_t( maxObjectCount ) * std::max<size_t>( meshlets.size(), 1 );
+	if( multiDrawIndirect && maxDrawCount > limits.maxDrawIndirectCount ) throw "Object (times meshlet) count exceeds maxDrawIndirectCount!";
+	if( drawIndirectCount && !multiDrawIndirect ) throw "initGpuCulling: drawIndirectCount needs multiDrawIndirect!";
+
+	GpuCulling culling;
+	culling.drawIndirectCount = drawIndirectCount;
+	culling.multiDrawIndirect = multiDrawIndirect;
+	culling.maxObjectCount = maxObjectCount;
+	culling.meshletCount = static_cast<uint32_t>( meshlets.size() );
+	culling.meshletBuffer = VK_NULL_HANDLE;
+	culling.meshletBufferMemory = VK_NULL_HANDLE;
+
+	// 0 = UBO with the MVP, 1 = objects, 2 = draw commands, 3 = draw count, [4 = meshlets] -- must match cullObjects.comp / cullMeshlets.comp
+	vector<VkDescriptorSetLayoutBinding> bindings( culling.meshletCount ? 5 : 4 );
+	for( uint32_t i = 0; i < bindings.size(); ++i ){
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	const VkDescriptorSetLayoutCreateInfo layoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags
+		static_cast<uint32_t>( bindings.size() ),
+		bindings.data()
+	};
+	{VkResult errorCode = vkCreateDescriptorSetLayout( device, &layoutInfo, nullptr, &culling.descriptorSetLayout ); RESULT_HANDLER( errorCode, "vkCreateDescriptorSetLayout" );}
+
+	const std::array<VkDescriptorPoolSize, 2> poolSizes{{
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>( bindings.size() ) - 1 }
+	}};
+	const VkDescriptorPoolCreateInfo poolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags
+		1, // max sets
+		static_cast<uint32_t>( poolSizes.size() ),
+		poolSizes.data()
+	};
+	{VkResult errorCode = vkCreateDescriptorPool( device, &poolInfo, nullptr, &culling.descriptorPool ); RESULT_HANDLER( errorCode, "vkCreateDescriptorPool" );}
+
+	const VkDescriptorSetAllocateInfo allocInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		nullptr, // pNext
+		culling.descriptorPool,
+		1, &culling.descriptorSetLayout
+	};
+	{VkResult errorCode = vkAllocateDescriptorSets( device, &allocInfo, &culling.descriptorSet ); RESULT_HANDLER( errorCode, "vkAllocateDescriptorSets" );}
+
+	culling.drawCommandBuffer = initBuffer( device, sizeof( VkDrawIndexedIndirectCommand ) * maxDrawCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT );
+	culling.drawCommandBufferMemory = initMemory<ResourceType::Buffer>( device, memoryProperties, culling.drawCommandBuffer, {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT} ); // written and read by the GPU only
+
+	// host visible so the counts can be read back for statistics
+	culling.drawCountBuffer = initBuffer( device, sizeof( CullingStats ), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT );
+	culling.drawCountBufferMemory = initMemory<ResourceType::Buffer>(
+		device,
+		memoryProperties,
+		culling.drawCountBuffer,
+		{
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		}
+	);
+
+	if( culling.meshletCount ){
+		// static data, so keep it simple: host visible like the other buffers of this app
+		culling.meshletBuffer = initBuffer( device, sizeof( Meshlet ) * meshlets.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT );
+		culling.meshletBufferMemory = initMemory<ResourceType::Buffer>(
+			device,
+			memoryProperties,
+			culling.meshletBuffer,
+			{
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			}
+		);
+		setMemoryData(  device, culling.meshletBufferMemory, const_cast<Meshlet*>( meshlets.data() ), sizeof( Meshlet ) * meshlets.size()  );
+	}
+
+	vector<VkDescriptorBufferInfo> bufferInfos = {
+		{ uniformBuffer, 0, VK_WHOLE_SIZE },
+		{ objectBuffer, 0, VK_WHOLE_SIZE },
+		{ culling.drawCommandBuffer, 0, VK_WHOLE_SIZE },
+		{ culling.drawCountBuffer, 0, VK_WHOLE_SIZE }
+	};
+	if( culling.meshletCount ) bufferInfos.push_back( { culling.meshletBuffer, 0, VK_WHOLE_SIZE } );
+
+	vector<VkWriteDescriptorSet> writes( bufferInfos.size() );
+	for( uint32_t i = 0; i < writes.size(); ++i ){
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = culling.descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = bindings[i].descriptorType;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets( device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+
+	const vector<VkPushConstantRange> pushConstantRanges = {
+		{ VK_SHADER_STAGE_COMPUTE_BIT, 0, 3 * sizeof( uint32_t ) } // CullParams
+	};
+	culling.shader = createShaderModule(  device, readFile( culling.meshletCount ? "cullMeshlets.spv" : "cullObjects.spv" )  );
+	culling.pipelineLayout = initPipelineLayout( device, culling.descriptorSetLayout, pushConstantRanges );
+	culling.pipeline = initComputePipeline( device, culling.pipelineLayout, culling.shader, pipelineCache );
+
+	return culling;
+}
+
+void killGpuCulling( const VkDevice device, GpuCulling& culling ){
+	killPipeline( device, culling.pipeline );
+	killPipelineLayout( device, culling.pipelineLayout );
+	killShaderModule( device, culling.shader );
+
+	vkDestroyDescriptorPool( device, culling.descriptorPool, nullptr );
+	vkDestroyDescriptorSetLayout( device, culling.descriptorSetLayout, nullptr );
+
+	killBuffer( device, culling.drawCountBuffer );
+	killMemory( device, culling.drawCountBufferMemory );
+	killBuffer( device, culling.drawCommandBuffer );
+	killMemory( device, culling.drawCommandBufferMemory );
+
+	if( culling.meshletCount ){
+		killBuffer( device, culling.meshletBuffer );
+		killMemory( device, culling.meshletBufferMemory );
+	}
+}
+
+void recordCullObjects( const VkCommandBuffer commandBuffer, const GpuCulling& culling, const uint32_t objectCount, const uint32_t indexCount ){
+	if( objectCount > culling.maxObjectCount ) throw "recordCullObjects: more objects than the culling buffers were made for!";
+
+	// the previous frame's indirect draw may still be reading the buffers about to be rewritten
+	const VkMemoryBarrier indirectReadDone{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, // dependency flags
+		1, &indirectReadDone, 0, nullptr, 0, nullptr
+	);
+
+	vkCmdFillBuffer( commandBuffer, culling.drawCountBuffer, 0, VK_WHOLE_SIZE, 0 );
+
+	const VkMemoryBarrier countCleared{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, // dependency flags
+		1, &countCleared, 0, nullptr, 0, nullptr
+	);
+
+	// second member is indexCount for cullObjects.comp, meshletCount for cullMeshlets.comp
+	const uint32_t cullParams[3] = { objectCount, culling.meshletCount ? culling.meshletCount : indexCount, culling.drawIndirectCount ? 1u : 0u /*compact*/ };
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling.pipeline );
+	vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling.pipelineLayout, 0, 1, &culling.descriptorSet, 0, nullptr );
+	vkCmdPushConstants( commandBuffer, culling.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( cullParams ), cullParams );
+
+	const uint32_t workgroupSize = 64; // local_size_x in cullObjects.comp and cullMeshlets.comp
+	const uint32_t invocationCount = objectCount * std::max( culling.meshletCount, 1u );
+	vkCmdDispatch( commandBuffer, (invocationCount + workgroupSize - 1) / workgroupSize, 1, 1 );
+
+	const VkMemoryBarrier drawsWritten{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT };
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		0, // dependency flags
+		1, &drawsWritten, 0, nullptr, 0, nullptr
+	);
+}
+
+void recordDrawCulledObjects( const VkCommandBuffer commandBuffer, const GpuCulling& culling, const uint32_t objectCount ){
+	const uint32_t stride = sizeof( VkDrawIndexedIndirectCommand );
+	const uint32_t maxDrawCount = objectCount * std::max( culling.meshletCount, 1u );
+
+	if( culling.drawIndirectCount ) vkCmdDrawIndexedIndirectCountKHR( commandBuffer, culling.drawCommandBuffer, 0, culling.drawCountBuffer, offsetof( CullingStats, drawCount ), maxDrawCount, stride );
+	else if( culling.multiDrawIndirect ) vkCmdDrawIndexedIndirect( commandBuffer, culling.drawCommandBuffer, 0, maxDrawCount, stride );
+	else for( uint32_t i = 0; i < maxDrawCount; ++i ) vkCmdDrawIndexedIndirect( commandBuffer, culling.drawCommandBuffer, VkDeviceSize( i ) * stride, 1, stride );
+}
+
+CullingStats getCullingStats( const VkDevice device, const GpuCulling& culling ){
+	void* data;
+	{VkResult errorCode = vkMapMemory( device, culling.drawCountBufferMemory, 0, sizeof( CullingStats ), 0, &data ); RESULT_HANDLER( errorCode, "vkMapMemory" );}
+	const CullingStats stats = *reinterpret_cast<const CullingStats*>( data );
+	vkUnmapMemory( device, culling.drawCountBufferMemory );
+
+	return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// LOD selection
+
+bool requestLodDrawSupport( VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures& features ){
+	const VkPhysicalDeviceFeatures supported = getPhysicalDeviceFeatures( physicalDevice );
+	if( !supported.drawIndirectFirstInstance ) throw "LOD selection needs the drawIndirectFirstInstance feature!";
+
+	features.drawIndirectFirstInstance = VK_TRUE; // firstInstance carries the object index to the vertex shader
+	features.multiDrawIndirect = supported.multiDrawIndirect;
+	return supported.multiDrawIndirect == VK_TRUE;
+}
+
+LodDraws initLodDraws( const VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties, const uint32_t objectCount, const bool multiDrawIndirect, const uint32_t regionCount ){
+	LodDraws draws;
+	draws.objectCount = objectCount;
+	draws.regionCount = regionCount;
+	draws.multiDrawIndirect = multiDrawIndirect;
+	draws.currentLods.assign( objectCount, 0 );
+
+	const VkDeviceSize size = sizeof( VkDrawIndexedIndirectCommand ) * objectCount * regionCount;
+	draws.buffer = initBuffer( device, size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT );
+	draws.memory = initMemory<ResourceType::Buffer>(
+		device,
+		memoryProperties,
+		draws.buffer,
+		{
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		}
+	);
+
+	void* data;
+	VkResult errorCode = vkMapMemory( device, draws.memory, 0, VK_WHOLE_SIZE, 0, &data ); RESULT_HANDLER( errorCode, "vkMapMemory" );
+	draws.mapped = reinterpret_cast<VkDrawIndexedIndirectCommand*>( data );
+	std::memset( data, 0, size ); // zero instanceCount -- draws nothing until the first updateLodDraws()
+
+	return draws;
+}
+
+void killLodDraws( const VkDevice device, LodDraws& draws ){
+	vkUnmapMemory( device, draws.memory );
+	killBuffer( device, draws.buffer );
+	killMemory( device, draws.memory );
+}
+
+float getPixelsPerUnit( const FrameTransforms& transforms, const glm::vec3 worldPosition, const float viewportHeight ){
+	// distance rather than view depth, so the choice does not change as the camera turns
+	const float distance = glm::length(  glm::vec3( transforms.view * transforms.model * glm::vec4( worldPosition, 1.0f ) )  );
+	const float nearLimit = 1.0e-3f;
+
+	return std::abs( transforms.proj[1][1] ) * 0.5f * viewportHeight / std::max( distance, nearLimit ); // abs: updateUniformBuffer flips Y
+}
+
+uint32_t selectLod( const vector<MeshLod>& lods, const float pixelsPerMeshUnit, const uint32_t currentLod ){
+	uint32_t lod = 0;
+	for( uint32_t i = 1; i < lods.size(); ++i ){
+		const float limit = i > currentLod ? ::lodMaxErrorPixels * (1.0f - ::lodHysteresis) : ::lodMaxErrorPixels;
+		if( lods[i].error * pixelsPerMeshUnit > limit ) break; // errors only grow down the chain
+
+		lod = i;
+	}
+
+	return lod;
+}
+
+uint64_t updateLodDraws( LodDraws& draws, const uint32_t region, const vector<MeshLod>& lods, const vector<ObjectData>& objects, const float meshRadius, const FrameTransforms& transforms, const float viewportHeight ){
+	uint64_t triangleCount = 0;
+	VkDrawIndexedIndirectCommand* const regionDraws = draws.mapped + size_t( region ) * draws.objectCount;
+
+	for( uint32_t i = 0; i < objects.size(); ++i ){
+		const glm::vec4 sphere = objects[i].boundingSphere;
+		const float objectScale = meshRadius > 0.0f ? sphere.w / meshRadius : 1.0f; // mesh units -> world units
+
+		const uint32_t lod = selectLod( lods, objectScale * getPixelsPerUnit( transforms, glm::vec3( sphere ), viewportHeight ), draws.currentLods[i] );
+		draws.currentLods[i] = lod;
+
+		regionDraws[i] = { lods[lod].indexCount, 1, lods[lod].firstIndex, 0 /*vertex offset*/, i /*first instance = object index*/ };
+		triangleCount += lods[lod].indexCount / 3;
+	}
+
+	return triangleCount;
+}
+
+void recordDrawLods( const VkCommandBuffer commandBuffer, const LodDraws& draws, const uint32_t region, const uint32_t objectCount ){
+	const uint32_t stride = sizeof( VkDrawIndexedIndirectCommand );
+	const VkDeviceSize offset = VkDeviceSize( region ) * draws.objectCount * stride;
+
+	if( draws.multiDrawIndirect ) vkCmdDrawIndexedIndirect( commandBuffer, draws.buffer, offset, objectCount, stride );
+	else for( uint32_t i = 0; i < objectCount; ++i ) vkCmdDrawIndexedIndirect( commandBuffer, draws.buffer, offset + VkDeviceSize( i ) * stride, 1, stride );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Texture streaming
+
+uint32_t getTransferQueueFamily( const VkPhysicalDevice physDevice, const uint32_t graphicsQueueFamily ){
+	const auto qfps = getQueueFamilyProperties( physDevice );
+
+	for( uint32_t qf = 0; qf < qfps.size(); ++qf ){
+		const VkQueueFlags flags = qfps[qf].queueFlags;
+		if( (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) ) return qf;
+	}
+
+	return graphicsQueueFamily;
+}
+
+VkImageView initStreamedTextureView( const VkDevice device, const Texture& texture, const uint32_t baseMipLevel ){
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = texture.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = texture.format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, baseMipLevel, texture.mipLevels - baseMipLevel, 0, 1 };
+
+	VkImageView view;
+	VkResult errorCode = vkCreateImageView( device, &viewInfo, nullptr, &view ); RESULT_HANDLER( errorCode, "vkCreateImageView" );
+	return view;
+}
+
+TextureStreamer initTextureStreamer( const VkDevice device, const VkPhysicalDevice physicalDevice, const uint32_t graphicsQueueFamily, const VkQueue graphicsQueue, const uint32_t transferQueueFamily, const VkQueue transferQueue ){
+	TextureStreamer streamer;
+	streamer.physicalDevice = physicalDevice;
+	streamer.graphicsQueueFamily = graphicsQueueFamily;
+	streamer.transferQueueFamily = transferQueueFamily;
+	streamer.graphicsQueue = graphicsQueue;
+	streamer.transferQueue = transferQueue;
+	streamer.graphicsCommandPool = initCommandPool( device, graphicsQueueFamily );
+	streamer.transferCommandPool = transferQueueFamily == graphicsQueueFamily ? streamer.graphicsCommandPool : initCommandPool( device, transferQueueFamily );
+
+	// mid grey, so nothing flashes while the real texture streams in
+	const uint32_t placeholderTexel = 0xFF808080;
+	streamer.placeholder = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_FORMAT_R8G8B8A8_UNORM, 1 };
+	createImage(
+		device,
+		physicalDevice,
+		1, 1,
+		1, // mip levels
+		streamer.placeholder.format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		streamer.placeholder.image,
+		streamer.placeholder.memory
+	);
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer( device, physicalDevice, sizeof( placeholderTexel ), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory );
+	setMemoryData(  device, stagingBufferMemory, const_cast<uint32_t*>( &placeholderTexel ), sizeof( placeholderTexel )  );
+
+	transitionImageLayout( graphicsQueue, streamer.graphicsCommandPool, device, streamer.placeholder.image, streamer.placeholder.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1 );
+	copyBufferToImage( graphicsQueue, streamer.graphicsCommandPool, device, stagingBuffer, streamer.placeholder.image, 1, 1 );
+	transitionImageLayout( graphicsQueue, streamer.graphicsCommandPool, device, streamer.placeholder.image, streamer.placeholder.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1 );
+
+	killBuffer( device, stagingBuffer );
+	killMemory( device, stagingBufferMemory );
+
+	streamer.placeholderView = createTextureImageView( device, streamer.placeholder );
+
+	streamer.decoder.reset(  new TextureDecoder( [physicalDevice]( const VkFormat format ){
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties( physicalDevice, format, &formatProperties );
+		return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	} )  );
+
+	return streamer;
+}
+
+void killTextureUpload( const VkDevice device, const TextureStreamer& streamer, const TextureUpload& upload ){
+	killFence( device, upload.done );
+	if( upload.transferDone ) killSemaphore( device, upload.transferDone );
+	vkFreeCommandBuffers( device, streamer.transferCommandPool, 1, &upload.transferCommandBuffer );
+	if( upload.acquireCommandBuffer ) vkFreeCommandBuffers( device, streamer.graphicsCommandPool, 1, &upload.acquireCommandBuffer );
+	killBuffer( device, upload.stagingBuffer );
+	killMemory( device, upload.stagingBufferMemory );
+}
+
+void killTextureStreamer( const VkDevice device, TextureStreamer& streamer ){
+	streamer.decoder.reset(); // drops the decodes not started yet, waits for the running ones
+
+	for( const TextureUpload& upload : streamer.uploads ){
+		{VkResult errorCode = vkWaitForFences( device, 1, &upload.done, VK_TRUE, UINT64_MAX ); RESULT_HANDLER( errorCode, "vkWaitForFences" );}
+		killTextureUpload( device, streamer, upload );
+	}
+	streamer.uploads.clear();
+
+	killRetiredTextureViews( device, streamer );
+	for( StreamedTexture& texture : streamer.textures ){
+		if( texture.view ) killImageView( device, texture.view );
+		if( texture.texture.image ){
+			killImage( device, texture.texture.image );
+			killMemory( device, texture.texture.memory );
+		}
+	}
+	streamer.textures.clear();
+
+	killImageView( device, streamer.placeholderView );
+	killImage( device, streamer.placeholder.image );
+	killMemory( device, streamer.placeholder.memory );
+
+	if( streamer.transferCommandPool != streamer.graphicsCommandPool ) killCommandPool( device, streamer.transferCommandPool );
+	killCommandPool( device, streamer.graphicsCommandPool );
+}
+
+uint32_t requestStreamedTexture( TextureStreamer& streamer, const string& path, const bool mipmapped ){
+	const uint32_t id = static_cast<uint32_t>( streamer.textures.size() );
+	streamer.textures.push_back( { {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_FORMAT_UNDEFINED, 0}, VK_NULL_HANDLE, 0, false, nullptr } );
+	streamer.decoder->request( id, path, mipmapped );
+
+	return id;
+}
+
+VkImageView getStreamedTextureView( const TextureStreamer& streamer, const uint32_t texture ){
+	const VkImageView view = streamer.textures[texture].view;
+	return view ? view : streamer.placeholderView;
+}
+
+// levels [firstLevel, texture.residentLevel) from staging into the image, ending in SHADER_READ_ONLY_OPTIMAL owned by the graphics family
+TextureUpload startTextureUpload( const VkDevice device, const TextureStreamer& streamer, const uint32_t textureId, const StreamedTexture& texture, const uint32_t firstLevel ){
+	const DecodedTexture& decoded = *texture.decoded;
+	const VkDeviceSize alignment = std::max( getBlockFormatInfo( decoded.format ).bytesPerBlock, 4u ); // bufferOffset: multiple of the block size and of 4
+	const uint32_t levelCount = texture.residentLevel - firstLevel;
+
+	TextureUpload upload{};
+	upload.texture = textureId;
+	upload.firstLevel = firstLevel;
+
+	vector<VkBufferImageCopy> regions( levelCount );
+	VkDeviceSize stagingSize = 0;
+	for( uint32_t i = 0; i < levelCount; ++i ){
+		const uint32_t level = firstLevel + i;
+		stagingSize = (stagingSize + alignment - 1) / alignment * alignment;
+
+		regions[i] = {};
+		regions[i].bufferOffset = stagingSize;
+		regions[i].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		regions[i].imageExtent = { std::max( decoded.width >> level, 1u ), std::max( decoded.height >> level, 1u ), 1 }; // whole levels: fine for any minImageTransferGranularity
+
+		stagingSize += decoded.levels[level].size();
+	}
+
+	createBuffer( device, streamer.physicalDevice, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, upload.stagingBuffer, upload.stagingBufferMemory );
+	void* data;
+	{VkResult errorCode = vkMapMemory( device, upload.stagingBufferMemory, 0, stagingSize, 0, &data ); RESULT_HANDLER( errorCode, "vkMapMemory" );}
+	for( uint32_t i = 0; i < levelCount; ++i ){
+		const vector<uint8_t>& level = decoded.levels[firstLevel + i];
+		std::memcpy( static_cast<uint8_t*>( data ) + regions[i].bufferOffset, level.data(), level.size() );
+	}
+	vkUnmapMemory( device, upload.stagingBufferMemory );
+
+	const bool ownershipTransfer = streamer.transferQueueFamily != streamer.graphicsQueueFamily;
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = texture.texture.image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, firstLevel, levelCount, 0, 1 };
+
+	// the levels were never used: no ownership to acquire on the transfer queue
+	upload.transferCommandBuffer = beginSingleTimeCommands( streamer.transferCommandPool, device );
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		vkCmdPipelineBarrier( upload.transferCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier );
+
+		vkCmdCopyBufferToImage( upload.transferCommandBuffer, upload.stagingBuffer, texture.texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, regions.data() );
+
+		// release to the graphics family (with its layout transition), or the plain transition when it is the same queue
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = ownershipTransfer ? 0 : VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		if( ownershipTransfer ){
+			barrier.srcQueueFamilyIndex = streamer.transferQueueFamily;
+			barrier.dstQueueFamilyIndex = streamer.graphicsQueueFamily;
+		}
+		vkCmdPipelineBarrier(
+			upload.transferCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, ownershipTransfer ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier
+		);
+	{VkResult errorCode = vkEndCommandBuffer( upload.transferCommandBuffer ); RESULT_HANDLER( errorCode, "vkEndCommandBuffer" );}
+
+	upload.done = initFence( device );
+
+	if( !ownershipTransfer ){
+		const VkSubmitInfo submit{ VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr, 0, nullptr, nullptr, 1, &upload.transferCommandBuffer, 0, nullptr };
+		VkResult errorCode = vkQueueSubmit( streamer.transferQueue, 1, &submit, upload.done ); RESULT_HANDLER( errorCode, "vkQueueSubmit" );
+		return upload;
+	}
+
+	// matching acquire on the graphics queue, after the copy
+	upload.acquireCommandBuffer = beginSingleTimeCommands( streamer.graphicsCommandPool, device );
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier( upload.acquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier );
+	{VkResult errorCode = vkEndCommandBuffer( upload.acquireCommandBuffer ); RESULT_HANDLER( errorCode, "vkEndCommandBuffer" );}
+
+	upload.transferDone = initSemaphore( device );
+	const VkPipelineStageFlags acquireStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	const VkSubmitInfo transferSubmit{ VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr, 0, nullptr, nullptr, 1, &upload.transferCommandBuffer, 1, &upload.transferDone };
+	const VkSubmitInfo acquireSubmit{ VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr, 1, &upload.transferDone, &acquireStage, 1, &upload.acquireCommandBuffer, 0, nullptr };
+	{VkResult errorCode = vkQueueSubmit( streamer.transferQueue, 1, &transferSubmit, VK_NULL_HANDLE ); RESULT_HANDLER( errorCode, "vkQueueSubmit" );}
+	{VkResult errorCode = vkQueueSubmit( streamer.graphicsQueue, 1, &acquireSubmit, upload.done ); RESULT_HANDLER( errorCode, "vkQueueSubmit" );}
+
+	return upload;
+}
+
+bool updateTextureStreamer( const VkDevice device, TextureStreamer& streamer, const VkDeviceSize uploadBudget ){
+	bool viewsChanged = false;
+
+	for( DecodeResult& result : streamer.decoder->takeResults() ){
+		if( !result.decoded ){
+			logger << "ERROR: texture streaming: " << result.error << " -- keeping the placeholder" << std::endl;
+			continue;
+		}
+
+		StreamedTexture& texture = streamer.textures[result.texture];
+		const DecodedTexture& decoded = *result.decoded;
+		texture.texture.format = decoded.format;
+		texture.texture.mipLevels = static_cast<uint32_t>( decoded.levels.size() );
+		createImage(
+			device,
+			streamer.physicalDevice,
+			decoded.width,
+			decoded.height,
+			texture.texture.mipLevels,
+			decoded.format,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			texture.texture.image,
+			texture.texture.memory
+		);
+		texture.residentLevel = texture.texture.mipLevels;
+		texture.decoded = std::move( result.decoded );
+	}
+
+	// fences poll the upload's progress, like a timeline value would
+	for( size_t i = 0; i < streamer.uploads.size(); ){
+		const TextureUpload& upload = streamer.uploads[i];
+		const VkResult status = vkGetFenceStatus( device, upload.done );
+		if( status == VK_NOT_READY ){ ++i; continue; }
+		RESULT_HANDLER( status, "vkGetFenceStatus" );
+
+		StreamedTexture& texture = streamer.textures[upload.texture];
+		if( texture.view ) streamer.retiredViews.push_back( texture.view );
+		texture.view = initStreamedTextureView( device, texture.texture, upload.firstLevel );
+		texture.residentLevel = upload.firstLevel;
+		texture.uploading = false;
+		if( texture.residentLevel == 0 ) texture.decoded.reset();
+		viewsChanged = true;
+
+		killTextureUpload( device, streamer, upload );
+		streamer.uploads[i] = streamer.uploads.back();
+		streamer.uploads.pop_back();
+	}
+
+	// coarsest first: everything up to 64^2 in one go (a few KB), then one finer level per upload
+	const uint32_t coarseSize = 64;
+	VkDeviceSize budgetLeft = uploadBudget;
+	for( uint32_t id = 0; id < streamer.textures.size(); ++id ){
+		const StreamedTexture& texture = streamer.textures[id];
+		if( !texture.decoded || texture.uploading || texture.residentLevel == 0 ) continue;
+
+		uint32_t firstLevel = texture.residentLevel - 1;
+		if( texture.residentLevel == texture.texture.mipLevels ){
+			const uint32_t largestSide = std::max( texture.decoded->width, texture.decoded->height );
+			while( firstLevel > 0 && (largestSide >> (firstLevel - 1)) <= coarseSize ) --firstLevel;
+		}
+
+		VkDeviceSize size = 0;
+		for( uint32_t level = firstLevel; level < texture.residentLevel; ++level ) size += texture.decoded->levels[level].size();
+		if( size > budgetLeft && budgetLeft < uploadBudget ) break; // over budget; a single level bigger than the whole budget still goes alone
+		budgetLeft -= std::min( size, budgetLeft );
+
+		streamer.uploads.push_back(  startTextureUpload( device, streamer, id, texture, firstLevel )  );
+		streamer.textures[id].uploading = true;
+	}
+
+	return viewsChanged;
+}
+
+void killRetiredTextureViews( const VkDevice device, TextureStreamer& streamer ){
+	for( const VkImageView view : streamer.retiredViews ) killImageView( device, view );
+	streamer.retiredViews.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bindless textures
+
+void requestBindlessSupport( VkPhysicalDevice physicalDevice, const vector<const char*>& layers, VkPhysicalDeviceDescriptorIndexingFeaturesEXT& indexingFeatures, vector<const char*>& deviceExtensions ){
+	const vector<VkExtensionProperties> supportedExtensions = getSupportedDeviceExtensions( physicalDevice, layers );
+	if( !isExtensionSupported( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME, supportedExtensions ) ) throw "Bindless textures need the " VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME " extension!";
+	if( !isExtensionSupported( VK_KHR_MAINTENANCE3_EXTENSION_NAME, supportedExtensions ) ) throw "Bindless textures need the " VK_KHR_MAINTENANCE3_EXTENSION_NAME " extension!";
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported{};
+	supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &supported, {} };
+	vkGetPhysicalDeviceFeatures2KHR( physicalDevice, &features2 );
+
+	if( !supported.runtimeDescriptorArray ) throw "Bindless textures need the runtimeDescriptorArray feature!";
+	if( !supported.descriptorBindingPartiallyBound ) throw "Bindless textures need the descriptorBindingPartiallyBound feature!";
+	if( !supported.descriptorBindingSampledImageUpdateAfterBind ) throw "Bindless textures need the descriptorBindingSampledImageUpdateAfterBind feature!";
+	if( !supported.descriptorBindingUpdateUnusedWhilePending ) throw "Bindless textures need the descriptorBindingUpdateUnusedWhilePending feature!";
+	if( !supported.shaderSampledImageArrayNonUniformIndexing ) throw "Bindless textures need the shaderSampledImageArrayNonUniformIndexing feature!";
+
+	indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	indexingFeatures.runtimeDescriptorArray = VK_TRUE; // textures[] has no size in the shader
+	indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE; // slots not handed out yet stay unwritten
+	indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE; // adding textures does not wait for the frames in flight
+	indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE; // instances of one draw may use different textures
+
+	deviceExtensions.push_back( VK_KHR_MAINTENANCE3_EXTENSION_NAME ); // required by descriptor indexing
+	deviceExtensions.push_back( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME );
+}
+
+BindlessTextureTable initBindlessTextureTable( const VkDevice device, const VkPhysicalDevice physicalDevice, const VkSampler sampler, const uint32_t capacity ){
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &indexingProperties, {} };
+	vkGetPhysicalDeviceProperties2KHR( physicalDevice, &properties2 );
+
+	BindlessTextureTable table{};
+	table.capacity = std::min({
+		capacity,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProperties.maxUpdateAfterBindDescriptorsInAllPools - 1 // the sampler
+	});
+	table.count = 0;
+
+	// must match the BINDLESS_TEXTURES variant of fragmentShader.frag
+	const std::array<VkDescriptorSetLayoutBinding, 2> bindings{{
+		{ 0, VK_DESCRIPTOR_TYPE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &sampler },
+		{ 1, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, table.capacity, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr }
+	}};
+	const std::array<VkDescriptorBindingFlagsEXT, 2> bindingFlags{{
+		0,
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT
+	}};
+	const VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT,
+		nullptr, // pNext
+		static_cast<uint32_t>( bindingFlags.size() ),
+		bindingFlags.data()
+	};
+	const VkDescriptorSetLayoutCreateInfo layoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		&bindingFlagsInfo, // pNext
+		VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT,
+		static_cast<uint32_t>( bindings.size() ),
+		bindings.data()
+	};
+	{VkResult errorCode = vkCreateDescriptorSetLayout( device, &layoutInfo, nullptr, &table.descriptorSetLayout ); RESULT_HANDLER( errorCode, "vkCreateDescriptorSetLayout" );}
+
+	const std::array<VkDescriptorPoolSize, 2> poolSizes{{
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, table.capacity }
+	}};
+	const VkDescriptorPoolCreateInfo poolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		nullptr, // pNext
+		VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT,
+		1, // max sets
+		static_cast<uint32_t>( poolSizes.size() ),
+		poolSizes.data()
+	};
+	{VkResult errorCode = vkCreateDescriptorPool( device, &poolInfo, nullptr, &table.descriptorPool ); RESULT_HANDLER( errorCode, "vkCreateDescriptorPool" );}
+
+	const VkDescriptorSetAllocateInfo allocInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		nullptr, // pNext
+		table.descriptorPool,
+		1, &table.descriptorSetLayout
+	};
+	{VkResult errorCode = vkAllocateDescriptorSets( device, &allocInfo, &table.descriptorSet ); RESULT_HANDLER( errorCode, "vkAllocateDescriptorSets" );}
+
+	return table;
+}
+
+void killBindlessTextureTable( const VkDevice device, BindlessTextureTable& table ){
+	vkDestroyDescriptorPool( device, table.descriptorPool, nullptr );
+	vkDestroyDescriptorSetLayout( device, table.descriptorSetLayout, nullptr );
+	table = {};
+}
+
+uint32_t addBindlessTexture( const VkDevice device, BindlessTextureTable& table, const VkImageView view ){
+	if( table.count == table.capacity ) throw "The bindless texture table is full!";
+
+	const uint32_t textureIndex = table.count++;
+	setBindlessTexture( device, table, textureIndex, view );
+	return textureIndex;
+}
+
+void setBindlessTexture( const VkDevice device, const BindlessTextureTable& table, const uint32_t textureIndex, const VkImageView view ){
+	const VkDescriptorImageInfo imageInfo{ VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = table.descriptorSet;
+	descriptorWrite.dstBinding = 1;
+	descriptorWrite.dstArrayElement = textureIndex;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets( device, 1, &descriptorWrite, 0, nullptr );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Virtual texturing
+
+bool requestSparseResidencySupport( const VkPhysicalDevice physicalDevice, const uint32_t queueFamily, const VkFormat format, const uint32_t pageSize, VkPhysicalDeviceFeatures& features ){
+	const VkPhysicalDeviceFeatures supported = getPhysicalDeviceFeatures( physicalDevice );
+	if( !supported.sparseBinding || !supported.sparseResidencyImage2D ) return false;
+	if( !(getQueueFamilyProperties( physicalDevice )[queueFamily].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) ) return false;
+
+	const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	uint32_t count;
+	vkGetPhysicalDeviceSparseImageFormatProperties( physicalDevice, format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT, usage, VK_IMAGE_TILING_OPTIMAL, &count, nullptr );
+	vector<VkSparseImageFormatProperties> properties( count );
+	vkGetPhysicalDeviceSparseImageFormatProperties( physicalDevice, format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT, usage, VK_IMAGE_TILING_OPTIMAL, &count, properties.data() );
+
+	// a page has to be exactly one sparse block, the unit memory gets bound in
+	const auto color = std::find_if( properties.begin(), properties.end(), []( const VkSparseImageFormatProperties& p ){ return p.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT; } );
+	if( color == properties.end() || color->imageGranularity.width != pageSize || color->imageGranularity.height != pageSize ) return false;
+
+	features.sparseBinding = VK_TRUE;
+	features.sparseResidencyImage2D = VK_TRUE;
+	return true;
+}
+
+// the region of a page in the sparse virtual image, bound to memory (or unbound with VK_NULL_HANDLE)
+VkSparseImageMemoryBind getSparsePageBind( const VirtualTextureLayout& layout, const uint32_t page, const VkDeviceMemory memory, const VkDeviceSize memoryOffset ){
+	return {
+		{ VK_IMAGE_ASPECT_COLOR_BIT, getPageMip( page ), 0 },
+		{ int32_t( getPageX( page ) * layout.pageSize ), int32_t( getPageY( page ) * layout.pageSize ), 0 },
+		{ layout.pageSize, layout.pageSize, 1 },
+		memory,
+		memoryOffset,
+		0 // flags
+	};
+}
+
+// moves the slot memory of the evicted pages over to the loaded ones; waits for the binds
+void bindSparsePages( const VkDevice device, const VirtualTexture& vt ){
+	vector<VkSparseImageMemoryBind> unbinds;
+	vector<VkSparseImageMemoryBind> binds;
+	for( const PageLoad& load : vt.pendingLoads ){
+		if( load.evictedPage != invalidPageId ) unbinds.push_back( getSparsePageBind( vt.layout, load.evictedPage, VK_NULL_HANDLE, 0 ) );
+		binds.push_back( getSparsePageBind( vt.layout, load.page, vt.sparsePageMemory, load.slot * vt.sparsePageBytes ) );
+	}
+
+	// without the semaphore, the two batches could execute in any order
+	const VkSparseImageMemoryBindInfo unbindInfo{ vt.pages.image, static_cast<uint32_t>( unbinds.size() ), unbinds.data() };
+	const VkSparseImageMemoryBindInfo bindInfo{ vt.pages.image, static_cast<uint32_t>( binds.size() ), binds.data() };
+	const bool unbind = !unbinds.empty();
+	const VkBindSparseInfo batches[] = {
+		{ VK_STRUCTURE_TYPE_BIND_SPARSE_INFO, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 1, &unbindInfo, 1, &vt.sparseUnbound },
+		{ VK_STRUCTURE_TYPE_BIND_SPARSE_INFO, nullptr, unbind ? 1u : 0u, &vt.sparseUnbound, 0, nullptr, 0, nullptr, 1, &bindInfo, 0, nullptr }
+	};
+
+	if( unbind ){VkResult errorCode = vkQueueBindSparse( vt.queue, 1, &batches[0], VK_NULL_HANDLE ); RESULT_HANDLER( errorCode, "vkQueueBindSparse" );}
+	{VkResult errorCode = vkQueueBindSparse( vt.queue, 1, &batches[1], vt.sparseBound ); RESULT_HANDLER( errorCode, "vkQueueBindSparse" );}
+	{VkResult errorCode = vkWaitForFences( device, 1, &vt.sparseBound, VK_TRUE, UINT64_MAX ); RESULT_HANDLER( errorCode, "vkWaitForFences" );}
+	{VkResult errorCode = vkResetFences( device, 1, &vt.sparseBound ); RESULT_HANDLER( errorCode, "vkResetFences" );}
+}
+
+VkDeviceSize getStagedPageSize( const VirtualTexture& vt ){
+	const uint32_t side = vt.layout.pageSize + 2 * vt.layout.pageBorder;
+	return VkDeviceSize( side ) * side * 4;
+}
+
+// the pending pages and the whole indirection into the staging buffer
+void stageVirtualTextureLoads( const VkDevice device, VirtualTexture& vt ){
+	const VkDeviceSize pageBytes = getStagedPageSize( vt );
+	parallelFor(  static_cast<uint32_t>( vt.pendingLoads.size() ), std::max( 1u, std::thread::hardware_concurrency() ), [&]( const uint32_t i ){
+		vt.pageSource( vt.layout, vt.pendingLoads[i].page, vt.layout.pageBorder, vt.staging + i * pageBytes );
+	}  );
+
+	uint8_t* indirection = vt.staging + virtualTextureUploadsPerFrame * pageBytes;
+	for( const vector<uint8_t>& level : buildIndirection( vt.layout, vt.cache ) ){
+		std::memcpy( indirection, level.data(), level.size() );
+		indirection += level.size();
+	}
+
+	if( vt.sparse ) bindSparsePages( device, vt );
+}
+
+void recordVirtualTextureCopies( const VkCommandBuffer commandBuffer, const VirtualTexture& vt, const VkImageLayout oldLayout ){
+	const VkDeviceSize pageBytes = getStagedPageSize( vt );
+	const uint32_t slotSide = vt.layout.pageSize + 2 * vt.layout.pageBorder;
+
+	vector<VkBufferImageCopy> pageRegions( vt.pendingLoads.size() );
+	for( size_t i = 0; i < vt.pendingLoads.size(); ++i ){
+		const PageLoad& load = vt.pendingLoads[i];
+
+		pageRegions[i] = {};
+		pageRegions[i].bufferOffset = i * pageBytes;
+		if( vt.sparse ){ // into the page's own region, no border
+			pageRegions[i].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, getPageMip( load.page ), 0, 1 };
+			pageRegions[i].imageOffset = { int32_t( getPageX( load.page ) * vt.layout.pageSize ), int32_t( getPageY( load.page ) * vt.layout.pageSize ), 0 };
+			pageRegions[i].imageExtent = { vt.layout.pageSize, vt.layout.pageSize, 1 };
+		}
+		else{
+			pageRegions[i].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			pageRegions[i].imageOffset = { int32_t( load.slot % vt.cache.slotsPerRow * slotSide ), int32_t( load.slot / vt.cache.slotsPerRow * slotSide ), 0 };
+			pageRegions[i].imageExtent = { slotSide, slotSide, 1 };
+		}
+	}
+
+	vector<VkBufferImageCopy> indirectionRegions( vt.layout.mipLevels );
+	VkDeviceSize indirectionOffset = virtualTextureUploadsPerFrame * pageBytes;
+	for( uint32_t mip = 0; mip < vt.layout.mipLevels; ++mip ){
+		const uint32_t pages = getPagesPerSide( vt.layout, mip );
+		indirectionRegions[mip] = {};
+		indirectionRegions[mip].bufferOffset = indirectionOffset;
+		indirectionRegions[mip].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1 };
+		indirectionRegions[mip].imageExtent = { pages, pages, 1 };
+		indirectionOffset += VkDeviceSize( pages ) * pages * 4;
+	}
+
+	std::array<VkImageMemoryBarrier, 2> barriers{};
+	for( VkImageMemoryBarrier& barrier : barriers ){
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0; // the frames sampling them are done, write-after-read needs no memory dependency
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	}
+	barriers[0].image = vt.pages.image;
+	barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, vt.pages.mipLevels, 0, 1 };
+	barriers[1].image = vt.indirection.image;
+	barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, vt.indirection.mipLevels, 0, 1 };
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>( barriers.size() ), barriers.data() );
+
+	vkCmdCopyBufferToImage( commandBuffer, vt.stagingBuffer, vt.pages.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>( pageRegions.size() ), pageRegions.data() );
+	vkCmdCopyBufferToImage( commandBuffer, vt.stagingBuffer, vt.indirection.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>( indirectionRegions.size() ), indirectionRegions.data() );
+
+	for( VkImageMemoryBarrier& barrier : barriers ){
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>( barriers.size() ), barriers.data() );
+}
+
+VkSampler initVirtualTextureSampler( const VkDevice device, const VkFilter filter, const VkSamplerMipmapMode mipmapMode ){
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = filter;
+	samplerInfo.minFilter = filter;
+	samplerInfo.mipmapMode = mipmapMode;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxAnisotropy = 1.0f;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+	VkSampler sampler;
+	VkResult errorCode = vkCreateSampler( device, &samplerInfo, nullptr, &sampler ); RESULT_HANDLER( errorCode, "vkCreateSampler" );
+	return sampler;
+}
+
+VirtualTexture initVirtualTexture( const VkDevice device, const VkPhysicalDevice physicalDevice, const VkQueue queue, const VkCommandPool commandPool, const bool sparse, uint32_t size, VirtualPageSource pageSource, const uint32_t viewportWidth, const uint32_t viewportHeight ){
+	const VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+	const VkPhysicalDeviceLimits limits = getPhysicalDeviceProperties( physicalDevice ).limits;
+
+	// the virtual image has to exist for real: within the image size and sparse address space limits (level 0 plus a third for the rest)
+	if( sparse ){
+		while( size > limits.maxImageDimension2D || VkDeviceSize( size ) * size * 4 /*bytes per texel*/ * 4 / 3 > limits.sparseAddressSpaceSize ) size /= 2;
+	}
+
+	VirtualTexture vt{};
+	vt.layout = makeVirtualTextureLayout( size, virtualTexturePageSize, sparse ? 0 : virtualTexturePageBorder );
+	vt.cache = initPageCache( vt.layout, virtualTexturePageSlots, virtualTexturePageSlots );
+	vt.pageSource = std::move( pageSource );
+	vt.sparse = sparse;
+	vt.queue = queue;
+
+	if( sparse ){
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.flags = VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent = { size, size, 1 };
+		imageInfo.mipLevels = vt.layout.mipLevels; // down to one page; finer than a sparse block would go into the mip tail
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		{VkResult errorCode = vkCreateImage( device, &imageInfo, nullptr, &vt.pages.image ); RESULT_HANDLER( errorCode, "vkCreateImage" );}
+		vt.pages.memory = VK_NULL_HANDLE;
+		vt.pages.format = format;
+		vt.pages.mipLevels = vt.layout.mipLevels;
+
+		uint32_t requirementCount;
+		vkGetImageSparseMemoryRequirements( device, vt.pages.image, &requirementCount, nullptr );
+		vector<VkSparseImageMemoryRequirements> sparseRequirements( requirementCount );
+		vkGetImageSparseMemoryRequirements( device, vt.pages.image, &requirementCount, sparseRequirements.data() );
+		for( const VkSparseImageMemoryRequirements& requirements : sparseRequirements ){
+			if( requirements.formatProperties.aspectMask & VK_IMAGE_ASPECT_METADATA_BIT ) throw "virtual texture: sparse images needing metadata are not supported!";
+			if( requirements.imageMipTailFirstLod < vt.layout.mipLevels ) throw "virtual texture: sparse mip tail within the page levels is not supported!";
+		}
+
+		// alignment = the size of a sparse block
+		const VkMemoryRequirements memoryRequirements = getMemoryRequirements<ResourceType::Image>( device, vt.pages.image );
+		vt.sparsePageBytes = memoryRequirements.alignment;
+		const VkMemoryAllocateInfo memoryInfo{
+			VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			nullptr, // pNext
+			vt.sparsePageBytes * vt.cache.slotPages.size(),
+			findMemoryType( physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT )
+		};
+		{VkResult errorCode = vkAllocateMemory( device, &memoryInfo, nullptr, &vt.sparsePageMemory ); RESULT_HANDLER( errorCode, "vkAllocateMemory" );}
+
+		vt.sparseUnbound = initSemaphore( device );
+		vt.sparseBound = initFence( device );
+		vt.pagesSampler = initVirtualTextureSampler( device, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR );
+	}
+	else{
+		const uint32_t side = virtualTexturePageSlots * (vt.layout.pageSize + 2 * vt.layout.pageBorder);
+		createImage( device, physicalDevice, side, side, 1, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vt.pages.image, vt.pages.memory );
+		vt.pages.format = format;
+		vt.pages.mipLevels = 1;
+
+		vt.pagesSampler = initVirtualTextureSampler( device, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_NEAREST );
+	}
+	vt.pagesView = createImageView( device, vt.pages.image, format, VK_IMAGE_ASPECT_COLOR_BIT, vt.pages.mipLevels );
+
+	createImage( device, physicalDevice, vt.layout.pages, vt.layout.pages, vt.layout.mipLevels, VK_FORMAT_R8G8B8A8_UINT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vt.indirection.image, vt.indirection.memory );
+	vt.indirection.format = VK_FORMAT_R8G8B8A8_UINT;
+	vt.indirection.mipLevels = vt.layout.mipLevels;
+	vt.indirectionView = createImageView( device, vt.indirection.image, vt.indirection.format, VK_IMAGE_ASPECT_COLOR_BIT, vt.indirection.mipLevels );
+	vt.indirectionSampler = initVirtualTextureSampler( device, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST ); // texelFetch only
+
+	VkDeviceSize indirectionBytes = 0;
+	for( uint32_t mip = 0; mip < vt.layout.mipLevels; ++mip ) indirectionBytes += VkDeviceSize( getPagesPerSide( vt.layout, mip ) ) * getPagesPerSide( vt.layout, mip ) * 4;
+	const VkDeviceSize stagingSize = virtualTextureUploadsPerFrame * getStagedPageSize( vt ) + indirectionBytes;
+	createBuffer( device, physicalDevice, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vt.stagingBuffer, vt.stagingBufferMemory );
+	{
+		void* data;
+		VkResult errorCode = vkMapMemory( device, vt.stagingBufferMemory, 0, VK_WHOLE_SIZE, 0, &data ); RESULT_HANDLER( errorCode, "vkMapMemory" );
+		vt.staging = static_cast<uint8_t*>( data );
+	}
+
+	// feedback target: page ids and depth, copied into a host visible buffer
+	vt.feedbackWidth = (viewportWidth + virtualTextureFeedbackScale - 1) / virtualTextureFeedbackScale;
+	vt.feedbackHeight = (viewportHeight + virtualTextureFeedbackScale - 1) / virtualTextureFeedbackScale;
+	const VkSurfaceFormatKHR feedbackFormat = { VK_FORMAT_R32_UINT, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+	createImage( device, physicalDevice, vt.feedbackWidth, vt.feedbackHeight, 1, feedbackFormat.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vt.feedbackImage, vt.feedbackImageMemory );
+	vt.feedbackImageView = createImageView( device, vt.feedbackImage, feedbackFormat.format, VK_IMAGE_ASPECT_COLOR_BIT );
+	const VkFormat depthFormat = findDepthFormat( physicalDevice );
+	createImage( device, physicalDevice, vt.feedbackWidth, vt.feedbackHeight, 1, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vt.feedbackDepthImage, vt.feedbackDepthImageMemory );
+	vt.feedbackDepthImageView = createImageView( device, vt.feedbackDepthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT );
+	vt.feedbackRenderPass = initRenderPass( device, physicalDevice, feedbackFormat, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL );
+	vt.feedbackFramebuffers = initFramebuffers( device, vt.feedbackRenderPass, vt.feedbackDepthImageView, { vt.feedbackImageView }, vt.feedbackWidth, vt.feedbackHeight );
+
+	const VkDeviceSize feedbackSize = VkDeviceSize( vt.feedbackWidth ) * vt.feedbackHeight * sizeof( uint32_t );
+	createBuffer( device, physicalDevice, feedbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vt.feedbackBuffer, vt.feedbackBufferMemory );
+	{
+		void* data;
+		VkResult errorCode = vkMapMemory( device, vt.feedbackBufferMemory, 0, VK_WHOLE_SIZE, 0, &data ); RESULT_HANDLER( errorCode, "vkMapMemory" );
+		std::memset( data, 0xFF, feedbackSize ); // invalidPageId -- the first update asks for nothing
+		vt.feedback = static_cast<const uint32_t*>( data );
+	}
+
+	// the root page and an indirection pointing everything at it
+	vt.pendingLoads = { { vt.cache.slotPages[0], 0, invalidPageId } };
+	stageVirtualTextureLoads( device, vt );
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands( commandPool, device );
+		recordVirtualTextureCopies( commandBuffer, vt, VK_IMAGE_LAYOUT_UNDEFINED );
+	endSingleTimeCommands( queue, commandPool, device, commandBuffer );
+	vt.pendingLoads.clear();
+
+	return vt;
+}
+
+void killVirtualTexture( const VkDevice device, VirtualTexture& vt ){
+	vkUnmapMemory( device, vt.feedbackBufferMemory );
+	killBuffer( device, vt.feedbackBuffer );
+	killMemory( device, vt.feedbackBufferMemory );
+	killFramebuffers( device, vt.feedbackFramebuffers );
+	killRenderPass( device, vt.feedbackRenderPass );
+	killImageView( device, vt.feedbackDepthImageView );
+	killImage( device, vt.feedbackDepthImage );
+	killMemory( device, vt.feedbackDepthImageMemory );
+	killImageView( device, vt.feedbackImageView );
+	killImage( device, vt.feedbackImage );
+	killMemory( device, vt.feedbackImageMemory );
+
+	vkUnmapMemory( device, vt.stagingBufferMemory );
+	killBuffer( device, vt.stagingBuffer );
+	killMemory( device, vt.stagingBufferMemory );
+
+	vkDestroySampler( device, vt.indirectionSampler, nullptr );
+	killImageView( device, vt.indirectionView );
+	killImage( device, vt.indirection.image );
+	killMemory( device, vt.indirection.memory );
+
+	vkDestroySampler( device, vt.pagesSampler, nullptr );
+	killImageView( device, vt.pagesView );
+	killImage( device, vt.pages.image );
+	if( vt.sparse ){
+		killFence( device, vt.sparseBound );
+		killSemaphore( device, vt.sparseUnbound );
+		killMemory( device, vt.sparsePageMemory );
+	}
+	else killMemory( device, vt.pages.memory );
+}
+
+VkDescriptorSetLayout createVirtualTextureDescriptorSetLayout( const VkDevice device ){
+	const std::array<VkDescriptorSetLayoutBinding, 4> bindings{{
+		{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+		{ 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+		{ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+		{ 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr }
+	}};
+	const VkDescriptorSetLayoutCreateInfo layoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags
+		static_cast<uint32_t>( bindings.size() ),
+		bindings.data()
+	};
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkResult errorCode = vkCreateDescriptorSetLayout( device, &layoutInfo, nullptr, &descriptorSetLayout ); RESULT_HANDLER( errorCode, "vkCreateDescriptorSetLayout" );
+	return descriptorSetLayout;
+}
+
+VkDescriptorSet createVirtualTextureDescriptorSet( const VkDevice device, const VkDescriptorPool descriptorPool, const VkDescriptorSetLayout descriptorSetLayout, const VkBuffer uniformBuffer, const VkBuffer objectBuffer, const VirtualTexture& vt ){
+	const VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, nullptr, descriptorPool, 1, &descriptorSetLayout };
+	VkDescriptorSet descriptorSet;
+	{VkResult errorCode = vkAllocateDescriptorSets( device, &allocInfo, &descriptorSet ); RESULT_HANDLER( errorCode, "vkAllocateDescriptorSets" );}
+
+	const VkDescriptorBufferInfo uniformInfo{ uniformBuffer, 0, sizeof( UniformBufferObject ) };
+	const VkDescriptorBufferInfo objectInfo{ objectBuffer, 0, VK_WHOLE_SIZE };
+	const VkDescriptorImageInfo pagesInfo{ vt.pagesSampler, vt.pagesView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	const VkDescriptorImageInfo indirectionInfo{ vt.indirectionSampler, vt.indirectionView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+	const std::array<VkWriteDescriptorSet, 4> writes{{
+		{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptorSet, 0, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, nullptr, &uniformInfo, nullptr },
+		{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptorSet, 1, 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &pagesInfo, nullptr, nullptr },
+		{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptorSet, 2, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &objectInfo, nullptr },
+		{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptorSet, 3, 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &indirectionInfo, nullptr, nullptr }
+	}};
+	vkUpdateDescriptorSets( device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+
+	return descriptorSet;
+}
+
+VirtualTextureStats updateVirtualTexture( const VkDevice device, VirtualTexture& vt ){
+	VirtualTextureStats stats{};
+	++vt.frame;
+
+	const auto analysisStart = std::chrono::high_resolution_clock::now();
+	const vector<PageRequest> requests = analyzeFeedback( vt.feedback, size_t( vt.feedbackWidth ) * vt.feedbackHeight, vt.layout );
+	vt.pendingLoads = updatePageCache( vt.cache, requests, vt.frame, virtualTextureUploadsPerFrame );
+	stats.analysisMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - analysisStart ).count();
+
+	stats.requestedPages = static_cast<uint32_t>( requests.size() );
+	stats.loadedPages = static_cast<uint32_t>( vt.pendingLoads.size() );
+	stats.residentPages = getResidentPageCount( vt.cache );
+	if( vt.pendingLoads.empty() ) return stats; // the indirection stays as it is
+
+	const auto loadStart = std::chrono::high_resolution_clock::now();
+	stageVirtualTextureLoads( device, vt );
+	stats.loadMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - loadStart ).count();
+
+	return stats;
+}
+
+void recordVirtualTextureUploads( const VkCommandBuffer commandBuffer, const VirtualTexture& vt ){
+	if( !vt.pendingLoads.empty() ) recordVirtualTextureCopies( commandBuffer, vt, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+}
+
+void recordBeginVirtualTextureFeedback( const VkCommandBuffer commandBuffer, const VirtualTexture& vt ){
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color.uint32[0] = invalidPageId;
+	clearValues[1].depthStencil = { 1.0f, 0 };
+
+	recordBeginRenderPass( commandBuffer, vt.feedbackRenderPass, vt.feedbackFramebuffers[0], clearValues.data(), vt.feedbackWidth, vt.feedbackHeight );
+}
+
+void recordEndVirtualTextureFeedback( const VkCommandBuffer commandBuffer, const VirtualTexture& vt ){
+	recordEndRenderPass( commandBuffer );
+
+	// the render pass left it in TRANSFER_SRC_OPTIMAL; its external dependency does not cover the copy
+	VkImageMemoryBarrier imageBarrier{};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = vt.feedbackImage;
+	imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier );
+
+	VkBufferImageCopy region{};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { vt.feedbackWidth, vt.feedbackHeight, 1 };
+	vkCmdCopyImageToBuffer( commandBuffer, vt.feedbackImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, vt.feedbackBuffer, 1, &region );
+
+	const VkBufferMemoryBarrier bufferBarrier{
+		VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+		nullptr, // pNext
+		VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_ACCESS_HOST_READ_BIT,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+		vt.feedbackBuffer,
+		0, VK_WHOLE_SIZE
+	};
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Resource cache
+
+// bump when the decoded texture changes for the same file, so the ones on disk are decoded again
+constexpr const char* resourceCacheVersion = "1";
+
+string getResourceIndexPath( const string& directory ){
+	return directory + "/index.txt";
+}
+
+string getCachedTexturePath( const string& directory, const uint64_t key ){
+	return directory + "/" + getContentKeyText( key ) + ".rct";
+}
+
+ResourceCache initResourceCache( const VkPhysicalDevice physicalDevice, const VkCommandPool commandPool, const VkQueue queue, const string& directory, const VkDeviceSize budget ){
+	std::error_code error;
+	std::filesystem::create_directories( directory, error );
+	if( error ) throw "cannot create the resource cache directory!";
+
+	ResourceCache cache{};
+	cache.physicalDevice = physicalDevice;
+	cache.commandPool = commandPool;
+	cache.queue = queue;
+	cache.isSampleable = [physicalDevice]( const VkFormat format ){
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties( physicalDevice, format, &formatProperties );
+		return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	};
+	cache.directory = directory;
+	cache.index = readResourceIndex( getResourceIndexPath( directory ) );
+	cache.budget = budget;
+
+	return cache;
+}
+
+void killCachedResource( const VkDevice device, const CachedResource& resource ){
+	if( resource.texture.image ){
+		killImageView( device, resource.view );
+		killImage( device, resource.texture.image );
+		killMemory( device, resource.texture.memory );
+	}
+	else{
+		killBuffer( device, resource.buffer );
+		killMemory( device, resource.bufferMemory );
+	}
+}
+
+void killResourceCache( const VkDevice device, ResourceCache& cache ){
+	for( const auto& resource : cache.resources ) killCachedResource( device, resource.second );
+	cache.resources.clear();
+	cache.unused.clear();
+	cache.residentBytes = 0;
+}
+
+// unreferenced resources, least recently released first, until the cache fits its budget or none is left
+void evictCachedResources( const VkDevice device, ResourceCache& cache ){
+	while( cache.residentBytes > cache.budget && !cache.unused.empty() ){
+		const auto evicted = cache.resources.find( cache.unused.back() );
+		cache.unused.pop_back();
+
+		cache.residentBytes -= evicted->second.bytes;
+		killCachedResource( device, evicted->second );
+		cache.resources.erase( evicted );
+		++cache.stats.evictions;
+	}
+}
+
+// another reference to a resident resource, or nullptr
+const CachedResource* referenceCachedResource( ResourceCache& cache, const uint64_t key ){
+	const auto found = cache.resources.find( key );
+	if( found == cache.resources.end() ) return nullptr;
+
+	CachedResource& resource = found->second;
+	if( resource.references++ == 0 ) cache.unused.erase( resource.unusedPosition );
+	++cache.stats.hits;
+	return &resource;
+}
+
+const CachedResource& addCachedResource( const VkDevice device, ResourceCache& cache, const CachedResource& resource ){
+	const CachedResource& added = cache.resources.emplace( resource.key, resource ).first->second;
+	cache.residentBytes += resource.bytes;
+	evictCachedResources( device, cache ); // makes room, if the others allow; the new one is referenced
+	return added;
+}
+
+const CachedResource& acquireCachedTexture( const VkDevice device, ResourceCache& cache, const string& path, const bool mipmapped ){
+	const vector<uint8_t> file = readResourceFile( path );
+	if( file.empty() ) throw "cannot read the texture file!";
+
+	const string settings = string( "texture " ) + resourceCacheVersion + (mipmapped ? " mipmapped" : "");
+	const uint64_t key = getContentKey( file.data(), file.size(), settings );
+	if( const CachedResource* resident = referenceCachedResource( cache, key ) ) return *resident;
+
+	// KTX2 the device samples as stored is as good as it gets; everything else is decoded once and kept on disk
+	DecodedTexture decoded;
+	if( cache.index.count( key ) && readCachedTexture( getCachedTexturePath( cache.directory, key ), decoded ) ) ++cache.stats.diskHits;
+	else{
+		decoded = decodeTextureFile( file, mipmapped, cache.isSampleable );
+		++cache.stats.misses;
+
+		Ktx2Header ktx2Header;
+		const bool storedAsIs = readKtx2Header( file.data(), file.size(), ktx2Header ) && ktx2Header.format == decoded.format;
+		if( !storedAsIs ){
+			writeCachedTexture( getCachedTexturePath( cache.directory, key ), decoded );
+			cache.index[key] = getCachedTextureInfo( decoded );
+			appendResourceIndex( getResourceIndexPath( cache.directory ), key, cache.index[key] ); // after the file, so the index never lists a missing one
+		}
+	}
+
+	vector<vector<vector<uint8_t>>> layers( 1 );
+	layers[0] = std::move( decoded.levels );
+
+	CachedResource resource{ key, {}, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, 0, 1, {} };
+	resource.texture = createTextureArrayImage( decoded.format, decoded.width, decoded.height, layers, device, cache.physicalDevice, cache.commandPool, cache.queue );
+	resource.view = createTextureImageView( device, resource.texture );
+	resource.bytes = getMemoryRequirements<ResourceType::Image>( device, resource.texture.image ).size;
+
+	return addCachedResource( device, cache, resource );
+}
+
+const CachedResource& acquireCachedBuffer( const VkDevice device, ResourceCache& cache, const void* data, const VkDeviceSize size, const VkBufferUsageFlags usage ){
+	const string settings = string( "buffer " ) + resourceCacheVersion + " " + std::to_string( usage );
+	const uint64_t key = getContentKey( static_cast<const uint8_t*>( data ), static_cast<size_t>( size ), settings );
+	if( const CachedResource* resident = referenceCachedResource( cache, key ) ) return *resident;
+
+	++cache.stats.misses;
+
+	CachedResource resource{ key, {}, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, 0, 1, {} };
+	resource.buffer = initBuffer( device, size, usage );
+	const std::vector<VkMemoryPropertyFlags> memoryTypePriority{
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+	};
+	resource.bufferMemory = initMemory<ResourceType::Buffer>( device, getPhysicalDeviceMemoryProperties( cache.physicalDevice ), resource.buffer, memoryTypePriority );
+	setMemoryData(  device, resource.bufferMemory, const_cast<void*>( data ), static_cast<size_t>( size )  );
+	resource.bytes = getMemoryRequirements<ResourceType::Buffer>( device, resource.buffer ).size;
+
+	return addCachedResource( device, cache, resource );
+}
+
+void releaseCachedResource( const VkDevice device, ResourceCache& cache, const uint64_t key ){
+	CachedResource& resource = cache.resources.at( key );
+	assert( resource.references > 0 );
+	if( --resource.references == 0 ){
+		cache.unused.push_front( key );
+		resource.unusedPosition = cache.unused.begin();
+	}
+
+	evictCachedResources( device, cache );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Staging ring
+
+StagingRing initStagingRing( const VkDevice device, const VkPhysicalDevice physicalDevice, const VkDeviceSize size ){
+	StagingRing ring{};
+	ring.size = (size + 255) & ~VkDeviceSize( 255 ); // keeps offsets aligned across the wrap
+	createBuffer( device, physicalDevice, ring.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ring.buffer, ring.memory );
+
+	void* mapped;
+	{VkResult errorCode = vkMapMemory( device, ring.memory, 0, VK_WHOLE_SIZE, 0, &mapped ); RESULT_HANDLER( errorCode, "vkMapMemory" );}
+	ring.mapped = static_cast<uint8_t*>( mapped );
+
+	return ring;
+}
+
+// hands back the space of the oldest submission in flight once it finished (or waits for it to); false if it did not
+bool freeOldestStaging( const VkDevice device, StagingRing& ring, const bool wait ){
+	if( ring.inFlight.empty() ) return false;
+
+	VkFence fence = ring.inFlight.front().first;
+	if( wait ){VkResult errorCode = vkWaitForFences( device, 1, &fence, VK_TRUE, UINT64_MAX ); RESULT_HANDLER( errorCode, "vkWaitForFences" );}
+	else if( vkGetFenceStatus( device, fence ) != VK_SUCCESS ) return false;
+	{VkResult errorCode = vkResetFences( device, 1, &fence ); RESULT_HANDLER( errorCode, "vkResetFences" );}
+
+	ring.tail = ring.inFlight.front().second;
+	ring.freeFences.push_back( fence );
+	ring.inFlight.pop_front();
+	return true;
+}
+
+void killStagingRing( const VkDevice device, StagingRing& ring ){
+	while( freeOldestStaging( device, ring, true ) ){}
+	killFences( device, ring.freeFences );
+
+	vkUnmapMemory( device, ring.memory );
+	killBuffer( device, ring.buffer );
+	killMemory( device, ring.memory );
+}
+
+VkDeviceSize allocateStaging( const VkDevice device, StagingRing& ring, const VkDeviceSize size, const VkDeviceSize alignment ){
+	if( size > ring.size ) throw "allocateStaging: the upload is bigger than the staging ring!";
+	while( freeOldestStaging( device, ring, false ) ){}
+
+	VkDeviceSize position = (ring.head + alignment - 1) / alignment * alignment;
+	if( position % ring.size + size > ring.size ) position = (position / ring.size + 1) * ring.size; // never straddles the end
+	while( position + size - ring.tail > ring.size ){
+		if( !freeOldestStaging( device, ring, true ) ) throw "allocateStaging: the staging ring is too small for the uploads of one submission!";
+	}
+
+	ring.head = position + size;
+	return position % ring.size;
+}
+
+VkFence retireStaging( const VkDevice device, StagingRing& ring ){
+	VkFence fence;
+	if( ring.freeFences.empty() ) fence = initFence( device );
+	else{
+		fence = ring.freeFences.back();
+		ring.freeFences.pop_back();
+	}
+
+	ring.inFlight.emplace_back( fence, ring.head );
+	return fence;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Image conversion
+
+// = ConvertParams in convertImage.comp
+struct ConvertParams{
+	uint32_t sourceSize[2];
+	uint32_t destinationSize[2];
+	uint32_t sourceOffset;
+	PixelFormat sourceFormat;
+	uint32_t sourceSrgb;
+	uint32_t destinationOffset;
+	PixelFormat destinationFormat;
+	uint32_t destinationSrgb;
+	ResampleFilter filter;
+};
+
+uint32_t getPixelSize( const PixelFormat format ){
+	switch( format ){
+		case PixelFormat::Bgr8: return 3;
+		case PixelFormat::Rgba8: return 4;
+		case PixelFormat::Rgba16f: return 8;
+	}
+	throw "getPixelSize: unknown PixelFormat!";
+}
+
+void writeImageConverterDescriptorSet( const VkDevice device, const VkDescriptorSet descriptorSet, const VkBuffer source, const VkBuffer destination ){
+	const std::array<VkDescriptorBufferInfo, 2> bufferInfos{{ { source, 0, VK_WHOLE_SIZE }, { destination, 0, VK_WHOLE_SIZE } }};
+
+	std::array<VkWriteDescriptorSet, 2> writes{};
+	for( uint32_t i = 0; i < writes.size(); ++i ){
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets( device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+}
+
+ImageConverter initImageConverter( const VkDevice device, const VkPhysicalDevice physicalDevice, const StagingRing& ring, const VkDeviceSize capacity ){
+	const VkDeviceSize maxStorageBufferRange = getPhysicalDeviceProperties( physicalDevice ).limits.maxStorageBufferRange;
+	if( ring.size > maxStorageBufferRange ) throw "initImageConverter: the staging ring is bigger than a storage buffer may be!";
+
+	ImageConverter converter{};
+	converter.capacity = std::min( capacity, maxStorageBufferRange );
+
+	// 0 = source, 1 = destination -- must match convertImage.comp
+	const std::array<VkDescriptorSetLayoutBinding, 2> bindings{{
+		{ 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+		{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr }
+	}};
+	const VkDescriptorSetLayoutCreateInfo layoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags
+		static_cast<uint32_t>( bindings.size() ),
+		bindings.data()
+	};
+	{VkResult errorCode = vkCreateDescriptorSetLayout( device, &layoutInfo, nullptr, &converter.descriptorSetLayout ); RESULT_HANDLER( errorCode, "vkCreateDescriptorSetLayout" );}
+
+	const VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 };
+	const VkDescriptorPoolCreateInfo poolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags
+		2, // max sets
+		1, &poolSize
+	};
+	{VkResult errorCode = vkCreateDescriptorPool( device, &poolInfo, nullptr, &converter.descriptorPool ); RESULT_HANDLER( errorCode, "vkCreateDescriptorPool" );}
+
+	const std::array<VkDescriptorSetLayout, 2> setLayouts{{ converter.descriptorSetLayout, converter.descriptorSetLayout }};
+	const VkDescriptorSetAllocateInfo allocInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		nullptr, // pNext
+		converter.descriptorPool,
+		static_cast<uint32_t>( setLayouts.size() ), setLayouts.data()
+	};
+	std::array<VkDescriptorSet, 2> descriptorSets;
+	{VkResult errorCode = vkAllocateDescriptorSets( device, &allocInfo, descriptorSets.data() ); RESULT_HANDLER( errorCode, "vkAllocateDescriptorSets" );}
+	converter.fromStaging = descriptorSets[0];
+	converter.fromOutput = descriptorSets[1];
+
+	createBuffer( device, physicalDevice, converter.capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, converter.output, converter.outputMemory );
+	createBuffer( device, physicalDevice, converter.capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, converter.readbackBuffer, converter.readbackMemory );
+	void* readback;
+	{VkResult errorCode = vkMapMemory( device, converter.readbackMemory, 0, VK_WHOLE_SIZE, 0, &readback ); RESULT_HANDLER( errorCode, "vkMapMemory" );}
+	converter.readback = static_cast<const uint8_t*>( readback );
+
+	writeImageConverterDescriptorSet( device, converter.fromStaging, ring.buffer, converter.output );
+	writeImageConverterDescriptorSet( device, converter.fromOutput, converter.output, converter.output );
+
+	const vector<VkPushConstantRange> pushConstantRanges = {
+		{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( ConvertParams ) }
+	};
+	converter.shader = createShaderModule( device, readFile( "convertImage.spv" ) );
+	converter.pipelineLayout = initPipelineLayout( device, converter.descriptorSetLayout, pushConstantRanges );
+	converter.pipeline = initComputePipeline( device, converter.pipelineLayout, converter.shader );
+
+	return converter;
+}
+
+void killImageConverter( const VkDevice device, ImageConverter& converter ){
+	killPipeline( device, converter.pipeline );
+	killPipelineLayout( device, converter.pipelineLayout );
+	killShaderModule( device, converter.shader );
+
+	vkUnmapMemory( device, converter.readbackMemory );
+	killBuffer( device, converter.readbackBuffer );
+	killMemory( device, converter.readbackMemory );
+	killBuffer( device, converter.output );
+	killMemory( device, converter.outputMemory );
+
+	vkDestroyDescriptorPool( device, converter.descriptorPool, nullptr );
+	vkDestroyDescriptorSetLayout( device, converter.descriptorSetLayout, nullptr );
+}
+
+void recordImageConversions( const VkCommandBuffer commandBuffer, const ImageConverter& converter, vector<ImageConversion>& conversions ){
+	const uint32_t workgroupSize = 8; // convertImage.comp local size
+	const auto getExtent = []( const uint32_t size, const uint32_t level ){ return std::max( size >> level, 1u ); };
+
+	// every level of every image one after another; 16 byte alignment satisfies the copies of all destination formats
+	vector<vector<VkDeviceSize>> levelOffsets( conversions.size() );
+	VkDeviceSize outputSize = 0;
+	uint32_t levelCount = 0;
+	for( size_t i = 0; i < conversions.size(); ++i ){
+		const ImageConversion& c = conversions[i];
+		for( uint32_t level = 0; level < c.mipLevels; ++level ){
+			levelOffsets[i].push_back( outputSize );
+			outputSize += VkDeviceSize( getExtent( c.width, level ) ) * getExtent( c.height, level ) * getPixelSize( c.destinationFormat );
+			outputSize = (outputSize + 15) & ~VkDeviceSize( 15 );
+		}
+		levelOffsets[i].push_back( outputSize ); // end
+		levelCount = std::max( levelCount, c.mipLevels );
+	}
+	if( outputSize > converter.capacity ) throw "recordImageConversions: the batch is bigger than the converter's capacity!";
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, converter.pipeline );
+	for( uint32_t level = 0; level < levelCount; ++level ){
+		// the dispatches of a level are independent of each other, so one barrier per level rather than per image
+		if( level > 0 ){
+			const VkMemoryBarrier levelWritten{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT };
+			vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &levelWritten, 0, nullptr, 0, nullptr );
+		}
+
+		const VkDescriptorSet descriptorSet = level == 0 ? converter.fromStaging : converter.fromOutput;
+		vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, converter.pipelineLayout, 0, 1, &descriptorSet, 0, nullptr );
+
+		for( size_t i = 0; i < conversions.size(); ++i ){
+			const ImageConversion& c = conversions[i];
+			if( level >= c.mipLevels ) continue;
+
+			const uint32_t width = getExtent( c.width, level );
+			const uint32_t height = getExtent( c.height, level );
+			const ConvertParams params = level == 0
+				? ConvertParams{
+					{ c.sourceWidth, c.sourceHeight }, { width, height },
+					static_cast<uint32_t>( c.sourceOffset ), c.sourceFormat, c.sourceSrgb,
+					static_cast<uint32_t>( levelOffsets[i][0] ), c.destinationFormat, c.destinationSrgb,
+					c.filter
+				}
+				: ConvertParams{
+					{ getExtent( c.width, level - 1 ), getExtent( c.height, level - 1 ) }, { width, height },
+					static_cast<uint32_t>( levelOffsets[i][level - 1] ), c.destinationFormat, c.destinationSrgb,
+					static_cast<uint32_t>( levelOffsets[i][level] ), c.destinationFormat, c.destinationSrgb,
+					c.filter
+				};
+			vkCmdPushConstants( commandBuffer, converter.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( params ), &params );
+			vkCmdDispatch( commandBuffer, (width + workgroupSize - 1) / workgroupSize, (height + workgroupSize - 1) / workgroupSize, 1 );
+		}
+	}
+
+	// out of the output buffer: all images in one barrier and the read backs in one copy
+	vector<VkImageMemoryBarrier> imageBarriers;
+	vector<VkBufferCopy> readbackRegions;
+	for( size_t i = 0; i < conversions.size(); ++i ){
+		ImageConversion& c = conversions[i];
+		if( c.image == VK_NULL_HANDLE ){
+			c.readbackOffset = levelOffsets[i][0];
+			readbackRegions.push_back( { levelOffsets[i][0], levelOffsets[i][0], levelOffsets[i][c.mipLevels] - levelOffsets[i][0] } );
+			continue;
+		}
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = c.image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, c.mipLevels, 0, 1 };
+		imageBarriers.push_back( barrier );
+	}
+	const VkMemoryBarrier outputWritten{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &outputWritten, 0, nullptr, static_cast<uint32_t>( imageBarriers.size() ), imageBarriers.data() );
+
+	for( size_t i = 0; i < conversions.size(); ++i ){
+		const ImageConversion& c = conversions[i];
+		if( c.image == VK_NULL_HANDLE ) continue;
+
+		vector<VkBufferImageCopy> regions( c.mipLevels );
+		for( uint32_t level = 0; level < c.mipLevels; ++level ){
+			regions[level].bufferOffset = levelOffsets[i][level];
+			regions[level].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			regions[level].imageExtent = { getExtent( c.width, level ), getExtent( c.height, level ), 1 };
+		}
+		vkCmdCopyBufferToImage( commandBuffer, converter.output, c.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>( regions.size() ), regions.data() );
+	}
+	if( !readbackRegions.empty() ) vkCmdCopyBuffer( commandBuffer, converter.output, converter.readbackBuffer, static_cast<uint32_t>( readbackRegions.size() ), readbackRegions.data() );
+
+	for( VkImageMemoryBarrier& barrier : imageBarriers ){
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+	const VkMemoryBarrier readbackWritten{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT };
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		1, &readbackWritten,
+		0, nullptr,
+		static_cast<uint32_t>( imageBarriers.size() ), imageBarriers.data()
+	);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shader hot reload
+
+#if RUNTIME_SHADER_COMPILER
+ShaderReloader initShaderReloader( const ShaderCompiler& compiler, const string& directory ){
+	ShaderReloader reloader;
+	reloader.compiler = &compiler;
+	reloader.watcher = initShaderWatcher( directory );
+	if( reloader.watcher.fd < 0 ) logger << "cannot watch " << directory << " for changed shaders, no hot reload" << std::endl;
+	reloader.results = std::make_shared<ShaderReloadResults>();
+	reloader.worker = std::make_unique<StreamingWorkers>( 1 );
+	return reloader;
+}
+
+void killShaderReloader( const VkDevice device, ShaderReloader& reloader ){
+	reloader.worker.reset();
+	for( const ReloadedPipeline& reloaded : reloader.results->pipelines ) if( reloaded.pipeline ) killPipeline( device, reloaded.pipeline );
+	reloader.results->pipelines.clear();
+	killShaderWatcher( reloader.watcher );
+}
+
+void addReloadablePipeline( ShaderReloader& reloader, const vector<ShaderSource>& shaders, std::function<VkPipeline( const vector<VkShaderModule>& )> create, VkPipeline* const pipeline ){
+	std::set<string> dependencies;
+	for( const ShaderSource& shader : shaders ){
+		const vector<string> shaderDependencies = getShaderDependencies( shader );
+		dependencies.insert( shaderDependencies.begin(), shaderDependencies.end() );
+	}
+
+	reloader.pipelines.push_back( { shaders, std::move( create ), pipeline, dependencies } );
+}
+
+bool updateShaderReloader( const VkDevice device, ShaderReloader& reloader ){
+	const std::set<string> changed = getChangedShaderFiles( reloader.watcher );
+
+	for( size_t i = 0; i < reloader.pipelines.size(); ++i ){
+		const ReloadablePipeline& reloadable = reloader.pipelines[i];
+		const bool affected = std::any_of( changed.begin(), changed.end(), [&]( const string& path ){ return reloadable.dependencies.count( path ) > 0; } );
+		if( !affected ) continue;
+
+		// copies: the pipeline list may grow while the job runs
+		const ShaderCompiler* const compiler = reloader.compiler;
+		const std::shared_ptr<ShaderReloadResults> results = reloader.results;
+		const vector<ShaderSource> shaders = reloadable.shaders;
+		const auto create = reloadable.create;
+		reloader.worker->enqueue( [=]{
+			const auto start = std::chrono::high_resolution_clock::now();
+			ReloadedPipeline reloaded{ i, VK_NULL_HANDLE, {}, "", 0.0 };
+			vector<VkShaderModule> modules;
+			try{
+				for( const ShaderSource& shader : shaders ){
+					vector<string> dependencies;
+					bool cached;
+					const vector<char> spirv = compileShader( *compiler, shader, dependencies, cached );
+					reloaded.dependencies.insert( dependencies.begin(), dependencies.end() );
+					modules.push_back( createShaderModule( device, spirv ) );
+				}
+
+				reloaded.pipeline = create( modules );
+			}
+			catch( const char* e ){ reloaded.error = e; }
+			catch( const string& e ){ reloaded.error = e; }
+			catch( const std::exception& e ){ reloaded.error = e.what(); }
+			catch( const VulkanResultException& e ){ reloaded.error = string( e.source ) + "() returned " + to_string( e.result ); }
+			for( const VkShaderModule module : modules ) killShaderModule( device, module );
+			reloaded.milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+
+			std::lock_guard<std::mutex> lock( results->mutex );
+			results->pipelines.push_back( std::move( reloaded ) );
+		} );
+	}
+
+	std::lock_guard<std::mutex> lock( reloader.results->mutex );
+	return !reloader.results->pipelines.empty();
+}
+
+void applyReloadedPipelines( const VkDevice device, ShaderReloader& reloader ){
+	vector<ReloadedPipeline> reloadedPipelines;
+	{
+		std::lock_guard<std::mutex> lock( reloader.results->mutex );
+		reloadedPipelines.swap( reloader.results->pipelines );
+	}
+
+	for( ReloadedPipeline& reloaded : reloadedPipelines ){
+		ReloadablePipeline& reloadable = reloader.pipelines[reloaded.index];
+		if( !reloaded.pipeline ){
+			logger << "shader reload failed, keeping the old pipeline: " << reloaded.error << std::endl;
+			continue;
+		}
+
+		killPipeline( device, *reloadable.pipeline );
+		*reloadable.pipeline = reloaded.pipeline;
+		reloadable.dependencies = std::move( reloaded.dependencies ); // includes may have been added or removed
+		logger << "pipeline of " << reloadable.shaders[0].path << " reloaded in " << reloaded.milliseconds << " ms" << std::endl;
+	}
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pipeline libraries
+
+bool requestPipelineLibrarySupport( VkPhysicalDevice physicalDevice, const vector<const char*>& layers, VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT& libraryFeatures, vector<const char*>& deviceExtensions ){
+	const vector<VkExtensionProperties> supportedExtensions = getSupportedDeviceExtensions( physicalDevice, layers );
+	if( !isExtensionSupported( VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, supportedExtensions ) || !isExtensionSupported( VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME, supportedExtensions ) ){
+		logger << "WARNING: " VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME " not supported. Falling back to monolithic pipelines." << std::endl;
+		return false;
+	}
+
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT supported{};
+	supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &supported, {} };
+	vkGetPhysicalDeviceFeatures2KHR( physicalDevice, &features2 );
+	if( !supported.graphicsPipelineLibrary ){
+		logger << "WARNING: graphicsPipelineLibrary feature not supported. Falling back to monolithic pipelines." << std::endl;
+		return false;
+	}
+
+	VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties{};
+	libraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &libraryProperties, {} };
+	vkGetPhysicalDeviceProperties2KHR( physicalDevice, &properties2 );
+	if( !libraryProperties.graphicsPipelineLibraryFastLinking ) logger << "WARNING: the driver does not promise fast linking of pipeline libraries." << std::endl;
+
+	libraryFeatures = {};
+	libraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	libraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+
+	deviceExtensions.push_back( VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME ); // required by graphics pipeline library
+	deviceExtensions.push_back( VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME );
+	return true;
+}
+
+PipelineLibraries initPipelineLibraries( const VkDevice device, const VkPhysicalDeviceLimits& limits, const VkPipelineCache pipelineCache ){
+	return { device, limits, pipelineCache, {} };
+}
+
+void killPipelineLibraries( PipelineLibraries& libraries ){
+	for( const auto& part : libraries.parts ) killPipeline( libraries.device, part.second );
+	libraries.parts.clear();
+}
+
+VkPipeline initPipelineLibrary( const VkDevice device, const VkPhysicalDeviceLimits& limits, const GraphicsPipelineState& state, const VkGraphicsPipelineLibraryFlagsEXT parts, const VkPipelineCache pipelineCache ){
+	return createGraphicsPipeline( device, limits, state, pipelineCache, parts );
+}
+
+std::array<VkPipeline, pipelineLibraryPartCount> getPipelineLibraries( PipelineLibraries& libraries, const GraphicsPipelineState& state ){
+	uint64_t alphaCutoffBits = 0;
+	std::memcpy( &alphaCutoffBits, &state.variant.alphaCutoff, sizeof( float ) );
+
+	// what each part depends on -- getPipelineStateKey() split up
+	std::array<vector<uint64_t>, pipelineLibraryPartCount> values = {{
+		{ VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT, state.vertexBufferBinding, uint64_t( state.topology ) },
+		{ VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT, getHandleValue( state.vertexShader ), uint64_t( state.polygonMode ), state.cullMode },
+		{ VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT, getHandleValue( state.fragmentShader ), state.depthTest, state.depthWrite, uint64_t( state.depthCompareOp ) },
+		{ VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT, state.blend }
+	}};
+	for( const VkVertexInputAttributeDescription& attribute : state.vertexAttributes ){
+		values[0].insert( values[0].end(), { attribute.location, attribute.binding, uint64_t( attribute.format ), attribute.offset } );
+	}
+	for( vector<uint64_t>* shaderPart : { &values[1], &values[2] } ){
+		shaderPart->insert( shaderPart->end(), { state.variant.instancing, state.variant.texturing, state.variant.alphaTest, alphaCutoffBits, getHandleValue( state.pipelineLayout ) } );
+	}
+	for( size_t part = 1; part < pipelineLibraryPartCount; ++part ){
+		values[part].insert( values[part].end(), { uint64_t( state.compatibility.colorFormat ), uint64_t( state.compatibility.depthFormat ), uint64_t( state.compatibility.samples ), state.compatibility.subpass } );
+	}
+
+	std::array<VkPipeline, pipelineLibraryPartCount> parts;
+	for( size_t part = 0; part < pipelineLibraryPartCount; ++part ){
+		const uint64_t key = xxHash64( values[part].data(), values[part].size() * sizeof( uint64_t ) );
+		const auto known = libraries.parts.find( key );
+		if( known != libraries.parts.end() ){
+			parts[part] = known->second;
+			continue;
+		}
+
+		const VkGraphicsPipelineLibraryFlagsEXT partBit = static_cast<VkGraphicsPipelineLibraryFlagsEXT>( values[part][0] );
+		parts[part] = initPipelineLibrary( libraries.device, libraries.limits, state, partBit, libraries.pipelineCache );
+		libraries.parts[key] = parts[part];
+	}
+
+	return parts;
+}
+
+VkPipeline linkPipelineLibraries( const VkDevice device, const std::array<VkPipeline, pipelineLibraryPartCount>& parts, const VkPipelineLayout pipelineLayout, const bool optimized, const VkPipelineCache pipelineCache ){
+	const VkPipelineLibraryCreateInfoKHR libraryInfo{ VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR, nullptr, static_cast<uint32_t>( parts.size() ), parts.data() };
+
+	// all state comes from the parts
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &libraryInfo;
+	pipelineInfo.flags = optimized ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	const VkResult errorCode = vkCreateGraphicsPipelines( device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline ); RESULT_HANDLER( errorCode, "vkCreateGraphicsPipelines" );
+	return pipeline;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pipeline registry
+
+PipelineRegistry initPipelineRegistry( const VkDevice device, const VkPhysicalDeviceLimits& limits, const VkPipelineCache pipelineCache, const bool pipelineLibraries, const unsigned threadCount ){
+	PipelineRegistry registry;
+	registry.device = device;
+	registry.limits = limits;
+	registry.pipelineCache = pipelineCache;
+	registry.results = std::make_shared<PipelineRegistryResults>();
+	registry.workers = std::make_unique<StreamingWorkers>( threadCount );
+	if( pipelineLibraries ) registry.libraries = std::make_unique<PipelineLibraries>( initPipelineLibraries( device, limits, pipelineCache ) );
+	registry.requests = 0;
+	return registry;
+}
+
+void killPipelineRegistry( PipelineRegistry& registry ){
+	registry.workers.reset();
+	updatePipelineRegistry( registry );
+
+	for( const auto& registered : registry.pipelines ) if( registered.second.pipeline ) killPipeline( registry.device, registered.second.pipeline );
+	registry.pipelines.clear();
+	killRetiredPipelines( registry );
+
+	if( registry.libraries ) killPipelineLibraries( *registry.libraries );
+	registry.libraries.reset();
+}
+
+void killRetiredPipelines( PipelineRegistry& registry ){
+	for( const VkPipeline pipeline : registry.retiredPipelines ) killPipeline( registry.device, pipeline );
+	registry.retiredPipelines.clear();
+}
+
+uint64_t getPipelineStateKey( const GraphicsPipelineState& state ){
+	uint64_t alphaCutoffBits = 0;
+	std::memcpy( &alphaCutoffBits, &state.variant.alphaCutoff, sizeof( float ) );
+
+	vector<uint64_t> values = {
+		getHandleValue( state.vertexShader ),
+		getHandleValue( state.fragmentShader ),
+		state.vertexBufferBinding,
+		uint64_t( state.topology ),
+		uint64_t( state.polygonMode ),
+		state.cullMode,
+		state.depthTest,
+		state.depthWrite,
+		uint64_t( state.depthCompareOp ),
+		state.blend,
+		state.variant.instancing,
+		state.variant.texturing,
+		state.variant.alphaTest,
+		alphaCutoffBits,
+		getHandleValue( state.pipelineLayout ),
+		uint64_t( state.compatibility.colorFormat ),
+		uint64_t( state.compatibility.depthFormat ),
+		uint64_t( state.compatibility.samples ),
+		state.compatibility.subpass
+	};
+	for( const VkVertexInputAttributeDescription& attribute : state.vertexAttributes ){
+		values.insert( values.end(), { attribute.location, attribute.binding, uint64_t( attribute.format ), attribute.offset } );
+	}
+	return xxHash64( values.data(), values.size() * sizeof( uint64_t ) );
+}
+
+uint64_t requestPipeline( PipelineRegistry& registry, const GraphicsPipelineState& state ){
+	++registry.requests;
+	const uint64_t key = getPipelineStateKey( state );
+	if( registry.pipelines.count( key ) ) return key;
+
+	// usable right away, linked without optimization; the workers only make the optimized link.
+	// Registered only once that worked: a throw leaves nothing pending that no worker would ever finish
+	std::array<VkPipeline, pipelineLibraryPartCount> parts{};
+	if( registry.libraries ){
+		parts = getPipelineLibraries( *registry.libraries, state );
+		registry.pipelines[key] = { linkPipelineLibraries( registry.device, parts, state.pipelineLayout, false, registry.pipelineCache ), false };
+	}
+	else registry.pipelines[key] = { VK_NULL_HANDLE, true };
+
+	const VkDevice device = registry.device;
+	const VkPhysicalDeviceLimits limits = registry.limits;
+	const VkPipelineCache pipelineCache = registry.pipelineCache;
+	const std::shared_ptr<PipelineRegistryResults> results = registry.results;
+	registry.workers->enqueue( [=]{
+		CreatedPipeline created{ key, VK_NULL_HANDLE, "" };
+		try{
+			if( parts[0] ) created.pipeline = linkPipelineLibraries( device, parts, state.pipelineLayout, true, pipelineCache );
+			else created.pipeline = initPipeline( device, limits, state, pipelineCache );
+		}
+		catch( const char* e ){ created.error = e; }
+		catch( const string& e ){ created.error = e; }
+		catch( const VulkanResultException& e ){ created.error = string( e.source ) + "() returned " + to_string( e.result ); }
+		catch( const std::exception& e ){ created.error = e.what(); }
+
+		{
+			std::lock_guard<std::mutex> lock( results->mutex );
+			results->pipelines.push_back( std::move( created ) );
+		}
+		results->pipelineCreated.notify_all();
+	} );
+
+	return key;
+}
+
+uint32_t updatePipelineRegistry( PipelineRegistry& registry ){
+	vector<CreatedPipeline> createdPipelines;
+	{
+		std::lock_guard<std::mutex> lock( registry.results->mutex );
+		createdPipelines.swap( registry.results->pipelines );
+	}
+
+	for( const CreatedPipeline& created : createdPipelines ){
+		RegisteredPipeline& registered = registry.pipelines[created.key];
+		if( !created.pipeline ) logger << "pipeline creation failed: " << created.error << std::endl; // a linked pipeline stays in use
+		else{
+			if( registered.pipeline ) registry.retiredPipelines.push_back( registered.pipeline ); // may still be used by pending command buffers
+			registered.pipeline = created.pipeline;
+		}
+		registered.pending = false;
+	}
+
+	return static_cast<uint32_t>( createdPipelines.size() );
+}
+
+VkPipeline getPipeline( const PipelineRegistry& registry, const uint64_t key ){
+	const auto registered = registry.pipelines.find( key );
+	return registered == registry.pipelines.end() ? VK_NULL_HANDLE : registered->second.pipeline;
+}
+
+VkPipeline getPipelineOr( const PipelineRegistry& registry, const uint64_t key, const uint64_t fallbackKey ){
+	const VkPipeline pipeline = getPipeline( registry, key );
+	return pipeline ? pipeline : getPipeline( registry, fallbackKey );
+}
+
+VkPipeline waitForPipeline( PipelineRegistry& registry, const uint64_t key ){
+	const auto registered = registry.pipelines.find( key );
+	if( registered == registry.pipelines.end() ) throw "waiting for a pipeline that was never requested!";
+
+	while( registry.pipelines[key].pending ){
+		{
+			std::unique_lock<std::mutex> lock( registry.results->mutex );
+			registry.results->pipelineCreated.wait(  lock, [&]{ return !registry.results->pipelines.empty(); }  );
+		}
+		updatePipelineRegistry( registry );
+	}
+
+	if( !registry.pipelines[key].pipeline ) throw "the pipeline waited for could not be created!";
+	return registry.pipelines[key].pipeline;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Descriptor allocator
+
+DescriptorAllocator initDescriptorAllocator( const VkDevice device, const vector<VkDescriptorPoolSize>& setSizes, const uint32_t setsPerPool ){
+	return { device, setSizes, setsPerPool, {}, {}, 0, 0 };
+}
+
+void killDescriptorAllocator( DescriptorAllocator& allocator ){
+	for( const VkDescriptorPool pool : allocator.usedPools ) vkDestroyDescriptorPool( allocator.device, pool, nullptr );
+	for( const VkDescriptorPool pool : allocator.freePools ) vkDestroyDescriptorPool( allocator.device, pool, nullptr );
+	allocator.usedPools.clear();
+	allocator.freePools.clear();
+}
+
+void takeDescriptorPool( DescriptorAllocator& allocator ){
+	if( !allocator.freePools.empty() ){
+		allocator.usedPools.push_back( allocator.freePools.back() );
+		allocator.freePools.pop_back();
+	}
+	else{
+		vector<VkDescriptorPoolSize> poolSizes = allocator.setSizes;
+		for( VkDescriptorPoolSize& size : poolSizes ) size.descriptorCount *= allocator.setsPerPool;
+		allocator.usedPools.push_back( createDescriptorPool( allocator.device, poolSizes, allocator.setsPerPool ) );
+	}
+	allocator.currentPoolSets = 0;
+}
+
+VkDescriptorSet allocateDescriptorSet( DescriptorAllocator& allocator, const VkDescriptorSetLayout descriptorSetLayout ){
+	// full: the pool stays used until the reset, the set comes out of the next one. Counted, as allocating past maxSets
+	// is invalid usage on Vulkan 1.0 without VK_KHR_maintenance1 -- not a VK_ERROR_OUT_OF_POOL_MEMORY to react to
+	if( allocator.usedPools.empty() || allocator.currentPoolSets == allocator.setsPerPool ) takeDescriptorPool( allocator );
+
+	VkDescriptorSetAllocateInfo allocateInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, nullptr, allocator.usedPools.back(), 1, &descriptorSetLayout };
+	VkDescriptorSet descriptorSet;
+	VkResult errorCode = vkAllocateDescriptorSets( allocator.device, &allocateInfo, &descriptorSet );
+	// fallback for pools that fragmented anyway
+	if( errorCode == VK_ERROR_OUT_OF_POOL_MEMORY || errorCode == VK_ERROR_FRAGMENTED_POOL ){
+		takeDescriptorPool( allocator );
+		allocateInfo.descriptorPool = allocator.usedPools.back();
+		errorCode = vkAllocateDescriptorSets( allocator.device, &allocateInfo, &descriptorSet );
+	}
+	RESULT_HANDLER( errorCode, "vkAllocateDescriptorSets" ); // fails in a fresh pool too: the layout needs more than setSizes
+
+	++allocator.currentPoolSets;
+	++allocator.allocatedSets;
+	return descriptorSet;
+}
+
+uint32_t resetDescriptorAllocator( DescriptorAllocator& allocator ){
+	for( const VkDescriptorPool pool : allocator.usedPools ){
+		{VkResult errorCode = vkResetDescriptorPool( allocator.device, pool, 0 ); RESULT_HANDLER( errorCode, "vkResetDescriptorPool" );}
+		allocator.freePools.push_back( pool );
+	}
+	allocator.usedPools.clear();
+
+	const uint32_t allocatedSets = allocator.allocatedSets;
+	allocator.allocatedSets = 0;
+	return allocatedSets;
+}
+
+uint32_t getDescriptorPoolCount( const DescriptorAllocator& allocator ){
+	return static_cast<uint32_t>( allocator.usedPools.size() + allocator.freePools.size() );
+}
+
+DescriptorSetCache initDescriptorSetCache( const VkDevice device, const vector<VkDescriptorPoolSize>& setSizes, const uint32_t setsPerPool ){
+	return { initDescriptorAllocator( device, setSizes, setsPerPool ), {}, {}, 0, 0 };
+}
+
+void killDescriptorSetCache( DescriptorSetCache& cache ){
+	killDescriptorAllocator( cache.allocator );
+	cache.entries.clear();
+	cache.retiredSets.clear();
+}
+
+bool operator==( const DescriptorBinding& a, const DescriptorBinding& b ){
+	return a.binding == b.binding && a.type == b.type
+		&& a.buffer == b.buffer && a.offset == b.offset && a.range == b.range
+		&& a.imageView == b.imageView && a.sampler == b.sampler && a.imageLayout == b.imageLayout;
+}
+
+VkDescriptorSet getCachedDescriptorSet( DescriptorSetCache& cache, const VkDescriptorSetLayout layout, const vector<DescriptorBinding>& bindings ){
+	vector<uint64_t> values = { getHandleValue( layout ) };
+	for( const DescriptorBinding& binding : bindings ){
+		values.insert( values.end(), {
+			binding.binding, uint64_t( binding.type ),
+			getHandleValue( binding.buffer ), binding.offset, binding.range,
+			getHandleValue( binding.imageView ), getHandleValue( binding.sampler ), uint64_t( binding.imageLayout )
+		} );
+	}
+	const uint64_t key = xxHash64( values.data(), values.size() * sizeof( uint64_t ) );
+
+	const auto known = cache.entries.find( key );
+	if( known != cache.entries.end() && known->second.layout == layout && known->second.bindings == bindings ){
+		++cache.hits;
+		return known->second.descriptorSet;
+	}
+
+	VkDescriptorSet descriptorSet;
+	vector<VkDescriptorSet>& retired = cache.retiredSets[getHandleValue( layout )];
+	if( retired.empty() ) descriptorSet = allocateDescriptorSet( cache.allocator, layout );
+	else{
+		descriptorSet = retired.back();
+		retired.pop_back();
+	}
+
+	vector<VkDescriptorBufferInfo> bufferInfos( bindings.size() );
+	vector<VkDescriptorImageInfo> imageInfos( bindings.size() );
+	vector<VkWriteDescriptorSet> writes( bindings.size() );
+	for( size_t i = 0; i < bindings.size(); ++i ){
+		const DescriptorBinding& binding = bindings[i];
+		const bool buffer = binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+			|| binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		bufferInfos[i] = { binding.buffer, binding.offset, binding.range };
+		imageInfos[i] = { binding.sampler, binding.imageView, binding.imageLayout };
+
+		writes[i] = {};
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = descriptorSet;
+		writes[i].dstBinding = binding.binding;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = binding.type;
+		if( buffer ) writes[i].pBufferInfo = &bufferInfos[i];
+		else writes[i].pImageInfo = &imageInfos[i];
+	}
+	vkUpdateDescriptorSets( cache.allocator.device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+	++cache.misses;
+
+	// a different set under the same key (a 64 bit hash collision) may still be in use, so it stays and this one is not cached
+	if( known == cache.entries.end() ) cache.entries[key] = { layout, bindings, descriptorSet };
+	return descriptorSet;
+}
+
+uint32_t invalidateDescriptorSets( DescriptorSetCache& cache, const uint64_t resource ){
+	uint32_t invalidated = 0;
+	for( auto entry = cache.entries.begin(); entry != cache.entries.end(); ){
+		const vector<DescriptorBinding>& bindings = entry->second.bindings;
+		const bool uses = std::any_of( bindings.begin(), bindings.end(), [&]( const DescriptorBinding& binding ){
+			return getHandleValue( binding.buffer ) == resource || getHandleValue( binding.imageView ) == resource || getHandleValue( binding.sampler ) == resource;
+		} );
+		if( !uses ){
+			++entry;
+			continue;
+		}
+
+		cache.retiredSets[getHandleValue( entry->second.layout )].push_back( entry->second.descriptorSet );
+		entry = cache.entries.erase( entry );
+		++invalidated;
+	}
+
+	return invalidated;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Headless benchmarks
+
+uint32_t getGraphicsQueueFamily( const VkPhysicalDevice physDevice ){
+	const auto qfps = getQueueFamilyProperties( physDevice );
+
+	for( uint32_t qf = 0; qf < qfps.size(); ++qf ){
+		if( qfps[qf].queueFlags & VK_QUEUE_GRAPHICS_BIT ) return qf;
+	}
+
+	throw "Cannot find a graphics queue family!";
+}
+
+HeadlessContext initHeadless( const DeviceRequirements& deviceRequirements, const void* const& extensionFeatures ){
+	HeadlessContext context;
+
+	vector<const char*> requestedLayers;
+	vector<const char*> requestedInstanceExtensions;
+
+#if VULKAN_VALIDATION
+	if(  isLayerSupported( "VK_LAYER_KHRONOS_validation", enumerate<VkInstance, VkLayerProperties>() )  ) requestedLayers.push_back( "VK_LAYER_KHRONOS_validation" );
+	else throw "VULKAN_VALIDATION is enabled but VK_LAYER_KHRONOS_validation layers are not supported!";
+
+	requestedInstanceExtensions.push_back( VK_EXT_DEBUG_UTILS_EXTENSION_NAME );
+
+	logger << "WARNING: Benchmarking with VULKAN_VALIDATION enabled. Timings will be dominated by the layers; build with -DVULKAN_VALIDATION=0." << std::endl;
+#endif
+
+	// so deviceRequirements can query the features of device extensions
+	if(  isExtensionSupported( VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME, getSupportedInstanceExtensions( requestedLayers ) )  ){
+		requestedInstanceExtensions.push_back( VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME );
+	}
+
+	context.instance = initInstance( requestedLayers, requestedInstanceExtensions );
+#if VULKAN_VALIDATION
+	context.debugHandle = initDebug( context.instance, DebugObjectType::debugUtils, ::debugSeverity, ::debugType );
+#endif
+
+	context.physicalDevice = getPhysicalDevice( context.instance ); // no surface -- any device will do
+	context.physicalDeviceProperties = getPhysicalDeviceProperties( context.physicalDevice );
+	context.physicalDeviceMemoryProperties = getPhysicalDeviceMemoryProperties( context.physicalDevice );
+	context.graphicsQueueFamily = getGraphicsQueueFamily( context.physicalDevice );
+	context.transferQueueFamily = getTransferQueueFamily( context.physicalDevice, context.graphicsQueueFamily );
+
+	context.enabledFeatures = {};
+	context.enabledDeviceExtensions = {};
+	if( deviceRequirements ) deviceRequirements( context.physicalDevice, context.enabledFeatures, context.enabledDeviceExtensions );
+
+	context.device = initDevice( context.physicalDevice, context.enabledFeatures, context.graphicsQueueFamily, context.graphicsQueueFamily, requestedLayers, context.enabledDeviceExtensions, context.transferQueueFamily, extensionFeatures );
+	context.graphicsQueue = getQueue( context.device, context.graphicsQueueFamily, 0 );
+	context.transferQueue = getQueue( context.device, context.transferQueueFamily, 0 );
+	context.commandPool = initCommandPool( context.device, context.graphicsQueueFamily );
+
+	logger << "Benchmarking on " << context.physicalDeviceProperties.deviceName << std::endl;
+
+	return context;
+}
+
+void killHeadless( HeadlessContext& context ){
+	killCommandPool( context.device, context.commandPool );
+	killDevice( context.device );
+
+#if VULKAN_VALIDATION
+	killDebug( context.instance, context.debugHandle );
+#endif
+	killInstance( context.instance );
+}
+
+OffscreenTarget initOffscreenTarget( const HeadlessContext& context, const uint32_t width, const uint32_t height ){
+	OffscreenTarget target;
+	target.width = width;
+	target.height = height;
+
+	const VkSurfaceFormatKHR colorFormat = { VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+	createImage(
+		context.device,
+		context.physicalDevice,
+		width, height,
+		1, // mip levels
+		colorFormat.format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		target.colorImage,
+		target.colorImageMemory
+	);
+	target.colorImageView = createImageView( context.device, target.colorImage, colorFormat.format, VK_IMAGE_ASPECT_COLOR_BIT );
+
+	const VkFormat depthFormat = findDepthFormat( context.physicalDevice );
+	createImage(
+		context.device,
+		context.physicalDevice,
+		width, height,
+		1, // mip levels
+		depthFormat,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		target.depthImage,
+		target.depthImageMemory
+	);
+	target.depthImageView = createImageView( context.device, target.depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT );
+
+	target.renderPass = initRenderPass( context.device, context.physicalDevice, colorFormat, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL );
+	target.framebuffers = initFramebuffers( context.device, target.renderPass, target.depthImageView, { target.colorImageView }, width, height );
+
+	return target;
+}
+
+void killOffscreenTarget( VkDevice device, OffscreenTarget& target ){
+	killFramebuffers( device, target.framebuffers );
+	killRenderPass( device, target.renderPass );
+
+	killImageView( device, target.depthImageView );
+	killImage( device, target.depthImage );
+	killMemory( device, target.depthImageMemory );
+
+	killImageView( device, target.colorImageView );
+	killImage( device, target.colorImage );
+	killMemory( device, target.colorImageMemory );
+}
+
+VkQueryPool initTimestampQueryPool( VkDevice device, uint32_t queryCount ){
+	const VkQueryPoolCreateInfo queryPoolInfo{
+		VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		nullptr, // pNext
+		0, // flags - reserved for future use
+		VK_QUERY_TYPE_TIMESTAMP,
+		queryCount,
+		0 // pipeline statistics - ignored for timestamps
+	};
+
+	VkQueryPool queryPool;
+	VkResult errorCode = vkCreateQueryPool( device, &queryPoolInfo, nullptr, &queryPool ); RESULT_HANDLER( errorCode, "vkCreateQueryPool" );
+	return queryPool;
+}
+
+void killQueryPool( VkDevice device, VkQueryPool queryPool ){
+	vkDestroyQueryPool( device, queryPool, nullptr );
+}
+
+double getTimestampDelta( VkDevice device, VkQueryPool queryPool, uint32_t firstQuery, float timestampPeriod ){
+	uint64_t timestamps[2];
+	VkResult errorCode = vkGetQueryPoolResults(
+		device,
+		queryPool,
+		firstQuery,
+		2, // query count
+		sizeof( timestamps ),
+		timestamps,
+		sizeof( uint64_t ), // stride
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT
+	); RESULT_HANDLER( errorCode, "vkGetQueryPoolResults" );
+
+	return static_cast<double>( timestamps[1] - timestamps[0] ) * timestampPeriod / 1.0e6; // ns -> ms
+}
+
+void submitAndWait( VkDevice device, VkQueue queue, VkCommandBuffer commandBuffer, VkFence fence ){
+	const VkSubmitInfo submit{
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		nullptr, // pNext
+		0, nullptr, // wait semaphores
+		nullptr, // pipeline stages to wait for semaphore
+		1, &commandBuffer,
+		0, nullptr // signal semaphores
+	};
+
+	{VkResult errorCode = vkQueueSubmit( queue, 1 /*submit count*/, &submit, fence ); RESULT_HANDLER( errorCode, "vkQueueSubmit" );}
+	{VkResult errorCode = vkWaitForFences( device, 1, &fence, VK_TRUE, UINT64_MAX ); RESULT_HANDLER( errorCode, "vkWaitForFences" );}
+	{VkResult errorCode = vkResetFences( device, 1, &fence ); RESULT_HANDLER( errorCode, "vkResetFences" );}
+}
+
+HeadlessScene initHeadlessScene( const HeadlessContext& context, const IndexedMesh& mesh, const uint32_t objectCount ){
+	const VkDevice device = context.device;
+	HeadlessScene scene;
+
+	scene.target = initOffscreenTarget( context, screenWidth, screenHeight );
+
+	const std::vector<VkMemoryPropertyFlags> memoryTypePriority{
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+	};
+
+	scene.indexCount = static_cast<uint32_t>( mesh.indices.size() );
+	scene.boundingSphere = computeBoundingSphere( mesh.vertices );
+
+	scene.vertexBuffer = initBuffer( device, sizeof( Vertex3D_UV ) * mesh.vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT );
+	scene.vertexBufferMemory = initMemory<ResourceType::Buffer>( device, context.physicalDeviceMemoryProperties, scene.vertexBuffer, memoryTypePriority );
+	setVertexData( device, scene.vertexBufferMemory, mesh.vertices );
+
+	scene.indexBuffer = initBuffer( device, sizeof( uint32_t ) * mesh.indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT );
+	scene.indexBufferMemory = initMemory<ResourceType::Buffer>( device, context.physicalDeviceMemoryProperties, scene.indexBuffer, memoryTypePriority );
+	setMemoryData(  device, scene.indexBufferMemory, const_cast<uint32_t*>( mesh.indices.data() ), sizeof( uint32_t ) * mesh.indices.size()  );
+
+	scene.objectBuffer = initObjectBuffer( device, objectCount );
+	scene.objectBufferMemory = initMemory<ResourceType::Buffer>( device, context.physicalDeviceMemoryProperties, scene.objectBuffer, memoryTypePriority );
+
+	scene.texture = createTextureImage( "vulkan.texture.bmp", device, context.physicalDevice, context.commandPool, context.graphicsQueue );
+	scene.textureImageView = createTextureImageView( device, scene.texture );
+	scene.textureSampler = createTextureSampler( device, 1.0f );
+
+	std::tie( scene.uniformBuffer, scene.uniformBufferMemory ) = createUniformBuffer( device, context.physicalDevice );
+	updateUniformBuffer( scene.uniformBufferMemory, device );
+
+	scene.descriptorSetLayout = createDescriptorSetLayout( device );
+	scene.descriptorPool = createDescriptorPool( device );
+	scene.descriptorSet = createDescriptorSet( scene.uniformBuffer, scene.textureImageView, scene.textureSampler, scene.objectBuffer, scene.descriptorSetLayout, scene.descriptorPool, device );
+	scene.pipelineLayout = initPipelineLayout( device, scene.descriptorSetLayout );
+	scene.vertexShader = createShaderModule( device, readFile( "vertexShader.spv" ) );
+	scene.fragmentShader = createShaderModule( device, readFile( "fragmentShader.spv" ) );
+
+	vector<VkCommandBuffer> commandBuffers;
+	acquireCommandBuffers( device, context.commandPool, 1, commandBuffers );
+	scene.commandBuffer = commandBuffers[0];
+	scene.fence = initFence( device );
+
+	scene.gpuTimestamps = getQueueFamilyProperties( context.physicalDevice )[context.graphicsQueueFamily].timestampValidBits > 0;
+	scene.queryPool = initTimestampQueryPool( device, 2 );
+
+	scene.clearValues = {};
+	scene.clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	scene.clearValues[1].depthStencil = {1.0f, 0};
+
+	return scene;
+}
+
+void killHeadlessScene( VkDevice device, HeadlessScene& scene ){
+	killQueryPool( device, scene.queryPool );
+	killFence( device, scene.fence );
+
+	killShaderModule( device, scene.fragmentShader );
+	killShaderModule( device, scene.vertexShader );
+	killPipelineLayout( device, scene.pipelineLayout );
+	vkDestroyDescriptorPool( device, scene.descriptorPool, nullptr );
+	vkDestroyDescriptorSetLayout( device, scene.descriptorSetLayout, nullptr );
+
+	killBuffer( device, scene.uniformBuffer );
+	killMemory( device, scene.uniformBufferMemory );
+	vkDestroySampler( device, scene.textureSampler, nullptr );
+	killImageView( device, scene.textureImageView );
+	killImage( device, scene.texture.image );
+	killMemory( device, scene.texture.memory );
+
+	killBuffer( device, scene.objectBuffer );
+	killMemory( device, scene.objectBufferMemory );
+	killBuffer( device, scene.indexBuffer );
+	killMemory( device, scene.indexBufferMemory );
+	killBuffer( device, scene.vertexBuffer );
+	killMemory( device, scene.vertexBufferMemory );
+
+	killOffscreenTarget( device, scene.target );
+}
+
+vector<GraphicsPipelineState> getBenchmarkPipelineStates( const GraphicsPipelineState& defaultState ){
+	ShaderVariant untextured = defaultShaderVariant;
+	untextured.texturing = VK_FALSE;
+	ShaderVariant alphaTested = defaultShaderVariant;
+	alphaTested.alphaTest = VK_TRUE;
+
+	vector<GraphicsPipelineState> states;
+	for( const VkCullModeFlags cullMode : { VK_CULL_MODE_NONE, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT } )
+	for( const VkBool32 blend : { VK_FALSE, VK_TRUE } )
+	for( const auto& depth : { std::make_pair( VK_TRUE, VK_TRUE ), std::make_pair( VK_TRUE, VK_FALSE ), std::make_pair( VK_FALSE, VK_FALSE ) } )
+	for( const VkCompareOp depthCompareOp : { VK_COMPARE_OP_LESS, VK_COMPARE_OP_LESS_OR_EQUAL } )
+	for( const ShaderVariant& variant : { defaultShaderVariant, untextured, alphaTested } ){
+		GraphicsPipelineState state = defaultState;
+		state.cullMode = cullMode;
+		state.blend = blend;
+		state.depthTest = depth.first;
+		state.depthWrite = depth.second;
+		state.depthCompareOp = depthCompareOp;
+		state.variant = variant;
+		states.push_back( state );
+	}
+	assert( states.size() == benchmarkPipelineStateCount );
+
+	return states;
+}
+
+// One instanced draw of 1 to 1M cubes into an offscreen target; prints wall and GPU time per frame.
+int benchmarkInstancing(){
+	const vector<uint32_t> instanceCounts = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+	const uint32_t warmupFrames = 5;
+	const uint32_t measuredFrames = 50;
+	const uint32_t vertexBufferBinding = 0;
+
+	const IndexedMesh cube = indexMesh( ::cubeVertices );
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+
+	// one object buffer sized for the largest run; smaller runs just use its beginning
+	HeadlessScene scene = initHeadlessScene( context, cube, instanceCounts.back() );
+
+	VkPipeline pipeline = initPipeline(
+		device,
+		context.physicalDeviceProperties.limits,
+		scene.pipelineLayout,
+		scene.target.renderPass,
+		scene.vertexShader,
+		scene.fragmentShader,
+		vertexBufferBinding
+	);
+
+	logger << "instances\twall ms/frame\tGPU ms/frame\tM instances/s" << std::endl;
+	for( const uint32_t count : instanceCounts ){
+		setObjectData(  device, scene.objectBufferMemory, generateObjects( generateInstanceTransforms( count ), scene.boundingSphere )  );
+
+		{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+		beginCommandBuffer( scene.commandBuffer );
+			if( scene.gpuTimestamps ){
+				vkCmdResetQueryPool( scene.commandBuffer, scene.queryPool, 0, 2 );
+				vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, scene.queryPool, 0 );
+			}
+
+			recordBeginRenderPass( scene.commandBuffer, scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+				recordBindPipeline( scene.commandBuffer, pipeline );
+				recordBindVertexBuffer( scene.commandBuffer, vertexBufferBinding, scene.vertexBuffer );
+				recordBindIndexBuffer( scene.commandBuffer, scene.indexBuffer );
+				vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &scene.descriptorSet, 0, nullptr );
+				recordDrawIndexed( scene.commandBuffer, scene.indexCount, count );
+			recordEndRenderPass( scene.commandBuffer );
+
+			if( scene.gpuTimestamps ) vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, scene.queryPool, 1 );
+		endCommandBuffer( scene.commandBuffer );
+
+		for( uint32_t frame = 0; frame < warmupFrames; ++frame ) submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+
+		double wallMilliseconds = 0.0;
+		double gpuMilliseconds = 0.0;
+		for( uint32_t frame = 0; frame < measuredFrames; ++frame ){
+			const auto frameStart = std::chrono::high_resolution_clock::now();
+			submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+			wallMilliseconds += std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - frameStart ).count();
+
+			if( scene.gpuTimestamps ) gpuMilliseconds += getTimestampDelta( device, scene.queryPool, 0, context.physicalDeviceProperties.limits.timestampPeriod );
+		}
+		wallMilliseconds /= measuredFrames;
+		gpuMilliseconds /= measuredFrames;
+
+		const double frameMilliseconds = scene.gpuTimestamps ? gpuMilliseconds : wallMilliseconds;
+		logger << count << "\t" << wallMilliseconds << "\t" << (scene.gpuTimestamps ? to_string( gpuMilliseconds ) : string( "n/a" )) << "\t" << count / frameMilliseconds / 1000.0 << std::endl;
+	}
+
+	killPipeline( device, pipeline );
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// 1K to 1M cubes spread so that only part of them is in view; compares one CPU-recorded draw per object with compute culling + indirect draws.
+// Command buffers are re-recorded every frame, as a scene with moving objects would have to, so the CPU recording cost shows up.
+int benchmarkGpuDriven(){
+	const vector<uint32_t> objectCounts = { 1000, 10000, 100000, 1000000 };
+	const float gridExtent = 8.0f; // wider than the view, so culling has something to do
+	const uint32_t warmupFrames = 5;
+	const uint32_t measuredFrames = 50;
+	const uint32_t vertexBufferBinding = 0;
+
+	const IndexedMesh cube = indexMesh( ::cubeVertices );
+	const uint32_t indexCount = static_cast<uint32_t>( cube.indices.size() );
+
+	bool drawIndirectCount = false;
+	bool multiDrawIndirect = false;
+	HeadlessContext context = initHeadless(  [&]( VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures& features, vector<const char*>& deviceExtensions ){
+		drawIndirectCount = requestGpuDrivenSupport( physicalDevice, {}, features, deviceExtensions );
+		multiDrawIndirect = features.multiDrawIndirect == VK_TRUE;
+	}  );
+	const VkDevice device = context.device;
+
+	HeadlessScene scene = initHeadlessScene( context, cube, objectCounts.back() );
+
+	GpuCulling culling = initGpuCulling( device, context.physicalDeviceProperties.limits, context.physicalDeviceMemoryProperties, scene.uniformBuffer, scene.objectBuffer, objectCounts.back(), drawIndirectCount, multiDrawIndirect );
+
+	VkPipeline pipeline = initPipeline(
+		device,
+		context.physicalDeviceProperties.limits,
+		scene.pipelineLayout,
+		scene.target.renderPass,
+		scene.vertexShader,
+		scene.fragmentShader,
+		vertexBufferBinding
+	);
+
+	const auto recordFrame = [&]( const uint32_t objectCount, const bool gpuDriven ){
+		{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+
+		beginCommandBuffer( scene.commandBuffer );
+			if( scene.gpuTimestamps ){
+				vkCmdResetQueryPool( scene.commandBuffer, scene.queryPool, 0, 2 );
+				vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, scene.queryPool, 0 );
+			}
+
+			if( gpuDriven ) recordCullObjects( scene.commandBuffer, culling, objectCount, indexCount );
+
+			recordBeginRenderPass( scene.commandBuffer, scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+				recordBindPipeline( scene.commandBuffer, pipeline );
+				recordBindVertexBuffer( scene.commandBuffer, vertexBufferBinding, scene.vertexBuffer );
+				recordBindIndexBuffer( scene.commandBuffer, scene.indexBuffer );
+				vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &scene.descriptorSet, 0, nullptr );
+				if( gpuDriven ) recordDrawCulledObjects( scene.commandBuffer, culling, objectCount );
+				else for( uint32_t i = 0; i < objectCount; ++i ) vkCmdDrawIndexed( scene.commandBuffer, indexCount, 1, 0, 0, i /*first instance = object index*/ );
+			recordEndRenderPass( scene.commandBuffer );
+
+			if( scene.gpuTimestamps ) vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, scene.queryPool, 1 );
+
+			if( gpuDriven ){
+				// make the counts available to getCullingStats()
+				const VkMemoryBarrier countReadback{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT };
+				vkCmdPipelineBarrier( scene.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &countReadback, 0, nullptr, 0, nullptr );
+			}
+		endCommandBuffer( scene.commandBuffer );
+	};
+
+	logger << "Draw indirect count: " << (drawIndirectCount ? "yes" : "no (fallback)") << std::endl;
+	logger << "Multi draw indirect: " << (multiDrawIndirect ? "yes" : "no (one draw call per object)") << std::endl;
+	logger << "mode\tobjects\tvisible\tCPU record us/frame\twall ms/frame\tGPU ms/frame" << std::endl;
+	for( const uint32_t count : objectCounts ){
+		setObjectData(  device, scene.objectBufferMemory, generateObjects( generateInstanceTransforms( count, gridExtent ), scene.boundingSphere )  );
+
+		for( const bool gpuDriven : { false, true } ){
+			for( uint32_t frame = 0; frame < warmupFrames; ++frame ){
+				recordFrame( count, gpuDriven );
+				submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+			}
+
+			double recordMicroseconds = 0.0;
+			double wallMilliseconds = 0.0;
+			double gpuMilliseconds = 0.0;
+			for( uint32_t frame = 0; frame < measuredFrames; ++frame ){
+				const auto frameStart = std::chrono::high_resolution_clock::now();
+				recordFrame( count, gpuDriven );
+				const auto recordEnd = std::chrono::high_resolution_clock::now();
+				submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+				const auto frameEnd = std::chrono::high_resolution_clock::now();
+
+				recordMicroseconds += std::chrono::duration<double, std::micro>( recordEnd - frameStart ).count();
+				wallMilliseconds += std::chrono::duration<double, std::milli>( frameEnd - frameStart ).count();
+				if( scene.gpuTimestamps ) gpuMilliseconds += getTimestampDelta( device, scene.queryPool, 0, context.physicalDeviceProperties.limits.timestampPeriod );
+			}
+			recordMicroseconds /= measuredFrames;
+			wallMilliseconds /= measuredFrames;
+			gpuMilliseconds /= measuredFrames;
+
+			const uint32_t visibleCount = gpuDriven ? getCullingStats( device, culling ).drawCount : count;
+			logger << (gpuDriven ? "gpu" : "cpu") << "\t" << count << "\t" << visibleCount << "\t" << recordMicroseconds << "\t" << wallMilliseconds << "\t" << (scene.gpuTimestamps ? to_string( gpuMilliseconds ) : string( "n/a" )) << std::endl;
+		}
+	}
+
+	killPipeline( device, pipeline );
+	killGpuCulling( device, culling );
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// Tessellated cubes culled per object (cullObjects.comp) vs. per meshlet (cullMeshlets.comp); prints triangles culled per frame and GPU time.
+int benchmarkMeshlets(){
+	const vector<uint32_t> objectCounts = { 1, 10, 100, 1000 };
+	const float gridExtent = 4.0f;
+	const uint32_t warmupFrames = 5;
+	const uint32_t measuredFrames = 50;
+	const uint32_t vertexBufferBinding = 0;
+
+	IndexedMesh cube = tessellateMesh( indexMesh( ::cubeVertices ), ::denseCubeTessellation );
+	const MeshletMesh cubeMeshlets = buildMeshlets( cube );
+	cube.indices = cubeMeshlets.indices; // same triangles in meshlet order, so both modes share the index buffer
+	const uint32_t indexCount = static_cast<uint32_t>( cube.indices.size() );
+
+	bool drawIndirectCount = false;
+	bool multiDrawIndirect = false;
+	HeadlessContext context = initHeadless(  [&]( VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures& features, vector<const char*>& deviceExtensions ){
+		drawIndirectCount = requestGpuDrivenSupport( physicalDevice, {}, features, deviceExtensions );
+		multiDrawIndirect = features.multiDrawIndirect == VK_TRUE;
+	}  );
+	const VkDevice device = context.device;
+
+	HeadlessScene scene = initHeadlessScene( context, cube, objectCounts.back() );
+
+	std::array<GpuCulling, 2> cullings = {
+		initGpuCulling( device, context.physicalDeviceProperties.limits, context.physicalDeviceMemoryProperties, scene.uniformBuffer, scene.objectBuffer, objectCounts.back(), drawIndirectCount, multiDrawIndirect ),
+		initGpuCulling( device, context.physicalDeviceProperties.limits, context.physicalDeviceMemoryProperties, scene.uniformBuffer, scene.objectBuffer, objectCounts.back(), drawIndirectCount, multiDrawIndirect, cubeMeshlets.meshlets )
+	};
+
+	VkPipeline pipeline = initPipeline(
+		device,
+		context.physicalDeviceProperties.limits,
+		scene.pipelineLayout,
+		scene.target.renderPass,
+		scene.vertexShader,
+		scene.fragmentShader,
+		vertexBufferBinding
+	);
+
+	logger << cubeMeshlets.meshlets.size() << " meshlets of <= " << maxMeshletTriangles << " triangles per cube, " << indexCount / 3 << " triangles per cube" << std::endl;
+	logger << "mode\tobjects\ttriangles\tculled triangles/frame\tculled %\tGPU ms/frame" << std::endl;
+	for( const uint32_t count : objectCounts ){
+		setObjectData(  device, scene.objectBufferMemory, generateObjects( generateInstanceTransforms( count, gridExtent ), scene.boundingSphere )  );
+
+		for( const GpuCulling& culling : cullings ){
+			{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+
+			beginCommandBuffer( scene.commandBuffer );
+				if( scene.gpuTimestamps ){
+					vkCmdResetQueryPool( scene.commandBuffer, scene.queryPool, 0, 2 );
+					vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, scene.queryPool, 0 );
+				}
+
+				recordCullObjects( scene.commandBuffer, culling, count, indexCount );
+
+				recordBeginRenderPass( scene.commandBuffer, scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+					recordBindPipeline( scene.commandBuffer, pipeline );
+					recordBindVertexBuffer( scene.commandBuffer, vertexBufferBinding, scene.vertexBuffer );
+					recordBindIndexBuffer( scene.commandBuffer, scene.indexBuffer );
+					vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &scene.descriptorSet, 0, nullptr );
+					recordDrawCulledObjects( scene.commandBuffer, culling, count );
+				recordEndRenderPass( scene.commandBuffer );
+
+				if( scene.gpuTimestamps ) vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, scene.queryPool, 1 );
+
+				const VkMemoryBarrier statsReadback{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT };
+				vkCmdPipelineBarrier( scene.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &statsReadback, 0, nullptr, 0, nullptr );
+			endCommandBuffer( scene.commandBuffer );
+
+			for( uint32_t frame = 0; frame < warmupFrames; ++frame ){
+				updateUniformBuffer( scene.uniformBufferMemory, device );
+				submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+			}
+
+			// the scene rotates, so visibility changes from frame to frame
+			const uint64_t totalTriangles = uint64_t( count ) * indexCount / 3;
+			double culledTriangles = 0.0;
+			double gpuMilliseconds = 0.0;
+			for( uint32_t frame = 0; frame < measuredFrames; ++frame ){
+				updateUniformBuffer( scene.uniformBufferMemory, device );
+				submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+
+				culledTriangles += double( totalTriangles - getCullingStats( device, culling ).triangleCount );
+				if( scene.gpuTimestamps ) gpuMilliseconds += getTimestampDelta( device, scene.queryPool, 0, context.physicalDeviceProperties.limits.timestampPeriod );
+			}
+			culledTriangles /= measuredFrames;
+			gpuMilliseconds /= measuredFrames;
+
+			logger << (culling.meshletCount ? "meshlet" : "object") << "\t" << count << "\t" << totalTriangles << "\t" << uint64_t( culledTriangles ) << "\t" << 100.0 * culledTriangles / totalTriangles << "\t" << (scene.gpuTimestamps ? to_string( gpuMilliseconds ) : string( "n/a" )) << std::endl;
+		}
+	}
+
+	killPipeline( device, pipeline );
+	for( GpuCulling& culling : cullings ) killGpuCulling( device, culling );
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+int benchmarkLod(){
+	const vector<uint32_t> objectCounts = { 1000, 4000, 16000 };
+	const float gridExtent = 4.0f;
+	const uint32_t warmupFrames = 5;
+	const uint32_t measuredFrames = 50;
+	const uint32_t vertexBufferBinding = 0;
+
+	// the flat cube simplifies without any error, so inflate it into a sphere to get a real LOD chain
+	IndexedMesh sphere = tessellateMesh( indexMesh( ::cubeVertices ), ::denseCubeTessellation );
+	for( Vertex3D_UV& vertex : sphere.vertices ){
+		const glm::vec3 position = glm::normalize( toVec3( vertex.position ) );
+		vertex.position = { position.x, position.y, position.z };
+	}
+	const LodMesh sphereLods = buildLodChain( sphere );
+	sphere.indices = sphereLods.indices;
+
+	bool multiDrawIndirect = false;
+	bool pipelineStatistics = false;
+	HeadlessContext context = initHeadless(  [&]( VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures& features, vector<const char*>& ){
+		multiDrawIndirect = requestLodDrawSupport( physicalDevice, features );
+
+		pipelineStatistics = getPhysicalDeviceFeatures( physicalDevice ).pipelineStatisticsQuery == VK_TRUE;
+		features.pipelineStatisticsQuery = pipelineStatistics;
+	}  );
+	const VkDevice device = context.device;
+
+	HeadlessScene scene = initHeadlessScene( context, sphere, objectCounts.back() );
+
+	LodDraws lodDraws = initLodDraws( device, context.physicalDeviceMemoryProperties, objectCounts.back(), multiDrawIndirect );
+
+	VkPipeline pipeline = initPipeline(
+		device,
+		context.physicalDeviceProperties.limits,
+		scene.pipelineLayout,
+		scene.target.renderPass,
+		scene.vertexShader,
+		scene.fragmentShader,
+		vertexBufferBinding
+	);
+
+	VkQueryPool statisticsQueryPool = VK_NULL_HANDLE;
+	if( pipelineStatistics ){
+		const VkQueryPoolCreateInfo queryPoolInfo{
+			VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			nullptr, // pNext
+			0, // flags - reserved for future use
+			VK_QUERY_TYPE_PIPELINE_STATISTICS,
+			1, // query count
+			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+		};
+		VkResult errorCode = vkCreateQueryPool( device, &queryPoolInfo, nullptr, &statisticsQueryPool ); RESULT_HANDLER( errorCode, "vkCreateQueryPool" );
+	}
+
+	// one command buffer for both modes; only the indirect draws written by the CPU differ
+	beginCommandBuffer( scene.commandBuffer );
+		if( scene.gpuTimestamps ){
+			vkCmdResetQueryPool( scene.commandBuffer, scene.queryPool, 0, 2 );
+			vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, scene.queryPool, 0 );
+		}
+		if( pipelineStatistics ){
+			vkCmdResetQueryPool( scene.commandBuffer, statisticsQueryPool, 0, 1 );
+			vkCmdBeginQuery( scene.commandBuffer, statisticsQueryPool, 0, 0 );
+		}
+
+		recordBeginRenderPass( scene.commandBuffer, scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+			recordBindPipeline( scene.commandBuffer, pipeline );
+			recordBindVertexBuffer( scene.commandBuffer, vertexBufferBinding, scene.vertexBuffer );
+			recordBindIndexBuffer( scene.commandBuffer, scene.indexBuffer );
+			vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &scene.descriptorSet, 0, nullptr );
+			recordDrawLods( scene.commandBuffer, lodDraws, 0, objectCounts.back() );
+		recordEndRenderPass( scene.commandBuffer );
+
+		if( pipelineStatistics ) vkCmdEndQuery( scene.commandBuffer, statisticsQueryPool, 0 );
+		if( scene.gpuTimestamps ) vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, scene.queryPool, 1 );
+	endCommandBuffer( scene.commandBuffer );
+
+	logger << "LOD triangles:";
+	for( const MeshLod& lod : sphereLods.lods ) logger << " " << lod.indexCount / 3 << " (error " << lod.error << ")";
+	logger << std::endl;
+	logger << "mode\tobjects\ttriangles/frame\tVS invocations/frame\tCPU select us/frame\tGPU ms/frame" << std::endl;
+	for( const uint32_t count : objectCounts ){
+		const vector<ObjectData> objects = generateObjects( generateInstanceTransforms( count, gridExtent ), scene.boundingSphere );
+		setObjectData( device, scene.objectBufferMemory, objects );
+
+		const vector<MeshLod> baseOnly = { sphereLods.lods[0] };
+		for( const bool lodEnabled : { false, true } ){
+			const vector<MeshLod>& lods = lodEnabled ? sphereLods.lods : baseOnly;
+			std::fill( lodDraws.currentLods.begin(), lodDraws.currentLods.end(), 0 );
+
+			const float viewportHeight = static_cast<float>( scene.target.height );
+			const auto updateDraws = [&]( const FrameTransforms& transforms ){
+				const uint64_t triangles = updateLodDraws( lodDraws, 0, lods, objects, scene.boundingSphere.w, transforms, viewportHeight );
+				// the command buffer always issues objectCounts.back() draws; the unused ones get no instances
+				for( uint32_t i = count; i < objectCounts.back(); ++i ) lodDraws.mapped[i] = { 0, 0, 0, 0, i };
+				return triangles;
+			};
+
+			for( uint32_t frame = 0; frame < warmupFrames; ++frame ){
+				updateDraws( updateUniformBuffer( scene.uniformBufferMemory, device ) );
+				submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+			}
+
+			double triangles = 0.0;
+			double vertexInvocations = 0.0;
+			double selectMicroseconds = 0.0;
+			double gpuMilliseconds = 0.0;
+			for( uint32_t frame = 0; frame < measuredFrames; ++frame ){
+				const FrameTransforms transforms = updateUniformBuffer( scene.uniformBufferMemory, device );
+
+				const auto selectStart = std::chrono::high_resolution_clock::now();
+				triangles += double(  updateDraws( transforms )  );
+				selectMicroseconds += std::chrono::duration<double, std::micro>( std::chrono::high_resolution_clock::now() - selectStart ).count();
+
+				submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+
+				if( pipelineStatistics ){
+					uint64_t invocations;
+					VkResult errorCode = vkGetQueryPoolResults( device, statisticsQueryPool, 0, 1, sizeof( invocations ), &invocations, sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT ); RESULT_HANDLER( errorCode, "vkGetQueryPoolResults" );
+					vertexInvocations += double( invocations );
+				}
+				if( scene.gpuTimestamps ) gpuMilliseconds += getTimestampDelta( device, scene.queryPool, 0, context.physicalDeviceProperties.limits.timestampPeriod );
+			}
+
+			logger << (lodEnabled ? "lod" : "base") << "\t" << count << "\t" << uint64_t( triangles / measuredFrames ) << "\t"
+			       << (pipelineStatistics ? to_string( uint64_t( vertexInvocations / measuredFrames ) ) : string( "n/a" )) << "\t"
+			       << selectMicroseconds / measuredFrames << "\t" << (scene.gpuTimestamps ? to_string( gpuMilliseconds / measuredFrames ) : string( "n/a" )) << std::endl;
+		}
+	}
+
+	if( pipelineStatistics ) killQueryPool( device, statisticsQueryPool );
+	killPipeline( device, pipeline );
+	killLodDraws( device, lodDraws );
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// writes the texture tiled to tileCount^2 its size as a 32 bit top-down BMP, so there is a texture big enough to miss the caches
+void writeTiledTexture( const char* sourcePath, const char* destinationPath, const uint32_t tileCount ){
+	const std::vector<char> file = readFile( sourcePath );
+	ImageHeader header;
+	if(  !readImageHeader( reinterpret_cast<const uint8_t*>( file.data() ), file.size(), header )  ) throw "writeTiledTexture: unsupported source image!";
+
+	vector<uint8_t> tile( size_t( header.width ) * header.height * 4 );
+	decodeImage( reinterpret_cast<const uint8_t*>( file.data() ), header, tile.data() );
+
+	const uint32_t width = header.width * tileCount;
+	const uint32_t height = header.height * tileCount;
+	const uint32_t pixelOffset = 14 + 40;
+
+	vector<uint8_t> bmp( pixelOffset + size_t( width ) * height * 4, 0 );
+	const auto write = [&]( const size_t offset, const uint32_t value, const uint32_t size ){
+		for( uint32_t i = 0; i < size; ++i ) bmp[offset + i] = uint8_t( value >> (8 * i) );
+	};
+	bmp[0] = 'B'; bmp[1] = 'M';
+	write( 2, static_cast<uint32_t>( bmp.size() ), 4 );
+	write( 10, pixelOffset, 4 );
+	write( 14, 40, 4 ); // BITMAPINFOHEADER
+	write( 18, width, 4 );
+	write( 22, uint32_t( -int32_t( height ) ), 4 ); // negative: top-down
+	write( 26, 1, 2 ); // planes
+	write( 28, 32, 2 ); // bits per pixel
+
+	for( uint32_t y = 0; y < height; ++y ){
+		for( uint32_t x = 0; x < width; ++x ){
+			const uint8_t* rgba = &tile[(size_t( y % header.height ) * header.width + x % header.width) * 4];
+			uint8_t* bgra = &bmp[pixelOffset + (size_t( y ) * width + x) * 4];
+			bgra[0] = rgba[2]; bgra[1] = rgba[1]; bgra[2] = rgba[0]; bgra[3] = rgba[3];
+		}
+	}
+
+	std::ofstream out( destinationPath, std::ios::binary );
+	out.write( reinterpret_cast<const char*>( bmp.data() ), static_cast<std::streamsize>( bmp.size() ) );
+	if( !out ) throw "writeTiledTexture: failed to write the image!";
+}
+
+int benchmarkTextureFiltering(){
+	const vector<uint32_t> instanceCounts = { 1000, 10000, 100000 }; // more instances = smaller cubes = stronger minification
+	const char* texturePath = "textureFilteringBenchmark.bmp";
+	const uint32_t textureTiles = 16; // 256^2 -> 4096^2
+	const uint32_t warmupFrames = 5;
+	const uint32_t measuredFrames = 50;
+	const uint32_t vertexBufferBinding = 0;
+
+	const IndexedMesh cube = indexMesh( ::cubeVertices );
+
+	bool samplerAnisotropy = false;
+	HeadlessContext context = initHeadless(  [&]( VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures& features, vector<const char*>& ){
+		samplerAnisotropy = getPhysicalDeviceFeatures( physicalDevice ).samplerAnisotropy == VK_TRUE;
+		features.samplerAnisotropy = samplerAnisotropy;
+	}  );
+	const VkDevice device = context.device;
+
+	HeadlessScene scene = initHeadlessScene( context, cube, instanceCounts.back() );
+	if( !scene.gpuTimestamps ) throw "benchmarkTextureFiltering needs GPU timestamps!";
+
+	writeTiledTexture( "vulkan.texture.bmp", texturePath, textureTiles );
+
+	// same texture without and with mips; the last mode adds anisotropic filtering
+	struct FilteringMode{
+		string name;
+		bool mipmapped;
+		float maxAnisotropy;
+
+		Texture texture;
+		VkImageView view;
+		VkSampler sampler;
+		VkDescriptorPool descriptorPool;
+		VkDescriptorSet descriptorSet;
+	};
+	vector<FilteringMode> modes = {
+		{ "no mips", false, 1.0f },
+		{ "mips", true, 1.0f }
+	};
+	if( samplerAnisotropy ) modes.push_back( { "mips + aniso", true, std::min( 16.0f, context.physicalDeviceProperties.limits.maxSamplerAnisotropy ) } );
+
+	for( FilteringMode& mode : modes ){
+		mode.texture = createTextureImage( texturePath, device, context.physicalDevice, context.commandPool, context.graphicsQueue, mode.mipmapped );
+		mode.view = createTextureImageView( device, mode.texture );
+		mode.sampler = createTextureSampler( device, mode.maxAnisotropy );
+		mode.descriptorPool = createDescriptorPool( device );
+		mode.descriptorSet = createDescriptorSet( scene.uniformBuffer, mode.view, mode.sampler, scene.objectBuffer, scene.descriptorSetLayout, mode.descriptorPool, device );
+	}
+	std::remove( texturePath );
+
+	VkPipeline pipeline = initPipeline(
+		device,
+		context.physicalDeviceProperties.limits,
+		scene.pipelineLayout,
+		scene.target.renderPass,
+		scene.vertexShader,
+		scene.fragmentShader,
+		vertexBufferBinding
+	);
+
+	logger << textureTiles * 256 << "^2 texture" << std::endl;
+	logger << "mode\tinstances\tGPU ms/frame" << std::endl;
+	for( const uint32_t count : instanceCounts ){
+		setObjectData(  device, scene.objectBufferMemory, generateObjects( generateInstanceTransforms( count ), scene.boundingSphere )  );
+
+		for( const FilteringMode& mode : modes ){
+			{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+
+			beginCommandBuffer( scene.commandBuffer );
+				vkCmdResetQueryPool( scene.commandBuffer, scene.queryPool, 0, 2 );
+				vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, scene.queryPool, 0 );
+
+				recordBeginRenderPass( scene.commandBuffer, scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+					recordBindPipeline( scene.commandBuffer, pipeline );
+					recordBindVertexBuffer( scene.commandBuffer, vertexBufferBinding, scene.vertexBuffer );
+					recordBindIndexBuffer( scene.commandBuffer, scene.indexBuffer );
+					vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &mode.descriptorSet, 0, nullptr );
+					recordDrawIndexed( scene.commandBuffer, scene.indexCount, count );
+				recordEndRenderPass( scene.commandBuffer );
+
+				vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, scene.queryPool, 1 );
+			endCommandBuffer( scene.commandBuffer );
+
+			for( uint32_t frame = 0; frame < warmupFrames; ++frame ) submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+
+			double gpuMilliseconds = 0.0;
+			for( uint32_t frame = 0; frame < measuredFrames; ++frame ){
+				submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+				gpuMilliseconds += getTimestampDelta( device, scene.queryPool, 0, context.physicalDeviceProperties.limits.timestampPeriod );
+			}
+
+			logger << mode.name << "\t" << count << "\t" << gpuMilliseconds / measuredFrames << std::endl;
+		}
+	}
+
+	killPipeline( device, pipeline );
+
+	for( FilteringMode& mode : modes ){
+		vkDestroyDescriptorPool( device, mode.descriptorPool, nullptr );
+		vkDestroySampler( device, mode.sampler, nullptr );
+		killImageView( device, mode.view );
+		killImage( device, mode.texture.image );
+		killMemory( device, mode.texture.memory );
+	}
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// A 4096^2 texture as BMP and as cooked KTX2: blocking createTextureImage() vs. streaming; for streaming, when the first
+// (coarse) levels and when all levels are resident, and how long the render thread spent in updateTextureStreamer().
+int benchmarkTextureStreaming(){
+	const char* bmpPath = "textureStreamingBenchmark.bmp";
+	const char* ktx2Path = "textureStreamingBenchmark.ktx2";
+	const uint32_t textureTiles = 16; // 256^2 -> 4096^2
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+
+	writeTiledTexture( "vulkan.texture.bmp", bmpPath, textureTiles );
+	{
+		const std::vector<char> file = readFile( bmpPath );
+		ImageHeader header;
+		readImageHeader( reinterpret_cast<const uint8_t*>( file.data() ), file.size(), header );
+		vector<uint8_t> rgba( size_t( header.width ) * header.height * 4 );
+		decodeImage( reinterpret_cast<const uint8_t*>( file.data() ), header, rgba.data() );
+
+		const vector<uint8_t> ktx2 = cookKtx2(  rgba.data(), header.width, header.height, MipFilter::Box, std::max( 1u, std::thread::hardware_concurrency() )  );
+		std::ofstream out( ktx2Path, std::ios::binary );
+		out.write( reinterpret_cast<const char*>( ktx2.data() ), static_cast<std::streamsize>( ktx2.size() ) );
+		if( !out ) throw "benchmarkTextureStreaming: failed to write the KTX2 file!";
+	}
+
+	using Clock = std::chrono::high_resolution_clock;
+	const auto millisecondsSince = []( const Clock::time_point start ){ return std::chrono::duration<double, std::milli>( Clock::now() - start ).count(); };
+
+	if( context.transferQueueFamily != context.graphicsQueueFamily ) logger << "uploads on transfer-only queue family " << context.transferQueueFamily << std::endl;
+	else logger << "uploads on the graphics queue (no transfer-only queue family)" << std::endl;
+	logger << "file\tblocking load ms\tstreamed: first levels ms\tall levels ms\trender thread ms" << std::endl;
+
+	for( const char* path : { bmpPath, ktx2Path } ){
+		const auto blockingStart = Clock::now();
+		Texture texture = createTextureImage( path, device, context.physicalDevice, context.commandPool, context.graphicsQueue );
+		const double blockingMilliseconds = millisecondsSince( blockingStart );
+		killImage( device, texture.image );
+		killMemory( device, texture.memory );
+
+		TextureStreamer streamer = initTextureStreamer( device, context.physicalDevice, context.graphicsQueueFamily, context.graphicsQueue, context.transferQueueFamily, context.transferQueue );
+
+		const auto streamingStart = Clock::now();
+		const uint32_t id = requestStreamedTexture( streamer, path, true );
+		double firstLevelsMilliseconds = 0.0;
+		double renderThreadMilliseconds = 0.0;
+		while( streamer.textures[id].residentLevel != 0 || streamer.textures[id].view == VK_NULL_HANDLE ){
+			const auto updateStart = Clock::now();
+			updateTextureStreamer( device, streamer, ::textureStreamingBudget );
+			killRetiredTextureViews( device, streamer ); // nothing draws with them here
+			renderThreadMilliseconds += millisecondsSince( updateStart );
+
+			if( firstLevelsMilliseconds == 0.0 && streamer.textures[id].view ) firstLevelsMilliseconds = millisecondsSince( streamingStart );
+			std::this_thread::yield(); // a frame would be rendered here
+		}
+		const double allLevelsMilliseconds = millisecondsSince( streamingStart );
+
+		{VkResult errorCode = vkDeviceWaitIdle( device ); RESULT_HANDLER( errorCode, "vkDeviceWaitIdle" );}
+		killTextureStreamer( device, streamer );
+
+		logger << path << "\t" << blockingMilliseconds << "\t" << firstLevelsMilliseconds << "\t" << allLevelsMilliseconds << "\t" << renderThreadMilliseconds << std::endl;
+	}
+
+	std::remove( bmpPath );
+	std::remove( ktx2Path );
+
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// Many small textures, each drawn with its own descriptor set and draw, vs. packed into the layers of one texture array (TexturePacker.h)
+// and drawn with one descriptor set and one instanced draw -- the batching path for devices without descriptor indexing.
+// Prints the packing efficiency too. Command buffers are re-recorded every frame, so the per-draw CPU cost shows up.
+int benchmarkTextureAtlas(){
+	const vector<uint32_t> textureCounts = { 64, 256, 1024 };
+	const uint32_t pageSize = 1024;
+	const uint32_t atlasMipLevels = 4;
+	const uint32_t warmupFrames = 5;
+	const uint32_t measuredFrames = 50;
+	const uint32_t vertexBufferBinding = 0;
+
+	const IndexedMesh cube = indexMesh( ::cubeVertices );
+	const uint32_t indexCount = static_cast<uint32_t>( cube.indices.size() );
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+
+	HeadlessScene scene = initHeadlessScene( context, cube, textureCounts.back() );
+
+	// both pipelines use the scene's set layout: binding 1 is a sampler2D for one, a sampler2DArray for the other
+	VkShaderModule arrayFragmentShader = createShaderModule( device, readFile( "fragmentShaderTextureArray.spv" ) );
+	VkPipeline pipeline = initPipeline( device, context.physicalDeviceProperties.limits, scene.pipelineLayout, scene.target.renderPass, scene.vertexShader, scene.fragmentShader, vertexBufferBinding );
+	VkPipeline arrayPipeline = initPipeline( device, context.physicalDeviceProperties.limits, scene.pipelineLayout, scene.target.renderPass, scene.vertexShader, arrayFragmentShader, vertexBufferBinding );
+
+	// returns wall and GPU milliseconds per frame
+	const auto measure = [&]( const std::function<void(void)>& recordDraws ){
+		const auto recordFrame = [&](){
+			{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+
+			beginCommandBuffer( scene.commandBuffer );
+				if( scene.gpuTimestamps ){
+					vkCmdResetQueryPool( scene.commandBuffer, scene.queryPool, 0, 2 );
+					vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, scene.queryPool, 0 );
+				}
+
+				recordBeginRenderPass( scene.commandBuffer, scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+					recordBindVertexBuffer( scene.commandBuffer, vertexBufferBinding, scene.vertexBuffer );
+					recordBindIndexBuffer( scene.commandBuffer, scene.indexBuffer );
+					recordDraws();
+				recordEndRenderPass( scene.commandBuffer );
+
+				if( scene.gpuTimestamps ) vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, scene.queryPool, 1 );
+			endCommandBuffer( scene.commandBuffer );
+		};
+
+		for( uint32_t frame = 0; frame < warmupFrames; ++frame ){
+			recordFrame();
+			submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+		}
+
+		double wallMilliseconds = 0.0;
+		double gpuMilliseconds = 0.0;
+		for( uint32_t frame = 0; frame < measuredFrames; ++frame ){
+			const auto frameStart = std::chrono::high_resolution_clock::now();
+			recordFrame();
+			submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+			wallMilliseconds += std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - frameStart ).count();
+
+			if( scene.gpuTimestamps ) gpuMilliseconds += getTimestampDelta( device, scene.queryPool, 0, context.physicalDeviceProperties.limits.timestampPeriod );
+		}
+
+		return std::make_pair( wallMilliseconds / measuredFrames, gpuMilliseconds / measuredFrames );
+	};
+
+	std::mt19937 random( 1 );
+	logger << "textures\tlayers\tpacking efficiency\tpack ms\tseparate wall ms/frame\tseparate GPU ms/frame\tarray wall ms/frame\tarray GPU ms/frame" << std::endl;
+	for( const uint32_t count : textureCounts ){
+		// 8 to 128 texels per side, a checkerboard in its own color each
+		vector<glm::uvec2> sizes( count );
+		vector<vector<uint8_t>> images( count );
+		vector<const uint8_t*> imagePointers( count );
+		for( uint32_t i = 0; i < count; ++i ){
+			sizes[i] = glm::uvec2( 8u << random() % 5, 8u << random() % 5 );
+			const uint8_t color[3] = { uint8_t( random() ), uint8_t( random() ), uint8_t( random() ) };
+
+			images[i].resize( size_t( sizes[i].x ) * sizes[i].y * 4 );
+			for( uint32_t y = 0; y < sizes[i].y; ++y ){
+				for( uint32_t x = 0; x < sizes[i].x; ++x ){
+					uint8_t* texel = &images[i][(size_t( y ) * sizes[i].x + x) * 4];
+					const uint32_t darker = (x / 4 + y / 4) & 1;
+					for( uint32_t c = 0; c < 3; ++c ) texel[c] = color[c] >> darker;
+					texel[3] = 255;
+				}
+			}
+			imagePointers[i] = images[i].data();
+		}
+
+		const auto packStart = std::chrono::high_resolution_clock::now();
+		const TextureAtlas atlas = packTextures( sizes, pageSize, pageSize, atlasMipLevels );
+		vector<vector<vector<uint8_t>>> layers( atlas.layerCount );
+		for( uint32_t layer = 0; layer < atlas.layerCount; ++layer ) layers[layer] = buildAtlasLayer( atlas, layer, imagePointers );
+		const double packMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - packStart ).count();
+		if( atlas.layerCount > context.physicalDeviceProperties.limits.maxImageArrayLayers ) throw "benchmarkTextureAtlas: more atlas layers than maxImageArrayLayers!";
+
+		// a descriptor set per texture, and one more for the array
+		const std::array<VkDescriptorPoolSize, 3> poolSizes{{
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, count + 1 },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, count + 1 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count + 1 }
+		}};
+		const VkDescriptorPoolCreateInfo poolInfo{
+			VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			nullptr, // pNext
+			0, // flags
+			count + 1, // max sets
+			static_cast<uint32_t>( poolSizes.size() ),
+			poolSizes.data()
+		};
+		VkDescriptorPool descriptorPool;
+		{VkResult errorCode = vkCreateDescriptorPool( device, &poolInfo, nullptr, &descriptorPool ); RESULT_HANDLER( errorCode, "vkCreateDescriptorPool" );}
+
+		vector<Texture> textures( count );
+		vector<VkImageView> textureImageViews( count );
+		vector<VkDescriptorSet> descriptorSets( count );
+		for( uint32_t i = 0; i < count; ++i ){
+			textures[i] = createTextureArrayImage( VK_FORMAT_R8G8B8A8_SRGB, sizes[i].x, sizes[i].y, {{ images[i] }}, device, context.physicalDevice, context.commandPool, context.graphicsQueue );
+			textureImageViews[i] = createTextureImageView( device, textures[i] );
+			descriptorSets[i] = createDescriptorSet( scene.uniformBuffer, textureImageViews[i], scene.textureSampler, scene.objectBuffer, scene.descriptorSetLayout, descriptorPool, device );
+		}
+
+		Texture arrayTexture = createTextureArrayImage( VK_FORMAT_R8G8B8A8_SRGB, pageSize, pageSize, layers, device, context.physicalDevice, context.commandPool, context.graphicsQueue );
+		VkImageView arrayImageView = createTextureArrayImageView( device, arrayTexture, atlas.layerCount );
+		VkDescriptorSet arrayDescriptorSet = createDescriptorSet( scene.uniformBuffer, arrayImageView, scene.textureSampler, scene.objectBuffer, scene.descriptorSetLayout, descriptorPool, device );
+
+		// separate: whole [0, 1] uv of its own texture
+		vector<ObjectData> objects = generateObjects( generateInstanceTransforms( count ), scene.boundingSphere );
+		setObjectData( device, scene.objectBufferMemory, objects );
+		const auto separate = measure( [&](){
+			recordBindPipeline( scene.commandBuffer, pipeline );
+			for( uint32_t i = 0; i < count; ++i ){
+				vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr );
+				vkCmdDrawIndexed( scene.commandBuffer, indexCount, 1, 0, 0, i /*first instance = object index*/ );
+			}
+		} );
+
+		// array: layer and rect of its texture
+		for( uint32_t i = 0; i < count; ++i ){
+			objects[i].uvTransform = getAtlasUvTransform( atlas, atlas.entries[i] );
+			objects[i].textureIndex = atlas.entries[i].layer;
+		}
+		setObjectData( device, scene.objectBufferMemory, objects );
+		const auto array = measure( [&](){
+			recordBindPipeline( scene.commandBuffer, arrayPipeline );
+			vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &arrayDescriptorSet, 0, nullptr );
+			recordDrawIndexed( scene.commandBuffer, indexCount, count );
+		} );
+
+		logger << count << "\t" << atlas.layerCount << "\t" << getPackingEfficiency( atlas ) << "\t" << packMilliseconds
+			<< "\t" << separate.first << "\t" << (scene.gpuTimestamps ? to_string( separate.second ) : string( "n/a" ))
+			<< "\t" << array.first << "\t" << (scene.gpuTimestamps ? to_string( array.second ) : string( "n/a" )) << std::endl;
+
+		vkDestroyDescriptorPool( device, descriptorPool, nullptr );
+		killImageView( device, arrayImageView );
+		killImage( device, arrayTexture.image );
+		killMemory( device, arrayTexture.memory );
+		for( uint32_t i = 0; i < count; ++i ){
+			killImageView( device, textureImageViews[i] );
+			killImage( device, textures[i].image );
+			killMemory( device, textures[i].memory );
+		}
+	}
+
+	killPipeline( device, arrayPipeline );
+	killPipeline( device, pipeline );
+	killShaderModule( device, arrayFragmentShader );
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// Flies low over a terrain plane textured with a virtualTextureSize^2 procedural virtual texture: hovering first (how many frames
+// until the pages the view needs are resident), then slow and fast. Per frame: feedback readback and analysis, page loads
+// (CPU generated), the feedback pass and the main pass. Runs the software indirection, and sparse residency where the device has it.
+int benchmarkVirtualTexture(){
+	struct Phase{ const char* name; uint32_t frames; float speed; /*world units per frame*/ };
+	const vector<Phase> phases = { { "hover", 60, 0.0f }, { "slow", 120, 0.5f }, { "fast", 120, 4.0f } };
+	const float terrainExtent = 4096.0f; // half size; 8 texels per unit at level 0
+	const float cameraHeight = 12.0f;
+	const uint32_t vertexBufferBinding = 0;
+
+	const vector<Vertex3D_UV> plane = {
+		{ { -1.0f, 0.0f, -1.0f }, { 0.0f, 0.0f } }, { { 1.0f, 0.0f, -1.0f }, { 1.0f, 0.0f } }, { { 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f } },
+		{ { -1.0f, 0.0f, -1.0f }, { 0.0f, 0.0f } }, { { 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f } }, { { -1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } }
+	};
+
+	bool sparseResidency = false;
+	HeadlessContext context = initHeadless(  [&]( VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures& features, vector<const char*>& ){
+		sparseResidency = requestSparseResidencySupport( physicalDevice, getGraphicsQueueFamily( physicalDevice ), VK_FORMAT_R8G8B8A8_SRGB, virtualTexturePageSize, features );
+	}  );
+	const VkDevice device = context.device;
+	if( !sparseResidency ) logger << "No sparse residency for " << virtualTexturePageSize << "^2 texel pages; software indirection only." << std::endl;
+
+	OffscreenTarget target = initOffscreenTarget( context, screenWidth, screenHeight );
+
+	const std::vector<VkMemoryPropertyFlags> memoryTypePriority{
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+	};
+
+	VkBuffer vertexBuffer = initBuffer( device, sizeof( Vertex3D_UV ) * plane.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT );
+	VkDeviceMemory vertexBufferMemory = initMemory<ResourceType::Buffer>( device, context.physicalDeviceMemoryProperties, vertexBuffer, memoryTypePriority );
+	setVertexData( device, vertexBufferMemory, plane );
+
+	VkBuffer objectBuffer = initObjectBuffer( device, 1 );
+	VkDeviceMemory objectBufferMemory = initMemory<ResourceType::Buffer>( device, context.physicalDeviceMemoryProperties, objectBuffer, memoryTypePriority );
+	setObjectData(  device, objectBufferMemory, generateObjects( { glm::scale( glm::mat4( 1.0f ), glm::vec3( terrainExtent ) ) }, glm::vec4( 0.0f, 0.0f, 0.0f, terrainExtent * 1.5f ) )  );
+
+	VkBuffer uniformBuffer;
+	VkDeviceMemory uniformBufferMemory;
+	std::tie( uniformBuffer, uniformBufferMemory ) = createUniformBuffer( device, context.physicalDevice );
+
+	VkDescriptorSetLayout descriptorSetLayout = createVirtualTextureDescriptorSetLayout( device );
+	const std::array<VkDescriptorPoolSize, 3> poolSizes{{
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 }
+	}};
+	const VkDescriptorPoolCreateInfo poolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		nullptr, // pNext
+		VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, // a set per mode
+		1, // max sets
+		static_cast<uint32_t>( poolSizes.size() ),
+		poolSizes.data()
+	};
+	VkDescriptorPool descriptorPool;
+	{VkResult errorCode = vkCreateDescriptorPool( device, &poolInfo, nullptr, &descriptorPool ); RESULT_HANDLER( errorCode, "vkCreateDescriptorPool" );}
+
+	VkShaderModule vertexShader = createShaderModule( device, readFile( "vertexShader.spv" ) );
+	VkPipelineLayout pipelineLayout = initPipelineLayout( device, descriptorSetLayout );
+
+	vector<VkCommandBuffer> commandBuffers;
+	acquireCommandBuffers( device, context.commandPool, 1, commandBuffers );
+	const VkCommandBuffer commandBuffer = commandBuffers[0];
+	VkFence fence = initFence( device );
+
+	const bool gpuTimestamps = getQueueFamilyProperties( context.physicalDevice )[context.graphicsQueueFamily].timestampValidBits > 0;
+	VkQueryPool queryPool = initTimestampQueryPool( device, 3 );
+
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	clearValues[1].depthStencil = {1.0f, 0};
+
+	glm::mat4 proj = glm::perspective( glm::radians( 60.0f ), float( target.width ) / float( target.height ), 0.1f, 2.0f * terrainExtent );
+	proj[1][1] *= -1; // Invert Y coordinate for Vulkan
+
+	vector<bool> modes = { false };
+	if( sparseResidency ) modes.push_back( true );
+
+	logger << "mode\tphase\tvirtual size\tframes until resident\trequested pages/frame\tloads/frame\tresident pages\tanalysis ms/frame\tload ms/frame\twall ms/frame\tuploads + feedback GPU ms/frame\tmain GPU ms/frame" << std::endl;
+	for( const bool sparse : modes ){
+		VirtualTexture virtualTexture = initVirtualTexture( device, context.physicalDevice, context.graphicsQueue, context.commandPool, sparse, virtualTextureSize, generateProceduralPage, target.width, target.height );
+		VkDescriptorSet descriptorSet = createVirtualTextureDescriptorSet( device, descriptorPool, descriptorSetLayout, uniformBuffer, objectBuffer, virtualTexture );
+
+		VkShaderModule feedbackShader = createShaderModule( device, readFile( "virtualTextureFeedback.spv" ) );
+		VkShaderModule fragmentShader = createShaderModule(  device, readFile( sparse ? "virtualTextureSparse.spv" : "virtualTexture.spv" )  );
+		VkPipeline feedbackPipeline = initPipeline( device, context.physicalDeviceProperties.limits, pipelineLayout, virtualTexture.feedbackRenderPass, vertexShader, feedbackShader, vertexBufferBinding );
+		VkPipeline pipeline = initPipeline( device, context.physicalDeviceProperties.limits, pipelineLayout, target.renderPass, vertexShader, fragmentShader, vertexBufferBinding );
+
+		glm::vec3 cameraPosition( -0.5f * terrainExtent, cameraHeight, 0.0f );
+		for( const Phase& phase : phases ){
+			VirtualTextureStats sum{};
+			double wallMilliseconds = 0.0;
+			double feedbackGpuMilliseconds = 0.0;
+			double mainGpuMilliseconds = 0.0;
+			uint32_t framesUntilResident = 0;
+
+			for( uint32_t frame = 0; frame < phase.frames; ++frame ){
+				const auto frameStart = std::chrono::high_resolution_clock::now();
+
+				cameraPosition.x += phase.speed;
+				const glm::mat4 view = glm::lookAt( cameraPosition, cameraPosition + glm::vec3( 1.0f, -0.3f, 0.2f ), glm::vec3( 0.0f, 1.0f, 0.0f ) );
+				UniformBufferObject ubo{ proj * view };
+				setMemoryData( device, uniformBufferMemory, &ubo, sizeof( ubo ) );
+
+				const VirtualTextureStats stats = updateVirtualTexture( device, virtualTexture );
+				sum.requestedPages += stats.requestedPages;
+				sum.loadedPages += stats.loadedPages;
+				sum.analysisMilliseconds += stats.analysisMilliseconds;
+				sum.loadMilliseconds += stats.loadMilliseconds;
+				sum.residentPages = stats.residentPages;
+				if( stats.loadedPages ) framesUntilResident = frame + 1;
+
+				{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+				beginCommandBuffer( commandBuffer );
+					if( gpuTimestamps ){
+						vkCmdResetQueryPool( commandBuffer, queryPool, 0, 3 );
+						vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0 );
+					}
+
+					recordVirtualTextureUploads( commandBuffer, virtualTexture );
+
+					recordBeginVirtualTextureFeedback( commandBuffer, virtualTexture );
+						recordBindPipeline( commandBuffer, feedbackPipeline );
+						vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr );
+						recordBindVertexBuffer( commandBuffer, vertexBufferBinding, vertexBuffer );
+						recordDraw( commandBuffer, static_cast<uint32_t>( plane.size() ) );
+					recordEndVirtualTextureFeedback( commandBuffer, virtualTexture );
+
+					if( gpuTimestamps ) vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1 );
+
+					recordBeginRenderPass( commandBuffer, target.renderPass, target.framebuffers[0], clearValues.data(), target.width, target.height );
+						recordBindPipeline( commandBuffer, pipeline );
+						vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr );
+						recordBindVertexBuffer( commandBuffer, vertexBufferBinding, vertexBuffer );
+						recordDraw( commandBuffer, static_cast<uint32_t>( plane.size() ) );
+					recordEndRenderPass( commandBuffer );
+
+					if( gpuTimestamps ) vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2 );
+				endCommandBuffer( commandBuffer );
+				submitAndWait( device, context.graphicsQueue, commandBuffer, fence );
+
+				wallMilliseconds += std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - frameStart ).count();
+				if( gpuTimestamps ){
+					feedbackGpuMilliseconds += getTimestampDelta( device, queryPool, 0, context.physicalDeviceProperties.limits.timestampPeriod );
+					mainGpuMilliseconds += getTimestampDelta( device, queryPool, 1, context.physicalDeviceProperties.limits.timestampPeriod );
+				}
+			}
+
+			const double frames = phase.frames;
+			logger << (sparse ? "sparse" : "indirection") << "\t" << phase.name << "\t" << virtualTexture.layout.size
+				<< "\t" << (framesUntilResident < phase.frames ? to_string( framesUntilResident ) : string( "never" ))
+				<< "\t" << sum.requestedPages / frames << "\t" << sum.loadedPages / frames << "\t" << sum.residentPages
+				<< "\t" << sum.analysisMilliseconds / frames << "\t" << sum.loadMilliseconds / frames << "\t" << wallMilliseconds / frames
+				<< "\t" << (gpuTimestamps ? to_string( feedbackGpuMilliseconds / frames ) : string( "n/a" ))
+				<< "\t" << (gpuTimestamps ? to_string( mainGpuMilliseconds / frames ) : string( "n/a" )) << std::endl;
+		}
+
+		killPipeline( device, pipeline );
+		killPipeline( device, feedbackPipeline );
+		killShaderModule( device, fragmentShader );
+		killShaderModule( device, feedbackShader );
+		{VkResult errorCode = vkFreeDescriptorSets( device, descriptorPool, 1, &descriptorSet ); RESULT_HANDLER( errorCode, "vkFreeDescriptorSets" );}
+		killVirtualTexture( device, virtualTexture );
+	}
+
+	killQueryPool( device, queryPool );
+	killFence( device, fence );
+
+	killPipelineLayout( device, pipelineLayout );
+	killShaderModule( device, vertexShader );
+
+	vkDestroyDescriptorPool( device, descriptorPool, nullptr );
+	vkDestroyDescriptorSetLayout( device, descriptorSetLayout, nullptr );
+
+	killBuffer( device, uniformBuffer );
+	killMemory( device, uniformBufferMemory );
+	killBuffer( device, objectBuffer );
+	killMemory( device, objectBufferMemory );
+	killBuffer( device, vertexBuffer );
+	killMemory( device, vertexBufferMemory );
+
+	killOffscreenTarget( device, target );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// Two paths with the same 4096^2 BMP, as two materials would name it: createTextureImage() for each vs. the resource cache,
+// cold (decoded, written to the cache directory) and warm (a new cache reading the decoded texture back). Then buffers with
+// distinct contents through a cache with a small budget, for the LRU eviction.
+int benchmarkResourceCache(){
+	const vector<string> paths = { "resourceCacheBenchmarkA.bmp", "resourceCacheBenchmarkB.bmp" };
+	const string directory = "resourceCacheBenchmark";
+	const uint32_t textureTiles = 16; // 256^2 -> 4096^2
+	const uint32_t bufferCount = 8;
+	const VkDeviceSize bufferSize = 1 << 20;
+	const VkDeviceSize bufferBudget = 4 * bufferSize;
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+
+	for( const string& path : paths ) writeTiledTexture( "vulkan.texture.bmp", path.c_str(), textureTiles );
+	std::filesystem::remove_all( directory );
+
+	using Clock = std::chrono::high_resolution_clock;
+	const auto millisecondsSince = []( const Clock::time_point start ){ return std::chrono::duration<double, std::milli>( Clock::now() - start ).count(); };
+	const auto logCache = [&]( const string& name, const double milliseconds, const ResourceCache& cache ){
+		logger << name << "\t" << milliseconds << "\t" << cache.stats.hits << "\t" << cache.stats.diskHits << "\t" << cache.stats.misses << "\t"
+			<< cache.stats.evictions << "\t" << cache.residentBytes / double( 1 << 20 ) << std::endl;
+	};
+
+	logger << "load\tms\thits\tdisk hits\tmisses\tevictions\tresident MiB" << std::endl;
+
+	{
+		const auto start = Clock::now();
+		for( const string& path : paths ){
+			Texture texture = createTextureImage( path.c_str(), device, context.physicalDevice, context.commandPool, context.graphicsQueue );
+			killImage( device, texture.image );
+			killMemory( device, texture.memory );
+		}
+		logger << "createTextureImage, both paths\t" << millisecondsSince( start ) << std::endl;
+	}
+
+	for( const string pass : { "cold", "warm" } ){
+		ResourceCache cache = initResourceCache( context.physicalDevice, context.commandPool, context.graphicsQueue, directory, ::resourceCacheBudget );
+
+		const auto start = Clock::now();
+		const CachedResource& a = acquireCachedTexture( device, cache, paths[0], true );
+		const CachedResource& b = acquireCachedTexture( device, cache, paths[1], true );
+		if( a.texture.image != b.texture.image ) throw "benchmarkResourceCache: the same file content was uploaded twice!";
+		logCache( pass + " cache, both paths", millisecondsSince( start ), cache );
+
+		releaseCachedResource( device, cache, a.key );
+		releaseCachedResource( device, cache, b.key );
+		killResourceCache( device, cache );
+	}
+
+	{
+		ResourceCache cache = initResourceCache( context.physicalDevice, context.commandPool, context.graphicsQueue, directory, bufferBudget );
+
+		std::mt19937 random( 1 );
+		vector<vector<uint32_t>> contents( bufferCount, vector<uint32_t>( bufferSize / sizeof( uint32_t ) ) );
+		for( auto& content : contents ) for( uint32_t& word : content ) word = random();
+
+		// each acquired and released in turn, as by a loading screen going through levels
+		const auto start = Clock::now();
+		for( const auto& content : contents ){
+			releaseCachedResource( device, cache, acquireCachedBuffer( device, cache, content.data(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT ).key );
+		}
+		logCache( std::to_string( bufferCount ) + " distinct 1 MiB buffers, 4 MiB budget", millisecondsSince( start ), cache );
+
+		// the last released is still resident, the first was evicted and gets uploaded again
+		for( const size_t i : { bufferCount - 1, 0u } ){
+			const auto againStart = Clock::now();
+			releaseCachedResource( device, cache, acquireCachedBuffer( device, cache, contents[i].data(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT ).key );
+			logCache( "buffer " + std::to_string( i ) + " again", millisecondsSince( againStart ), cache );
+		}
+
+		killResourceCache( device, cache );
+	}
+
+	for( const string& path : paths ) std::remove( path.c_str() );
+	std::filesystem::remove_all( directory );
+
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// Batches of images through ImageConverter, a submission each, sources written into the staging ring every time:
+// format conversions, resizes and mip chains. Throughput in megapixels of source per second, of GPU time where the queue
+// has timestamps. The plain BGR8 -> RGBA8 conversion is checked against the CPU.
+int benchmarkImageConversion(){
+	const uint32_t imageCount = 8;
+	const uint32_t imageSize = 1024;
+	const uint32_t warmupBatches = 1;
+	const uint32_t measuredBatches = 5;
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+
+	StagingRing ring = initStagingRing( device, context.physicalDevice, 64 << 20 );
+	ImageConverter converter = initImageConverter( device, context.physicalDevice, ring, 128 << 20 );
+
+	// gradients and a checkerboard, so both smooth areas and hard edges (ringing, aliasing) are there
+	vector<uint8_t> bgr( size_t( imageSize ) * imageSize * 3 );
+	vector<uint8_t> rgba( size_t( imageSize ) * imageSize * 4 );
+	for( uint32_t y = 0; y < imageSize; ++y ){
+		for( uint32_t x = 0; x < imageSize; ++x ){
+			const size_t texel = size_t( y ) * imageSize + x;
+			const uint8_t color[4] = { uint8_t( x * 255 / (imageSize - 1) ), uint8_t( y * 255 / (imageSize - 1) ), uint8_t( ((x / 32 + y / 32) & 1) * 255 ), 255 };
+			bgr[3 * texel] = color[2];
+			bgr[3 * texel + 1] = color[1];
+			bgr[3 * texel + 2] = color[0];
+			std::memcpy( &rgba[4 * texel], color, 4 );
+		}
+	}
+
+	struct ConversionCase{
+		const char* name;
+		PixelFormat sourceFormat;
+		PixelFormat destinationFormat;
+		bool destinationSrgb;
+		uint32_t size;
+		ResampleFilter filter;
+		bool mipmapped; // into images, the others are read back
+	};
+	const vector<ConversionCase> cases = {
+		{ "BGR8 -> RGBA8", PixelFormat::Bgr8, PixelFormat::Rgba8, true, imageSize, ResampleFilter::Bilinear, false },
+		{ "RGBA8 sRGB -> RGBA8 linear", PixelFormat::Rgba8, PixelFormat::Rgba8, false, imageSize, ResampleFilter::Bilinear, false },
+		{ "RGBA8 sRGB -> RGBA16F", PixelFormat::Rgba8, PixelFormat::Rgba16f, false, imageSize, ResampleFilter::Bilinear, false },
+		{ "BGR8 -> RGBA8, bilinear to 1/2", PixelFormat::Bgr8, PixelFormat::Rgba8, true, imageSize / 2, ResampleFilter::Bilinear, false },
+		{ "BGR8 -> RGBA8, Lanczos3 to 1/2", PixelFormat::Bgr8, PixelFormat::Rgba8, true, imageSize / 2, ResampleFilter::Lanczos3, false },
+		{ "BGR8 -> RGBA8 image, bilinear mips", PixelFormat::Bgr8, PixelFormat::Rgba8, true, imageSize, ResampleFilter::Bilinear, true },
+		{ "BGR8 -> RGBA8 image, Lanczos3 mips", PixelFormat::Bgr8, PixelFormat::Rgba8, true, imageSize, ResampleFilter::Lanczos3, true }
+	};
+
+	vector<VkCommandBuffer> commandBuffers;
+	acquireCommandBuffers( device, context.commandPool, 1, commandBuffers );
+	const VkCommandBuffer commandBuffer = commandBuffers[0];
+
+	const bool gpuTimestamps = getQueueFamilyProperties( context.physicalDevice )[context.graphicsQueueFamily].timestampValidBits > 0;
+	VkQueryPool queryPool = initTimestampQueryPool( device, 2 );
+
+	logger << "conversion\timages\twall ms/batch\tGPU ms/batch\tMP/s" << std::endl;
+	for( const ConversionCase& conversionCase : cases ){
+		const uint32_t mipLevels = conversionCase.mipmapped ? static_cast<uint32_t>( std::floor( std::log2( conversionCase.size ) ) ) + 1 : 1;
+		const vector<uint8_t>& source = conversionCase.sourceFormat == PixelFormat::Bgr8 ? bgr : rgba;
+
+		vector<Texture> images( conversionCase.mipmapped ? imageCount : 0 );
+		for( Texture& image : images ){
+			image = { VK_NULL_HANDLE, VK_NULL_HANDLE, conversionCase.destinationFormat == PixelFormat::Rgba16f ? VK_FORMAT_R16G16B16A16_SFLOAT : conversionCase.destinationSrgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM, mipLevels };
+			createImage( device, context.physicalDevice, conversionCase.size, conversionCase.size, mipLevels, image.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image.image, image.memory );
+		}
+
+		double wallMilliseconds = 0.0;
+		double gpuMilliseconds = 0.0;
+		for( uint32_t batch = 0; batch < warmupBatches + measuredBatches; ++batch ){
+			const auto batchStart = std::chrono::high_resolution_clock::now();
+
+			vector<ImageConversion> conversions;
+			for( uint32_t i = 0; i < imageCount; ++i ){
+				const VkDeviceSize sourceOffset = allocateStaging( device, ring, source.size() );
+				std::memcpy( ring.mapped + sourceOffset, source.data(), source.size() );
+				conversions.push_back( {
+					sourceOffset, conversionCase.sourceFormat, true, imageSize, imageSize,
+					conversionCase.destinationFormat, conversionCase.destinationSrgb, conversionCase.size, conversionCase.size,
+					conversionCase.filter, mipLevels,
+					conversionCase.mipmapped ? images[i].image : VK_NULL_HANDLE, 0
+				} );
+			}
+
+			{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+			beginCommandBuffer( commandBuffer );
+				if( gpuTimestamps ){
+					vkCmdResetQueryPool( commandBuffer, queryPool, 0, 2 );
+					vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0 );
+				}
+				recordImageConversions( commandBuffer, converter, conversions );
+				if( gpuTimestamps ) vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1 );
+			endCommandBuffer( commandBuffer );
+
+			// not submitAndWait(): the ring resets its fences itself
+			VkFence fence = retireStaging( device, ring );
+			const VkSubmitInfo submit{ VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr, 0, nullptr, nullptr, 1, &commandBuffer, 0, nullptr };
+			{VkResult errorCode = vkQueueSubmit( context.graphicsQueue, 1, &submit, fence ); RESULT_HANDLER( errorCode, "vkQueueSubmit" );}
+			{VkResult errorCode = vkWaitForFences( device, 1, &fence, VK_TRUE, UINT64_MAX ); RESULT_HANDLER( errorCode, "vkWaitForFences" );}
+
+			if( batch < warmupBatches ) continue;
+			wallMilliseconds += std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - batchStart ).count();
+			if( gpuTimestamps ) gpuMilliseconds += getTimestampDelta( device, queryPool, 0, context.physicalDeviceProperties.limits.timestampPeriod );
+
+			if( &conversionCase == &cases[0] ){
+				const uint8_t* converted = converter.readback + conversions[0].readbackOffset;
+				for( size_t texel = 0; texel < size_t( imageSize ) * imageSize; ++texel ){
+					for( uint32_t channel = 0; channel < 4; ++channel ){
+						if( std::abs( int( converted[4 * texel + channel] ) - int( rgba[4 * texel + channel] ) ) > 1 ) throw "benchmarkImageConversion: BGR8 -> RGBA8 does not match the CPU!";
+					}
+				}
+			}
+		}
+		wallMilliseconds /= measuredBatches;
+		gpuMilliseconds /= measuredBatches;
+
+		const double megapixels = double( imageCount ) * imageSize * imageSize / 1.0e6;
+		const double batchMilliseconds = gpuTimestamps ? gpuMilliseconds : wallMilliseconds;
+		logger << conversionCase.name << "\t" << imageCount << "\t" << wallMilliseconds << "\t" << (gpuTimestamps ? to_string( gpuMilliseconds ) : string( "n/a" )) << "\t" << megapixels / batchMilliseconds * 1000.0 << std::endl;
+
+		for( Texture& image : images ){
+			killImage( device, image.image );
+			killMemory( device, image.memory );
+		}
+	}
+
+	killQueryPool( device, queryPool );
+	killImageConverter( device, converter );
+	killStagingRing( device, ring );
+
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// The graphics pipelines of the app and the benchmarks, created without a pipeline cache, with an empty one (cold, then saved)
+// and with the one loaded back from the file (warm). Drivers with a shader cache of their own (Mesa's on disk) shrink the
+// difference after their first run.
+int benchmarkPipelineCache(){
+	const string path = "pipelineCacheBenchmark.bin";
+	const uint32_t vertexBufferBinding = 0;
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+	OffscreenTarget target = initOffscreenTarget( context, screenWidth, screenHeight );
+
+	VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayout( device );
+	VkDescriptorSetLayout virtualTextureDescriptorSetLayout = createVirtualTextureDescriptorSetLayout( device );
+	VkPipelineLayout pipelineLayout = initPipelineLayout( device, descriptorSetLayout );
+	VkPipelineLayout virtualTexturePipelineLayout = initPipelineLayout( device, virtualTextureDescriptorSetLayout );
+
+	VkShaderModule vertexShader = createShaderModule( device, readFile( "vertexShader.spv" ) );
+	const vector<std::pair<VkPipelineLayout, VkShaderModule>> variants = {
+		{ pipelineLayout, createShaderModule( device, readFile( "fragmentShader.spv" ) ) },
+		{ pipelineLayout, createShaderModule( device, readFile( "fragmentShaderTextureArray.spv" ) ) },
+		{ virtualTexturePipelineLayout, createShaderModule( device, readFile( "virtualTexture.spv" ) ) },
+		{ virtualTexturePipelineLayout, createShaderModule( device, readFile( "virtualTextureSparse.spv" ) ) }
+	};
+
+	const auto createPipelines = [&]( const VkPipelineCache pipelineCache ){
+		const auto start = std::chrono::high_resolution_clock::now();
+		vector<VkPipeline> pipelines;
+		for( const auto& variant : variants ){
+			pipelines.push_back( initPipeline( device, context.physicalDeviceProperties.limits, variant.first, target.renderPass, vertexShader, variant.second, vertexBufferBinding, pipelineCache ) );
+		}
+		const double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+
+		for( const VkPipeline pipeline : pipelines ) killPipeline( device, pipeline );
+		return milliseconds;
+	};
+
+	std::remove( path.c_str() );
+	logger << "pipeline cache\tpipelines\tms" << std::endl;
+	logger << "none\t" << variants.size() << "\t" << createPipelines( VK_NULL_HANDLE ) << std::endl;
+
+	VkPipelineCache coldCache = initPipelineCache( device, context.physicalDeviceProperties, path );
+	logger << "cold\t" << variants.size() << "\t" << createPipelines( coldCache ) << std::endl;
+	savePipelineCache( device, coldCache, path );
+	killPipelineCache( device, coldCache );
+
+	VkPipelineCache warmCache = initPipelineCache( device, context.physicalDeviceProperties, path );
+	logger << "warm\t" << variants.size() << "\t" << createPipelines( warmCache ) << std::endl;
+	killPipelineCache( device, warmCache );
+	std::remove( path.c_str() );
+
+	for( const auto& variant : variants ) killShaderModule( device, variant.second );
+	killShaderModule( device, vertexShader );
+	killPipelineLayout( device, virtualTexturePipelineLayout );
+	killPipelineLayout( device, pipelineLayout );
+	vkDestroyDescriptorSetLayout( device, virtualTextureDescriptorSetLayout, nullptr );
+	vkDestroyDescriptorSetLayout( device, descriptorSetLayout, nullptr );
+
+	killOffscreenTarget( device, target );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// Resizes an offscreen target through a few sizes and renders one frame after each, as recreateSwapchain does: keeping the
+// pipeline (dynamic viewport and scissor) vs. creating it again, as the viewport baked into it used to require.
+// No pipeline cache for the rebuilds; a driver shader cache (Mesa's) still makes them cheaper than a first creation.
+int benchmarkResize(){
+	const vector<VkExtent2D> sizes = { {640, 480}, {1280, 720}, {800, 600}, {1920, 1080}, {1024, 768} };
+	const uint32_t rounds = 10;
+	const uint32_t vertexBufferBinding = 0;
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+
+	VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayout( device );
+	VkPipelineLayout pipelineLayout = initPipelineLayout( device, descriptorSetLayout );
+	VkShaderModule vertexShader = createShaderModule( device, readFile( "vertexShader.spv" ) );
+	VkShaderModule fragmentShader = createShaderModule( device, readFile( "fragmentShader.spv" ) );
+
+	vector<VkCommandBuffer> commandBuffers;
+	acquireCommandBuffers( device, context.commandPool, 1, commandBuffers );
+	const VkCommandBuffer commandBuffer = commandBuffers[0];
+	VkFence fence = initFence( device );
+
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	clearValues[1].depthStencil = {1.0f, 0};
+
+	logger << "pipeline on resize\tresizes\tms/resize" << std::endl;
+	for( const bool rebuildPipeline : { false, true } ){
+		OffscreenTarget target = initOffscreenTarget( context, screenWidth, screenHeight );
+		VkPipeline pipeline = initPipeline( device, context.physicalDeviceProperties.limits, pipelineLayout, target.renderPass, vertexShader, fragmentShader, vertexBufferBinding );
+
+		double milliseconds = 0.0;
+		for( uint32_t round = 0; round < rounds; ++round ){
+			for( const VkExtent2D size : sizes ){
+				const auto resizeStart = std::chrono::high_resolution_clock::now();
+
+				// all targets have the same formats, so their render passes are compatible with the one the pipeline was created for
+				killOffscreenTarget( device, target );
+				target = initOffscreenTarget( context, size.width, size.height );
+				if( rebuildPipeline ){
+					killPipeline( device, pipeline );
+					pipeline = initPipeline( device, context.physicalDeviceProperties.limits, pipelineLayout, target.renderPass, vertexShader, fragmentShader, vertexBufferBinding );
+				}
+
+				// clear only: what gets drawn does not depend on how the size change is handled
+				{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+				beginCommandBuffer( commandBuffer );
+					recordBeginRenderPass( commandBuffer, target.renderPass, target.framebuffers[0], clearValues.data(), target.width, target.height );
+						recordBindPipeline( commandBuffer, pipeline );
+					recordEndRenderPass( commandBuffer );
+				endCommandBuffer( commandBuffer );
+				submitAndWait( device, context.graphicsQueue, commandBuffer, fence );
+
+				milliseconds += std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - resizeStart ).count();
+			}
+		}
+
+		const size_t resizes = rounds * sizes.size();
+		logger << (rebuildPipeline ? "rebuilt" : "kept") << "\t" << resizes << "\t" << milliseconds / resizes << std::endl;
+
+		killPipeline( device, pipeline );
+		killOffscreenTarget( device, target );
+	}
+
+	killFence( device, fence );
+	killShaderModule( device, fragmentShader );
+	killShaderModule( device, vertexShader );
+	killPipelineLayout( device, pipelineLayout );
+	vkDestroyDescriptorSetLayout( device, descriptorSetLayout, nullptr );
+
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// A frame that suddenly needs many pipeline states (new materials coming into view), each drawing one cube: created on the
+// frame that needs them vs. requested from the pipeline registry, drawn with the default pipeline until they are ready.
+// Frames are rendered until every cube is drawn with its own pipeline. Registry first: a driver shader cache (Mesa's)
+// makes the second run's creations cheaper, which favours the synchronous one.
+int benchmarkPipelineRegistry(){
+	const uint32_t vertexBufferBinding = 0;
+	const uint32_t maxFrames = 10000;
+
+	const IndexedMesh cube = indexMesh( ::cubeVertices );
+	const uint32_t indexCount = static_cast<uint32_t>( cube.indices.size() );
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+	HeadlessScene scene = initHeadlessScene( context, cube, benchmarkPipelineStateCount );
+	const RenderPassCompatibility compatibility{ VK_FORMAT_R8G8B8A8_UNORM, findDepthFormat( context.physicalDevice ), VK_SAMPLE_COUNT_1_BIT, 0 }; // = initOffscreenTarget()
+
+	GraphicsPipelineState defaultState = getDefaultPipelineState( scene.pipelineLayout, scene.target.renderPass, scene.vertexShader, scene.fragmentShader, vertexBufferBinding );
+	defaultState.compatibility = compatibility;
+	const vector<GraphicsPipelineState> states = getBenchmarkPipelineStates( defaultState );
+	const uint32_t objectCount = static_cast<uint32_t>( states.size() );
+	setObjectData(  device, scene.objectBufferMemory, generateObjects( generateInstanceTransforms( objectCount ), scene.boundingSphere )  );
+
+	// getObjectPipeline( i ) draws object i, VK_NULL_HANDLE skips it; returns the milliseconds from recording to the end of the frame on the GPU
+	const auto renderFrame = [&]( const std::function<VkPipeline( uint32_t )>& getObjectPipeline ){
+		const auto frameStart = std::chrono::high_resolution_clock::now();
+
+		{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+		beginCommandBuffer( scene.commandBuffer );
+			recordBeginRenderPass( scene.commandBuffer, scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+				recordBindVertexBuffer( scene.commandBuffer, vertexBufferBinding, scene.vertexBuffer );
+				recordBindIndexBuffer( scene.commandBuffer, scene.indexBuffer );
+				vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &scene.descriptorSet, 0, nullptr );
+				for( uint32_t i = 0; i < objectCount; ++i ){
+					const VkPipeline pipeline = getObjectPipeline( i );
+					if( !pipeline ) continue;
+
+					recordBindPipeline( scene.commandBuffer, pipeline );
+					vkCmdDrawIndexed( scene.commandBuffer, indexCount, 1, 0, 0, i /*first instance = object index*/ );
+				}
+			recordEndRenderPass( scene.commandBuffer );
+		endCommandBuffer( scene.commandBuffer );
+		submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+
+		return std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - frameStart ).count();
+	};
+
+	logger << "creation\tstates\trequests\tpipelines\tframes until all drawn\tworst frame ms\tmean frame ms" << std::endl;
+
+	// every state requested twice, as two objects sharing a material would; the registry creates each once
+	// (the first state is the default one, so that is shared too)
+	{
+		PipelineRegistry registry = initPipelineRegistry( device, context.physicalDeviceProperties.limits, VK_NULL_HANDLE );
+		const uint64_t defaultKey = requestPipeline( registry, defaultState );
+		waitForPipeline( registry, defaultKey );
+
+		double worstFrame = 0.0, frameSum = 0.0;
+		uint32_t frames = 0;
+		vector<uint64_t> keys( objectCount );
+		bool allDrawn = false;
+		while( !allDrawn && frames < maxFrames ){
+			const auto frameStart = std::chrono::high_resolution_clock::now();
+			if( frames == 0 ){
+				for( uint32_t i = 0; i < objectCount; ++i ) keys[i] = requestPipeline( registry, states[i] );
+				for( uint32_t i = 0; i < objectCount; ++i ) requestPipeline( registry, states[i] );
+			}
+			updatePipelineRegistry( registry );
+			allDrawn = std::all_of( keys.begin(), keys.end(), [&]( const uint64_t key ){ return getPipeline( registry, key ) != VK_NULL_HANDLE; } );
+			const double requestMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - frameStart ).count();
+
+			const double frame = requestMilliseconds + renderFrame( [&]( const uint32_t i ){ return getPipelineOr( registry, keys[i], defaultKey ); } );
+			worstFrame = std::max( worstFrame, frame );
+			frameSum += frame;
+			++frames;
+		}
+
+		logger << "registry\t" << objectCount << "\t" << registry.requests - 1 << "\t" << registry.pipelines.size() << "\t" << frames << "\t" << worstFrame << "\t" << frameSum / frames << std::endl;
+		killPipelineRegistry( registry );
+	}
+
+	{
+		vector<VkPipeline> pipelines;
+		const auto frameStart = std::chrono::high_resolution_clock::now();
+		for( const GraphicsPipelineState& state : states ) pipelines.push_back( initPipeline( device, context.physicalDeviceProperties.limits, state ) );
+		const double creationMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - frameStart ).count();
+
+		const double frame = creationMilliseconds + renderFrame( [&]( const uint32_t i ){ return pipelines[i]; } );
+		logger << "synchronous\t" << objectCount << "\t" << objectCount << "\t" << pipelines.size() << "\t1\t" << frame << "\t" << frame << std::endl;
+
+		for( const VkPipeline pipeline : pipelines ) killPipeline( device, pipeline );
+	}
+
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// 10K cubes drawn one draw each, every one moving every frame; per-draw data through a uniform buffer slice and descriptor set per
+// draw, one dynamic uniform buffer with an offset per draw, or push constants. Prints the CPU time of writing the data and recording.
+int benchmarkPerDrawData(){
+	const uint32_t drawCount = 10000;
+	const uint32_t warmupFrames = 5;
+	const uint32_t measuredFrames = 50;
+	const uint32_t vertexBufferBinding = 0;
+
+	const IndexedMesh cube = indexMesh( ::cubeVertices );
+	const uint32_t indexCount = static_cast<uint32_t>( cube.indices.size() );
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+	const VkPhysicalDeviceLimits& limits = context.physicalDeviceProperties.limits;
+
+	// the scene's descriptor set and object buffer go unused: the draws get their data through one of the modes below
+	HeadlessScene scene = initHeadlessScene( context, cube, 1 );
+
+	// one slice per draw, at the offset alignment uniform buffer descriptors need; mapped for the whole run
+	const VkDeviceSize alignment = limits.minUniformBufferOffsetAlignment;
+	const VkDeviceSize drawDataStride = (sizeof( PerDrawData ) + alignment - 1) / alignment * alignment;
+	VkBuffer drawDataBuffer;
+	VkDeviceMemory drawDataMemory;
+	createBuffer( device, context.physicalDevice, drawDataStride * drawCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, drawDataBuffer, drawDataMemory );
+	uint8_t* drawDataMapping;
+	{VkResult errorCode = vkMapMemory( device, drawDataMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>( &drawDataMapping ) ); RESULT_HANDLER( errorCode, "vkMapMemory" );}
+
+	const vector<char> pushVertexShaderCode = readFile( "vertexShaderPushConstants.spv" );
+	const vector<char> uniformVertexShaderCode = readFile( "vertexShaderPerDrawUniform.spv" );
+	const vector<char> fragmentShaderCode = readFile( "fragmentShader.spv" );
+	VkShaderModule pushVertexShader = createShaderModule( device, pushVertexShaderCode );
+	VkShaderModule uniformVertexShader = createShaderModule( device, uniformVertexShaderCode );
+
+	// the layouts are the reflected ones; the dynamic variant differs only in the type of the uniform buffer, which SPIR-V does not say
+	const ShaderReflection fragmentReflection = reflectSpirv( fragmentShaderCode );
+	const ShaderReflection pushReflection = mergeShaderReflections( { reflectSpirv( pushVertexShaderCode ), fragmentReflection } );
+	const ShaderReflection uniformReflection = mergeShaderReflections( { reflectSpirv( uniformVertexShaderCode ), fragmentReflection } );
+	ShaderReflection dynamicReflection = uniformReflection;
+	for( ReflectedBinding& binding : dynamicReflection.bindings ){
+		if( binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ) binding.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	}
+	if( pushReflection.pushConstantRanges.empty() || pushReflection.pushConstantRanges[0].size > limits.maxPushConstantsSize ){
+		throw "vertexShaderPushConstants.spv does not fit into the push constants of the device!";
+	}
+
+	DescriptorLayoutCache layoutCache;
+	enum class Mode{ Uniform, DynamicUniform, PushConstants };
+	struct ModeResources{
+		Mode mode;
+		const char* name;
+		const ShaderReflection& reflection;
+		VkShaderModule vertexShader;
+		VkPipelineLayout pipelineLayout;
+		VkPipeline pipeline;
+		VkDescriptorPool descriptorPool;
+		vector<VkDescriptorSet> descriptorSets; // one per draw, or one
+	};
+	vector<ModeResources> modes = {
+		{ Mode::Uniform, "ubo", uniformReflection, uniformVertexShader },
+		{ Mode::DynamicUniform, "dynamic ubo", dynamicReflection, uniformVertexShader },
+		{ Mode::PushConstants, "push constants", pushReflection, pushVertexShader }
+	};
+	for( ModeResources& resources : modes ){
+		resources.pipelineLayout = getReflectedPipelineLayout( device, layoutCache, resources.reflection );
+		resources.pipeline = initPipeline(
+			device,
+			limits,
+			getDefaultPipelineState( resources.pipelineLayout, scene.target.renderPass, resources.vertexShader, scene.fragmentShader, vertexBufferBinding )
+		);
+
+		const uint32_t setCount = resources.mode == Mode::Uniform ? drawCount : 1;
+		resources.descriptorPool = createDescriptorPool( device, getDescriptorPoolSizes( resources.reflection, setCount ), setCount );
+		const vector<VkDescriptorSetLayout> setLayouts(  setCount, getDescriptorSetLayout( device, layoutCache, getDescriptorSetLayoutBindings( resources.reflection, 0 ) )  );
+		const VkDescriptorSetAllocateInfo allocateInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, nullptr, resources.descriptorPool, setCount, setLayouts.data() };
+		resources.descriptorSets.resize( setCount );
+		{VkResult errorCode = vkAllocateDescriptorSets( device, &allocateInfo, resources.descriptorSets.data() ); RESULT_HANDLER( errorCode, "vkAllocateDescriptorSets" );}
+
+		// binding 0 = the draw's slice (the dynamic offset adds to offset 0), binding 1 = the texture
+		for( uint32_t i = 0; i < setCount; ++i ){
+			const VkDescriptorBufferInfo drawDataInfo{ drawDataBuffer, i * drawDataStride, sizeof( PerDrawData ) };
+			const VkDescriptorImageInfo imageInfo{ scene.textureSampler, scene.textureImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			vector<VkWriteDescriptorSet> writes;
+			for( const ReflectedBinding& binding : resources.reflection.bindings ){
+				VkWriteDescriptorSet write{};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = resources.descriptorSets[i];
+				write.dstBinding = binding.binding;
+				write.descriptorCount = 1;
+				write.descriptorType = binding.type;
+				if( binding.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ) write.pImageInfo = &imageInfo;
+				else write.pBufferInfo = &drawDataInfo;
+				writes.push_back( write );
+			}
+			vkUpdateDescriptorSets( device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+		}
+	}
+
+	const vector<glm::mat4> transforms = generateInstanceTransforms( drawCount );
+	glm::mat4 projection = glm::perspective( glm::radians( 45.0f ), float( scene.target.width ) / float( scene.target.height ), 0.1f, 100.0f );
+	projection[1][1] *= -1; // Invert Y coordinate for Vulkan
+	const glm::mat4 view = glm::translate( glm::mat4( 1.0f ), glm::vec3( 0.0f, 0.0f, -6.0f ) );
+
+	// the data of every draw changes every frame, and the command buffer is recorded anew -- the cost of a scene where everything moves
+	const auto recordFrame = [&]( const ModeResources& resources, const uint32_t frame ){
+		const glm::mat4 viewProjection = projection * glm::rotate( view, frame * glm::radians( 1.0f ), glm::vec3( 0.5f, 1.0f, 0.4f ) );
+		const auto getDrawData = [&]( const uint32_t i ){
+			return PerDrawData{ viewProjection * transforms[i], glm::vec4( 1.0f, 1.0f, 0.0f, 0.0f ), 0 };
+		};
+
+		if( resources.mode != Mode::PushConstants ){
+			for( uint32_t i = 0; i < drawCount; ++i ){
+				const PerDrawData drawData = getDrawData( i );
+				std::memcpy( drawDataMapping + i * drawDataStride, &drawData, sizeof( drawData ) );
+			}
+		}
+
+		{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+		beginCommandBuffer( scene.commandBuffer );
+			if( scene.gpuTimestamps ){
+				vkCmdResetQueryPool( scene.commandBuffer, scene.queryPool, 0, 2 );
+				vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, scene.queryPool, 0 );
+			}
+
+			recordBeginRenderPass( scene.commandBuffer, scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+				recordBindPipeline( scene.commandBuffer, resources.pipeline );
+				recordBindVertexBuffer( scene.commandBuffer, vertexBufferBinding, scene.vertexBuffer );
+				recordBindIndexBuffer( scene.commandBuffer, scene.indexBuffer );
+				if( resources.mode == Mode::PushConstants ){
+					vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, resources.pipelineLayout, 0, 1, &resources.descriptorSets[0], 0, nullptr );
+				}
+				for( uint32_t i = 0; i < drawCount; ++i ){
+					if( resources.mode == Mode::Uniform ){
+						vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, resources.pipelineLayout, 0, 1, &resources.descriptorSets[i], 0, nullptr );
+					}
+					else if( resources.mode == Mode::DynamicUniform ){
+						const uint32_t offset = static_cast<uint32_t>( i * drawDataStride );
+						vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, resources.pipelineLayout, 0, 1, &resources.descriptorSets[0], 1, &offset );
+					}
+					else recordPushDrawData( scene.commandBuffer, resources.pipelineLayout, getDrawData( i ) );
+
+					recordDrawIndexed( scene.commandBuffer, indexCount );
+				}
+			recordEndRenderPass( scene.commandBuffer );
+
+			if( scene.gpuTimestamps ) vkCmdWriteTimestamp( scene.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, scene.queryPool, 1 );
+		endCommandBuffer( scene.commandBuffer );
+	};
+
+	logger << "per-draw data\tdraws\tCPU update+record us/frame\twall ms/frame\tGPU ms/frame" << std::endl;
+	for( const ModeResources& resources : modes ){
+		for( uint32_t frame = 0; frame < warmupFrames; ++frame ){
+			recordFrame( resources, frame );
+			submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+		}
+
+		double recordMicroseconds = 0.0;
+		double wallMilliseconds = 0.0;
+		double gpuMilliseconds = 0.0;
+		for( uint32_t frame = 0; frame < measuredFrames; ++frame ){
+			const auto frameStart = std::chrono::high_resolution_clock::now();
+			recordFrame( resources, warmupFrames + frame );
+			const auto recordEnd = std::chrono::high_resolution_clock::now();
+			submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+			const auto frameEnd = std::chrono::high_resolution_clock::now();
+
+			recordMicroseconds += std::chrono::duration<double, std::micro>( recordEnd - frameStart ).count();
+			wallMilliseconds += std::chrono::duration<double, std::milli>( frameEnd - frameStart ).count();
+			if( scene.gpuTimestamps ) gpuMilliseconds += getTimestampDelta( device, scene.queryPool, 0, limits.timestampPeriod );
+		}
+		recordMicroseconds /= measuredFrames;
+		wallMilliseconds /= measuredFrames;
+		gpuMilliseconds /= measuredFrames;
+
+		logger << resources.name << "\t" << drawCount << "\t" << recordMicroseconds << "\t" << wallMilliseconds << "\t" << (scene.gpuTimestamps ? to_string( gpuMilliseconds ) : string( "n/a" )) << std::endl;
+	}
+
+	for( const ModeResources& resources : modes ){
+		killPipeline( device, resources.pipeline );
+		vkDestroyDescriptorPool( device, resources.descriptorPool, nullptr );
+	}
+	killDescriptorLayoutCache( device, layoutCache );
+	killShaderModule( device, uniformVertexShader );
+	killShaderModule( device, pushVertexShader );
+
+	vkUnmapMemory( device, drawDataMemory );
+	killBuffer( device, drawDataBuffer );
+	killMemory( device, drawDataMemory );
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// Two frames in flight, each getting a descriptor set per draw for 1K to 10K draws (over a few textures) and drawing with them:
+// allocated and written out of per-frame DescriptorAllocators reset wholesale once the frame's fence signaled, out of one pool
+// the frame's sets are freed back into one by one (VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT), or looked up in a
+// DescriptorSetCache. Prints the sets, descriptor set writes and pools per frame and the CPU time.
+int benchmarkDescriptorAllocator(){
+	const vector<uint32_t> drawCounts = { 1000, 10000 };
+	const uint32_t textureCount = 8; // views of one image, as separate textures would be to the descriptors
+	const uint32_t framesInFlight = 2;
+	const uint32_t warmupFrames = 5;
+	const uint32_t measuredFrames = 50;
+	const uint32_t vertexBufferBinding = 0;
+
+	const IndexedMesh cube = indexMesh( ::cubeVertices );
+	const uint32_t indexCount = static_cast<uint32_t>( cube.indices.size() );
+
+	HeadlessContext context = initHeadless();
+	const VkDevice device = context.device;
+
+	HeadlessScene scene = initHeadlessScene( context, cube, drawCounts.back() );
+	setObjectData(  device, scene.objectBufferMemory, generateObjects( generateInstanceTransforms( drawCounts.back() ), scene.boundingSphere )  );
+
+	vector<VkImageView> textureImageViews;
+	for( uint32_t i = 0; i < textureCount; ++i ) textureImageViews.push_back( createTextureImageView( device, scene.texture ) );
+
+	const vector<VkDescriptorPoolSize> setSizes = { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 }, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 } };
+	// = writeDescriptorSet()
+	const auto getBindings = [&]( const uint32_t draw ){
+		return vector<DescriptorBinding>{
+			{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, scene.uniformBuffer, 0, sizeof( UniformBufferObject ), VK_NULL_HANDLE, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED },
+			{ 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_NULL_HANDLE, 0, 0, textureImageViews[draw % textureCount], scene.textureSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+			{ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, scene.objectBuffer, 0, VK_WHOLE_SIZE, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED }
+		};
+	};
+
+	VkPipeline pipeline = initPipeline( device, context.physicalDeviceProperties.limits, scene.pipelineLayout, scene.target.renderPass, scene.vertexShader, scene.fragmentShader, vertexBufferBinding );
+
+	// a command pool, command buffer and fence per frame in flight, as the swapchain loop in start() has
+	vector<VkCommandPool> commandPools;
+	vector<VkCommandBuffer> commandBuffers;
+	for( uint32_t frame = 0; frame < framesInFlight; ++frame ){
+		commandPools.push_back( initCommandPool( device, context.graphicsQueueFamily ) );
+		vector<VkCommandBuffer> frameCommandBuffers;
+		acquireCommandBuffers( device, commandPools.back(), 1, frameCommandBuffers );
+		commandBuffers.push_back( frameCommandBuffers[0] );
+	}
+	vector<VkFence> fences = initFences( device, framesInFlight, VK_FENCE_CREATE_SIGNALED_BIT );
+
+	const auto recordAndSubmit = [&]( const uint32_t frame, const vector<VkDescriptorSet>& descriptorSets ){
+		{VkResult errorCode = vkResetCommandPool( device, commandPools[frame], 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+		beginCommandBuffer( commandBuffers[frame] );
+			recordBeginRenderPass( commandBuffers[frame], scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+				recordBindPipeline( commandBuffers[frame], pipeline );
+				recordBindVertexBuffer( commandBuffers[frame], vertexBufferBinding, scene.vertexBuffer );
+				recordBindIndexBuffer( commandBuffers[frame], scene.indexBuffer );
+				for( uint32_t i = 0; i < descriptorSets.size(); ++i ){
+					vkCmdBindDescriptorSets( commandBuffers[frame], VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr );
+					vkCmdDrawIndexed( commandBuffers[frame], indexCount, 1, 0, 0, i /*first instance = object index*/ );
+				}
+			recordEndRenderPass( commandBuffers[frame] );
+		endCommandBuffer( commandBuffers[frame] );
+
+		const VkSubmitInfo submit{ VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr, 0, nullptr, nullptr, 1, &commandBuffers[frame], 0, nullptr };
+		{VkResult errorCode = vkQueueSubmit( context.graphicsQueue, 1, &submit, fences[frame] ); RESULT_HANDLER( errorCode, "vkQueueSubmit" );}
+	};
+
+	enum class Mode{ FrameAllocators, FreeSets, SetCache };
+	logger << "sets\tdraws\tsets/frame\twrites/frame\tpools\tCPU release us/frame\tCPU get sets us/frame\twall ms/frame" << std::endl;
+	for( const uint32_t drawCount : drawCounts ){
+		for( const Mode mode : { Mode::FrameAllocators, Mode::FreeSets, Mode::SetCache } ){
+			// the frame allocators and the cache start with no pools and grow to what they need; the other pool is sized for all frames up front
+			vector<DescriptorAllocator> allocators;
+			VkDescriptorPool freeingPool = VK_NULL_HANDLE;
+			DescriptorSetCache cache = initDescriptorSetCache( device, setSizes, ::staticDescriptorSetsPerPool );
+			if( mode == Mode::FrameAllocators ){
+				for( uint32_t frame = 0; frame < framesInFlight; ++frame ) allocators.push_back( initDescriptorAllocator( device, setSizes, ::frameDescriptorSetsPerPool ) );
+			}
+			else if( mode == Mode::FreeSets ){
+				vector<VkDescriptorPoolSize> poolSizes = setSizes;
+				for( VkDescriptorPoolSize& size : poolSizes ) size.descriptorCount *= framesInFlight * drawCount;
+				VkDescriptorPoolCreateInfo poolInfo{};
+				poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+				poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+				poolInfo.maxSets = framesInFlight * drawCount;
+				poolInfo.poolSizeCount = static_cast<uint32_t>( poolSizes.size() );
+				poolInfo.pPoolSizes = poolSizes.data();
+				{VkResult errorCode = vkCreateDescriptorPool( device, &poolInfo, nullptr, &freeingPool ); RESULT_HANDLER( errorCode, "vkCreateDescriptorPool" );}
+			}
+			vector<vector<VkDescriptorSet>> frameSets( framesInFlight );
+
+			double releaseMicroseconds = 0.0;
+			double allocateMicroseconds = 0.0;
+			double wallMilliseconds = 0.0;
+			uint32_t setsPerFrame = 0;
+			uint32_t writes = 0;
+			for( uint32_t frameNumber = 0; frameNumber < warmupFrames + measuredFrames; ++frameNumber ){
+				const uint32_t frame = frameNumber % framesInFlight;
+				const auto frameStart = std::chrono::high_resolution_clock::now();
+
+				// the frame's previous sets are free to go once its fence signaled; cached sets stay
+				{VkResult errorCode = vkWaitForFences( device, 1, &fences[frame], VK_TRUE, UINT64_MAX ); RESULT_HANDLER( errorCode, "vkWaitForFences" );}
+				{VkResult errorCode = vkResetFences( device, 1, &fences[frame] ); RESULT_HANDLER( errorCode, "vkResetFences" );}
+				const auto releaseStart = std::chrono::high_resolution_clock::now();
+				if( mode == Mode::FrameAllocators ) resetDescriptorAllocator( allocators[frame] );
+				else if( mode == Mode::FreeSets && !frameSets[frame].empty() ){
+					VkResult errorCode = vkFreeDescriptorSets( device, freeingPool, static_cast<uint32_t>( frameSets[frame].size() ), frameSets[frame].data() ); RESULT_HANDLER( errorCode, "vkFreeDescriptorSets" );
+				}
+				const auto allocateStart = std::chrono::high_resolution_clock::now();
+
+				const uint32_t missesBefore = cache.misses;
+				frameSets[frame].resize( drawCount );
+				for( uint32_t i = 0; i < drawCount; ++i ){
+					if( mode == Mode::FrameAllocators ) frameSets[frame][i] = createDescriptorSet( scene.uniformBuffer, textureImageViews[i % textureCount], scene.textureSampler, scene.objectBuffer, scene.descriptorSetLayout, allocators[frame] );
+					else if( mode == Mode::FreeSets ) frameSets[frame][i] = createDescriptorSet( scene.uniformBuffer, textureImageViews[i % textureCount], scene.textureSampler, scene.objectBuffer, scene.descriptorSetLayout, freeingPool, device );
+					else frameSets[frame][i] = getCachedDescriptorSet( cache, scene.descriptorSetLayout, getBindings( i ) );
+				}
+				const auto allocateEnd = std::chrono::high_resolution_clock::now();
+				if( mode == Mode::FrameAllocators ) setsPerFrame = allocators[frame].allocatedSets;
+				else if( mode == Mode::FreeSets ) setsPerFrame = drawCount;
+				else setsPerFrame = static_cast<uint32_t>( cache.entries.size() );
+
+				recordAndSubmit( frame, frameSets[frame] );
+
+				if( frameNumber >= warmupFrames ){
+					writes += mode == Mode::SetCache ? cache.misses - missesBefore : drawCount;
+					releaseMicroseconds += std::chrono::duration<double, std::micro>( allocateStart - releaseStart ).count();
+					allocateMicroseconds += std::chrono::duration<double, std::micro>( allocateEnd - allocateStart ).count();
+					wallMilliseconds += std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - frameStart ).count();
+				}
+			}
+			{VkResult errorCode = vkQueueWaitIdle( context.graphicsQueue ); RESULT_HANDLER( errorCode, "vkQueueWaitIdle" );}
+
+			uint32_t pools = 1;
+			if( mode == Mode::FrameAllocators ){
+				pools = 0;
+				for( DescriptorAllocator& allocator : allocators ){
+					pools += getDescriptorPoolCount( allocator );
+					killDescriptorAllocator( allocator );
+				}
+			}
+			else if( mode == Mode::FreeSets ) vkDestroyDescriptorPool( device, freeingPool, nullptr );
+			else pools = getDescriptorPoolCount( cache.allocator );
+
+			const char* modeName = mode == Mode::FrameAllocators ? "frame allocators" : mode == Mode::FreeSets ? "free sets" : "set cache";
+			logger << modeName << "\t" << drawCount << "\t" << setsPerFrame << "\t" << double( writes ) / measuredFrames << "\t" << pools << "\t"
+			       << releaseMicroseconds / measuredFrames << "\t" << allocateMicroseconds / measuredFrames << "\t" << wallMilliseconds / measuredFrames << std::endl;
+
+			// as before destroying a texture: its sets go, the others stay cached
+			if( mode == Mode::SetCache ){
+				const size_t cachedSets = cache.entries.size();
+				const uint32_t invalidated = invalidateDescriptorSets( cache, getHandleValue( textureImageViews[0] ) );
+				logger << "set cache: invalidating one texture dropped " << invalidated << " of " << cachedSets << " sets" << std::endl;
+			}
+			killDescriptorSetCache( cache );
+		}
+	}
+
+	killFences( device, fences );
+	for( const VkCommandPool commandPool : commandPools ) killCommandPool( device, commandPool );
+
+	killPipeline( device, pipeline );
+	for( const VkImageView textureImageView : textureImageViews ) killImageView( device, textureImageView );
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
+
+// Pipeline states needed on the frame they are first used, one more cube with a new state per frame: created monolithically
+// on that frame vs. linked from pipeline libraries, the optimized link made in the background -- with the parts created on
+// first use, or all at load. Prints the first-use hitch (worst and mean frame while states are new) and the frames until
+// every cube drew with an optimized pipeline. Libraries first: a driver shader cache (Mesa's) favours the later runs.
+int benchmarkPipelineLibrary(){
+	const uint32_t vertexBufferBinding = 0;
+	const uint32_t maxFrames = 10000;
+
+	const IndexedMesh cube = indexMesh( ::cubeVertices );
+	const uint32_t indexCount = static_cast<uint32_t>( cube.indices.size() );
+
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures{};
+	const void* extensionFeatures = nullptr;
+	HeadlessContext context = initHeadless(  [&]( VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures&, vector<const char*>& deviceExtensions ){
+		if( requestPipelineLibrarySupport( physicalDevice, {}, libraryFeatures, deviceExtensions ) ) extensionFeatures = &libraryFeatures;
+	}, extensionFeatures  );
+	const bool pipelineLibraries = extensionFeatures != nullptr;
+	const VkDevice device = context.device;
+	HeadlessScene scene = initHeadlessScene( context, cube, benchmarkPipelineStateCount );
+	const RenderPassCompatibility compatibility{ VK_FORMAT_R8G8B8A8_UNORM, findDepthFormat( context.physicalDevice ), VK_SAMPLE_COUNT_1_BIT, 0 }; // = initOffscreenTarget()
+
+	GraphicsPipelineState defaultState = getDefaultPipelineState( scene.pipelineLayout, scene.target.renderPass, scene.vertexShader, scene.fragmentShader, vertexBufferBinding );
+	defaultState.compatibility = compatibility;
+	// 108 pipelines out of 1 vertex input, 9 pre-rasterization, 18 fragment shader and 2 output parts
+	const vector<GraphicsPipelineState> states = getBenchmarkPipelineStates( defaultState );
+	const uint32_t objectCount = static_cast<uint32_t>( states.size() );
+	setObjectData(  device, scene.objectBufferMemory, generateObjects( generateInstanceTransforms( objectCount ), scene.boundingSphere )  );
+
+	// draws the first keys.size() cubes, each with its pipeline from the registry
+	const auto renderFrame = [&]( const PipelineRegistry& registry, const vector<uint64_t>& keys ){
+		{VkResult errorCode = vkResetCommandPool( device, context.commandPool, 0 ); RESULT_HANDLER( errorCode, "vkResetCommandPool" );}
+		beginCommandBuffer( scene.commandBuffer );
+			recordBeginRenderPass( scene.commandBuffer, scene.target.renderPass, scene.target.framebuffers[0], scene.clearValues.data(), scene.target.width, scene.target.height );
+				recordBindVertexBuffer( scene.commandBuffer, vertexBufferBinding, scene.vertexBuffer );
+				recordBindIndexBuffer( scene.commandBuffer, scene.indexBuffer );
+				vkCmdBindDescriptorSets( scene.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &scene.descriptorSet, 0, nullptr );
+				for( uint32_t i = 0; i < keys.size(); ++i ){
+					recordBindPipeline( scene.commandBuffer, getPipeline( registry, keys[i] ) );
+					vkCmdDrawIndexed( scene.commandBuffer, indexCount, 1, 0, 0, i /*first instance = object index*/ );
+				}
+			recordEndRenderPass( scene.commandBuffer );
+		endCommandBuffer( scene.commandBuffer );
+		submitAndWait( device, context.graphicsQueue, scene.commandBuffer, scene.fence );
+	};
+
+	enum class Mode{ Libraries, PrewarmedLibraries, Monolithic };
+	const char* modeNames[] = { "libraries", "libraries, parts at load", "monolithic" };
+
+	logger << "pipelines\tstates\tparts\tload ms\tworst frame ms\tmean frame ms\tframes until optimized" << std::endl;
+	for( const Mode mode : { Mode::Libraries, Mode::PrewarmedLibraries, Mode::Monolithic } ){
+		if( mode != Mode::Monolithic && !pipelineLibraries ){
+			logger << modeNames[static_cast<int>( mode )] << "\tunsupported" << std::endl;
+			continue;
+		}
+
+		PipelineRegistry registry = initPipelineRegistry( device, context.physicalDeviceProperties.limits, VK_NULL_HANDLE, mode != Mode::Monolithic );
+
+		const auto loadStart = std::chrono::high_resolution_clock::now();
+		if( mode == Mode::PrewarmedLibraries ) for( const GraphicsPipelineState& state : states ) getPipelineLibraries( *registry.libraries, state );
+		const double loadMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - loadStart ).count();
+
+		// a new state every frame, waited for as the cube cannot be drawn without it; then frames until the optimized links replaced the linked ones
+		double worstFrame = 0.0, frameSum = 0.0;
+		uint32_t frames = 0;
+		uint32_t optimized = mode == Mode::Monolithic ? objectCount : 0;
+		vector<uint64_t> keys;
+		while( (keys.size() < objectCount || optimized < objectCount) && frames < maxFrames ){
+			const auto frameStart = std::chrono::high_resolution_clock::now();
+			const bool newState = keys.size() < objectCount;
+			if( newState ){
+				keys.push_back( requestPipeline( registry, states[keys.size()] ) );
+				waitForPipeline( registry, keys.back() );
+			}
+			updatePipelineRegistry( registry );
+
+			renderFrame( registry, keys );
+			optimized += static_cast<uint32_t>( registry.retiredPipelines.size() );
+			killRetiredPipelines( registry ); // the frame finished
+
+			const double frame = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - frameStart ).count();
+			if( newState ){
+				worstFrame = std::max( worstFrame, frame );
+				frameSum += frame;
+			}
+			++frames;
+		}
+
+		const size_t parts = registry.libraries ? registry.libraries->parts.size() : 0;
+		logger << modeNames[static_cast<int>( mode )] << "\t" << objectCount << "\t" << parts << "\t" << loadMilliseconds << "\t" << worstFrame << "\t" << frameSum / objectCount << "\t" << frames << std::endl;
+		killPipelineRegistry( registry );
+	}
+
+	killHeadlessScene( device, scene );
+	killHeadless( context );
+
+	return EXIT_SUCCESS;
+}
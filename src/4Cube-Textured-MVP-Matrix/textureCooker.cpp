@@ -0,0 +1,136 @@
+// Offline texture cooker: BMP/TGA in, GPU-ready KTX2 out (full mip chain, BC1 or BC3 sRGB), so createTextureImage()
+// only copies the levels into the image at runtime. Needs no Vulkan or SDL.
+// Incremental: the hash of the source and the cooking settings is stored in the output, unchanged inputs are skipped.
+// Files are cooked in parallel; with fewer files than threads, each file's filtering and encoding is split up as well.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ImageDecoder.h"
+#include "Ktx2.h"
+#include "TextureCooker.h"
+
+// bump when the cooked output changes for the same input, so stale files are cooked again
+constexpr const char* cookerVersion = "1";
+constexpr const char* sourceHashKey = "textureCooker.sourceHash";
+
+std::vector<uint8_t> readBinaryFile( const std::string& path ){
+	std::ifstream file( path, std::ios::binary | std::ios::ate );
+	if( !file ) return {};
+
+	std::vector<uint8_t> bytes( static_cast<size_t>( file.tellg() ) );
+	file.seekg( 0 );
+	file.read( reinterpret_cast<char*>( bytes.data() ), bytes.size() );
+	return bytes;
+}
+
+// FNV-1a 64
+uint64_t hashBytes( const uint8_t* bytes, const size_t size, uint64_t hash = 0xCBF29CE484222325ull ){
+	for( size_t i = 0; i < size; ++i ) hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	return hash;
+}
+
+std::string getOutputPath( const std::string& inputPath ){
+	const size_t dot = inputPath.find_last_of( '.' );
+	const size_t slash = inputPath.find_last_of( "/\\" );
+	const bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+	return (hasExtension ? inputPath.substr( 0, dot ) : inputPath) + ".ktx2";
+}
+
+struct CookResult{
+	bool skipped;
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+};
+
+CookResult cookTexture( const std::string& inputPath, const std::string& outputPath, const MipFilter filter, const bool force, const unsigned threadCount ){
+	const std::vector<uint8_t> input = readBinaryFile( inputPath );
+	if( input.empty() ) throw "cannot read the input file!";
+
+	const std::string settings = std::string( cookerVersion ) + (filter == MipFilter::Box ? " box" : " kaiser");
+	const uint64_t hash = hashBytes(  input.data(), input.size(), hashBytes( reinterpret_cast<const uint8_t*>( settings.data() ), settings.size() )  );
+	char hashText[17];
+	std::snprintf( hashText, sizeof( hashText ), "%016llx", static_cast<unsigned long long>( hash ) );
+
+	if( !force ){
+		const std::vector<uint8_t> previous = readBinaryFile( outputPath );
+		std::string previousHash;
+		if( readKtx2Value( previous.data(), previous.size(), sourceHashKey, previousHash ) && previousHash == hashText ) return { true, VK_FORMAT_UNDEFINED, 0, 0, 0 };
+	}
+
+	ImageHeader header;
+	if( !readImageHeader( input.data(), input.size(), header ) ) throw "unsupported image -- uncompressed 24/32 bit BMP or TGA only!";
+
+	std::vector<uint8_t> rgba( size_t( header.width ) * header.height * 4 );
+	decodeImage( input.data(), header, rgba.data() );
+
+	const std::vector<uint8_t> output = cookKtx2(  rgba.data(), header.width, header.height, filter, threadCount, { { sourceHashKey, hashText } }  );
+	std::ofstream file( outputPath, std::ios::binary | std::ios::trunc );
+	file.write( reinterpret_cast<const char*>( output.data() ), output.size() );
+	if( !file ) throw "cannot write the output file!";
+
+	Ktx2Header cooked;
+	if( !readKtx2Header( output.data(), output.size(), cooked ) ) throw "the cooked KTX2 file does not read back!";
+	return { false, cooked.format, cooked.width, cooked.height, cooked.levelCount };
+}
+
+int main( int argc, char* argv[] ){
+	MipFilter filter = MipFilter::Kaiser;
+	bool force = false;
+	unsigned threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+	std::vector<std::string> inputs;
+
+	for( int i = 1; i < argc; ++i ){
+		const std::string argument = argv[i];
+		if( argument == "--filter=box" ) filter = MipFilter::Box;
+		else if( argument == "--filter=kaiser" ) filter = MipFilter::Kaiser;
+		else if( argument == "--force" ) force = true;
+		else if( argument.rfind( "--threads=", 0 ) == 0 ) threadCount = std::max(  1, std::atoi( argument.c_str() + 10 )  );
+		else if( argument.rfind( "--", 0 ) == 0 ){
+			std::cerr << "unknown option " << argument << std::endl;
+			inputs.clear();
+			break;
+		}
+		else inputs.push_back( argument );
+	}
+	if( inputs.empty() ){
+		std::cerr << "usage: textureCooker.app [--filter=kaiser|box] [--threads=N] [--force] image.bmp|image.tga..." << std::endl;
+		std::cerr << "writes image.ktx2 next to every input" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const uint32_t fileCount = static_cast<uint32_t>( inputs.size() );
+	const unsigned fileThreads = std::min<unsigned>( threadCount, fileCount );
+	const unsigned threadsPerFile = std::max( 1u, threadCount / fileThreads );
+
+	std::mutex outputMutex;
+	std::atomic<uint32_t> failures( 0 );
+	parallelFor( fileCount, fileThreads, [&]( const uint32_t i ){
+		const std::string outputPath = getOutputPath( inputs[i] );
+		const auto start = std::chrono::high_resolution_clock::now();
+		try{
+			const CookResult result = cookTexture( inputs[i], outputPath, filter, force, threadsPerFile );
+			const double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+
+			std::lock_guard<std::mutex> lock( outputMutex );
+			if( result.skipped ) std::cout << inputs[i] << ": up to date" << std::endl;
+			else std::cout << inputs[i] << " -> " << outputPath << ": " << result.width << "x" << result.height << ", " << result.levelCount << " levels, "
+				<< (result.format == VK_FORMAT_BC3_SRGB_BLOCK ? "BC3" : "BC1") << ", " << milliseconds << " ms" << std::endl;
+		}
+		catch( const char* e ){
+			++failures;
+			std::lock_guard<std::mutex> lock( outputMutex );
+			std::cerr << "ERROR: " << inputs[i] << ": " << e << std::endl;
+		}
+	} );
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,15 +1,60 @@
 #version 450
+// build.sh compiles this three times: as is, and with -DPER_DRAW_PUSH_CONSTANTS or -DPER_DRAW_UNIFORM for the per-draw data
+// path (PerDrawData in main.cpp), where every draw carries its own transform instead of indexing the object buffer
 
 layout (location = 0) in vec3 inPos;
 layout (location = 1) in vec2 inUV;
 
+#if defined(PER_DRAW_PUSH_CONSTANTS) || defined(PER_DRAW_UNIFORM)
+// = PerDrawData in main.cpp
+#ifdef PER_DRAW_PUSH_CONSTANTS
+layout(push_constant) uniform PerDrawData {
+#else
+layout(binding = 0) uniform PerDrawData { // a (dynamic) uniform buffer, one slice per draw
+#endif
+    mat4 mvp;
+    vec4 uvTransform;
+    uint textureIndex;
+} draw;
+#else
+// = ShaderVariant::instancing in main.cpp (a specialization constant, set per pipeline)
+layout(constant_id = 0) const bool instancing = true;
+
 layout(binding = 0) uniform UniformBufferObject {
     mat4 mvp;
 } ubo;
 
+struct ObjectData {
+    mat4 model;
+    vec4 boundingSphere; // only used by cullObjects.comp
+    vec4 uvTransform; // xy = scale, zw = offset into a texture array layer (TexturePacker.h)
+    uint textureIndex; // into the bindless texture table or the texture array
+};
+
+// per-object data; gl_InstanceIndex is the object index (instance number, or firstInstance of an indirect draw)
+layout(std430, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+#endif
+
 layout (location = 0) smooth out vec2 outUV;
+layout (location = 1) flat out uint outTextureIndex;
 
 void main(){
-	outUV = inUV;
-	gl_Position = ubo.mvp * vec4(inPos, 1.0);
+#if defined(PER_DRAW_PUSH_CONSTANTS) || defined(PER_DRAW_UNIFORM)
+	outUV = inUV * draw.uvTransform.xy + draw.uvTransform.zw;
+	outTextureIndex = draw.textureIndex;
+	gl_Position = draw.mvp * vec4(inPos, 1.0);
+#else
+	if (instancing) {
+		outUV = inUV * objects[gl_InstanceIndex].uvTransform.xy + objects[gl_InstanceIndex].uvTransform.zw;
+		outTextureIndex = objects[gl_InstanceIndex].textureIndex;
+		gl_Position = ubo.mvp * objects[gl_InstanceIndex].model * vec4(inPos, 1.0);
+	}
+	else {
+		outUV = inUV;
+		outTextureIndex = 0;
+		gl_Position = ubo.mvp * vec4(inPos, 1.0);
+	}
+#endif
 }
@@ -0,0 +1,56 @@
+#version 450
+// Virtual texturing (VirtualTexture.h, VirtualTexture in main.cpp); build.sh compiles this three times:
+// as is: pages come out of a texture of physical page slots, found through the indirection
+// with -DSPARSE_RESIDENCY: samples the sparse virtual image itself, the indirection only tells the finest resident level
+// with -DFEEDBACK: writes the page each pixel wants into the (smaller) feedback target, for the next frame's page requests
+
+// = virtualTexturePageSize, virtualTexturePageBorder and virtualTextureFeedbackScale in main.cpp
+const float pageSize = 128.0;
+const float pageBorder = 4.0;
+const float feedbackScale = 8.0;
+
+layout (location = 0) smooth in vec2 uv;
+
+layout(set = 0, binding = 1) uniform sampler2D pages; // the physical page slots, or the sparse virtual image
+layout(set = 0, binding = 3) uniform usampler2D indirection; // per level and page: slot x, slot y, level of the resident page
+
+#ifdef FEEDBACK
+layout (location = 0) out uint outPage;
+#else
+layout (location = 0) out vec4 outColor;
+#endif
+
+// level of the virtual texture the pixel covers, unclamped
+float getLod(){
+	const vec2 texels = uv * vec2(textureSize(indirection, 0)) * pageSize;
+	const vec2 dx = dFdx(texels);
+	const vec2 dy = dFdy(texels);
+	return 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+}
+
+ivec2 getPage(int mip){
+	const ivec2 pagesAtMip = textureSize(indirection, mip);
+	return clamp(ivec2(uv * vec2(pagesAtMip)), ivec2(0), pagesAtMip - 1);
+}
+
+void main(){
+	const int levels = textureQueryLevels(indirection);
+#ifdef FEEDBACK
+	// the feedback target is feedbackScale times smaller, so are the derivatives of the full size pass
+	const int mip = clamp(int(floor(getLod() - log2(feedbackScale))), 0, levels - 1);
+	const uvec2 page = uvec2(getPage(mip));
+	outPage = uint(mip) << 24 | page.y << 12 | page.x;
+#else
+	const float lod = clamp(getLod(), 0.0, float(levels - 1));
+	const uvec4 entry = texelFetch(indirection, getPage(int(lod)), int(lod));
+#ifdef SPARSE_RESIDENCY
+	// where lod is not resident (yet), the finest level that is
+	outColor = textureLod(pages, uv, max(lod, float(entry.z)));
+#else
+	// the resident page may be an ancestor, covering a bigger part of the texture; bilinear within the page, no trilinear
+	const vec2 inPage = fract(uv * vec2(textureSize(indirection, int(entry.z)))) * pageSize;
+	const vec2 slot = vec2(entry.xy) * (pageSize + 2.0 * pageBorder);
+	outColor = textureLod(pages, (slot + pageBorder + inPage) / vec2(textureSize(pages, 0)), 0.0);
+#endif
+#endif
+}